@@ -0,0 +1,58 @@
+#pragma once
+
+#include "algorithms/common/simd.h"
+
+#include <cstddef>
+
+namespace thts {
+    /**
+     * Kernels for computing boltzmann (softmax) weights and log-sum-exps over contiguous arrays of values, used by the
+     * MENTS family of algorithms for action selection and soft backups.
+     *
+     * Given values x_i (typically Q(s,a_i)/temp), 'compute_boltzmann_weights' overwrites each x_i with
+     * exp(x_i - max_j x_j), and returns the sum of these weights. Subtracting the maximum value means that the largest
+     * weight is 1.0, which avoids overflow (see MentsDNode::compute_action_weights). The log-sum-exp of the values is
+     * then 'max_value + log(sum_weights)'.
+     *
+     * On x86 processors the kernels are vectorised with AVX-512 or AVX2 (and FMA) if the processor supports them,
+     * which is checked at runtime, so the library does not need to be compiled with '-mavx2' or similar flags.
+     * Otherwise a scalar implementation is used. The vectorised implementations use a polynomial approximation of exp
+     * that is accurate to a few ulps, so results may differ from the scalar implementation (which uses std::exp) in
+     * the last few bits. Weights for values more than 708 below the maximum value (where exp underflows) are set to
+     * zero.
+     */
+
+    /**
+     * Computes boltzmann weights in place.
+     *
+     * Args:
+     *      values:
+     *          An array of 'n' values, that are overwritten with the weights exp(values[i] - max_value)
+     *      n:
+     *          The number of values
+     *      max_value:
+     *          A double reference to be filled with the maximum of the values (the normalisation term)
+     *      simd_level:
+     *          The instruction set to use, which must be supported by the processor (defaults to
+     *          'get_supported_simd_level()')
+     *
+     * Returns:
+     *      The sum of the weights
+     */
+    double compute_boltzmann_weights(double* values, std::size_t n, double& max_value);
+    double compute_boltzmann_weights(double* values, std::size_t n, double& max_value, SimdLevel simd_level);
+
+    /**
+     * Sets values[i] = scale * values[i] + shift, for each value. Used to normalise weights and mix them with a
+     * uniform distribution.
+     *
+     * Args:
+     *      values: An array of 'n' values to update in place
+     *      n: The number of values
+     *      scale: The amount to multiply each value by
+     *      shift: The amount to add to each value after scaling
+     *      simd_level: The instruction set to use (defaults to 'get_supported_simd_level()')
+     */
+    void scale_and_shift_values(double* values, std::size_t n, double scale, double shift);
+    void scale_and_shift_values(double* values, std::size_t n, double scale, double shift, SimdLevel simd_level);
+}
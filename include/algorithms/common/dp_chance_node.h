@@ -1,7 +1,9 @@
 #pragma once
 
 #include "algorithms/common/dp_decision_node.h"
+#include "algorithms/common/mixin_child_map_view.h"
 
+#include "relaxed_atomic.h"
 #include "thts_types.h"
 #include "thts_chance_node.h"
 #include "thts_decision_node.h"
@@ -11,8 +13,8 @@ namespace thts {
     // forward declare corresponding DPDNode class
     class DPDNode;
 
-    // Typedef for children map
-    typedef std::unordered_map<std::shared_ptr<const Observation>, std::shared_ptr<DPDNode>> DPDNodeChildMap;
+    // Typedef for a view of the children map (see MixinChildMapView)
+    typedef MixinChildMapView<DNodeChildMap,DPDNode> DPDNodeChildMap;
 
     /**
      * An implementation of dynamic programming backups for nodes to use.
@@ -28,8 +30,8 @@ namespace thts {
         friend DPDNode;
 
         protected:
-            int num_backups;
-            double dp_value;
+            RelaxedAtomic<int> num_backups;
+            RelaxedAtomic<double> dp_value;
 
             /**
              * Constructor 
@@ -46,18 +48,18 @@ namespace thts {
              * 
              * I.e. Q(s,a) = R(s,a) + E_{s'}[V(s')]
              * 
-             * Assumes all children are locked.
+             * Reads child statistics without locking the children.
              * 
              * Args:
              *      children: The children map for this node
              *      local_reward: A value for the reward at this node (i.e. R(s,a))
              *      is_opponent: True if this node is acting as an opponent in a two player game
              */
-            void backup_dp_impl(DPDNodeChildMap& children, double local_reward, bool is_opponent);
+            void backup_dp_impl(const DPDNodeChildMap& children, double local_reward, bool is_opponent);
 
 
             /**
-             * Helper to convert children maps into children maps for DP Nodes.
+             * Helper to make a view of a children map, for DPDNodes.
              * 
              * Templated with the top-level class of the ThtsDNode, so that the children can be cast from
              * ThtsDNode -> T -> DPDNode
@@ -66,25 +68,20 @@ namespace thts {
              *      children: A children map for a ThtsCNode, mapping observations to DNodes.
              * 
              * Returns:
-             *      A map from observations to DPDNodes, to be used in backup.
+             *      A view of 'children' as DPDNodes, to be used in recommend_action or backup. The view references 
+             *      'children', and makes no allocations.
              */
             template <typename T>
-            std::shared_ptr<DPDNodeChildMap> convert_child_map(DNodeChildMap& children) const {
-                std::shared_ptr<DPDNodeChildMap> dp_children = std::make_shared<DPDNodeChildMap>();
-                for (std::pair<std::shared_ptr<const Observation>,std::shared_ptr<ThtsDNode>> pr : children) {
-                    std::shared_ptr<T> superclass_ptr = std::static_pointer_cast<T>(pr.second);
-                    std::shared_ptr<DPDNode> dp_node_ptr = std::static_pointer_cast<DPDNode>(superclass_ptr);
-                    dp_children->insert_or_assign(pr.first, dp_node_ptr);
-                }
-                return dp_children;
+            DPDNodeChildMap make_child_view(const DNodeChildMap& children) const {
+                return DPDNodeChildMap::make<T>(children);
             }
 
         public:
             /**
              * Interface for calling the backup function for ThtsCNode classes subclassing this DPCNode.
              * 
-             * Casts the child map so that the DPCNode can use it, and assures that all children are 
-             * locked around the backup_impl call.
+             * Makes a view of the child map so that the DPCNode can use it. Children are not locked, as the
+             * statistics read in the backup are RelaxedAtomics.
              * 
              * Templated with the top-level class of the ThtsDNode, so that the children can be cast from
              * ThtsDNode -> T -> DPDNode.
@@ -95,11 +92,9 @@ namespace thts {
              *      is_opponent: True if this node is acting as an opponent in a two player game.
              */
             template <typename T>
-            void backup_dp(DNodeChildMap& children, double local_reward, bool is_opponent=false) {
-                std::shared_ptr<DPDNodeChildMap> dp_children = convert_child_map<T>(children);
-                for (auto pr : children) pr.second->lock();
-                backup_dp_impl(*dp_children, local_reward, is_opponent);
-                for (auto pr : children) pr.second->unlock();
+            void backup_dp(const DNodeChildMap& children, double local_reward, bool is_opponent=false) {
+                DPDNodeChildMap dp_children = make_child_view<T>(children);
+                backup_dp_impl(dp_children, local_reward, is_opponent);
             }
     };
 }
\ No newline at end of file
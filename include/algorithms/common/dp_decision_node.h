@@ -1,7 +1,9 @@
 #pragma once
 
 #include "algorithms/common/dp_chance_node.h"
+#include "algorithms/common/mixin_child_map_view.h"
 
+#include "relaxed_atomic.h"
 #include "thts_types.h"
 #include "thts_chance_node.h"
 #include "thts_decision_node.h"
@@ -11,8 +13,8 @@ namespace thts {
     // forward declare corresponding DPCNode class
     class DPCNode;
 
-    // Typedef for children map
-    typedef std::unordered_map<std::shared_ptr<const Action>, std::shared_ptr<DPCNode>> DPCNodeChildMap;
+    // Typedef for a view of the children map (see MixinChildMapView)
+    typedef MixinChildMapView<CNodeChildMap,DPCNode> DPCNodeChildMap;
 
     /**
      * An implementation of dynamic programming backups for nodes to use.
@@ -28,8 +30,8 @@ namespace thts {
         friend DPCNode;
 
         protected:
-            int num_backups;
-            double dp_value;
+            RelaxedAtomic<int> num_backups;
+            RelaxedAtomic<double> dp_value;
 
             /**
              * Constructor 
@@ -70,23 +72,23 @@ namespace thts {
              *      An action recommendation from this node.
              */
             std::shared_ptr<const Action> recommend_action_best_dp_value_impl(
-                DPCNodeChildMap& children, RandManager& rand_manager, int visit_threshold, bool is_opponent) const;
+                const DPCNodeChildMap& children, RandManager& rand_manager, int visit_threshold, bool is_opponent) const;
 
             /**
              * Performs a dynamic programming backup.
              * 
              * I.e. V(s) = max_a Q(s,a)
              * 
-             * Assumes all children are locked.
+             * Reads child statistics without locking the children.
              * 
              * Args:
              *      children: The children map for this node
              *      is_opponent: True if this node is acting as an opponent in a two player game.
              */
-            void backup_dp_impl(DPCNodeChildMap& children, bool is_opponent);
+            void backup_dp_impl(const DPCNodeChildMap& children, bool is_opponent);
 
             /**
-             * Helper to convert children maps into children maps for DP Nodes.
+             * Helper to make a view of a children map, for DPCNodes.
              * 
              * Templated with the top-level class of the ThtsCNode, so that the children can be cast from
              * ThtsCNode -> T -> DPCNode
@@ -95,24 +97,19 @@ namespace thts {
              *      children: A children map for a ThtsDNode, mapping actions to CNodes.
              * 
              * Returns:
-             *      A map from actions to DPCNodes, to be used in recommend_action or backup.
+             *      A view of 'children' as DPCNodes, to be used in recommend_action or backup. The view references 
+             *      'children', and makes no allocations.
              */
             template <typename T>
-            std::shared_ptr<DPCNodeChildMap> convert_child_map(const CNodeChildMap& children) const {
-                std::shared_ptr<DPCNodeChildMap> dp_children = std::make_shared<DPCNodeChildMap>();
-                for (std::pair<std::shared_ptr<const Action>,std::shared_ptr<ThtsCNode>> pr : children) {
-                    std::shared_ptr<T> superclass_ptr = std::static_pointer_cast<T>(pr.second);
-                    std::shared_ptr<DPCNode> dp_node_ptr = std::static_pointer_cast<DPCNode>(superclass_ptr);
-                    dp_children->insert_or_assign(pr.first, dp_node_ptr);
-                }
-                return dp_children;
+            DPCNodeChildMap make_child_view(const CNodeChildMap& children) const {
+                return DPCNodeChildMap::make<T>(children);
             }
 
         public:
             /**
              * Interface for calling the recommend_action function for ThtsDNode classes subclassing this DPDNode.
              * 
-             * Casts the child map so that the DPDNode can use it, and assures that all children are 
+             * Makes a view of the child map so that the DPDNode can use it, and assures that all children are 
              * locked around the backup_impl call.
              * 
              * Templated with the top-level class of the ThtsCNode, so that the children can be cast from
@@ -136,19 +133,19 @@ namespace thts {
                 int visit_threshold=0, 
                 bool is_opponent=false) const 
             {
-                std::shared_ptr<DPCNodeChildMap> dp_children = convert_child_map<T>(children);
-                for (auto pr : children) pr.second->lock();
+                DPCNodeChildMap dp_children = make_child_view<T>(children);
+                for (const auto& pr : children) pr.second->lock();
                 std::shared_ptr<const Action> action = recommend_action_best_dp_value_impl(
-                    *dp_children, rand_manager, visit_threshold, is_opponent);
-                for (auto pr : children) pr.second->unlock();
+                    dp_children, rand_manager, visit_threshold, is_opponent);
+                for (const auto& pr : children) pr.second->unlock();
                 return action;
             }
             
             /**
              * Interface for calling the backup function for ThtsDNode classes subclassing this DPDNode.
              * 
-             * Casts the child map so that the DPDNode can use it, and assures that all children are 
-             * locked around the backup_impl call.
+             * Makes a view of the child map so that the DPDNode can use it. Children are not locked, as the
+             * statistics read in the backup are RelaxedAtomics.
              * 
              * Templated with the top-level class of the ThtsCNode, so that the children can be cast from
              * ThtsCNode -> T -> DPCNode.
@@ -159,10 +156,8 @@ namespace thts {
              */
             template <typename T>
             void backup_dp(const CNodeChildMap& children, bool is_opponent=false) {
-                std::shared_ptr<DPCNodeChildMap> dp_children = convert_child_map<T>(children);
-                for (auto pr : children) pr.second->lock();
-                backup_dp_impl(*dp_children, is_opponent);
-                for (auto pr : children) pr.second->unlock();
+                DPCNodeChildMap dp_children = make_child_view<T>(children);
+                backup_dp_impl(dp_children, is_opponent);
             }
     };
 }
\ No newline at end of file
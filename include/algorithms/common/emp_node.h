@@ -1,5 +1,8 @@
 #pragma once
 
+#include "algorithms/common/mixin_child_map_view.h"
+
+#include "relaxed_atomic.h"
 #include "thts_types.h"
 #include "thts_chance_node.h"
 #include "thts_decision_node.h"
@@ -9,8 +12,8 @@ namespace thts {
     // forward declare EmpNode class
     class EmpNode;
 
-    // Typedef for children map
-    typedef std::unordered_map<std::shared_ptr<const Action>, std::shared_ptr<EmpNode>> EmpNodeChildMap;
+    // Typedef for a view of the children map (see MixinChildMapView)
+    typedef MixinChildMapView<CNodeChildMap,EmpNode> EmpNodeChildMap;
 
     /**
      * An implementation of empircal average return backups for nodes to use. Note that the behaviour at decision and 
@@ -25,8 +28,8 @@ namespace thts {
      */
     class EmpNode {
         protected:
-            int num_backups;
-            double avg_return;
+            RelaxedAtomic<int> num_backups;
+            RelaxedAtomic<double> avg_return;
 
             /**
              * Constructor 
@@ -68,7 +71,7 @@ namespace thts {
              *      An action recommendation from this node.
              */
             std::shared_ptr<const Action> recommend_action_best_emp_value_impl(
-                EmpNodeChildMap& children, RandManager& rand_manager, int visit_threshold, bool is_opponent) const;
+                const EmpNodeChildMap& children, RandManager& rand_manager, int visit_threshold, bool is_opponent) const;
 
             /**
              * Updates the average return given a return from this node from a trial
@@ -79,7 +82,7 @@ namespace thts {
             void backup_emp(double _return);
 
             /**
-             * Helper to convert children maps into children maps for Emp Nodes.
+             * Helper to make a view of a children map, for EmpNodes.
              * 
              * Templated with the top-level class of the ThtsCNode, so that the children can be cast from
              * ThtsCNode -> T -> EmpNode
@@ -88,24 +91,19 @@ namespace thts {
              *      children: A children map for a ThtsDNode, mapping actions to CNodes.
              * 
              * Returns:
-             *      A map from actions to EmpNodes, to be used in recommend_action or backup.
+             *      A view of 'children' as EmpNodes, to be used in recommend_action or backup. The view references 
+             *      'children', and makes no allocations.
              */
             template <typename T>
-            std::shared_ptr<EmpNodeChildMap> convert_child_map(const CNodeChildMap& children) const {
-                std::shared_ptr<EmpNodeChildMap> emp_children = std::make_shared<EmpNodeChildMap>();
-                for (std::pair<std::shared_ptr<const Action>,std::shared_ptr<ThtsCNode>> pr : children) {
-                    std::shared_ptr<T> superclass_ptr = std::static_pointer_cast<T>(pr.second);
-                    std::shared_ptr<EmpNode> emp_node_ptr = std::static_pointer_cast<EmpNode>(superclass_ptr);
-                    emp_children->insert_or_assign(pr.first, emp_node_ptr);
-                }
-                return emp_children;
+            EmpNodeChildMap make_child_view(const CNodeChildMap& children) const {
+                return EmpNodeChildMap::make<T>(children);
             }
 
         public:
             /**
              * Interface for calling the recommend_action function for ThtsDNode classes subclassing this EmpNode.
              * 
-             * Casts the child map so that the EmpNode can use it, and assures that all children are 
+             * Makes a view of the child map so that the EmpNode can use it, and assures that all children are 
              * locked around the backup_impl call.
              * 
              * Templated with the top-level class of the ThtsCNode, so that the children can be cast from
@@ -129,11 +127,11 @@ namespace thts {
                 int visit_threshold=0, 
                 bool is_opponent=false) const 
             {
-                std::shared_ptr<EmpNodeChildMap> emp_children = convert_child_map<T>(children);
-                for (auto pr : children) pr.second->lock();
+                EmpNodeChildMap emp_children = make_child_view<T>(children);
+                for (const auto& pr : children) pr.second->lock();
                 std::shared_ptr<const Action> action = recommend_action_best_emp_value_impl(
-                    *emp_children, rand_manager, visit_threshold, is_opponent);
-                for (auto pr : children) pr.second->unlock();
+                    emp_children, rand_manager, visit_threshold, is_opponent);
+                for (const auto& pr : children) pr.second->unlock();
                 return action;
             }
     };
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "algorithms/common/ent_decision_node.h"
+#include "algorithms/common/mixin_child_map_view.h"
 
+#include "relaxed_atomic.h"
 #include "thts_types.h"
 #include "thts_chance_node.h"
 #include "thts_decision_node.h"
@@ -11,8 +13,8 @@ namespace thts {
     // forward declare corresponding EntDNode class
     class EntDNode;
 
-    // Typedef for children map
-    typedef std::unordered_map<std::shared_ptr<const Observation>, std::shared_ptr<EntDNode>> EntDNodeChildMap;
+    // Typedef for a view of the children map (see MixinChildMapView)
+    typedef MixinChildMapView<DNodeChildMap,EntDNode> EntDNodeChildMap;
 
     /**
      * An implementation of dynamic programming backups for nodes to use.
@@ -28,8 +30,8 @@ namespace thts {
         friend EntDNode;
 
         protected:
-            int num_backups;
-            double subtree_entropy;
+            RelaxedAtomic<int> num_backups;
+            RelaxedAtomic<double> subtree_entropy;
 
             /**
              * Constructor 
@@ -44,17 +46,17 @@ namespace thts {
             /**
              * Computes the subtree entropy as a backup
              * 
-             * Assumes all children are locked.
+             * Reads child statistics without locking the children.
              * 
              * Args:
              *      children: The children map for this node
              *      is_opponent: True if this node is acting as an opponent in a two player game
              */
-            void backup_ent_impl(EntDNodeChildMap& children);
+            void backup_ent_impl(const EntDNodeChildMap& children);
 
 
             /**
-             * Helper to convert children maps into children maps for DP Nodes.
+             * Helper to make a view of a children map, for EntDNodes.
              * 
              * Templated with the top-level class of the ThtsDNode, so that the children can be cast from
              * ThtsDNode -> T -> EntDNode
@@ -63,25 +65,20 @@ namespace thts {
              *      children: A children map for a ThtsCNode, mapping observations to DNodes.
              * 
              * Returns:
-             *      A map from observations to EntDNodes, to be used in backup.
+             *      A view of 'children' as EntDNodes, to be used in recommend_action or backup. The view references 
+             *      'children', and makes no allocations.
              */
             template <typename T>
-            std::shared_ptr<EntDNodeChildMap> convert_child_map(DNodeChildMap& children) const {
-                std::shared_ptr<EntDNodeChildMap> ent_children = std::make_shared<EntDNodeChildMap>();
-                for (std::pair<std::shared_ptr<const Observation>,std::shared_ptr<ThtsDNode>> pr : children) {
-                    std::shared_ptr<T> superclass_ptr = std::static_pointer_cast<T>(pr.second);
-                    std::shared_ptr<EntDNode> ent_node_ptr = std::static_pointer_cast<EntDNode>(superclass_ptr);
-                    ent_children->insert_or_assign(pr.first, ent_node_ptr);
-                }
-                return ent_children;
+            EntDNodeChildMap make_child_view(const DNodeChildMap& children) const {
+                return EntDNodeChildMap::make<T>(children);
             }
 
         public:
             /**
              * Interface for calling the backup function for ThtsCNode classes subclassing this EntCNode.
              * 
-             * Casts the child map so that the EntCNode can use it, and assures that all children are 
-             * locked around the backup_impl call.
+             * Makes a view of the child map so that the EntCNode can use it. Children are not locked, as the
+             * statistics read in the backup are RelaxedAtomics.
              * 
              * Templated with the top-level class of the ThtsDNode, so that the children can be cast from
              * ThtsDNode -> T -> EntDNode.
@@ -92,11 +89,9 @@ namespace thts {
              *      is_opponent: True if this node is acting as an opponent in a two player game.
              */
             template <typename T>
-            void backup_ent(DNodeChildMap& children) {
-                std::shared_ptr<EntDNodeChildMap> ent_children = convert_child_map<T>(children);
-                for (auto pr : children) pr.second->lock();
-                backup_ent_impl(*ent_children);
-                for (auto pr : children) pr.second->unlock();
+            void backup_ent(const DNodeChildMap& children) {
+                EntDNodeChildMap ent_children = make_child_view<T>(children);
+                backup_ent_impl(ent_children);
             }
     };
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "algorithms/common/ent_chance_node.h"
+#include "algorithms/common/mixin_child_map_view.h"
 
+#include "relaxed_atomic.h"
 #include "thts_types.h"
 #include "thts_chance_node.h"
 #include "thts_decision_node.h"
@@ -11,8 +13,8 @@ namespace thts {
     // forward declare corresponding EntCNode class
     class EntCNode;
 
-    // Typedef for children map
-    typedef std::unordered_map<std::shared_ptr<const Action>, std::shared_ptr<EntCNode>> EntCNodeChildMap;
+    // Typedef for a view of the children map (see MixinChildMapView)
+    typedef MixinChildMapView<CNodeChildMap,EntCNode> EntCNodeChildMap;
 
     /**
      * An implementation of entropy backups for nodes to use.
@@ -30,9 +32,9 @@ namespace thts {
         friend EntCNode;
 
         protected:
-            int num_backups;
-            double local_entropy;
-            double subtree_entropy;
+            RelaxedAtomic<int> num_backups;
+            RelaxedAtomic<double> local_entropy;
+            RelaxedAtomic<double> subtree_entropy;
 
             /**
              * Constructor 
@@ -58,17 +60,17 @@ namespace thts {
             /**
              * Computes the local and subtree entropy as a backup
              * 
-             * Assumes all children are locked.
+             * Reads child statistics without locking the children.
              * 
              * Args:
              *      children: The children map for this node
              *      policy: The current policy this node would use for action selection
              *      is_opponent: True if this node is acting as an opponent in a two player game.
              */
-            void backup_ent_impl(EntCNodeChildMap& children, ActionDistr& policy, bool is_opponent);
+            void backup_ent_impl(const EntCNodeChildMap& children, const ActionDistr& policy, bool is_opponent);
 
             /**
-             * Helper to convert children maps into children maps for Ent Nodes.
+             * Helper to make a view of a children map, for EntCNodes.
              * 
              * Templated with the top-level class of the ThtsCNode, so that the children can be cast from
              * ThtsCNode -> T -> EntCNode
@@ -77,17 +79,12 @@ namespace thts {
              *      children: A children map for a ThtsDNode, mapping actions to CNodes.
              * 
              * Returns:
-             *      A map from actions to EntCNodes, to be used in recommend_action or backup.
+             *      A view of 'children' as EntCNodes, to be used in recommend_action or backup. The view references 
+             *      'children', and makes no allocations.
              */
             template <typename T>
-            std::shared_ptr<EntCNodeChildMap> convert_child_map(const CNodeChildMap& children) const {
-                std::shared_ptr<EntCNodeChildMap> ent_children = std::make_shared<EntCNodeChildMap>();
-                for (std::pair<std::shared_ptr<const Action>,std::shared_ptr<ThtsCNode>> pr : children) {
-                    std::shared_ptr<T> superclass_ptr = std::static_pointer_cast<T>(pr.second);
-                    std::shared_ptr<EntCNode> ent_node_ptr = std::static_pointer_cast<EntCNode>(superclass_ptr);
-                    ent_children->insert_or_assign(pr.first, ent_node_ptr);
-                }
-                return ent_children;
+            EntCNodeChildMap make_child_view(const CNodeChildMap& children) const {
+                return EntCNodeChildMap::make<T>(children);
             }
 
         public:
@@ -95,8 +92,8 @@ namespace thts {
             /**
              * Interface for calling the backup function for ThtsDNode classes subclassing this EntDNode.
              * 
-             * Casts the child map so that the EntDNode can use it, and assures that all children are 
-             * locked around the backup_impl call.
+             * Makes a view of the child map so that the EntDNode can use it. Children are not locked, as the
+             * statistics read in the backup are RelaxedAtomics.
              * 
              * Templated with the top-level class of the ThtsCNode, so that the children can be cast from
              * ThtsCNode -> T -> EntCNode.
@@ -107,11 +104,9 @@ namespace thts {
              *      is_opponent: True if this node is acting as an opponent in a two player game.
              */
             template <typename T>
-            void backup_ent(const CNodeChildMap& children, ActionDistr& policy, bool is_opponent=false) {
-                std::shared_ptr<EntCNodeChildMap> ent_children = convert_child_map<T>(children);
-                for (auto pr : children) pr.second->lock();
-                backup_ent_impl(*ent_children, policy, is_opponent);
-                for (auto pr : children) pr.second->unlock();
+            void backup_ent(const CNodeChildMap& children, const ActionDistr& policy, bool is_opponent=false) {
+                EntCNodeChildMap ent_children = make_child_view<T>(children);
+                backup_ent_impl(ent_children, policy, is_opponent);
             }
     };
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+
+namespace thts {
+    /**
+     * A typed, read only view of the 'children' map of a ThtsDNode or ThtsCNode, that presents the children as
+     * references to a mixin class (e.g. DPCNode or EntDNode).
+     *
+     * Mixins need to access children through their own type, but the 'children' map stores pointers to ThtsCNode or
+     * ThtsDNode objects. Rather than building a new map of cast pointers for every backup, the view holds a reference
+     * to the existing map, and casts each child on the fly when it is iterated over. Constructing and iterating a view
+     * makes no heap allocations.
+     *
+     * Casting from a ThtsCNode to a mixin depends on the top-level class of the node (ThtsCNode -> T -> Mixin), as
+     * the mixin is a separate base class of T. The view stores a pointer to a (non-capturing) cast function, so that
+     * the functions in the mixins using the view don't need to be templated with T (see 'make').
+     *
+     * Template args:
+     *      M: The type of the children map being viewed (CNodeChildMap or DNodeChildMap)
+     *      Mixin: The type to view each child as
+     *
+     * Member variables:
+     *      children:
+     *          The children map being viewed
+     *      cast_fn:
+     *          Function to cast a child node (from the children map) to the Mixin type
+     */
+    template <typename M, typename Mixin>
+    class MixinChildMapView {
+        public:
+            typedef typename M::key_type key_type;
+            typedef typename M::mapped_type::element_type node_type;
+            typedef Mixin& (*cast_fn_type)(node_type&);
+            typedef std::pair<const key_type&, Mixin&> value_type;
+
+            /**
+             * Forward iterator over the children, returning (key, Mixin&) pairs by value.
+             */
+            class const_iterator {
+                friend MixinChildMapView;
+
+                protected:
+                    typename M::const_iterator iter;
+                    cast_fn_type cast_fn;
+
+                    const_iterator(typename M::const_iterator iter, cast_fn_type cast_fn) :
+                        iter(iter), cast_fn(cast_fn) {}
+
+                public:
+                    typedef std::forward_iterator_tag iterator_category;
+                    typedef MixinChildMapView::value_type value_type;
+                    typedef std::ptrdiff_t difference_type;
+                    typedef void pointer;
+                    typedef value_type reference;
+
+                    reference operator*() const { return value_type(iter->first, cast_fn(*iter->second)); }
+
+                    const_iterator& operator++() {
+                        ++iter;
+                        return *this;
+                    }
+
+                    const_iterator operator++(int) {
+                        const_iterator tmp = *this;
+                        ++iter;
+                        return tmp;
+                    }
+
+                    bool operator==(const const_iterator& other) const { return iter == other.iter; }
+                    bool operator!=(const const_iterator& other) const { return iter != other.iter; }
+            };
+
+            typedef const_iterator iterator;
+
+        protected:
+            const M& children;
+            cast_fn_type cast_fn;
+
+        public:
+            /**
+             * Constructor
+             */
+            MixinChildMapView(const M& children, cast_fn_type cast_fn) : children(children), cast_fn(cast_fn) {}
+
+            /**
+             * Makes a view of 'children', where each child is (ultimately) of type T.
+             *
+             * Template args:
+             *      T: The top-level class of the children, so that they can be cast node_type -> T -> Mixin
+             *
+             * Args:
+             *      children: The children map to view
+             *
+             * Returns:
+             *      A view of 'children', as Mixin objects
+             */
+            template <typename T>
+            static MixinChildMapView make(const M& children) {
+                return MixinChildMapView(children, [](node_type& node) -> Mixin& { return (T&) node; });
+            }
+
+            /**
+             * Iteration and size, following the interface of the children map
+             */
+            const_iterator begin() const { return const_iterator(children.begin(), cast_fn); }
+            const_iterator end() const { return const_iterator(children.end(), cast_fn); }
+            std::size_t size() const { return children.size(); }
+            bool empty() const { return children.empty(); }
+    };
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "thts_chance_node.h"
+#include "thts_types.h"
+
+#include <memory>
+
+namespace thts {
+    // forward declare
+    class RandManager;
+
+    /**
+     * Helpers for (double) progressive widening, used by UCT and MENTS nodes when the action (or outcome) space is 
+     * too large to enumerate every child.
+     * 
+     * With progressive widening, a node that has been visited N times may only have up to ceil(k * N^alpha) children 
+     * (and always at least one), where k ('coeff') and alpha ('exponent') are parameters in the manager. Decision 
+     * nodes admit actions to their set of actions in a fixed order as their visit count grows, and chance nodes only 
+     * sample new outcomes from the environment while they are under the limit, otherwise resampling one of their 
+     * existing children.
+     */
+
+    /**
+     * Returns the maximum number of children that a node with 'num_visits' visits may have, 
+     * max(1, ceil(coeff * num_visits^exponent)).
+     * 
+     * Args:
+     *      num_visits: The number of visits to the node
+     *      coeff: The coefficient (k) of the widening limit
+     *      exponent: The exponent (alpha) of the widening limit
+     */
+    int compute_progressive_widening_limit(int num_visits, double coeff, double exponent);
+
+    /**
+     * Returns the order that a decision node should admit actions in with progressive widening. If there is a 
+     * policy prior, then actions are ordered by decreasing prior probability (so the most promising actions are 
+     * considered first), otherwise they are put in a uniformly random order.
+     * 
+     * Args:
+     *      actions: The valid actions at the decision node
+     *      policy_prior: The policy prior at the decision node, or nullptr if there isn't one
+     *      rand_manager: The RandManager to shuffle actions with when there is no prior
+     * 
+     * Returns:
+     *      A new ActionVector containing 'actions' in the order they should be admitted
+     */
+    std::shared_ptr<ActionVector> get_progressive_widening_action_order(
+        const ActionVector& actions, std::shared_ptr<ActionPrior> policy_prior, RandManager& rand_manager);
+
+    /**
+     * Samples one of the existing children of a chance node, with probability proportional to the number of visits 
+     * to each child (children with no visits are counted as having one), which is used instead of sampling from the 
+     * environment when a chance node is at its progressive widening limit.
+     * 
+     * Args:
+     *      children: The (non-empty) children of a chance node
+     *      rand_manager: The RandManager to sample with
+     * 
+     * Returns:
+     *      The observation corresponding to the sampled child
+     */
+    std::shared_ptr<const Observation> sample_existing_child_observation(
+        const DNodeChildMap& children, RandManager& rand_manager);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+/**
+ * Defined if the vectorised (x86) kernels can be compiled, i.e. when compiling for x86 with a compiler that supports
+ * per function 'target' attributes. Whether they can be run is checked at runtime (see 'get_supported_simd_level').
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define THTS_X86_SIMD
+#endif
+
+namespace thts {
+    /**
+     * The instruction sets that can be used by the vectorised kernels (see boltzmann_kernel.h and ucb_kernel.h).
+     */
+    enum class SimdLevel {
+        scalar,
+        avx2,
+        avx512
+    };
+
+    /**
+     * Returns the best SimdLevel supported by the processor (and compiler). Detected once and cached.
+     */
+    SimdLevel get_supported_simd_level();
+}
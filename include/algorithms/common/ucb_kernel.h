@@ -0,0 +1,94 @@
+#pragma once
+
+#include "algorithms/common/simd.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace thts {
+    // forward declare
+    class RandManager;
+
+    /**
+     * Kernels for computing ucb (and puct) values over contiguous arrays, used by UctDNode (and subclasses) to select
+     * actions on wide action spaces.
+     *
+     * The ucb value of an action has the form:
+     *      q_value + coeff * weight * f(child_visits),
+     * where 'q_value' already includes any opponent coefficient and virtual loss, 'coeff' is computed once per node
+     * visit (e.g. bias * sqrt(log(num_visits)) for ucb), 'weight' is an optional prior probability and 'f' is either
+     * 1/sqrt(child_visits) (ucb) or 1/child_visits (puct). Children with zero visits are treated as having one visit.
+     *
+     * Like the boltzmann kernels (see boltzmann_kernel.h), the kernels are vectorised with AVX-512 or AVX2 if the
+     * processor supports them. The vectorised implementations use the same (correctly rounded) operations in the same
+     * order as the scalar implementation, so all implementations give identical results, and equal ucb values (which
+     * ties are broken between) stay equal.
+     */
+
+    /**
+     * How the exploration term of a ucb value scales with the number of visits to the child.
+     */
+    enum class UcbVisitsScaling {
+        inv_sqrt,
+        inv
+    };
+
+    /**
+     * Adds exploration terms to ucb values in place.
+     *
+     * Args:
+     *      values:
+     *          An array of 'n' q-values, that 'coeff * weights[i] * f(child_visits[i])' is added to
+     *      child_visits:
+     *          An array of 'n' child visit counts (as doubles)
+     *      weights:
+     *          An array of 'n' weights (e.g. prior probabilities), or nullptr to use a weight of 1.0 for every action
+     *      n:
+     *          The number of values
+     *      coeff:
+     *          The coefficient of the exploration terms
+     *      scaling:
+     *          The function 'f' to apply to child visit counts
+     *      simd_level:
+     *          The instruction set to use (defaults to 'get_supported_simd_level()')
+     */
+    void add_ucb_exploration_terms(
+        double* values,
+        const double* child_visits,
+        const double* weights,
+        std::size_t n,
+        double coeff,
+        UcbVisitsScaling scaling);
+    void add_ucb_exploration_terms(
+        double* values,
+        const double* child_visits,
+        const double* weights,
+        std::size_t n,
+        double coeff,
+        UcbVisitsScaling scaling,
+        SimdLevel simd_level);
+
+    /**
+     * Returns the maximum of 'n' values (or the lowest double if n == 0).
+     *
+     * Args:
+     *      values: An array of 'n' values
+     *      n: The number of values
+     *      simd_level: The instruction set to use (defaults to 'get_supported_simd_level()')
+     */
+    double compute_max_value(const double* values, std::size_t n);
+    double compute_max_value(const double* values, std::size_t n, SimdLevel simd_level);
+
+    /**
+     * Returns the index of the maximum value, breaking ties uniformly at random. The dense equivalent of
+     * 'helper::get_max_key_break_ties_randomly', and similarly only uses a random number if there is a tie.
+     *
+     * Args:
+     *      values: A non-empty vector of values
+     *      rand_manager: The RandManager to break ties with
+     *
+     * Returns:
+     *      The index of a maximum value in 'values'
+     */
+    int get_max_index_break_ties_randomly(const std::vector<double>& values, RandManager& rand_manager);
+}
@@ -50,15 +50,21 @@ namespace thts {
              *      opponent_coeff: 
              *          A value of -1.0 or 1.0 for if we are acting as the opponent in a two player game or not 
              *          respectively
+             *      position_hint:
+             *          The index of 'action' in 'actions' if known, used as the position hint to look up the child 
+             *          (see 'FlatChildMap::find'), so that looping over 'actions' doesn't search 'children' each time
              */
-            virtual double get_soft_q_value(std::shared_ptr<const Action> action, double opponent_coeff) const;
+            virtual double get_soft_q_value(
+                const std::shared_ptr<const Action>& action, 
+                double opponent_coeff, 
+                std::size_t position_hint=CNodeChildMap::npos) const;
             
             /**
              * Calls both the entropy backup and dp backup from DPDNode
              */
             virtual void backup(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
@@ -67,7 +73,7 @@ namespace thts {
             /**
              * Helper to make a EstCNode child object.
              */
-            std::shared_ptr<EstCNode> create_child_node_helper(std::shared_ptr<const Action> action) const;
+            std::shared_ptr<EstCNode> create_child_node_helper(const std::shared_ptr<const Action>& action) const;
 
             /**
              * Override the pretty print to print out the soft value, dp value, entropy and temperature
@@ -80,6 +86,6 @@ namespace thts {
              * create the correct EstCNode using the above version of create_child_node
              */
             virtual std::shared_ptr<ThtsCNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Action> action) const;
+                const std::shared_ptr<const Action>& action) const;
     };
 }
\ No newline at end of file
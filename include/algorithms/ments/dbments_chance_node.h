@@ -50,8 +50,8 @@ namespace thts {
              * Calls both the soft backup from MentsCNode and dp backup from DPCNode
              */
             virtual void backup(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
@@ -61,7 +61,8 @@ namespace thts {
              * Helper to make a DBMentsDNode child object.
              */
             std::shared_ptr<DBMentsDNode> create_child_node_helper(
-                std::shared_ptr<const State> observation, std::shared_ptr<const State> next_state=nullptr) const;
+                const std::shared_ptr<const State>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr) const;
 
             /**
              * Override the pretty print to print out both the dp value and the soft value
@@ -74,6 +75,7 @@ namespace thts {
              * create the correct DBMentsDNode using the above version of create_child_node
              */
             virtual std::shared_ptr<ThtsDNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Observation> observation, std::shared_ptr<const State> next_state=nullptr) const;
+                const std::shared_ptr<const Observation>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr) const;
     };
 }
\ No newline at end of file
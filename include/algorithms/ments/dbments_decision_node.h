@@ -72,13 +72,18 @@ namespace thts {
              *      The recommended action
              */
             virtual std::shared_ptr<const Action> recommend_action(ThtsEnvContext& ctx) const;
+
+            /**
+             * Fills 'child_stats' with the visit counts and dp values of the children of this node.
+             */
+            virtual void fill_child_recommendation_stats_itfc(ChildRecommendationStatsMap& child_stats) const;
             
             /**
              * Calls both the soft backup from MentsDNode and dp backup from DPDNode
              */
             virtual void backup(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
@@ -87,7 +92,7 @@ namespace thts {
             /**
              * Helper to make a DBMentsCNode child object.
              */
-            std::shared_ptr<DBMentsCNode> create_child_node_helper(std::shared_ptr<const Action> action) const;
+            std::shared_ptr<DBMentsCNode> create_child_node_helper(const std::shared_ptr<const Action>& action) const;
 
             /**
              * Override the pretty print to print out both the dp value and the soft value
@@ -100,6 +105,6 @@ namespace thts {
              * create the correct DBMentsCNode using the above version of create_child_node
              */
             virtual std::shared_ptr<ThtsCNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Action> action) const;
+                const std::shared_ptr<const Action>& action) const;
     };
 }
\ No newline at end of file
@@ -55,8 +55,8 @@ namespace thts {
              * Calls both the entropy backup and dp backup from DPCNode
              */
             virtual void backup(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
@@ -66,7 +66,8 @@ namespace thts {
              * Helper to make a DentsDNode child object.
              */
             std::shared_ptr<DentsDNode> create_child_node_helper(
-                std::shared_ptr<const State> observation, std::shared_ptr<const State> next_state=nullptr) const;
+                const std::shared_ptr<const State>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr) const;
 
             /**
              * Override the pretty print to print out both the dp value and the soft value
@@ -79,6 +80,7 @@ namespace thts {
              * create the correct DentsDNode using the above version of create_child_node
              */
             virtual std::shared_ptr<ThtsDNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Observation> observation, std::shared_ptr<const State> next_state=nullptr) const;
+                const std::shared_ptr<const Observation>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr) const;
     };
 }
\ No newline at end of file
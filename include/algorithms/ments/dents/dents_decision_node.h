@@ -64,8 +64,14 @@ namespace thts {
              *      opponent_coeff: 
              *          A value of -1.0 or 1.0 for if we are acting as the opponent in a two player game or not 
              *          respectively
+             *      position_hint:
+             *          The index of 'action' in 'actions' if known, used as the position hint to look up the child 
+             *          (see 'FlatChildMap::find'), so that looping over 'actions' doesn't search 'children' each time
              */
-            virtual double get_soft_q_value(std::shared_ptr<const Action> action, double opponent_coeff) const;
+            virtual double get_soft_q_value(
+                const std::shared_ptr<const Action>& action, 
+                double opponent_coeff, 
+                std::size_t position_hint=CNodeChildMap::npos) const;
             
             /**
              * Uses the DPDNode to recommend an action according to the DP values.
@@ -84,13 +90,19 @@ namespace thts {
              *      The recommended action
              */
             virtual std::shared_ptr<const Action> recommend_action(ThtsEnvContext& ctx) const;   
+
+            /**
+             * Fills 'child_stats' with the visit counts and dp values (or average returns if not using dp values) of 
+             * the children of this node.
+             */
+            virtual void fill_child_recommendation_stats_itfc(ChildRecommendationStatsMap& child_stats) const;
             
             /**
              * Calls both the entropy backup and dp backup from DPDNode
              */
             virtual void backup(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
@@ -99,7 +111,7 @@ namespace thts {
             /**
              * Helper to make a DentsCNode child object.
              */
-            std::shared_ptr<DentsCNode> create_child_node_helper(std::shared_ptr<const Action> action) const;
+            std::shared_ptr<DentsCNode> create_child_node_helper(const std::shared_ptr<const Action>& action) const;
 
             /**
              * Override the pretty print to print out the soft value, dp value, entropy and temperature
@@ -112,6 +124,6 @@ namespace thts {
              * create the correct DentsCNode using the above version of create_child_node
              */
             virtual std::shared_ptr<ThtsCNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Action> action) const;
+                const std::shared_ptr<const Action>& action) const;
     };
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "algorithms/ments/ments_decision_node.h"
 #include "algorithms/ments/ments_manager.h"
+#include "distributions/categorical_distribution.h"
 #include "thts_types.h"
 
 #include "thts_chance_node.h"
@@ -34,7 +35,11 @@ namespace thts {
      *          A cached value of the environments reward R(state,action), for this nodes state, action pair. (Mostly 
      *          for the case where it is non-trivial to compute the reward, so don't recompute).
      *      next_state_distr: 
-     *          A cached StateDistribution, representing the distribution over possible next states
+     *          A cached StateDistribution, representing the distribution over possible next states (or nullptr if 
+     *          'use_generative_model' is set in the manager, in which case next states are sampled from the env)
+     *      next_state_sampler:
+     *          An alias table for 'next_state_distr', constructed once in the constructor, so that sampling next 
+     *          states takes O(1) time
      */
     class MentsCNode : public ThtsCNode {
         // Allow MentsDNode access to private members
@@ -44,10 +49,11 @@ namespace thts {
          * Core MentsCNode implementation.
          */
         protected:
-            int num_backups;
-            double soft_value;
+            RelaxedAtomic<int> num_backups;
+            RelaxedAtomic<double> soft_value;
             double local_reward;
             std::shared_ptr<StateDistr> next_state_distr;
+            CategoricalDistribution<std::shared_ptr<const State>> next_state_sampler;
 
             /**
              * Handles the thts sample_observation function by randomly sampling.
@@ -116,8 +122,8 @@ namespace thts {
              *          Sum of rewards in both of the 'trial_rewards_after_node' and 'trial_rewards_before_node' lists
              */
             virtual void backup(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
@@ -139,7 +145,8 @@ namespace thts {
              *      A pointer to a new MentsDNode object
              */
             std::shared_ptr<MentsDNode> create_child_node_helper(
-                std::shared_ptr<const State> observation, std::shared_ptr<const State> next_state=nullptr) const;
+                const std::shared_ptr<const State>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr) const;
 
             /**
              * Returns a string representation of the value of this node currently. Used for pretty printing.
@@ -185,7 +192,8 @@ namespace thts {
              *      A pointer to a new child chance node
              */
             std::shared_ptr<MentsDNode> create_child_node(
-                std::shared_ptr<const State> observation, std::shared_ptr<const State> next_state=nullptr);
+                const std::shared_ptr<const State>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr);
 
             /**
              * If this node has a child object corresponding to 'observation'.
@@ -196,7 +204,7 @@ namespace thts {
              * Returns:
              *      true if we have a child corresponding to 'observation'
              */
-            bool has_child_node(std::shared_ptr<const State> observation) const;
+            bool has_child_node(const std::shared_ptr<const State>& observation) const;
 
             /**
              * Retrieves a child node from the children map.
@@ -209,7 +217,7 @@ namespace thts {
              * Returns:
              *      A pointer to the child node corresponding to 'observation'
              */
-            std::shared_ptr<MentsDNode> get_child_node(std::shared_ptr<const State> observation) const;
+            std::shared_ptr<MentsDNode> get_child_node(const std::shared_ptr<const State>& observation) const;
 
 
 
@@ -224,16 +232,18 @@ namespace thts {
             virtual void visit_itfc(ThtsEnvContext& ctx);
             virtual std::shared_ptr<const Observation> sample_observation_itfc(ThtsEnvContext& ctx);
             virtual void backup_itfc(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
 
             virtual std::shared_ptr<ThtsDNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Observation> observation, std::shared_ptr<const State> next_state=nullptr) const;
+                const std::shared_ptr<const Observation>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr) const;
             // virtual std::shared_ptr<ThtsDNode> create_child_node_itfc(
-            //    std::shared_ptr<const Observation> observation, std::shared_ptr<const State> next_state=nullptr) final;
+            //    const std::shared_ptr<const Observation>& observation,
+            //    const std::shared_ptr<const State>& next_state=nullptr) final;
                 
 
 
@@ -245,8 +255,9 @@ namespace thts {
         //     bool is_opponent() const;
         //     int get_num_children() const;
 
-        //     bool has_child_node_itfc(std::shared_ptr<const Observation> observation) const;
-        //     std::shared_ptr<ThtsDNode> get_child_node_itfc(std::shared_ptr<const Observation> observation) const;
+        //     bool has_child_node_itfc(const std::shared_ptr<const Observation>& observation) const;
+        //     std::shared_ptr<ThtsDNode> get_child_node_itfc(
+        //        const std::shared_ptr<const Observation>& observation) const;
 
         //     std::string get_pretty_print_string(int depth) const;
 
@@ -14,6 +14,7 @@
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace thts {
     // forward declare corresponding MentsCNode class
@@ -40,11 +41,36 @@ namespace thts {
      *      num_backups: 
      *          The number of times this node has been backed up
      *      actions: 
-     *          A list of valid actions that can be used at this node
+     *          A list of valid actions that can be used at this node. If using progressive widening, this is the list 
+     *          of actions admitted so far
      *      policy_prior: 
      *          A prior policy for this state (if we have one)
      *      psuedo_q_value_offset: 
      *          An offset to use for any psuedo q values set from a policy prior
+     *      action_values_buffer:
+     *          A contiguous buffer of per action values (indexed the same as 'actions'), reused by 'select_action_ments' 
+     *          and 'backup_soft' to compute action weights and distributions without allocating. Only used while 
+     *          holding this node's lock
+     *      incremental_soft_q_values:
+     *          When using incremental soft backups (see 'incremental_soft_backup' in MentsManager), the values of 
+     *          Q(s,a)/temp for each action (indexed the same as 'actions') that are currently included in 
+     *          'incremental_sum_weights'
+     *      incremental_max_value:
+     *          The normalisation term used for 'incremental_sum_weights'. An upper bound on the values in 
+     *          'incremental_soft_q_values' (but not necessarily the maximum if the max value has decreased)
+     *      incremental_sum_weights:
+     *          The sum of exp(value - incremental_max_value) over the values in 'incremental_soft_q_values'
+     *      incremental_temp:
+     *          The temperature that 'incremental_soft_q_values' were computed with
+     *      num_incremental_updates:
+     *          The number of incremental updates since the terms were last fully recomputed, or -1 if they have not 
+     *          been computed yet
+     *      _incremental_selected_index_slot:
+     *          A slot to use for storing the index (in 'actions') of the selected action in ThtsEnvContexts, for 
+     *          incremental soft backups
+     *      widening_actions:
+     *          If using progressive widening, all of the valid actions, in the order that they are admitted to 
+     *          'actions' (see progressive_widening.h). Otherwise nullptr
      */
     class MentsDNode : public ThtsDNode {
         // Allow MentsCNode and MentsLogger access to private members
@@ -55,11 +81,25 @@ namespace thts {
          * Core MentsDNode implementation.
          */
         protected:
-            int num_backups;
-            double soft_value;
+            RelaxedAtomic<int> num_backups;
+            RelaxedAtomic<double> soft_value;
             std::shared_ptr<ActionVector> actions;
             std::shared_ptr<ActionPrior> policy_prior;
             double psuedo_q_value_offset;
+            std::vector<double> action_values_buffer;
+            std::vector<double> incremental_soft_q_values;
+            double incremental_max_value;
+            double incremental_sum_weights;
+            double incremental_temp;
+            int num_incremental_updates;
+            ThtsEnvContextSlot<std::size_t> _incremental_selected_index_slot;
+            std::shared_ptr<ActionVector> widening_actions;
+
+            /**
+             * Admits actions from 'widening_actions' to 'actions', until there are as many actions as the progressive 
+             * widening limit for the current number of visits allows. Does nothing if not using progressive widening.
+             */
+            void widen_actions();
 
             /**
              * Returns if we have a valid 'policy_prior' to use.
@@ -97,20 +137,27 @@ namespace thts {
              *      opponent_coeff: 
              *          A value of -1.0 or 1.0 for if we are acting as the opponent in a two player game or not 
              *          respectively
+             *      position_hint:
+             *          The index of 'action' in 'actions' if known, used as the position hint to look up the child 
+             *          (see 'FlatChildMap::find'), so that looping over 'actions' doesn't search 'children' each time
              */
-            virtual double get_soft_q_value(std::shared_ptr<const Action> action, double opponent_coeff) const;
+            virtual double get_soft_q_value(
+                const std::shared_ptr<const Action>& action, 
+                double opponent_coeff, 
+                std::size_t position_hint=CNodeChildMap::npos) const;
 
             /**
              * Computes the weights for each action.
              * 
              * (This excludes any probability mass from epsilon exploration).
              * 
-             * Assumes that we already hold locks for all of the children.
+             * The soft q-values are written into the contiguous 'action_weights' array, and the weights are computed 
+             * with the (vectorised) boltzmann kernel (see boltzmann_kernel.h).
              * 
              * Args:
              *      action_weights: 
-             *          An ActionDistr to be filled with values of the form exp(q_value/temp - C), where C is equal to
-             *          max(q_value/temp)
+             *          A vector to be filled with values of the form exp(q_value/temp - C), where C is equal to
+             *          max(q_value/temp). Resized to the number of actions, and indexed the same as 'actions'
              *      sun_action_weights:
              *          A double reference to be filled with the sum of all the weights in 'action_weights'
              *      normalisation_term:
@@ -119,7 +166,7 @@ namespace thts {
              *          A thts env context
              */
             virtual void compute_action_weights(
-                ActionDistr& action_weights, 
+                std::vector<double>& action_weights, 
                 double& sum_action_weights, 
                 double& normalisation_term, 
                 ThtsEnvContext& context) const;
@@ -127,7 +174,22 @@ namespace thts {
             /**
              * Computes the action distribution for each action. (Including probability mass from epsilon exploration).
              * 
-             * Is thread safe, and will lock children before trying to access them.
+             * Is thread safe, child values are read lock free.
+             * 
+             * Args:
+             *      action_probs:
+             *          A vector to be filled with a normalised probability distribution to select actions with, indexed 
+             *          the same as 'actions'. Probabilities that are close to zero are set to zero
+             *      context:
+             *          A thts env context
+             */
+            void compute_action_distribution(
+                std::vector<double>& action_probs, 
+                ThtsEnvContext& context) const;
+
+            /**
+             * Computes the action distribution as an ActionDistr, for when it needs to be looked up by action. 
+             * Actions with a probability close to zero are not included in 'action_distr'.
              * 
              * Args:
              *      action_distr:
@@ -139,6 +201,38 @@ namespace thts {
                 ActionDistr& action_distr, 
                 ThtsEnvContext& context) const;
 
+            /**
+             * Applies a (soft) virtual loss to an action distribution, if using virtual loss.
+             * 
+             * If 'k' trials are currently running through the child for action 'a', which has 'n' backups, then we 
+             * lower the value of Q(s,a) by 'virtual_loss * k / (n+k)' (as in UctDNode::fill_ucb_values). With 
+             * boltzmann weights this corresponds to multiplying the probability of 'a' by 
+             * exp(-virtual_loss * k / ((n+k) * temp)). The distribution is renormalised afterwards.
+             * 
+             * Is thread safe, and will only lock children with virtual losses applied.
+             * 
+             * Args:
+             *      action_distr:
+             *          A normalised ActionDistr (from 'compute_action_distribution') to apply the virtual loss to
+             * 
+             * Returns:
+             *      If 'action_distr' was modified
+             */
+            bool apply_virtual_loss(ActionDistr& action_distr) const;
+
+            /**
+             * Applies a (soft) virtual loss to an action distribution (as a vector indexed the same as 'actions'), in 
+             * the same way as 'apply_virtual_loss(ActionDistr&)'.
+             * 
+             * Args:
+             *      action_probs:
+             *          A normalised distribution (from 'compute_action_distribution') to apply the virtual loss to
+             * 
+             * Returns:
+             *      If 'action_probs' was modified
+             */
+            bool apply_virtual_loss(std::vector<double>& action_probs) const;
+
             /**
              * Implements select_action for ments
              * 
@@ -150,6 +244,52 @@ namespace thts {
              */
             std::shared_ptr<const Action> select_action_ments(ThtsEnvContext& ctx);
 
+            /**
+             * Returns if this node can use incremental soft backups. Subclasses whose action weights depend on more 
+             * than the soft q-values of actions (such as RENTS) should override this to return false.
+             */
+            virtual bool supports_incremental_soft_backup() const;
+
+            /**
+             * Returns if incremental soft backups are being used at this node, i.e. if they are enabled in the 
+             * MentsManager and supported by this node, and a transposition table isn't being used. (With a 
+             * transposition table children can be shared between parents, and the incremental update only refreshes 
+             * the term of the child selected through this node, so the other terms would become stale.)
+             */
+            bool use_incremental_soft_backup() const;
+
+            /**
+             * Gets the context slot used to store the selected index at decision nodes at 'decision_depth'. Slots are 
+             * cached per thread, so that constructing a node doesn't build the slot name or lock the slot registry.
+             */
+            static ThtsEnvContextSlot<std::size_t> get_incremental_selected_index_slot(int decision_depth);
+
+            /**
+             * Recomputes all of the terms used for incremental soft backups, from the current soft q-values of all 
+             * actions.
+             * 
+             * Args:
+             *      temp: The temperature to use
+             */
+            void recompute_incremental_soft_backup_terms(double temp);
+
+            /**
+             * Tries to update the terms used for incremental soft backups in O(1), given that only the soft q-value of 
+             * the action selected in this trial has changed. 
+             * 
+             * The update is not made (and false is returned) if a full recompute is needed. That is, if the terms 
+             * haven't been computed yet, the temperature has changed, 'incremental_soft_backup_recompute_period' 
+             * updates have been made since the last recompute, or the update would lose too much precision.
+             * 
+             * Args:
+             *      temp: The temperature to use
+             *      ctx: A thts env context, containing the action selected at this node in the trial
+             * 
+             * Returns:
+             *      If the update was made
+             */
+            bool update_incremental_soft_backup_terms(double temp, ThtsEnvContext& ctx);
+
             /**
              * Implements recommend_action for ments.
              * 
@@ -177,6 +317,9 @@ namespace thts {
              * 
              * I.e. V(s) = temp * log(sum(exp(Q(s,a)/temp)))
              * 
+             * If using incremental soft backups, then the sum is updated from the previous backup where possible, 
+             * rather than summing over all actions.
+             * 
              * Args:
              *      ctx: A thts env context
              */
@@ -230,6 +373,20 @@ namespace thts {
              */
             virtual std::shared_ptr<const Action> recommend_action(ThtsEnvContext& ctx) const;
             
+            /**
+             * Fills 'child_stats' with the visit counts and soft q-values (from 'get_soft_q_value') of the children 
+             * of this node. Used to merge recommendations over independent trees.
+             * 
+             * Args:
+             *      child_stats: A map to fill with the statistics for each child of this node
+             */
+            virtual void fill_child_recommendation_stats_itfc(ChildRecommendationStatsMap& child_stats) const;
+
+            /**
+             * Returns the value of 'recommend_most_visited' from the MentsManager.
+             */
+            virtual bool recommends_most_visited_itfc() const;
+            
             /**
              * Implements the thts backup function for the node
              * 
@@ -240,8 +397,8 @@ namespace thts {
              *      trial_cumulative_return: unused
              */
             virtual void backup(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
@@ -261,7 +418,7 @@ namespace thts {
              * Returns:
              *      A pointer to a new MentsCNode object
              */
-            std::shared_ptr<MentsCNode> create_child_node_helper(std::shared_ptr<const Action> action) const;
+            std::shared_ptr<MentsCNode> create_child_node_helper(const std::shared_ptr<const Action>& action) const;
 
             /**
              * Returns a string representation of the value of this node currently. Used for pretty printing.
@@ -305,7 +462,7 @@ namespace thts {
              * Returns:
              *      A pointer to a new child chance node
              */
-            std::shared_ptr<MentsCNode> create_child_node(std::shared_ptr<const Action> action);
+            std::shared_ptr<MentsCNode> create_child_node(const std::shared_ptr<const Action>& action);
 
             /**
              * If this node has a child object corresponding to 'action'.
@@ -316,7 +473,7 @@ namespace thts {
              * Returns:
              *      true if we have a child corresponding to 'action'
              */
-            bool has_child_node(std::shared_ptr<const Action> action) const;
+            bool has_child_node(const std::shared_ptr<const Action>& action) const;
 
             /**
              * Retrieves a child node from the children map.
@@ -329,7 +486,7 @@ namespace thts {
              * Returns:
              *      A pointer to the child node corresponding to 'action'
              */
-            std::shared_ptr<MentsCNode> get_child_node(std::shared_ptr<const Action> action) const;
+            std::shared_ptr<MentsCNode> get_child_node(const std::shared_ptr<const Action>& action) const;
 
 
 
@@ -345,15 +502,16 @@ namespace thts {
             virtual std::shared_ptr<const Action> select_action_itfc(ThtsEnvContext& ctx);
             virtual std::shared_ptr<const Action> recommend_action_itfc(ThtsEnvContext& ctx) const;
             virtual void backup_itfc(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
 
             virtual std::shared_ptr<ThtsCNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Action> action) const;
-            // virtual std::shared_ptr<ThtsCNode> create_child_node_itfc(std::shared_ptr<const Action> action) final;
+                const std::shared_ptr<const Action>& action) const;
+            // virtual std::shared_ptr<ThtsCNode> create_child_node_itfc(
+            //    const std::shared_ptr<const Action>& action) final;
 
 
 
@@ -367,8 +525,8 @@ namespace thts {
         //     bool is_opponent() const;
         //     int get_num_children() const;
 
-        //     bool has_child_node_itfc(std::shared_ptr<const Action> action) const;
-        //     std::shared_ptr<ThtsCNode> get_child_node_itfc(std::shared_ptr<const Action> action) const;
+        //     bool has_child_node_itfc(const std::shared_ptr<const Action>& action) const;
+        //     std::shared_ptr<ThtsCNode> get_child_node_itfc(const std::shared_ptr<const Action>& action) const;
 
         //     std::string get_pretty_print_string(int depth) const;
 
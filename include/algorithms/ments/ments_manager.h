@@ -26,6 +26,16 @@ namespace thts {
         static const int recommend_visit_threshold_default=0;
         static const bool recommend_most_visited_default=false;
 
+        static const bool incremental_soft_backup_default=false;
+        static const int incremental_soft_backup_recompute_period_default=100;
+
+        static const bool use_progressive_widening_default=false;
+        static constexpr double progressive_widening_coeff_default=1.0;
+        static constexpr double progressive_widening_exponent_default=0.5;
+        static const bool use_chance_progressive_widening_default=false;
+        static constexpr double chance_progressive_widening_coeff_default=1.0;
+        static constexpr double chance_progressive_widening_exponent_default=0.5;
+
         double temp;
         double prior_policy_search_weight;
         double epsilon;
@@ -44,6 +54,16 @@ namespace thts {
         int recommend_visit_threshold;
         bool recommend_most_visited;
 
+        bool incremental_soft_backup;
+        int incremental_soft_backup_recompute_period;
+
+        bool use_progressive_widening;
+        double progressive_widening_coeff;
+        double progressive_widening_exponent;
+        bool use_chance_progressive_widening;
+        double chance_progressive_widening_coeff;
+        double chance_progressive_widening_exponent;
+
         MentsManagerArgs(std::shared_ptr<ThtsEnv> thts_env) :
             ThtsManagerArgs(thts_env),
             temp(temp_default),
@@ -59,7 +79,15 @@ namespace thts {
             shift_pseudo_q_values(shift_pseudo_q_values_default),
             psuedo_q_value_offset(psuedo_q_value_offset_default),
             recommend_visit_threshold(recommend_visit_threshold_default),
-            recommend_most_visited(recommend_most_visited_default) {}
+            recommend_most_visited(recommend_most_visited_default),
+            incremental_soft_backup(incremental_soft_backup_default),
+            incremental_soft_backup_recompute_period(incremental_soft_backup_recompute_period_default),
+            use_progressive_widening(use_progressive_widening_default),
+            progressive_widening_coeff(progressive_widening_coeff_default),
+            progressive_widening_exponent(progressive_widening_exponent_default),
+            use_chance_progressive_widening(use_chance_progressive_widening_default),
+            chance_progressive_widening_coeff(chance_progressive_widening_coeff_default),
+            chance_progressive_widening_exponent(chance_progressive_widening_exponent_default) {}
 
         virtual ~MentsManagerArgs() = default;
     };
@@ -123,6 +151,38 @@ namespace thts {
      *          to have a minimum number of samples before its a candidate for recommendation.
      *      recommend_most_visited:
      *          If we should recommend the most visited child node instead of the largest value.
+     * 
+     * Member variables (incremental backups):
+     *      incremental_soft_backup:
+     *          If true, decision nodes maintain the sum of exp(Q(s,a)/temp) (and the max term) between backups, and 
+     *          soft backups only update the term for the action selected in the trial, which is O(1) rather than 
+     *          O(|A|). The terms are fully recomputed whenever the temperature changes (e.g. with temperature decay), 
+     *          and periodically to avoid accumulating floating point errors. Only used by algorithms that use 
+     *          MentsDNode::backup_soft, and ignored by algorithms whose soft backup depends on more than the child 
+     *          values (e.g. RENTS). Also ignored when using a transposition table, as a child shared between parents 
+     *          can be backed up through another parent, which would leave a stale term for it in this parent's sum.
+     *      incremental_soft_backup_recompute_period:
+     *          The maximum number of incremental updates made between full recomputes of the soft backup terms.
+     * 
+     * Member variables (progressive widening):
+     *      use_progressive_widening:
+     *          If true, decision nodes use progressive widening: a decision node with N visits only considers its first 
+     *          ceil(progressive_widening_coeff * N^progressive_widening_exponent) actions (in both the search policy 
+     *          and soft backups), admitting actions in order of decreasing prior probability if there is a prior (and 
+     *          in a random order otherwise). See progressive_widening.h.
+     *      progressive_widening_coeff:
+     *          The coefficient (k) of the decision node widening limit k * N^alpha
+     *      progressive_widening_exponent:
+     *          The exponent (alpha) of the decision node widening limit k * N^alpha
+     *      use_chance_progressive_widening:
+     *          If true, chance nodes use progressive widening: a chance node with N visits only samples a new outcome 
+     *          from the environment if it has fewer than 
+     *          ceil(chance_progressive_widening_coeff * N^chance_progressive_widening_exponent) children, and 
+     *          otherwise samples an existing child in proportion to its visit count.
+     *      chance_progressive_widening_coeff:
+     *          The coefficient (k) of the chance node widening limit k * N^alpha
+     *      chance_progressive_widening_exponent:
+     *          The exponent (alpha) of the chance node widening limit k * N^alpha
      *          
      */
     class MentsManager : public ThtsManager {
@@ -145,6 +205,16 @@ namespace thts {
             int recommend_visit_threshold;
             bool recommend_most_visited;
 
+            bool incremental_soft_backup;
+            int incremental_soft_backup_recompute_period;
+
+            bool use_progressive_widening;
+            double progressive_widening_coeff;
+            double progressive_widening_exponent;
+            bool use_chance_progressive_widening;
+            double chance_progressive_widening_coeff;
+            double chance_progressive_widening_exponent;
+
             MentsManager(const MentsManagerArgs& args) :
                 ThtsManager(args),
                 temp(args.temp),
@@ -160,6 +230,14 @@ namespace thts {
                 shift_pseudo_q_values(args.shift_pseudo_q_values),
                 psuedo_q_value_offset(args.psuedo_q_value_offset),
                 recommend_visit_threshold(args.recommend_visit_threshold),
-                recommend_most_visited(args.recommend_most_visited) {};
+                recommend_most_visited(args.recommend_most_visited),
+                incremental_soft_backup(args.incremental_soft_backup),
+                incremental_soft_backup_recompute_period(args.incremental_soft_backup_recompute_period),
+                use_progressive_widening(args.use_progressive_widening),
+                progressive_widening_coeff(args.progressive_widening_coeff),
+                progressive_widening_exponent(args.progressive_widening_exponent),
+                use_chance_progressive_widening(args.use_chance_progressive_widening),
+                chance_progressive_widening_coeff(args.chance_progressive_widening_coeff),
+                chance_progressive_widening_exponent(args.chance_progressive_widening_exponent) {};
     };
 }
\ No newline at end of file
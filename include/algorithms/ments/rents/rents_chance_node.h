@@ -61,7 +61,8 @@ namespace thts {
              *      A pointer to a new RentsDNode object
              */
             std::shared_ptr<RentsDNode> create_child_node_helper(
-                std::shared_ptr<const State> observation, std::shared_ptr<const State> next_state=nullptr) const;
+                const std::shared_ptr<const State>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr) const;
 
 
 
@@ -74,6 +75,7 @@ namespace thts {
          */
         public:
             virtual std::shared_ptr<ThtsDNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Observation> observation, std::shared_ptr<const State> next_state=nullptr) const;
+                const std::shared_ptr<const Observation>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr) const;
     };
 }
\ No newline at end of file
@@ -13,11 +13,31 @@
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace thts {
     // forward declare corresponding RentsCNode class
     class RentsCNode;
 
+    /**
+     * The action distribution that a RentsDNode passes to its children through the context (see RentsDNode). Stored 
+     * inline in the context, so that it's reused between trials without allocating.
+     * 
+     * Member variables:
+     *      actions_id: 
+     *          Identifies the node's 'actions' vector (only compared, never dereferenced), so that children can cache 
+     *          how their actions map to the node's actions
+     *      actions:
+     *          The node's actions. The node (and so its actions) outlives the trial
+     *      probs:
+     *          The probability of each action in 'actions', indexed the same as 'actions'
+     */
+    struct RentsActionDistr {
+        const void* actions_id = nullptr;
+        std::vector<const Action*> actions;
+        std::vector<double> probs;
+    };
+
     /**
      * An implementation of RENTS in the Thts schema
      * 
@@ -30,8 +50,12 @@ namespace thts {
      * questionable if RENTS may be useful in that case?)
      * 
      * Member variables:
-     *      _node_distr_key: A key to use for storing this node's select action distribution in context's.
-     *      _parent_distr_key: A key to use for accessing the parent's distribution from context's.
+     *      _node_distr_slot: A context slot to store this node's select action distribution in.
+     *      _parent_distr_slot: A context slot to get the parent's distribution from (invalid for the root node).
+     *      parent_actions_id: The 'actions_id' of the parent distribution that 'parent_action_indices' was computed for
+     *      parent_action_indices: 
+     *          The index in the parent distribution of each action in 'actions' (or 'npos' if the parent doesn't have 
+     *          the action). Only accessed while holding this node's lock
      */
     class RentsDNode : public MentsDNode {
         // Allow RentsCNode access to private members
@@ -41,8 +65,19 @@ namespace thts {
          * Core RentsDNode implementation.
          */
         protected:
-            std::string _node_distr_key;
-            std::string _parent_distr_key;
+            static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+            ThtsEnvContextSlot<RentsActionDistr> _node_distr_slot;
+            ThtsEnvContextSlot<RentsActionDistr> _parent_distr_slot;
+            mutable const void* parent_actions_id;
+            mutable std::vector<std::size_t> parent_action_indices;
+
+            /**
+             * Gets the context slot used to pass distributions from decision nodes at 'decision_depth' to their 
+             * children. Slots are cached per thread, so that constructing a node doesn't build the slot name or lock 
+             * the slot registry.
+             */
+            static ThtsEnvContextSlot<RentsActionDistr> get_distr_slot(int decision_depth);
 
             /**
              * Gets the action distribution for a parent node 
@@ -54,33 +89,20 @@ namespace thts {
              *      The action distribution the parent node used, or, nullptr if this node has no parent decision node 
              *      (i.e. it is the root node/top level node)
             */
-            std::shared_ptr<ActionDistr> get_parent_distr_from_context(ThtsEnvContext& ctx) const;
-
-            /**
-             * Puts the action distribution for this node into the thts env context
-             * 
-             * Args:
-             *      action_distr: The distribution over actions computed in the select action phase to be stored
-             *      ctx: A thts env context to store the distribution
-            */
-           void put_node_distr_in_context(std::shared_ptr<ActionDistr> action_distr, ThtsEnvContext& ctx) const;
+            const RentsActionDistr* get_parent_distr_from_context(ThtsEnvContext& ctx) const;
 
            /**
-            * Get prob from parent distribution (handling boundary cases at the root node)
-            * 
-            * For the boundary case at. theroot node, we always return a probability of 1.0, so that the normal 
-            * ments distribution can be computed.
+            * Gets the index in 'parent_distr' of each action in 'actions', recomputing 'parent_action_indices' if it 
+            * was computed for a different parent distribution (e.g. if there are multiple parents when using a 
+            * transposition table, or if actions were added with progressive widening).
             * 
             * Args:
-            *       parent_distr: The parent distribtion over actions (possibly nullptr)
-            *       action: The action to get a probability for 
+            *       parent_distr: The parent distribtion over actions
             * 
             * Returns:
-            *       The probability that the parent distribution would sample 'action' (or a const 1.0 in the boundary 
-            *       root node case)
+            *       The index in 'parent_distr' of each action in 'actions', or 'npos' if the parent doesn't have it
            */
-          double get_parent_action_prob(
-            std::shared_ptr<ActionDistr> parent_distr, std::shared_ptr<const Action> action) const;
+          const std::vector<std::size_t>& get_parent_action_indices(const RentsActionDistr& parent_distr) const;
 
             /**
              * Computes the weights for each action.
@@ -91,8 +113,8 @@ namespace thts {
              * 
              * Args:
              *      action_weights: 
-             *          An ActionDistr to be filled with values of the form exp(q_value/temp - C), where C is equal to
-             *          max(q_value/temp)
+             *          A vector to be filled with values of the form P(a) * exp(q_value/temp - C), where C is equal to
+             *          max(q_value/temp) and P(a) is the parents probability of 'a', indexed the same as 'actions'
              *      sun_action_weights:
              *          A double reference to be filled with the sum of all the weights in 'action_weights'
              *      normalisation_term:
@@ -101,11 +123,20 @@ namespace thts {
              *          A thts env context
              */
             virtual void compute_action_weights(
-                ActionDistr& action_weights, 
+                std::vector<double>& action_weights, 
                 double& sum_action_weights, 
                 double& normalisation_term, 
                 ThtsEnvContext& context) const;
 
+            /**
+             * Rents action weights depend on the parent's distribution (from the context), which can change every 
+             * trial, so soft backups can't be computed incrementally.
+             * 
+             * Returns:
+             *      false
+             */
+            virtual bool supports_incremental_soft_backup() const;
+
             /**
              * Implements select_action for rents.
              * 
@@ -166,7 +197,7 @@ namespace thts {
              * Returns:
              *      A pointer to a new MentsCNode object
              */
-            std::shared_ptr<RentsCNode> create_child_node_helper(std::shared_ptr<const Action> action) const;
+            std::shared_ptr<RentsCNode> create_child_node_helper(const std::shared_ptr<const Action>& action) const;
 
 
 
@@ -179,6 +210,6 @@ namespace thts {
          */
         public:
             virtual std::shared_ptr<ThtsCNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Action> action) const;
+                const std::shared_ptr<const Action>& action) const;
     };
 }
@@ -62,12 +62,14 @@ namespace thts {
              * 
              * Args:
              *      action: The action that we want a value for
+             *      position_hint: The index of 'action' in 'actions' if known (see 'get_soft_q_value')
              * 
              * Returns:
              *      The soft value corresponding to the child at 'action', divided by the temperature
              * 
             */
-            double get_soft_q_value_over_temp(std::shared_ptr<const Action> action) const;
+            double get_soft_q_value_over_temp(
+                const std::shared_ptr<const Action>& action, std::size_t position_hint=CNodeChildMap::npos) const;
 
             /**
              * Updates the 'qval_to_act' and 'act_to_qval' maps.
@@ -78,7 +80,7 @@ namespace thts {
              *      action: The action to be updated in the maps
              *      new_q_value: The new q_value (over temp) to be updated in the maps
             */
-            void update_maps(std::shared_ptr<const Action> action, double new_q_value);
+            void update_maps(const std::shared_ptr<const Action>& action, double new_q_value);
 
             /**
              * Computes the sparse action set for this node.
@@ -108,7 +110,7 @@ namespace thts {
              * 
              * Args:
              *      action_weights: 
-             *          An ActionDistr to be filled with weights for each action
+             *          A vector to be filled with weights for each action, indexed the same as 'actions'
              *      sun_action_weights:
              *          A double reference to be filled with the sum of all the weights in 'action_weights'
              *      normalisation_term:
@@ -117,7 +119,7 @@ namespace thts {
              *          A thts env context
              */
             virtual void compute_action_weights(
-                ActionDistr& action_weights, 
+                std::vector<double>& action_weights, 
                 double& sum_action_weights, 
                 double& normalisation_term, 
                 ThtsEnvContext& context) const;
@@ -184,8 +186,8 @@ namespace thts {
              *      ctx: A thts env context
              */
             virtual void backup(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
@@ -205,7 +207,7 @@ namespace thts {
              * Returns:
              *      A pointer to a new MentsCNode object
              */
-            std::shared_ptr<TentsCNode> create_child_node_helper(std::shared_ptr<const Action> action) const;
+            std::shared_ptr<TentsCNode> create_child_node_helper(const std::shared_ptr<const Action>& action) const;
 
 
 
@@ -218,6 +220,6 @@ namespace thts {
          */
         public:
             virtual std::shared_ptr<ThtsCNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Action> action) const;
+                const std::shared_ptr<const Action>& action) const;
     };
 }
@@ -34,7 +34,7 @@ namespace thts {
             /**
              * Helper to make a PuctDNode child object.
              */
-            std::shared_ptr<PuctDNode> create_child_node_helper(std::shared_ptr<const State> observation) const; 
+            std::shared_ptr<PuctDNode> create_child_node_helper(const std::shared_ptr<const State>& observation) const;
 
         public:
             /**
@@ -42,6 +42,7 @@ namespace thts {
              * create the correct PuctDNode using the above version of create_child_node
              */
             virtual std::shared_ptr<ThtsDNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Observation> observation, std::shared_ptr<const State> next_state=nullptr) const;
+                const std::shared_ptr<const Observation>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr) const;
     };
 }
\ No newline at end of file
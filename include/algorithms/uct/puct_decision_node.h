@@ -41,16 +41,22 @@ namespace thts {
              */
             virtual double compute_ucb_term(int num_visits, int child_visits) const;
 
+            /**
+             * Implements the coefficient for the puct form of the ucb term, for the dense ucb kernel.
+             */
+            virtual double compute_ucb_term_coeff(int num_visits, UcbVisitsScaling& scaling) const;
+
             /**
              * Helper to make a PuctCNode child object.
              */
-            std::shared_ptr<PuctCNode> create_child_node_helper(std::shared_ptr<const Action> action) const;
+            std::shared_ptr<PuctCNode> create_child_node_helper(const std::shared_ptr<const Action>& action) const;
 
         public:
             /**
              * Override create_child_node_helper_itfc, so that the ThtsDNode create_child_node_itfc function can 
              * create the correct PuctCNode using the above version of create_child_node
              */
-            virtual std::shared_ptr<ThtsCNode> create_child_node_helper_itfc(std::shared_ptr<const Action> action) const;
+            virtual std::shared_ptr<ThtsCNode> create_child_node_helper_itfc(
+                const std::shared_ptr<const Action>& action) const;
     };
 }
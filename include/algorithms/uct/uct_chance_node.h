@@ -2,6 +2,7 @@
 
 #include "algorithms/uct/uct_decision_node.h"
 #include "algorithms/uct/uct_manager.h"
+#include "distributions/categorical_distribution.h"
 #include "thts_chance_node.h"
 #include "thts_decision_node.h"
 #include "thts_env_context.h"
@@ -21,7 +22,11 @@ namespace thts {
      * 
      * Member variables:
      *      next_state_distr: 
-     *          A cached StateDistribution, representing the distribution over possible next states
+     *          A cached StateDistribution, representing the distribution over possible next states (or nullptr if 
+     *          'use_generative_model' is set in the manager, in which case next states are sampled from the env)
+     *      next_state_sampler:
+     *          An alias table for 'next_state_distr', constructed once in the constructor, so that sampling next 
+     *          states takes O(1) time
      *      num_backups: 
      *          The number of times backup has been called at this node
      *      avg_return: 
@@ -35,9 +40,10 @@ namespace thts {
          * Core UctCNode implementation.
          */
         protected:
-            int num_backups;
-            double avg_return;
+            RelaxedAtomic<int> num_backups;
+            RelaxedAtomic<double> avg_return;
             std::shared_ptr<StateDistr> next_state_distr;
+            CategoricalDistribution<std::shared_ptr<const State>> next_state_sampler;
 
             /**
              * Handles the thts sample_observation function by randomly sampling.
@@ -107,8 +113,8 @@ namespace thts {
              *          Sum of rewards in both of the 'trial_rewards_after_node' and 'trial_rewards_before_node' lists
              */
             void backup(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
@@ -128,7 +134,7 @@ namespace thts {
              * Returns:
              *      A pointer to a new UctDNode object
              */
-            std::shared_ptr<UctDNode> create_child_node_helper(std::shared_ptr<const State> observation) const; 
+            std::shared_ptr<UctDNode> create_child_node_helper(const std::shared_ptr<const State>& observation) const; 
 
             /**
              * Returns a string representation of the value of this node currently. Used for pretty printing.
@@ -172,7 +178,7 @@ namespace thts {
              * Returns:
              *      A pointer to a new child chance node
              */
-            std::shared_ptr<UctDNode> create_child_node(std::shared_ptr<const State> observation);
+            std::shared_ptr<UctDNode> create_child_node(const std::shared_ptr<const State>& observation);
 
             /**
              * If this node has a child object corresponding to 'observation'.
@@ -183,7 +189,7 @@ namespace thts {
              * Returns:
              *      true if we have a child corresponding to 'observation'
              */
-            bool has_child_node(std::shared_ptr<const State> observation) const;
+            bool has_child_node(const std::shared_ptr<const State>& observation) const;
 
             /**
              * Retrieves a child node from the children map.
@@ -196,7 +202,7 @@ namespace thts {
              * Returns:
              *      A pointer to the child node corresponding to 'observation'
              */
-            std::shared_ptr<UctDNode> get_child_node(std::shared_ptr<const State> observation) const;
+            std::shared_ptr<UctDNode> get_child_node(const std::shared_ptr<const State>& observation) const;
 
 
 
@@ -211,16 +217,18 @@ namespace thts {
             virtual void visit_itfc(ThtsEnvContext& ctx);
             virtual std::shared_ptr<const Observation> sample_observation_itfc(ThtsEnvContext& ctx);
             virtual void backup_itfc(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
 
             virtual std::shared_ptr<ThtsDNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Observation> observation, std::shared_ptr<const State> next_state=nullptr) const;
+                const std::shared_ptr<const Observation>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr) const;
             // virtual std::shared_ptr<ThtsDNode> create_child_node_itfc(
-            //    std::shared_ptr<const Observation> observation, std::shared_ptr<const State> next_state=nullptr) final;
+            //    const std::shared_ptr<const Observation>& observation,
+            //    const std::shared_ptr<const State>& next_state=nullptr) final;
                 
 
 
@@ -232,8 +240,9 @@ namespace thts {
         //     bool is_opponent() const;
         //     int get_num_children() const;
 
-        //     bool has_child_node_itfc(std::shared_ptr<const Observation> observation) const;
-        //     std::shared_ptr<ThtsDNode> get_child_node_itfc(std::shared_ptr<const Observation> observation) const;
+        //     bool has_child_node_itfc(const std::shared_ptr<const Observation>& observation) const;
+        //     std::shared_ptr<ThtsDNode> get_child_node_itfc(
+        //        const std::shared_ptr<const Observation>& observation) const;
 
         //     std::string get_pretty_print_string(int depth) const;
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "algorithms/common/ucb_kernel.h"
 #include "algorithms/uct/uct_chance_node.h"
 #include "algorithms/uct/uct_manager.h"
 #include "thts_chance_node.h"
@@ -11,6 +12,7 @@
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace thts {
 
@@ -27,10 +29,22 @@ namespace thts {
      *      avg_return: 
      *          The average return from this node
      *      actions: 
-     *          A cached list of actions
+     *          A cached list of actions. If using progressive widening, this is the list of actions admitted so far
      *      policy_prior: 
      *          A map from actions to probabilities representing a policy prior (over action/child nodes). The default 
      *          value of nullptr is used to indicate 
+     *      dense_policy_prior:
+     *          The probabilities from 'policy_prior' in a contiguous array, indexed the same as 'actions' (empty if 
+     *          there is no prior)
+     *      ucb_values_buffer:
+     *          A contiguous buffer that ucb values are computed in, indexed the same as 'actions'. Only used while 
+     *          holding this node's lock
+     *      child_visits_buffer:
+     *          A contiguous buffer of child visit counts, indexed the same as 'actions'. Only used while holding this 
+     *          node's lock
+     *      widening_actions:
+     *          If using progressive widening, all of the valid actions, in the order that they are admitted to 
+     *          'actions' (see progressive_widening.h). Otherwise nullptr
      */
     class UctDNode : public ThtsDNode {
         // Allow UctCNode and UctLogger access to private members
@@ -41,10 +55,20 @@ namespace thts {
          * Core UctDNode implementation.
          */
         protected:
-            int num_backups;
-            double avg_return;
+            RelaxedAtomic<int> num_backups;
+            RelaxedAtomic<double> avg_return;
             std::shared_ptr<ActionVector> actions;
             std::shared_ptr<ActionPrior> policy_prior;
+            std::vector<double> dense_policy_prior;
+            std::vector<double> ucb_values_buffer;
+            std::vector<double> child_visits_buffer;
+            std::shared_ptr<ActionVector> widening_actions;
+
+            /**
+             * Admits actions from 'widening_actions' to 'actions', until there are as many actions as the progressive 
+             * widening limit for the current number of visits allows. Does nothing if not using progressive widening.
+             */
+            void widen_actions();
 
             /**
              * Returns if we have a valid 'policy_prior' to use.
@@ -86,6 +110,35 @@ namespace thts {
             virtual void fill_ucb_values(
                 std::unordered_map<std::shared_ptr<const Action>,double>& ucb_values, ThtsEnvContext& ctx) const;
 
+            /**
+             * Computes the coefficient of the exploration term for the (dense) ucb kernel, which is computed once per 
+             * call to 'fill_dense_ucb_values'. The exploration term for a child is then 
+             * 'coeff * f(child_visits)', which should equal 'compute_ucb_term(num_visits, child_visits)'.
+             * 
+             * Subclasses that override 'compute_ucb_term' should override this too.
+             * 
+             * Args:
+             *      num_visits: The number of visits to this node
+             *      scaling: A reference to be filled with how the term scales with child visits (the function 'f')
+             * 
+             * Returns:
+             *      The coefficient of the exploration term
+             */
+            virtual double compute_ucb_term_coeff(int num_visits, UcbVisitsScaling& scaling) const;
+
+            /**
+             * Dense version of 'fill_ucb_values', that computes the same values into contiguous arrays indexed the 
+             * same as 'actions'. Child statistics are gathered in a single pass over the children, and then the 
+             * exploration terms are added by the (vectorised) ucb kernel (see ucb_kernel.h).
+             * 
+             * Args:
+             *      ucb_values: A vector to be filled with ucb values
+             *      child_visits: A vector to be filled with the visit counts of children (used by the kernel)
+             *      ctx: The thts context given to a select aciton call
+             */
+            void fill_dense_ucb_values(
+                std::vector<double>& ucb_values, std::vector<double>& child_visits, ThtsEnvContext& ctx) const;
+
             /**
              * Implementation of thts 'select_action' function: that selects actions according to a hybrid 
              * implementation of the ucb and pucb algorithms.
@@ -180,6 +233,20 @@ namespace thts {
              */
             std::shared_ptr<const Action> recommend_action(ThtsEnvContext& ctx) const;
             
+            /**
+             * Fills 'child_stats' with the visit counts and average returns of the children of this node. Used to 
+             * merge recommendations over independent trees.
+             * 
+             * Args:
+             *      child_stats: A map to fill with the statistics for each child of this node
+             */
+            virtual void fill_child_recommendation_stats_itfc(ChildRecommendationStatsMap& child_stats) const;
+
+            /**
+             * Returns the value of 'recommend_most_visited' from the UctManager.
+             */
+            virtual bool recommends_most_visited_itfc() const;
+            
             /**
              * Implements the thts backup function for the node
              * 
@@ -198,8 +265,8 @@ namespace thts {
              *          Sum of rewards in both of the 'trial_rewards_after_node' and 'trial_rewards_before_node' lists
              */
             void backup(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
@@ -219,7 +286,7 @@ namespace thts {
              * Returns:
              *      A pointer to a new UctCNode object
              */
-            std::shared_ptr<UctCNode> create_child_node_helper(std::shared_ptr<const Action> action) const;
+            std::shared_ptr<UctCNode> create_child_node_helper(const std::shared_ptr<const Action>& action) const;
 
             /**
              * Returns a string representation of the value of this node currently. Used for pretty printing.
@@ -263,7 +330,7 @@ namespace thts {
              * Returns:
              *      A pointer to a new child chance node
              */
-            std::shared_ptr<UctCNode> create_child_node(std::shared_ptr<const Action> action);
+            std::shared_ptr<UctCNode> create_child_node(const std::shared_ptr<const Action>& action);
 
             /**
              * If this node has a child object corresponding to 'action'.
@@ -274,7 +341,7 @@ namespace thts {
              * Returns:
              *      true if we have a child corresponding to 'action'
              */
-            bool has_child_node(std::shared_ptr<const Action> action) const;
+            bool has_child_node(const std::shared_ptr<const Action>& action) const;
 
             /**
              * Retrieves a child node from the children map.
@@ -287,7 +354,7 @@ namespace thts {
              * Returns:
              *      A pointer to the child node corresponding to 'action'
              */
-            std::shared_ptr<UctCNode> get_child_node(std::shared_ptr<const Action> action) const;
+            std::shared_ptr<UctCNode> get_child_node(const std::shared_ptr<const Action>& action) const;
 
 
 
@@ -304,14 +371,16 @@ namespace thts {
             virtual std::shared_ptr<const Action> select_action_itfc(ThtsEnvContext& ctx);
             virtual std::shared_ptr<const Action> recommend_action_itfc(ThtsEnvContext& ctx) const;
             virtual void backup_itfc(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
 
-            virtual std::shared_ptr<ThtsCNode> create_child_node_helper_itfc(std::shared_ptr<const Action> action) const;
-            // virtual std::shared_ptr<ThtsCNode> create_child_node_itfc(std::shared_ptr<const Action> action) final;
+            virtual std::shared_ptr<ThtsCNode> create_child_node_helper_itfc(
+                const std::shared_ptr<const Action>& action) const;
+            // virtual std::shared_ptr<ThtsCNode> create_child_node_itfc(
+            //    const std::shared_ptr<const Action>& action) final;
 
 
 
@@ -325,8 +394,8 @@ namespace thts {
         //     bool is_opponent() const;
         //     int get_num_children() const;
 
-        //     bool has_child_node_itfc(std::shared_ptr<const Action> action) const;
-        //     std::shared_ptr<ThtsCNode> get_child_node_itfc(std::shared_ptr<const Action> action);
+        //     bool has_child_node_itfc(const std::shared_ptr<const Action>& action) const;
+        //     std::shared_ptr<ThtsCNode> get_child_node_itfc(const std::shared_ptr<const Action>& action);
 
         //     std::string get_pretty_print_string(int depth) const;
 
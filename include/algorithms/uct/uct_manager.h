@@ -14,18 +14,40 @@ namespace thts {
         static const int heuristic_psuedo_trials_default=0;
         static const bool recommend_most_visited_default=true;
         static constexpr double epsilon_exploration_default=0.0;
+        static const bool use_dense_ucb_values_default=true;
+        static const bool use_progressive_widening_default=false;
+        static constexpr double progressive_widening_coeff_default=1.0;
+        static constexpr double progressive_widening_exponent_default=0.5;
+        static const bool use_chance_progressive_widening_default=false;
+        static constexpr double chance_progressive_widening_coeff_default=1.0;
+        static constexpr double chance_progressive_widening_exponent_default=0.5;
 
         double bias;
         int heuristic_psuedo_trials;
         bool recommend_most_visited;
         double epsilon_exploration;
+        bool use_dense_ucb_values;
+
+        bool use_progressive_widening;
+        double progressive_widening_coeff;
+        double progressive_widening_exponent;
+        bool use_chance_progressive_widening;
+        double chance_progressive_widening_coeff;
+        double chance_progressive_widening_exponent;
 
         UctManagerArgs(std::shared_ptr<ThtsEnv> thts_env) :
             ThtsManagerArgs(thts_env),
             bias(bias_default),
             heuristic_psuedo_trials(heuristic_psuedo_trials_default),
             recommend_most_visited(recommend_most_visited_default),
-            epsilon_exploration(epsilon_exploration_default) {}
+            epsilon_exploration(epsilon_exploration_default),
+            use_dense_ucb_values(use_dense_ucb_values_default),
+            use_progressive_widening(use_progressive_widening_default),
+            progressive_widening_coeff(progressive_widening_coeff_default),
+            progressive_widening_exponent(progressive_widening_exponent_default),
+            use_chance_progressive_widening(use_chance_progressive_widening_default),
+            chance_progressive_widening_coeff(chance_progressive_widening_coeff_default),
+            chance_progressive_widening_exponent(chance_progressive_widening_exponent_default) {}
 
         virtual ~UctManagerArgs() = default;
     };
@@ -48,6 +70,28 @@ namespace thts {
      *          Defines the proportion of time to be spent exploring uniformly randomly (i.e. select a random action 
      *          rather than using the UCB formula). Default set to zero and to purely use the primary action selection. 
      *          This value should be in the range [0,1].
+     *      use_dense_ucb_values:
+     *          If true, decision nodes compute ucb values into contiguous arrays (indexed the same as their actions) 
+     *          using the (vectorised) ucb kernel (see ucb_kernel.h), rather than into an unordered_map using 
+     *          'compute_ucb_term' per action. Both give the same values (up to floating point rounding).
+     *      use_progressive_widening:
+     *          If true, decision nodes use progressive widening: a decision node with N visits only considers its first 
+     *          ceil(progressive_widening_coeff * N^progressive_widening_exponent) actions, admitting actions in order 
+     *          of decreasing prior probability if there is a prior (and in a random order otherwise). See 
+     *          progressive_widening.h.
+     *      progressive_widening_coeff:
+     *          The coefficient (k) of the decision node widening limit k * N^alpha
+     *      progressive_widening_exponent:
+     *          The exponent (alpha) of the decision node widening limit k * N^alpha
+     *      use_chance_progressive_widening:
+     *          If true, chance nodes use progressive widening (i.e. double progressive widening, if decision nodes do 
+     *          too): a chance node with N visits only samples a new outcome from the environment if it has fewer than 
+     *          ceil(chance_progressive_widening_coeff * N^chance_progressive_widening_exponent) children, and 
+     *          otherwise samples an existing child in proportion to its visit count.
+     *      chance_progressive_widening_coeff:
+     *          The coefficient (k) of the chance node widening limit k * N^alpha
+     *      chance_progressive_widening_exponent:
+     *          The exponent (alpha) of the chance node widening limit k * N^alpha
      */
     class UctManager : public ThtsManager {
         public:
@@ -58,12 +102,27 @@ namespace thts {
             int heuristic_psuedo_trials;
             bool recommend_most_visited;
             double epsilon_exploration;
+            bool use_dense_ucb_values;
+
+            bool use_progressive_widening;
+            double progressive_widening_coeff;
+            double progressive_widening_exponent;
+            bool use_chance_progressive_widening;
+            double chance_progressive_widening_coeff;
+            double chance_progressive_widening_exponent;
 
             UctManager(const UctManagerArgs& args) :
                 ThtsManager(args),
                 bias(args.bias),
                 heuristic_psuedo_trials(args.heuristic_psuedo_trials),
                 recommend_most_visited(args.recommend_most_visited),
-                epsilon_exploration(args.epsilon_exploration) {};
+                epsilon_exploration(args.epsilon_exploration),
+                use_dense_ucb_values(args.use_dense_ucb_values),
+                use_progressive_widening(args.use_progressive_widening),
+                progressive_widening_coeff(args.progressive_widening_coeff),
+                progressive_widening_exponent(args.progressive_widening_exponent),
+                use_chance_progressive_widening(args.use_chance_progressive_widening),
+                chance_progressive_widening_coeff(args.chance_progressive_widening_coeff),
+                chance_progressive_widening_exponent(args.chance_progressive_widening_exponent) {};
     };
 }
\ No newline at end of file
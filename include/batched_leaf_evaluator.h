@@ -0,0 +1,171 @@
+#pragma once
+
+#include "thts_types.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace thts {
+    // forward declare
+    class ThtsManager;
+
+    /**
+     * The result of evaluating a (leaf) state with a BatchedLeafEvaluator.
+     *
+     * Member variables:
+     *      heuristic_value:
+     *          The heuristic value of the state (zero if the heuristic wasn't requested, or there is no heuristic)
+     *      policy_prior:
+     *          The policy prior for the state, or nullptr if the manager doesn't have a prior function
+     */
+    struct LeafEvaluation {
+        double heuristic_value = 0.0;
+        std::shared_ptr<ActionPrior> policy_prior;
+    };
+
+    /**
+     * An in-process evaluator that batches calls to the heuristic and prior functions of a ThtsManager.
+     *
+     * Heuristics and priors are often model evaluations that are much cheaper per state when evaluated in a batch.
+     * When a ThtsManager is constructed with 'use_batched_evaluation', decision nodes evaluate their state with
+     * 'evaluate' (see the ThtsDNode constructor), which queues the state and parks the calling thread until its batch
+     * has been evaluated. An evaluator thread owned by this object evaluates the queued states in batches, using the
+     * managers heuristic and prior evaluators, or 'batch_heuristic_fn' and 'batch_prior_fn' (falling back to calling
+     * 'heuristic_fn' and 'prior_fn' on each state in the batch, see ThtsManager::compute_heuristic_values).
+     *
+     * A batch is dispatched when any of the following hold:
+     * - 'batch_size' states are queued;
+     * - every active worker (see 'add_active_worker') is parked waiting on an evaluation, so no more states can be
+     *      queued (with no active workers, for example when a root node is constructed, states are evaluated
+     *      immediately);
+     * - the oldest queued state has waited for 'max_latency'.
+     *
+     * A parked trial keeps the virtual loss it added to the chance nodes on its path (see ThtsPool), so other trials
+     * are steered away from the pending leaf while it's evaluated. Because a parked thread is waiting on a single
+     * state, batches can be at most as large as the number of threads running trials.
+     *
+     * Exceptions thrown by the heuristic or prior functions are rethrown from 'evaluate' in the threads that queued
+     * the states of the batch.
+     *
+     * Member variables:
+     *      thts_manager:
+     *          The manager whose heuristic and prior functions are used to evaluate states. The evaluator is owned by
+     *          the manager (see ThtsManager::leaf_evaluator)
+     *      batch_size:
+     *          The maximum number of states to evaluate in a batch
+     *      max_latency:
+     *          The maximum time to wait for a batch to fill up before dispatching it
+     *      evaluator_lock:
+     *          A mutex protecting all of the following member variables
+     *      queue_cv:
+     *          Condition variable that the evaluator thread waits on for requests to be queued
+     *      evaluated_cv:
+     *          Condition variable that parked threads wait on for their request to be evaluated
+     *      queue:
+     *          The requests waiting to be put into a batch
+     *      num_active_workers:
+     *          The number of threads currently running trials that may queue a request
+     *      num_batches:
+     *          The number of batches evaluated so far
+     *      num_evaluations:
+     *          The number of states evaluated so far
+     *      is_alive:
+     *          Set to false to make the evaluator thread exit (once the queue is empty)
+     *      evaluator_thread:
+     *          The thread that evaluates batches
+     */
+    class BatchedLeafEvaluator {
+        protected:
+            /**
+             * A queued state, and the result of evaluating it. Requests live on the stack of the parked thread.
+             */
+            struct Request {
+                std::shared_ptr<const State> state;
+                bool evaluate_heuristic;
+                std::chrono::steady_clock::time_point queued_time;
+                LeafEvaluation evaluation;
+                std::exception_ptr error;
+                bool is_evaluated = false;
+            };
+
+            ThtsManager& thts_manager;
+            std::size_t batch_size;
+            std::chrono::duration<double> max_latency;
+
+            std::mutex evaluator_lock;
+            std::condition_variable queue_cv;
+            std::condition_variable evaluated_cv;
+            std::deque<Request*> queue;
+            int num_active_workers;
+            std::size_t num_batches;
+            std::size_t num_evaluations;
+            bool is_alive;
+
+            std::thread evaluator_thread;
+
+            /**
+             * If a batch should be dispatched now. Requires 'evaluator_lock' to be held.
+             */
+            bool should_dispatch_batch() const;
+
+            /**
+             * Evaluates the states of a batch, writing the results into the requests. Called without holding
+             * 'evaluator_lock'.
+             */
+            void evaluate_batch(const std::vector<Request*>& batch);
+
+            /**
+             * The evaluator thread function. Waits for requests to be queued, and evaluates them in batches.
+             */
+            void evaluator_fn();
+
+        public:
+            /**
+             * Constructor. Starts the evaluator thread.
+             *
+             * Args:
+             *      thts_manager: The manager whose heuristic and prior functions to use
+             *      batch_size: The maximum number of states to evaluate in a batch
+             *      max_latency: The maximum time (in seconds) to wait for a batch to fill up
+             */
+            BatchedLeafEvaluator(ThtsManager& thts_manager, std::size_t batch_size, double max_latency);
+
+            /**
+             * Destructor. Evaluates any states that are still queued, and joins the evaluator thread.
+             */
+            virtual ~BatchedLeafEvaluator();
+
+            /**
+             * Queues 'state' to be evaluated, and parks the calling thread until it has been.
+             *
+             * Args:
+             *      state: The state to evaluate
+             *      evaluate_heuristic: If the heuristic should be evaluated (the prior is always evaluated)
+             *
+             * Returns:
+             *      The heuristic value and policy prior for 'state'
+             */
+            LeafEvaluation evaluate(std::shared_ptr<const State> state, bool evaluate_heuristic=true);
+
+            /**
+             * Indicates that the calling thread has started (or stopped) running trials. Used by ThtsPool so that
+             * batches are dispatched as soon as all of its workers are parked.
+             */
+            void add_active_worker();
+            void remove_active_worker();
+
+            /**
+             * Getters for the number of batches and the number of states that have been evaluated
+             */
+            std::size_t get_num_batches();
+            std::size_t get_num_evaluations();
+    };
+}
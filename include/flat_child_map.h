@@ -0,0 +1,226 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace thts {
+    /**
+     * A map from (shared_ptr) keys to child nodes, stored in a flat array, used for the 'children' of nodes. 
+     * 
+     * Provides the parts of the 'std::unordered_map' interface that are used with 'children', but avoids hashing 
+     * through the virtual 'hash' functions of Action and Observation objects for most lookups:
+     *      - Entries are stored densely in a vector, in the order that they are added. 
+     *      - Slots can be reserved for keys in a fixed order (see 'reserve_keys'), so that decision nodes can store 
+     *          their children in the same order as 'actions', and look them up by position using 'find(key, pos)'.
+     *      - Maps with at most 'small_size' slots (e.g. chance nodes with few outcomes) are searched linearly, 
+     *          comparing key pointers first (the same Action objects from 'actions' are usually used to look up 
+     *          children), and only then comparing by value. 
+     *      - Larger maps look up keys without a position hint in a hash index (by value), which is built lazily the 
+     *          first time that it's needed, so nodes that are only ever looked up by position never hash their keys.
+     * 
+     * Reserved slots that haven't been assigned a value are not considered to be in the map (and are skipped by 
+     * iteration, 'find', 'size' and so on).
+     * 
+     * Const lookups may be made concurrently (e.g. when evaluating a static tree from multiple threads), so the lazily 
+     * built index is published with an atomic compare and swap. Non-const functions require exclusive access.
+     * 
+     * Member variables:
+     *      entries:
+     *          The (key,value) pairs in the map, including reserved slots
+     *      occupied:
+     *          If each slot in 'entries' has been assigned a value (is in the map)
+     *      num_occupied:
+     *          The number of occupied slots, i.e. the size of the map
+     *      key_index:
+     *          A map from keys (hashed by value) to positions in 'entries', or nullptr if it hasn't been built yet. 
+     *          Only built when there are more than 'small_size' slots
+     */
+    template <typename K, typename V>
+    class FlatChildMap {
+        public:
+            typedef K key_type;
+            typedef V mapped_type;
+            typedef std::pair<const K,V> value_type;
+            typedef std::size_t size_type;
+
+            static constexpr size_type small_size = 8;
+            static constexpr size_type npos = static_cast<size_type>(-1);
+
+            /**
+             * Forward iterator over the occupied slots.
+             */
+            template <bool is_const>
+            class base_iterator {
+                friend FlatChildMap;
+
+                protected:
+                    typedef std::conditional_t<is_const, const FlatChildMap*, FlatChildMap*> map_pointer;
+
+                    map_pointer map;
+                    size_type pos;
+
+                    base_iterator(map_pointer map, size_type pos) : map(map), pos(pos) {
+                        skip_unoccupied();
+                    }
+
+                    void skip_unoccupied() {
+                        while (pos < map->entries.size() && !map->occupied[pos]) pos++;
+                    }
+
+                public:
+                    typedef std::forward_iterator_tag iterator_category;
+                    typedef FlatChildMap::value_type value_type;
+                    typedef std::ptrdiff_t difference_type;
+                    typedef std::conditional_t<is_const, const value_type*, value_type*> pointer;
+                    typedef std::conditional_t<is_const, const value_type&, value_type&> reference;
+
+                    base_iterator() : map(nullptr), pos(0) {}
+
+                    template <bool other_is_const, typename = std::enable_if_t<is_const && !other_is_const>>
+                    base_iterator(const base_iterator<other_is_const>& other) : map(other.map), pos(other.pos) {}
+
+                    reference operator*() const { return map->entries[pos]; }
+                    pointer operator->() const { return &map->entries[pos]; }
+
+                    /**
+                     * Returns the position of the entry's slot. Slots are never moved (until the map is cleared), 
+                     * so the position can be used to index data stored alongside the map.
+                     */
+                    size_type position() const { return pos; }
+
+                    base_iterator& operator++() {
+                        pos++;
+                        skip_unoccupied();
+                        return *this;
+                    }
+
+                    base_iterator operator++(int) {
+                        base_iterator tmp = *this;
+                        ++(*this);
+                        return tmp;
+                    }
+
+                    template <bool other_is_const>
+                    bool operator==(const base_iterator<other_is_const>& other) const { return pos == other.pos; }
+
+                    template <bool other_is_const>
+                    bool operator!=(const base_iterator<other_is_const>& other) const { return pos != other.pos; }
+
+                    template <bool> friend class base_iterator;
+            };
+
+            typedef base_iterator<false> iterator;
+            typedef base_iterator<true> const_iterator;
+
+        protected:
+            typedef std::unordered_map<K,size_type> KeyIndex;
+
+            std::vector<value_type> entries;
+            std::vector<bool> occupied;
+            size_type num_occupied;
+            mutable std::atomic<KeyIndex*> key_index;
+
+            /**
+             * Returns the position of the slot for 'key' (occupied or not), or 'npos' if there is no slot for it.
+             */
+            size_type find_position(const K& key) const;
+
+            /**
+             * Returns the key index, building it if it hasn't been built yet.
+             */
+            const KeyIndex& get_key_index() const;
+
+            /**
+             * Adds a new (unoccupied) slot for 'key', and returns its position.
+             */
+            size_type add_slot(const K& key);
+
+        public:
+            FlatChildMap();
+            FlatChildMap(const FlatChildMap& other);
+            FlatChildMap(FlatChildMap&& other);
+            ~FlatChildMap();
+            FlatChildMap& operator=(const FlatChildMap& other);
+            FlatChildMap& operator=(FlatChildMap&& other);
+
+            void swap(FlatChildMap& other);
+
+            /**
+             * Reserves slots for 'keys', in order, so that the i-th key of 'keys' is at position i (if the map was 
+             * empty before the call). Keys that already have slots are skipped, but if the map is empty then 'keys' 
+             * are assumed to be distinct (e.g. the valid actions of a state), and no lookups are made. Reserved slots 
+             * are not in the map until they are assigned a value.
+             * 
+             * Args:
+             *      keys: The keys to reserve slots for
+             */
+            void reserve_keys(const std::vector<K>& keys);
+
+            /**
+             * Reserves a slot for a single key (after any existing slots), if it doesn't already have a slot. Used to 
+             * add keys one at a time (e.g. with progressive widening).
+             * 
+             * Args:
+             *      key: The key to reserve a slot for
+             */
+            void reserve_key(const K& key);
+
+            size_type size() const;
+            bool empty() const;
+            void clear();
+
+            iterator begin();
+            iterator end();
+            const_iterator begin() const;
+            const_iterator end() const;
+
+            iterator find(const K& key);
+            const_iterator find(const K& key) const;
+
+            /**
+             * Finds 'key', checking the slot at position 'position_hint' first. If the map has reserved slots for 
+             * 'actions' (see 'reserve_keys') then looking up 'actions->at(i)' with a hint of 'i' is a single pointer 
+             * comparison.
+             * 
+             * Args:
+             *      key: The key to find
+             *      position_hint: The position that 'key' is expected to be at
+             * 
+             * Returns:
+             *      An iterator to the (key,value) pair, or 'end()' if 'key' is not in the map
+             */
+            iterator find(const K& key, size_type position_hint);
+            const_iterator find(const K& key, size_type position_hint) const;
+
+            size_type count(const K& key) const;
+
+            /**
+             * Returns a reference to the value for 'key'. Throws 'std::out_of_range' if 'key' is not in the map.
+             */
+            V& at(const K& key);
+            const V& at(const K& key) const;
+
+            /**
+             * Returns a reference to the value for 'key', adding it to the map (with a default value) if necessary.
+             */
+            V& operator[](const K& key);
+
+            /**
+             * Sets the value for 'key', adding it to the map if necessary.
+             * 
+             * Returns:
+             *      An iterator to the (key,value) pair, and if 'key' was added to the map
+             */
+            std::pair<iterator,bool> insert_or_assign(const K& key, const V& value);
+    };
+}
+
+#include "flat_child_map.cc"
@@ -3,10 +3,12 @@
 #include "thts_types.h"
 
 #include <memory>
+#include <vector>
 
-// forward declar ThtsEnv
+// forward declar ThtsEnv and RandManager
 namespace thts {
     class ThtsEnv;
+    class RandManager;
 }
 
 namespace thts::helper {
@@ -14,4 +16,17 @@ namespace thts::helper {
      * A default heuristic function that returns a constant zero
      */
     double zero_heuristic_fn(std::shared_ptr<const State> state, std::shared_ptr<ThtsEnv> env=nullptr);
+
+    /**
+     * Samples an index from a vector of non-negative weights, with probability proportional to the weights. The 
+     * weights don't need to be normalised. Uses a single random number.
+     * 
+     * Args:
+     *      weights: The weights to sample an index from, at least one of which should be positive
+     *      rand_manager: The RandManager to get the random number from
+     * 
+     * Returns:
+     *      The sampled index
+     */
+    int sample_index_from_weights(const std::vector<double>& weights, RandManager& rand_manager);
 }
\ No newline at end of file
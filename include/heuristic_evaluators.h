@@ -0,0 +1,100 @@
+#pragma once
+
+#include "thts_types.h"
+
+#include <memory>
+#include <vector>
+
+
+namespace thts {
+    // forward declare
+    class ThtsEnv;
+
+    /**
+     * An interface for (stateful) heuristic functions, that can be used instead of a HeuristicFnPtr (see
+     * ThtsManagerArgs::heuristic_evaluator).
+     *
+     * Unlike a function pointer, an evaluator can hold its own state, such as lookup tables, caches or handles to
+     * models. If 'clone_for_thread' returns a new object, then each thread that evaluates a heuristic value uses its
+     * own clone (see ThtsManager::get_heuristic_evaluator), so the state doesn't need any locking. Otherwise, a
+     * single evaluator is shared between threads, and so must be thread safe.
+     */
+    class HeuristicEvaluator {
+        public:
+            virtual ~HeuristicEvaluator() = default;
+
+            /**
+             * Computes the heuristic value of 'state'.
+             *
+             * Args:
+             *      state: The state to compute a heuristic value for
+             *      env: The environment that 'state' is from
+             *
+             * Returns:
+             *      The heuristic value of 'state'
+             */
+            virtual double evaluate(std::shared_ptr<const State> state, std::shared_ptr<ThtsEnv> env) = 0;
+
+            /**
+             * Computes the heuristic values of a batch of states (see BatchedLeafEvaluator). Default implementation
+             * calls 'evaluate' on each state.
+             *
+             * Args:
+             *      states: The states to compute heuristic values for
+             *      env: The environment that the states are from
+             *      heuristic_values: Output vector (already sized to match 'states')
+             */
+            virtual void evaluate_batch(
+                const std::vector<std::shared_ptr<const State>>& states,
+                std::shared_ptr<ThtsEnv> env,
+                std::vector<double>& heuristic_values);
+
+            /**
+             * Returns a copy of this evaluator for a thread to use, or nullptr if this evaluator should be shared
+             * between threads. Default implementation returns nullptr.
+             */
+            virtual std::shared_ptr<HeuristicEvaluator> clone_for_thread() const;
+    };
+
+    /**
+     * An interface for (stateful) prior functions, that can be used instead of a PriorFnPtr (see
+     * ThtsManagerArgs::prior_evaluator). See HeuristicEvaluator for how evaluators are cloned for threads.
+     */
+    class PriorEvaluator {
+        public:
+            virtual ~PriorEvaluator() = default;
+
+            /**
+             * Computes the policy prior for 'state'.
+             *
+             * Args:
+             *      state: The state to compute a policy prior for
+             *      env: The environment that 'state' is from
+             *
+             * Returns:
+             *      The policy prior for 'state'
+             */
+            virtual std::shared_ptr<ActionPrior> evaluate(
+                std::shared_ptr<const State> state, std::shared_ptr<ThtsEnv> env) = 0;
+
+            /**
+             * Computes the policy priors of a batch of states (see BatchedLeafEvaluator). Default implementation
+             * calls 'evaluate' on each state.
+             *
+             * Args:
+             *      states: The states to compute policy priors for
+             *      env: The environment that the states are from
+             *      policy_priors: Output vector (already sized to match 'states')
+             */
+            virtual void evaluate_batch(
+                const std::vector<std::shared_ptr<const State>>& states,
+                std::shared_ptr<ThtsEnv> env,
+                std::vector<std::shared_ptr<ActionPrior>>& policy_priors);
+
+            /**
+             * Returns a copy of this evaluator for a thread to use, or nullptr if this evaluator should be shared
+             * between threads. Default implementation returns nullptr.
+             */
+            virtual std::shared_ptr<PriorEvaluator> clone_for_thread() const;
+    };
+}
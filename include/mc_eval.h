@@ -7,6 +7,7 @@
 #include "thts_manager.h"
 #include "thts_types.h"
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -50,6 +51,11 @@ namespace thts {
 
             EvalPolicy(const EvalPolicy& policy);
 
+            /**
+             * Copies 'policy', but uses 'rand_manager' (for example so that each thread can use its own rng).
+            */
+            EvalPolicy(const EvalPolicy& policy, RandManager& rand_manager);
+
             /**
              * Resets cur_node back to root node.
             */
@@ -71,9 +77,51 @@ namespace thts {
            void update_step(std::shared_ptr<const Action> action, std::shared_ptr<const Observation> obsv);
     };
 
+    /**
+     * Streaming statistics of sampled returns, using Welford's algorithm, so that the mean and variance can be 
+     * computed without storing the returns. Accumulators from different threads can be merged.
+     * 
+     * Member variables:
+     *      num_samples:
+     *          The number of returns added
+     *      mean:
+     *          The mean of the returns added
+     *      sum_squared_deviations:
+     *          The sum of squared differences of the returns from 'mean'
+    */
+    struct ReturnAccumulator {
+        int num_samples;
+        double mean;
+        double sum_squared_deviations;
+
+        ReturnAccumulator();
+
+        /**
+         * Adds a sampled return.
+        */
+        void add(double sample_return);
+
+        /**
+         * Merges the returns added to 'other' into this accumulator.
+        */
+        void merge(const ReturnAccumulator& other);
+
+        /**
+         * Returns the (unbiased) sample variance of the returns added, or zero if less than two have been added.
+        */
+        double get_variance() const;
+    };
+
     /**
      * MC Evaluator
      * 
+     * Each thread running rollouts uses its own RandManager (seeded from 'rand_manager'), and accumulates statistics 
+     * in its own ReturnAccumulator, which is merged into 'return_stats' when it finishes. So threads only contend 
+     * for 'lock' when merging.
+     * 
+     * When running with 'run_rollouts_until_confident', threads also merge their statistics every 
+     * 'rollouts_per_merge' rollouts, and stop once the confidence interval on the mean return is narrow enough.
+     * 
      * N.B. Currently only works for fully observable environments.
      * N.B.B. We store references in the class, and the caller needs to assure that they still exists. (I.e. usually 
      * we're going to make an MCEvaluator, call run rollouts, and then throw it away).
@@ -85,41 +133,79 @@ namespace thts {
      *          The policy to evaluate
      *      max_trial_length: 
      *          The maximum trial length to use in MC evaluations
+     *      store_sampled_returns:
+     *          If the sampled returns should be stored in 'sampled_returns' (the mean and stddev are computed without 
+     *          them)
      *      sampled_returns: 
-     *          A list of sampled returns 
+     *          A list of sampled returns (if 'store_sampled_returns' is true)
+     *      return_stats:
+     *          The statistics of all of the returns sampled
      *      rand_manager: 
-     *          Manager for rng
+     *          Manager for rng, used to seed the RandManager of each thread
      *      lock: 
-     *          A lock to protect access to class variables (i.e. sampled_returns in 'run_rollout')
+     *          A lock to protect access to 'sampled_returns' and 'return_stats'
+     *      next_rollout:
+     *          A counter used by threads to claim rollouts to run
+     *      stop_rollouts:
+     *          Set when the confidence interval is narrow enough to stop running rollouts
+     *      target_confidence_interval_width:
+     *          The confidence interval width to stop at, or zero if not stopping early
+     *      confidence_z_score:
+     *          The z score used for the confidence interval (e.g. 1.96 for a 95% confidence interval)
+     *      min_num_rollouts:
+     *          The minimum number of rollouts to run before stopping early
     */
     class MCEvaluator {
+        public:
+            static const int rollouts_per_merge = 64;
+            static constexpr double confidence_z_score_default = 1.96;
+            static const int min_num_rollouts_default = 100;
+
         protected:
             std::shared_ptr<const ThtsEnv> thts_env;
             EvalPolicy& policy;
             int max_trial_length;
+            bool store_sampled_returns;
             std::vector<double> sampled_returns;
+            ReturnAccumulator return_stats;
             RandManager& rand_manager;
             std::mutex lock;
 
+            std::atomic<int> next_rollout;
+            std::atomic<bool> stop_rollouts;
+            double target_confidence_interval_width;
+            double confidence_z_score;
+            int min_num_rollouts;
+
             /**
-             * Runs a single rollout and stores the result in 'sampled_returns'.
+             * Runs a single rollout and returns the sampled return.
             */
-            void run_rollout(EvalPolicy& thread_policy);
+            double run_rollout(EvalPolicy& thread_policy, RandManager& thread_rand_manager);
 
             /**
-             * Runs rollouts as a worker thread
+             * Runs rollouts as a worker thread, until 'total_rollouts' have been run (by all threads) or 
+             * 'stop_rollouts' is set.
             */
-            void thread_run_rollouts(
-                int total_rollouts, int thread_id, int num_threads, std::unique_ptr<EvalPolicy> thread_policy);
+            void thread_run_rollouts(int total_rollouts, int thread_seed);
 
+            /**
+             * Merges a threads statistics (and returns) into 'return_stats' (and 'sampled_returns'), and clears them. 
+             * If stopping early, sets 'stop_rollouts' if the confidence interval is now narrow enough.
+            */
+            void merge_thread_stats(ReturnAccumulator& thread_stats, std::vector<double>& thread_returns);
 
+            /**
+             * Spawns 'num_threads' threads to run 'num_rollouts' rollouts, and waits for them to finish.
+            */
+            void spawn_rollout_threads(int num_rollouts, int num_threads);
 
         public:
             MCEvaluator(
                 std::shared_ptr<const ThtsEnv> thts_env,
                 EvalPolicy& eval_policy,
                 int max_trial_length,
-                RandManager& rand_manager);
+                RandManager& rand_manager,
+                bool store_sampled_returns=true);
 
             /**
              * Run 'num_rollout' many rollouts to gather stats. Does so by spawning 'num_threads' many threads and 
@@ -130,13 +216,47 @@ namespace thts {
             void run_rollouts(int num_rollouts, int num_threads);
 
             /**
-             * Returns the mean return of 'sampled_returns'
+             * Runs rollouts (as in 'run_rollouts') until the width of the confidence interval on the mean return is 
+             * at most 'target_confidence_interval_width', or 'max_num_rollouts' rollouts have been run.
+             * 
+             * Args:
+             *      max_num_rollouts: The maximum number of rollouts to run
+             *      num_threads: The number of threads to run rollouts with
+             *      target_confidence_interval_width: The width of confidence interval to stop at
+             *      confidence_z_score: The z score of the confidence interval (1.96 for a 95% confidence interval)
+             *      min_num_rollouts: The minimum number of rollouts to run, before the confidence interval is trusted
+            */
+            void run_rollouts_until_confident(
+                int max_num_rollouts, 
+                int num_threads, 
+                double target_confidence_interval_width,
+                double confidence_z_score=confidence_z_score_default,
+                int min_num_rollouts=min_num_rollouts_default);
+
+            /**
+             * Returns the number of rollouts run
             */
-           double get_mean_return();
+            int get_num_rollouts();
 
-           /**
-            * Returns the stddev of 'sampled_returns'
-           */
-          double get_stddev_return();
+            /**
+             * Returns the mean return
+            */
+            double get_mean_return();
+
+            /**
+             * Returns the (sample) stddev of the returns
+            */
+            double get_stddev_return();
+
+            /**
+             * Returns the width of the confidence interval on the mean return, for a given z score (infinity if 
+             * less than two rollouts have been run)
+            */
+            double get_confidence_interval_width(double z_score=confidence_z_score_default);
+
+            /**
+             * Returns the sampled returns (empty if not storing them)
+            */
+            const std::vector<double>& get_sampled_returns() const;
     };
 }
\ No newline at end of file
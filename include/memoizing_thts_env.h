@@ -0,0 +1,153 @@
+#pragma once
+
+#include "sharded_cache.h"
+#include "thts_env.h"
+#include "thts_types.h"
+
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+
+namespace thts {
+    /**
+     * Key types for the caches in MemoizingThtsEnv
+     */
+    typedef std::pair<std::shared_ptr<const State>,std::shared_ptr<const Action>> StateActionKey;
+    typedef std::tuple<
+        std::shared_ptr<const State>,std::shared_ptr<const Action>,std::shared_ptr<const Observation>> RewardKey;
+
+    /**
+     * Hash and equality functions for the cache keys. States, actions and observations are compared by value, and
+     * (for RewardKey) the observation may be nullptr.
+     */
+    struct StateActionKeyHash {
+        std::size_t operator()(const StateActionKey& key) const;
+    };
+
+    struct StateActionKeyEqual {
+        bool operator()(const StateActionKey& lhs, const StateActionKey& rhs) const;
+    };
+
+    struct RewardKeyHash {
+        std::size_t operator()(const RewardKey& key) const;
+    };
+
+    struct RewardKeyEqual {
+        bool operator()(const RewardKey& lhs, const RewardKey& rhs) const;
+    };
+
+    /**
+     * A ThtsEnv decorator that memoizes the deterministic functions of another (wrapped) environment.
+     *
+     * 'is_sink_state_itfc' and 'get_valid_actions_itfc' are cached by state, 'get_transition_distribution_itfc' by
+     * (state, action), and 'get_reward_itfc' by (state, action, observation). Keys are compared by value, so in
+     * domains where the same states are reached through many paths (transpositions), the wrapped environment is only
+     * called once per distinct key (while it's in the cache). The ActionVector and StateDistr objects returned are
+     * shared between all of the callers, and so must not be modified.
+     *
+     * Rewards are only cached if 'cache_rewards' is true, which should be set to false for environments with
+     * stochastic rewards. Sampling functions and contexts are always forwarded to the wrapped environment.
+     *
+     * Each cache is a ShardedCache holding at most 'max_cache_size' entries, so the cache can be safely shared
+     * between threads.
+     *
+     * Member variables:
+     *      env:
+     *          The wrapped environment
+     *      cache_rewards:
+     *          If rewards are cached
+     *      is_sink_state_cache:
+     *          Cache of 'is_sink_state_itfc' results
+     *      valid_actions_cache:
+     *          Cache of 'get_valid_actions_itfc' results
+     *      transition_distribution_cache:
+     *          Cache of 'get_transition_distribution_itfc' results
+     *      reward_cache:
+     *          Cache of 'get_reward_itfc' results
+     */
+    class MemoizingThtsEnv : public ThtsEnv {
+        public:
+            static const std::size_t max_cache_size_default = 1 << 20;
+            static const std::size_t num_cache_shards_default = 16;
+
+        protected:
+            std::shared_ptr<ThtsEnv> env;
+            bool cache_rewards;
+
+            mutable ShardedCache<std::shared_ptr<const State>,bool> is_sink_state_cache;
+            mutable ShardedCache<std::shared_ptr<const State>,std::shared_ptr<ActionVector>> valid_actions_cache;
+            mutable ShardedCache<StateActionKey,std::shared_ptr<StateDistr>,StateActionKeyHash,StateActionKeyEqual>
+                transition_distribution_cache;
+            mutable ShardedCache<RewardKey,double,RewardKeyHash,RewardKeyEqual> reward_cache;
+
+        public:
+            /**
+             * Constructor.
+             *
+             * Args:
+             *      env: The environment to wrap
+             *      cache_rewards: If rewards should be cached (false for environments with stochastic rewards)
+             *      max_cache_size: The maximum number of entries in each cache, or zero for no limit
+             *      num_cache_shards: The number of shards to split each cache into
+             */
+            MemoizingThtsEnv(
+                std::shared_ptr<ThtsEnv> env,
+                bool cache_rewards=true,
+                std::size_t max_cache_size=max_cache_size_default,
+                std::size_t num_cache_shards=num_cache_shards_default);
+
+            virtual ~MemoizingThtsEnv() = default;
+
+            /**
+             * Returns the wrapped environment
+             */
+            std::shared_ptr<ThtsEnv> get_wrapped_env() const;
+
+            /**
+             * Getters for the hit and miss counts of each cache
+             */
+            CacheStats get_is_sink_state_cache_stats() const;
+            CacheStats get_valid_actions_cache_stats() const;
+            CacheStats get_transition_distribution_cache_stats() const;
+            CacheStats get_reward_cache_stats() const;
+
+            /**
+             * Removes all entries from the caches.
+             */
+            void clear_caches();
+
+            /**
+             * ThtsEnv interface, memoizing or forwarding to the wrapped environment (see class comment).
+             */
+            virtual std::shared_ptr<const State> get_initial_state_itfc() const;
+
+            virtual bool is_sink_state_itfc(std::shared_ptr<const State> state) const;
+
+            virtual std::shared_ptr<ActionVector> get_valid_actions_itfc(std::shared_ptr<const State> state) const;
+
+            virtual std::shared_ptr<StateDistr> get_transition_distribution_itfc(
+                std::shared_ptr<const State> state, std::shared_ptr<const Action> action) const;
+
+            virtual std::shared_ptr<const State> sample_transition_distribution_itfc(
+                std::shared_ptr<const State> state,
+                std::shared_ptr<const Action> action,
+                RandManager& rand_manager) const;
+
+            virtual std::shared_ptr<ObservationDistr> get_observation_distribution_itfc(
+                std::shared_ptr<const Action> action, std::shared_ptr<const State> next_state) const;
+
+            virtual std::shared_ptr<const Observation> sample_observation_distribution_itfc(
+                std::shared_ptr<const Action> action,
+                std::shared_ptr<const State> next_state,
+                RandManager& rand_manager) const;
+
+            virtual double get_reward_itfc(
+                std::shared_ptr<const State> state,
+                std::shared_ptr<const Action> action,
+                std::shared_ptr<const Observation> observation=nullptr) const;
+
+            virtual std::shared_ptr<ThtsEnvContext> sample_context_itfc(std::shared_ptr<const State> state) const;
+    };
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+namespace thts {
+    /**
+     * A slab allocator used to allocate the nodes of a search tree.
+     * 
+     * Each thread bump allocates from its own slab, and keeps its own free lists (by size) of blocks that it has 
+     * freed, so neither allocating nor freeing a node takes a lock. When a thread's free list for a size grows to 
+     * 'free_batch_size' blocks, the batch is moved to the shared free lists (taking 'arena_lock' once per batch), and 
+     * threads take batches from the shared free lists when their slab is full, before allocating a new slab.
+     * 
+     * Arenas are used in generations (see 'ThtsManager::start_new_node_arena'). When 'ThtsPool::advance_root' 
+     * discards the old tree, the manager's arena is retired and new nodes are allocated in a new arena. Retiring an 
+     * arena counts the live blocks in each slab (the blocks bump allocated from it, minus those sitting in free lists), 
+     * and releases the slabs with none. Freeing a block in a retired arena decrements its slab's count, and the slab is 
+     * released as soon as its last block is freed. So the subtree kept by 'advance_root' only pins the slabs that its 
+     * nodes are in, rather than the whole of the previous generation (and the generations before it). The memory held 
+     * by retired arenas is bounded by the number of slabs containing a live node, at most one slab per live node.
+     * 
+     * Allocations larger than the slab size (and any allocations made after the arena is retired) are allocated 
+     * individually, and are released as soon as they're freed.
+     * 
+     * The number of bytes in use is counted per thread (in each ThreadCache), and only summed up when 
+     * 'get_num_bytes_in_use' is called, so allocating and freeing don't write to any shared memory.
+     * 
+     * Nodes are allocated in an arena using 'std::allocate_shared' with a NodeAllocator (see 'ThtsManager::make_node'), 
+     * which puts the node and its shared_ptr control block in a single block of the arena. Each NodeAllocator holds a 
+     * shared_ptr to the arena, so the arena lives until the last node allocated in it has been freed.
+     * 
+     * Member variables:
+     *      slab_size:
+     *          The size (in bytes) of each slab. Allocations larger than this are given their own slab
+     *      node_arena_id:
+     *          A unique id for this arena, used to tag the thread local cache of ThreadCaches
+     *      retired:
+     *          If this arena has been retired, in which case freed blocks are not reused
+     *      arena_lock:
+     *          A mutex protecting 'slabs', 'individual_blocks', 'thread_caches' and 'shared_free_lists'
+     *      slabs:
+     *          The slabs allocated by this arena. Sorted by address when the arena is retired (and not modified 
+     *          after), so that the slab containing a freed block can be found without taking 'arena_lock'
+     *      individual_blocks:
+     *          The blocks that were allocated individually (rather than from a slab), keyed by address
+     *      num_slabs:
+     *          The number of slabs and individual blocks currently allocated
+     *      thread_caches:
+     *          The slab, free lists and byte count of each thread that has used this arena
+     *      shared_free_lists:
+     *          A map from (rounded) block sizes to batches of blocks that have been freed and can be reused
+     */
+    class NodeArena {
+        public:
+            static constexpr std::size_t slab_size_default = 1 << 16;
+            static constexpr std::size_t alignment = alignof(std::max_align_t);
+            static constexpr std::size_t free_batch_size = 64;
+
+        protected:
+            /**
+             * A slab of memory. 'num_blocks' is the number of blocks bump allocated from the slab, and is only 
+             * written by the thread allocating from it. 'num_live_blocks' is only used once the arena is retired.
+             */
+            struct Slab {
+                char* begin;
+                std::size_t size;
+                std::unique_ptr<char[]> memory;
+                std::size_t num_blocks;
+                std::atomic<std::size_t> num_live_blocks;
+            };
+
+            /**
+             * The slab that a thread is bump allocating from (and the region of it left), the blocks that the thread 
+             * has freed, and the bytes that the thread has allocated minus the bytes that it has freed (which may be 
+             * negative when the thread frees blocks allocated by other threads). 'num_bytes' is only written by the 
+             * thread, but is read by 'get_num_bytes_in_use'.
+             */
+            struct ThreadCache {
+                Slab* slab;
+                char* next;
+                char* end;
+                std::unordered_map<std::size_t,std::vector<void*>> free_lists;
+                std::atomic<std::ptrdiff_t> num_bytes;
+            };
+
+            std::size_t slab_size;
+            std::uint64_t node_arena_id;
+            std::atomic<bool> retired;
+
+            mutable std::mutex arena_lock;
+            std::vector<std::unique_ptr<Slab>> slabs;
+            std::unordered_map<void*,std::unique_ptr<char[]>> individual_blocks;
+            std::atomic<int> num_slabs;
+            std::unordered_map<std::thread::id,std::unique_ptr<ThreadCache>> thread_caches;
+            std::unordered_map<std::size_t,std::vector<std::vector<void*>>> shared_free_lists;
+
+            /**
+             * Returns a new unique node arena id.
+             */
+            static std::uint64_t get_new_node_arena_id();
+
+            /**
+             * Returns the ThreadCache for the calling thread, creating it if necessary.
+             */
+            ThreadCache& get_thread_cache();
+
+            /**
+             * Allocates a block when the calling thread's free list (for 'num_bytes' sized blocks) is empty and its 
+             * slab is full. Takes 'arena_lock', and either moves a batch of freed blocks from 'shared_free_lists' into 
+             * the thread's free list, or gives the thread a new slab.
+             */
+            void* allocate_slow_path(ThreadCache& thread_cache, std::size_t num_bytes);
+
+            /**
+             * Allocates a new slab. Should be called holding 'arena_lock'.
+             */
+            Slab* new_slab();
+
+            /**
+             * Allocates and frees blocks individually (see 'individual_blocks'). Take 'arena_lock'.
+             */
+            void* allocate_individual_block(std::size_t num_bytes);
+            void deallocate_individual_block(void* ptr);
+
+            /**
+             * Returns the index of the slab containing 'ptr' when 'slabs' is sorted by address (i.e. in a retired 
+             * arena), or 'slabs.size()' if 'ptr' is not in a slab.
+             */
+            std::size_t find_sorted_slab_index(void* ptr) const;
+
+            /**
+             * Adds 'num_bytes' to the calling thread's byte count.
+             */
+            static void add_thread_bytes(ThreadCache& thread_cache, std::ptrdiff_t num_bytes);
+
+            /**
+             * Rounds 'num_bytes' up to a multiple of 'alignment'.
+             */
+            static std::size_t round_up(std::size_t num_bytes);
+
+        public:
+            /**
+             * Constructor.
+             * 
+             * Args:
+             *      slab_size: The size (in bytes) of each slab
+             */
+            NodeArena(std::size_t slab_size=slab_size_default);
+
+            /**
+             * Destructor. Releases all slabs.
+             */
+            virtual ~NodeArena();
+
+            /**
+             * Allocates a block of at least 'num_bytes' bytes, aligned to 'alignment'.
+             * 
+             * Args:
+             *      num_bytes: The number of bytes required
+             * 
+             * Returns:
+             *      A pointer to the allocated block
+             */
+            void* allocate(std::size_t num_bytes);
+
+            /**
+             * Returns a block to the arena, so that it can be reused (unless the arena has been retired).
+             * 
+             * Args:
+             *      ptr: A pointer to a block returned from 'allocate'
+             *      num_bytes: The number of bytes that were requested in the call to 'allocate'
+             */
+            void deallocate(void* ptr, std::size_t num_bytes);
+
+            /**
+             * Retires this arena. No new nodes should be allocated in it, and freed blocks are no longer kept for 
+             * reuse. Instead each slab is released once all of the blocks in it have been freed. Should only be 
+             * called when no other threads are allocating or freeing blocks in this arena.
+             */
+            void retire();
+
+            /**
+             * Returns if this arena has been retired.
+             */
+            bool is_retired() const;
+
+            /**
+             * Returns the size of the slabs allocated by this arena.
+             */
+            std::size_t get_slab_size() const;
+
+            /**
+             * Returns the number of slabs (including individually allocated blocks) currently allocated by this 
+             * arena.
+             */
+            int get_num_slabs();
+
+            /**
+             * Returns the number of bytes currently allocated out of this arena.
+             */
+            std::size_t get_num_bytes_in_use() const;
+    };
+
+    /**
+     * A (standard library compatible) allocator that allocates out of a NodeArena.
+     * 
+     * Member variables:
+     *      node_arena:
+     *          The arena to allocate from
+     */
+    template <typename T>
+    class NodeAllocator {
+        static_assert(alignof(T) <= NodeArena::alignment, "NodeAllocator doesn't support over aligned types");
+
+        public:
+            typedef T value_type;
+
+            std::shared_ptr<NodeArena> node_arena;
+
+            NodeAllocator(std::shared_ptr<NodeArena> node_arena) : node_arena(node_arena) {}
+
+            template <typename U>
+            NodeAllocator(const NodeAllocator<U>& other) : node_arena(other.node_arena) {}
+
+            T* allocate(std::size_t n) {
+                return static_cast<T*>(node_arena->allocate(n * sizeof(T)));
+            }
+
+            void deallocate(T* ptr, std::size_t n) {
+                node_arena->deallocate(ptr, n * sizeof(T));
+            }
+    };
+
+    template <typename T, typename U>
+    bool operator==(const NodeAllocator<T>& lhs, const NodeAllocator<U>& rhs) {
+        return lhs.node_arena == rhs.node_arena;
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const NodeAllocator<T>& lhs, const NodeAllocator<U>& rhs) {
+        return !(lhs == rhs);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+
+
+namespace thts {
+    /**
+     * A wrapper around std::atomic, using relaxed memory ordering, for node statistics (such as 'num_visits',
+     * 'avg_return' and 'soft_value') that are read from other nodes without holding the node's lock.
+     *
+     * During the selection phase a node reads the statistics of all of its children. Grabbing every childs lock to
+     * read them costs two lock operations per child, and serialises threads at nodes with a large branching factor.
+     * Instead, statistics are stored in RelaxedAtomics, so that each individual value can be read lock free, and can
+     * never be torn by a concurrent write. Different values may be read from different points in time (e.g. the
+     * 'avg_return' and 'num_backups' of a child that is being backed up concurrently), which is 'consistent enough'
+     * for selection and backups, in the same way that lock free MCTS implementations are.
+     *
+     * Writes are expected to be made by the thread holding the lock of the node that owns the value, so that there is
+     * only ever a single writer. This means that compound assignments (e.g. '+=' and '++') are implemented as a
+     * relaxed load followed by a relaxed store, rather than as (more expensive) atomic read-modify-writes. Code
+     * writing a value that is derived from a loop should compute the value in a local variable and store it once, so
+     * that readers never observe a partially computed value.
+     *
+     * Implicitly converts to and from T, so that it can be used in place of a T member variable.
+     *
+     * Member variables:
+     *      val:
+     *          The underlying atomic value
+     */
+    template <typename T>
+    class RelaxedAtomic {
+        private:
+            std::atomic<T> val;
+
+        public:
+            /**
+             * Constructors
+             */
+            RelaxedAtomic();
+            RelaxedAtomic(T init_val);
+            RelaxedAtomic(const RelaxedAtomic& other);
+
+            /**
+             * Relaxed load of the value
+             */
+            T load() const;
+            operator T() const;
+
+            /**
+             * Relaxed store of a value
+             */
+            void store(T new_val);
+            RelaxedAtomic& operator=(T new_val);
+            RelaxedAtomic& operator=(const RelaxedAtomic& other);
+
+            /**
+             * Compound assignments. Assume that the caller is the only writer (see class docstring).
+             */
+            RelaxedAtomic& operator+=(T delta);
+            RelaxedAtomic& operator-=(T delta);
+            RelaxedAtomic& operator*=(T factor);
+            RelaxedAtomic& operator/=(T divisor);
+            T operator++();
+            T operator++(int);
+            T operator--();
+            T operator--(int);
+    };
+}
+
+#include "relaxed_atomic.cc"
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+
+namespace thts {
+    /**
+     * A read only view of a contiguous sequence of rewards, along with their (precomputed) sum, which is how the 
+     * rewards before and after a node in a trial are passed to 'backup'.
+     * 
+     * The backup phase of a trial passes every node on the trial a prefix of the rewards and a suffix of the rewards 
+     * (see ThtsPool::run_backup_phase). Using views into buffers that are filled once per trial, rather than building 
+     * new vectors for each node, makes the cost of passing the rewards to each node O(1) rather than O(depth), and 
+     * avoids any allocations in the backup phase.
+     * 
+     * A view doesn't own the rewards, and is only valid while the buffer that it was constructed from is alive and 
+     * unmodified. So nodes should copy the rewards (e.g. using 'to_vector') if they need them after 'backup' returns.
+     * 
+     * Provides the parts of the (const) 'std::vector' interface needed to read the rewards, so that it can be used 
+     * with range based for loops, and with container matchers in tests.
+     * 
+     * Member variables:
+     *      rewards:
+     *          A pointer to the first reward in the view
+     *      num_rewards:
+     *          The number of rewards in the view
+     *      rewards_sum:
+     *          The sum of the rewards in the view
+     */
+    class RewardsView {
+        public:
+            typedef double value_type;
+            typedef std::size_t size_type;
+            typedef const double& reference;
+            typedef const double& const_reference;
+            typedef const double* iterator;
+            typedef const double* const_iterator;
+
+        private:
+            const double* rewards;
+            size_type num_rewards;
+            double rewards_sum;
+
+        public:
+            /**
+             * Constructs an empty view.
+             */
+            RewardsView() : rewards(nullptr), num_rewards(0), rewards_sum(0.0) {}
+
+            /**
+             * Constructs a view of 'num_rewards' rewards starting at 'rewards', whose sum is 'rewards_sum'.
+             */
+            RewardsView(const double* rewards, size_type num_rewards, double rewards_sum) :
+                rewards(rewards), num_rewards(num_rewards), rewards_sum(rewards_sum) {}
+
+            /**
+             * Constructs a view of all of the rewards in 'rewards', computing their sum.
+             */
+            RewardsView(const std::vector<double>& rewards);
+
+            /**
+             * Accessors
+             */
+            const_iterator begin() const { return rewards; }
+            const_iterator end() const { return rewards + num_rewards; }
+            size_type size() const { return num_rewards; }
+            bool empty() const { return num_rewards == 0; }
+            const double& operator[](size_type i) const { return rewards[i]; }
+            const double& front() const { return rewards[0]; }
+            const double& back() const { return rewards[num_rewards-1]; }
+            const double* data() const { return rewards; }
+
+            /**
+             * Returns the sum of the rewards in the view.
+             */
+            double sum() const { return rewards_sum; }
+
+            /**
+             * Returns a copy of the rewards in the view.
+             */
+            std::vector<double> to_vector() const;
+    };
+}
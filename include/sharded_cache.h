@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace thts {
+    /**
+     * Statistics about the use of a ShardedCache.
+     *
+     * Member variables:
+     *      num_hits:
+     *          The number of lookups that found a cached value
+     *      num_misses:
+     *          The number of lookups that didn't find a cached value
+     *      size:
+     *          The number of values currently in the cache
+     */
+    struct CacheStats {
+        std::size_t num_hits;
+        std::size_t num_misses;
+        std::size_t size;
+
+        /**
+         * Returns the fraction of lookups that were hits (zero if there haven't been any lookups)
+         */
+        double get_hit_rate() const;
+    };
+
+    /**
+     * A bounded, thread safe, key-value cache.
+     *
+     * The cache is split into shards, each of which is an unordered_map protected by its own mutex, so threads only
+     * contend when they access the same shard. If 'max_size' is non-zero, then each shard holds at most
+     * 'max_size / num_shards' (rounded up) values, and the oldest value in a shard is evicted when inserting into a
+     * full shard.
+     *
+     * Values are copied out of the cache, so V should be cheap to copy (e.g. a shared_ptr to a shared object).
+     *
+     * Member variables:
+     *      shards:
+     *          The shards of the cache
+     *      max_entries_per_shard:
+     *          The maximum number of values in each shard, or zero if the size of the cache is not limited
+     *      hasher:
+     *          The hash function for keys
+     *      num_hits:
+     *          The number of lookups that found a value
+     *      num_misses:
+     *          The number of lookups that didn't find a value
+     */
+    template <typename K, typename V, typename Hash=std::hash<K>, typename KeyEqual=std::equal_to<K>>
+    class ShardedCache {
+        protected:
+            /**
+             * A shard of the cache.
+             *
+             * Member variables:
+             *      shard_lock:
+             *          Mutex protecting this shard
+             *      entries:
+             *          The cached values
+             *      insertion_order:
+             *          The keys of 'entries' in the order they were inserted, used to evict the oldest entry
+             */
+            struct Shard {
+                std::mutex shard_lock;
+                std::unordered_map<K,V,Hash,KeyEqual> entries;
+                std::deque<K> insertion_order;
+            };
+
+            std::vector<std::unique_ptr<Shard>> shards;
+            std::size_t max_entries_per_shard;
+            Hash hasher;
+
+            std::atomic<std::size_t> num_hits;
+            std::atomic<std::size_t> num_misses;
+
+            /**
+             * Returns the shard that 'key' belongs in.
+             */
+            Shard& get_shard(const K& key);
+
+        public:
+            /**
+             * Constructor.
+             *
+             * Args:
+             *      num_shards: The number of shards to split the cache into
+             *      max_size: The maximum number of values in the cache, or zero for no limit
+             */
+            ShardedCache(std::size_t num_shards, std::size_t max_size=0);
+
+            /**
+             * Looks up the value for 'key'.
+             *
+             * Args:
+             *      key: The key to look up
+             *      value: Output, set to the cached value if it was found
+             *
+             * Returns:
+             *      If a value was found for 'key'
+             */
+            bool find(const K& key, V& value);
+
+            /**
+             * Inserts a value for 'key', if there isn't already one. If another thread inserted a value for 'key' in
+             * the meantime, then the value already in the cache is kept, so that all callers share the same value.
+             *
+             * Args:
+             *      key: The key to insert a value for
+             *      value: The value to insert
+             *
+             * Returns:
+             *      The value in the cache for 'key'
+             */
+            V insert(const K& key, const V& value);
+
+            /**
+             * Removes all values from the cache (the hit and miss counts are kept).
+             */
+            void clear();
+
+            /**
+             * Returns the number of values in the cache.
+             */
+            std::size_t size();
+
+            /**
+             * Returns the hit and miss counts, and size of the cache.
+             */
+            CacheStats get_stats();
+    };
+}
+
+#include "sharded_cache.cc"
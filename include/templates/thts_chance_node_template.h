@@ -122,8 +122,8 @@ namespace thts {
              *          Sum of rewards in both of the 'trial_rewards_after_node' and 'trial_rewards_before_node' lists
              */
             void backup(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 _Context& ctx);
@@ -145,7 +145,8 @@ namespace thts {
              *      A pointer to a new _DNode object
              */
             std::shared_ptr<_DNode> create_child_node_helper(
-                std::shared_ptr<const _O> observation, std::shared_ptr<const _S> next_state=nullptr) const;
+                const std::shared_ptr<const _O>& observation,
+                const std::shared_ptr<const _S>& next_state=nullptr) const;
 
             /**
              * Returns a string representation of the value of this node currently. Used for pretty printing.
@@ -191,7 +192,7 @@ namespace thts {
              *      A pointer to a new child chance node
              */
             std::shared_ptr<_DNode> create_child_node(
-                std::shared_ptr<const _O> observation, std::shared_ptr<const _S> next_state=nullptr);
+                const std::shared_ptr<const _O>& observation, const std::shared_ptr<const _S>& next_state=nullptr);
 
             /**
              * If this node has a child object corresponding to 'observation'.
@@ -202,7 +203,7 @@ namespace thts {
              * Returns:
              *      true if we have a child corresponding to 'observation'
              */
-            bool has_child_node(std::shared_ptr<const _O> observation) const;
+            bool has_child_node(const std::shared_ptr<const _O>& observation) const;
 
             /**
              * Retrieves a child node from the children map.
@@ -215,7 +216,7 @@ namespace thts {
              * Returns:
              *      A pointer to the child node corresponding to 'observation'
              */
-            std::shared_ptr<_DNode> get_child_node(std::shared_ptr<const _O> observation) const;
+            std::shared_ptr<_DNode> get_child_node(const std::shared_ptr<const _O>& observation) const;
 
 
 
@@ -230,16 +231,18 @@ namespace thts {
             virtual void visit_itfc(ThtsEnvContext& ctx);
             virtual std::shared_ptr<const Observation> sample_observation_itfc(ThtsEnvContext& ctx);
             virtual void backup_itfc(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
 
             virtual std::shared_ptr<ThtsDNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Observation> observation, std::shared_ptr<const State> next_state=nullptr) const;
+                const std::shared_ptr<const Observation>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr) const;
             // virtual std::shared_ptr<ThtsDNode> create_child_node_itfc(
-            //    std::shared_ptr<const Observation> observation, std::shared_ptr<const State> next_state=nullptr) final;
+            //    const std::shared_ptr<const Observation>& observation,
+            //    const std::shared_ptr<const State>& next_state=nullptr) final;
                 
 
 
@@ -251,8 +254,9 @@ namespace thts {
         //     bool is_opponent() const;
         //     int get_num_children() const;
 
-        //     bool has_child_node_itfc(std::shared_ptr<const Observation> observation) const;
-        //     std::shared_ptr<ThtsDNode> get_child_node_itfc(std::shared_ptr<const Observation> observation) const;
+        //     bool has_child_node_itfc(const std::shared_ptr<const Observation>& observation) const;
+        //     std::shared_ptr<ThtsDNode> get_child_node_itfc(
+        //        const std::shared_ptr<const Observation>& observation) const;
 
         //     std::string get_pretty_print_string(int depth) const;
 
@@ -304,8 +308,8 @@ namespace thts {
     }
 
     void _CNode::backup(
-        const std::vector<double>& trial_rewards_before_node, 
-        const std::vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         _Context& ctx)
@@ -317,10 +321,10 @@ namespace thts {
      * N.B. for MDP, next_state=nullptr
      */ 
     shared_ptr<_DNode> _CNode::create_child_node_helper(
-        shared_ptr<const _O> observation, shared_ptr<const _S> next_state) const 
+        const shared_ptr<const _O>& observation, const shared_ptr<const _S>& next_state) const 
     {  
         shared_ptr<const _S> mdp_next_state = static_pointer_cast<const _S>(observation);
-        return make_shared<_DNode>(
+        return thts_manager->make_node<_DNode>(
             thts_manager, 
             mdp_next_state,
             decision_depth+1, 
@@ -338,18 +342,19 @@ namespace thts {
  * All this code basically calls the corresponding base implementation function, with approprtiate casts before/after.
  */
 namespace thts {
-    shared_ptr<_DNode> _CNode::create_child_node(shared_ptr<const _O> observation, shared_ptr<const _S> next_state) {
+    shared_ptr<_DNode> _CNode::create_child_node(
+        const shared_ptr<const _O>& observation, const shared_ptr<const _S>& next_state) {
         shared_ptr<const Observation> obsv_itfc = static_pointer_cast<const Observation>(observation);
         shared_ptr<const State> next_state_itfc = static_pointer_cast<const State>(next_state);
         shared_ptr<ThtsDNode> new_child = ThtsCNode::create_child_node_itfc(obsv_itfc, next_state_itfc);
         return static_pointer_cast<_DNode>(new_child);
     }
 
-    bool _CNode::has_child_node(std::shared_ptr<const _O> observation) const {
+    bool _CNode::has_child_node(const std::shared_ptr<const _O>& observation) const {
         return ThtsCNode::has_child_node_itfc(static_pointer_cast<const Observation>(observation));
     }
     
-    shared_ptr<_DNode> _CNode::get_child_node(shared_ptr<const _O> observation) const {
+    shared_ptr<_DNode> _CNode::get_child_node(const shared_ptr<const _O>& observation) const {
         shared_ptr<const Observation> obsv_itfc = static_pointer_cast<const Observation>(observation);
         shared_ptr<ThtsDNode> new_child = ThtsCNode::get_child_node_itfc(obsv_itfc);
         return static_pointer_cast<_DNode>(new_child);
@@ -372,8 +377,8 @@ namespace thts {
     }
 
     void _CNode::backup_itfc(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -388,7 +393,7 @@ namespace thts {
     }
 
     shared_ptr<ThtsDNode> _CNode::create_child_node_helper_itfc(
-        shared_ptr<const Observation> observation, shared_ptr<const State> next_state) const 
+        const shared_ptr<const Observation>& observation, const shared_ptr<const State>& next_state) const 
     {
         shared_ptr<const _O> obsv_itfc = static_pointer_cast<const _O>(observation);
         shared_ptr<const _S> next_state_itfc = static_pointer_cast<const _S>(next_state);
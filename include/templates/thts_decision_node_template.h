@@ -130,8 +130,8 @@ namespace thts {
              *          Sum of rewards in both of the 'trial_rewards_after_node' and 'trial_rewards_before_node' lists
              */
             void backup(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 _Context& ctx);
@@ -151,7 +151,7 @@ namespace thts {
              * Returns:
              *      A pointer to a new _CNode object
              */
-            std::shared_ptr<_CNode> create_child_node_helper(std::shared_ptr<const _A> action) const;
+            std::shared_ptr<_CNode> create_child_node_helper(const std::shared_ptr<const _A>& action) const;
 
             /**
              * Returns a string representation of the value of this node currently. Used for pretty printing.
@@ -195,7 +195,7 @@ namespace thts {
              * Returns:
              *      A pointer to a new child chance node
              */
-            std::shared_ptr<_CNode> create_child_node(std::shared_ptr<const _A> action);
+            std::shared_ptr<_CNode> create_child_node(const std::shared_ptr<const _A>& action);
 
             /**
              * If this node has a child object corresponding to 'action'.
@@ -206,7 +206,7 @@ namespace thts {
              * Returns:
              *      true if we have a child corresponding to 'action'
              */
-            bool has_child_node(std::shared_ptr<const _A> action) const;
+            bool has_child_node(const std::shared_ptr<const _A>& action) const;
 
             /**
              * Retrieves a child node from the children map.
@@ -219,7 +219,7 @@ namespace thts {
              * Returns:
              *      A pointer to the child node corresponding to 'action'
              */
-            std::shared_ptr<_CNode> get_child_node(std::shared_ptr<const _A> action) const;
+            std::shared_ptr<_CNode> get_child_node(const std::shared_ptr<const _A>& action) const;
 
 
 
@@ -235,15 +235,16 @@ namespace thts {
             virtual std::shared_ptr<const Action> select_action_itfc(ThtsEnvContext& ctx);
             virtual std::shared_ptr<const Action> recommend_action_itfc(ThtsEnvContext& ctx) const;
             virtual void backup_itfc(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx);
 
             virtual std::shared_ptr<ThtsCNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Action> action) const;
-            // virtual std::shared_ptr<ThtsCNode> create_child_node_itfc(std::shared_ptr<const Action> action) final;
+                const std::shared_ptr<const Action>& action) const;
+            // virtual std::shared_ptr<ThtsCNode> create_child_node_itfc(
+            //    const std::shared_ptr<const Action>& action) final;
 
 
 
@@ -258,8 +259,8 @@ namespace thts {
         //     bool is_opponent() const;
         //     int get_num_children() const;
 
-        //     bool has_child_node_itfc(std::shared_ptr<const Action> action) const;
-        //     std::shared_ptr<ThtsCNode> get_child_node_itfc(std::shared_ptr<const Action> action) const;
+        //     bool has_child_node_itfc(const std::shared_ptr<const Action>& action) const;
+        //     std::shared_ptr<ThtsCNode> get_child_node_itfc(const std::shared_ptr<const Action>& action) const;
 
         //     std::string get_pretty_print_string(int depth) const;
 
@@ -315,16 +316,16 @@ namespace thts {
     }
 
     void _DNode::backup(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         _Context& ctx) 
     {
     }
 
-    shared_ptr<_CNode> _DNode::create_child_node_helper(shared_ptr<const _A> action) const {
-        return make_shared<_CNode>(
+    shared_ptr<_CNode> _DNode::create_child_node_helper(const shared_ptr<const _A>& action) const {
+        return thts_manager->make_node<_CNode>(
             thts_manager, 
             state, 
             action, 
@@ -343,17 +344,17 @@ namespace thts {
  * All this code basically calls the corresponding base implementation function, with approprtiate casts before/after.
  */
 namespace thts {
-    shared_ptr<_CNode> _DNode::create_child_node(shared_ptr<const _A> action) {
+    shared_ptr<_CNode> _DNode::create_child_node(const shared_ptr<const _A>& action) {
         shared_ptr<const Action> act_itfc = static_pointer_cast<const Action>(action);
         shared_ptr<ThtsCNode> new_child = ThtsDNode::create_child_node_itfc(act_itfc);
         return static_pointer_cast<_CNode>(new_child);
     }
 
-    bool _DNode::has_child_node(shared_ptr<const _A> action) const {
+    bool _DNode::has_child_node(const shared_ptr<const _A>& action) const {
         return ThtsDNode::has_child_node_itfc(static_pointer_cast<const Action>(action));
     }
 
-    shared_ptr<_CNode> _DNode::get_child_node(shared_ptr<const _A> action) const {
+    shared_ptr<_CNode> _DNode::get_child_node(const shared_ptr<const _A>& action) const {
         shared_ptr<const Action> act_itfc = static_pointer_cast<const Action>(action);
         shared_ptr<ThtsCNode> new_child = ThtsDNode::get_child_node_itfc(act_itfc);
         return static_pointer_cast<_CNode>(new_child);
@@ -382,8 +383,8 @@ namespace thts {
     }
 
     void _DNode::backup_itfc(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -397,7 +398,7 @@ namespace thts {
             ctx_itfc);
     }
 
-    shared_ptr<ThtsCNode> _DNode::create_child_node_helper_itfc(shared_ptr<const Action> action) const {
+    shared_ptr<ThtsCNode> _DNode::create_child_node_helper_itfc(const shared_ptr<const Action>& action) const {
         shared_ptr<const _A> act_itfc = static_pointer_cast<const _A>(action);
         shared_ptr<_CNode> child_node = create_child_node_helper(act_itfc);
         return static_pointer_cast<ThtsCNode>(child_node);
@@ -5,6 +5,7 @@
 #include "thts_logger.h"
 #include "thts_manager.h"
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <limits>
@@ -37,14 +38,23 @@ namespace thts {
      *          A boolean stating if the workers thread pool is running. Set to false at destruction.
      *      num_threads: 
      *          The number of threads used in the workers thread pool.
+     *      use_lock_free_dispatch:
+     *          If workers should claim trials from the atomic 'trials_remaining' counter without holding 
+     *          'work_left_lock'. If false, every trial is dispatched while holding 'work_left_lock'.
+     *      max_trial_chunk_size:
+     *          The maximum number of trials a worker can claim at once when 'use_lock_free_dispatch' is true.
      *      num_trials: 
      *          The number of trials the pool is currently trying to run in total.
      *      start_time: 
      *          The start time of a 'run_trials' call.
      *      max_run_time: 
      *          The maximum duration we allow thts to run for)not including finishing off the current trials).
+     *      deadline:
+     *          The (steady clock) time that 'max_run_time' runs out, computed from 'start_time' and 'max_run_time'.
      *      trials_remaining: 
-     *          The number of trials the workers pool needs to run to have completed 'num_trials' trials.
+     *          The number of trials the workers pool needs to run to have completed 'num_trials' trials. Atomic so 
+     *          that workers can claim trials without holding 'work_left_lock'. May go negative when trials are 
+     *          claimed in chunks, which is treated the same as zero.
      *      num_threads_working: 
      *          The number of threads currently working
      *      trials_completed: 
@@ -53,6 +63,9 @@ namespace thts {
      *          The ThtsManager to use in the thts planning routine
      *      root_node: 
      *          The ThtsDNode root node that currently want to plan for
+     *      old_tree_deleter:
+     *          A thread used to free the discarded parts of the tree after a call to 'advance_root', so that the 
+     *          caller does not need to wait for the old tree to be freed
      */
     class ThtsPool {
         protected:   
@@ -65,15 +78,21 @@ namespace thts {
 
             // constant after init
             int num_threads;
+            bool use_lock_free_dispatch;
+            int max_trial_chunk_size;
 
             // protected by can_work_lock - variables only updated on 'run_trials' call 
+            // (workers only read them lock free after being woken via work_left_cv)
             int num_trials;
-            std::chrono::time_point<std::chrono::system_clock> start_time;
+            std::chrono::time_point<std::chrono::steady_clock> start_time;
             std::chrono::duration<double> max_run_time;
+            std::chrono::time_point<std::chrono::steady_clock> deadline;
+
+            // atomic, updated by workers when claiming trials (kept on its own cache line)
+            alignas(64) std::atomic<int> trials_remaining;
 
             // protected by can_work_lock - variables related to if should run more trials + updated by workers
-            int trials_remaining;
-            int num_threads_working;
+            alignas(64) int num_threads_working;
 
             // protected by logging_lock - variables to do with logging
             int trials_completed;
@@ -83,6 +102,9 @@ namespace thts {
             std::shared_ptr<ThtsManager> thts_manager;
             std::shared_ptr<ThtsDNode> root_node;
 
+            // Only used in 'advance_root' and the destructor
+            std::thread old_tree_deleter;
+
         public:
             /**
              * Constructs the ThtsPool with 'num_threads' worker threads.
@@ -94,12 +116,19 @@ namespace thts {
              *          NULL, then a default root node construction is attempted using the initial state from 
              *          thts_manager->thts_env.
              *      num_threads: The number of worker threads to spawn
+             *      logger: An optional logger to log the progress of thts with
+             *      use_lock_free_dispatch: 
+             *          If workers should claim trials from an atomic counter (in chunks) rather than holding 
+             *          'work_left_lock' for every trial
+             *      max_trial_chunk_size: The maximum number of trials a worker can claim at once
              */
             ThtsPool(
                 std::shared_ptr<ThtsManager> thts_manager=nullptr, 
                 std::shared_ptr<ThtsDNode> root_node=nullptr, 
                 int num_threads=1,
-                std::shared_ptr<ThtsLogger> logger=nullptr);
+                std::shared_ptr<ThtsLogger> logger=nullptr,
+                bool use_lock_free_dispatch=true,
+                int max_trial_chunk_size=16);
 
             /**
              * Destructor. Required to allow the thread pool to exit gracefully.
@@ -108,12 +137,43 @@ namespace thts {
 
             /**
              * Setter for new search environment, so thread pool can be reused
+             * 
+             * If 'new_thts_manager' is the pool's current manager, then it starts a new node arena for the new tree 
+             * (see 'ThtsManager::start_new_node_arena').
             */
             void set_new_env(
                 std::shared_ptr<ThtsManager> new_thts_manager, 
                 std::shared_ptr<ThtsDNode> new_root_node,
                 std::shared_ptr<ThtsLogger> new_logger=nullptr);
 
+            /**
+             * Advances the root node after 'action' was taken in the real environment and 'observation' was 
+             * observed, so that the subtree for the next decision is reused.
+             * 
+             * If the tree contains a decision node for ('action', 'observation'), then it becomes the new root node 
+             * (see 'ThtsDNode::make_root_node'), and the rest of the old tree is released. If no other references to 
+             * the old tree are held, then it is freed (on a background thread if 'free_old_tree_in_background' is 
+             * true). If the tree doesn't contain the node, then the pool is left unchanged and nullptr is returned, 
+             * and a new root node should be set using 'set_new_env'.
+             * 
+             * When using a transposition table, entries for timesteps before the new root are removed from the table.
+             * 
+             * Waits for any trials still running (e.g. from a non-blocking 'run_trials' call) to finish first, as 
+             * the tree, transposition table and node arena are modified.
+             * 
+             * Args:
+             *      action: The action taken at the current root node
+             *      observation: The observation received after taking 'action'
+             *      free_old_tree_in_background: If the discarded tree should be freed on a background thread
+             * 
+             * Returns:
+             *      The new root node, or nullptr if it isn't in the tree
+             */
+            virtual std::shared_ptr<ThtsDNode> advance_root(
+                std::shared_ptr<const Action> action, 
+                std::shared_ptr<const Observation> observation,
+                bool free_old_tree_in_background=true);
+
             /**
              * Returns a boolean for if the workers need to do more work to complete a 'run_trials' call.
              * 
@@ -122,6 +182,44 @@ namespace thts {
             virtual bool work_left();
 
         protected:
+            /**
+             * Sets 'start_time', 'max_run_time' and the corresponding (saturating) 'deadline'.
+             * 
+             * Args:
+             *      new_start_time: The start time of a 'run_trials' call
+             *      new_max_run_time: The maximum duration to run trials for
+             */
+            void set_run_time_limits(
+                std::chrono::time_point<std::chrono::steady_clock> new_start_time, 
+                std::chrono::duration<double> new_max_run_time);
+
+            /**
+             * Returns if there is still time left before 'deadline'. Doesn't require work_left_lock.
+             */
+            bool time_left() const;
+
+            /**
+             * Claims a chunk of trials from 'trials_remaining' without taking 'work_left_lock'.
+             * 
+             * Chunk sizes are proportional to the number of trials remaining per thread (capped at 
+             * 'max_trial_chunk_size'), so that chunks get smaller towards the end of a 'run_trials' call, and we 
+             * don't end up with one thread running lots of trials while the others are idle.
+             * 
+             * Args:
+             *      trials_remaining_at_claim: 
+             *          Set to the value of 'trials_remaining' immediately before the chunk was claimed
+             * 
+             * Returns:
+             *      The number of trials claimed, zero if there are no trials left to claim
+             */
+            int claim_trials(int& trials_remaining_at_claim);
+
+            /**
+             * Runs trials claimed with 'claim_trials' until there are no trials or time left. Called by worker_fn 
+             * without holding work_left_lock.
+             */
+            void run_claimed_trials();
+
             /**
              * Checks if a worker should continue their selection phase or if it is time to end.
              * 
@@ -136,7 +234,7 @@ namespace thts {
              *      If the selection phase should be ended.
              */
             virtual bool should_continue_selection_phase(
-                std::shared_ptr<ThtsDNode> cur_node, bool new_decision_node_created_this_trial);
+                const std::shared_ptr<ThtsDNode>& cur_node, bool new_decision_node_created_this_trial);
 
             /**
              * Runs the selection phase of a trial, called by worker threads.
@@ -194,7 +292,8 @@ namespace thts {
             /**
              * The worker thread thnuk.
              * 
-             * Waits for work, and calls 'run_thts_trial' until there is no more work to do.
+             * Waits for work, and calls 'run_thts_trial' until there is no more work to do. Only interacts with 
+             * 'work_left_cv' when going idle if 'use_lock_free_dispatch' is true.
              */
             virtual void worker_fn();
 
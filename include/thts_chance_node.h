@@ -1,20 +1,25 @@
 #pragma once
 
+#include "flat_child_map.h"
+#include "relaxed_atomic.h"
+#include "rewards_view.h"
 #include "thts_decision_node.h"
 #include "thts_manager.h"
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace thts {
     // forward declare
     class ThtsDNode;
 
-    // CNodeMap type is lengthy, so typedef
-    typedef std::unordered_map<std::shared_ptr<const Observation>,std::shared_ptr<ThtsDNode>> DNodeChildMap;
+    // DNodeMap type is lengthy, so typedef (stored flat, chance nodes with few outcomes are searched linearly)
+    typedef FlatChildMap<std::shared_ptr<const Observation>,std::shared_ptr<ThtsDNode>> DNodeChildMap;
     
     /**
      * An abstract base class for Chance Nodes.
@@ -40,11 +45,21 @@ namespace thts {
      *          when the Thts algorithm is used at each timestep to make a decision. For example, this is necessary in 
      *          a two player game to decide who's turn it is
      *      num_visits:
-     *          The number of times the node has been visited (had the 'visit' function called)
+     *          The number of times the node has been visited (had the 'visit' function called). A RelaxedAtomic so 
+     *          that it can be read by the parent node during selection without holding this nodes lock
+     *      num_virtual_losses:
+     *          The number of trials that have visited this node, but not yet backed it up, when running with a 
+     *          virtual loss (see 'virtual_loss' in ThtsManager). Atomic so that it can be read by the parent decision 
+     *          node during selection without holding this nodes lock
      *      parent:
      *          A pointer to this nodes parent node. nullptr if this node is the root node
      *      children:
-     *          A map from Action objects to child ThtsCNode objects
+     *          A map from Observation objects to child ThtsDNode objects
+     *      child_rewards:
+     *          The reward for reaching each child, indexed by the position of the child's slot in 'children' (see 
+     *          'FlatChildMap::iterator::position'), so that the lookup that finds a child also finds its reward. 
+     *          Computed once when the child is created (only if the managers 'cache_rewards' option is set), and NaN 
+     *          for any slots that don't have a reward stored
      */
     class ThtsCNode : public std::enable_shared_from_this<ThtsCNode> {
         // Allow ThtsDNode access to private members
@@ -60,8 +75,10 @@ namespace thts {
             int decision_timestep;
             std::weak_ptr<const ThtsDNode> parent;
 
-            int num_visits;
+            RelaxedAtomic<int> num_visits;
+            std::atomic<int> num_virtual_losses;
             DNodeChildMap children;
+            std::vector<double> child_rewards;
 
         public: 
             /**
@@ -137,19 +154,20 @@ namespace thts {
              * 
              * Args:
              *      trial_rewards_before_node: 
-             *          A list of rewards recieved (at each timestep) on the trial prior to reaching this node.
+             *          A list of rewards recieved (at each timestep) on the trial prior to reaching this node. (A view 
+             *          that is only valid until this function returns, see RewardsView.)
              *      trial_rewards_after_node:
              *          A list of rewards recieved (at each timestep) on the trial after reaching this node. This list 
              *          includes the reward from R(state,action) that would have been recieved from taking the action 
-             *          in this node.
+             *          in this node. (A view that is only valid until this function returns, see RewardsView.)
              *      trial_cumulative_return_after_node:
              *          Sum of rewards in the 'trial_rewards_after_node' list
              *      trial_cumulative_return:
              *          Sum of rewards in both of the 'trial_rewards_after_node' and 'trial_rewards_before_node' lists
              */
             virtual void backup_itfc(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx) = 0;
@@ -174,7 +192,8 @@ namespace thts {
              *      A pointer to the created child node
              */
             virtual std::shared_ptr<ThtsDNode> create_child_node_itfc(
-                std::shared_ptr<const Observation> observation, std::shared_ptr<const State> next_state=nullptr) final;
+                const std::shared_ptr<const Observation>& observation,
+                const std::shared_ptr<const State>& next_state=nullptr) final;
 
         protected:
             /**
@@ -188,8 +207,8 @@ namespace thts {
              *      A pointer to a newly created child node on the heap
              */
             virtual std::shared_ptr<ThtsDNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Observation> observation, 
-                std::shared_ptr<const State> next_state=nullptr) const = 0;
+                const std::shared_ptr<const Observation>& observation, 
+                const std::shared_ptr<const State>& next_state=nullptr) const = 0;
 
             /**
              * Helper for pretty printing. Should return some string representing the current 'value' of this node.
@@ -200,6 +219,22 @@ namespace thts {
             virtual std::string get_pretty_print_val() const = 0;
 
         public:
+            /**
+             * Adds a virtual loss to this node. Called by ThtsPool in the selection phase (when using virtual loss).
+             */
+            void add_virtual_loss();
+
+            /**
+             * Removes a virtual loss from this node. Called by ThtsPool in the backup phase (when using virtual loss).
+             */
+            void remove_virtual_loss();
+
+            /**
+             * Gets the number of (in flight) trials that currently have a virtual loss applied to this node. Can be 
+             * called without holding this nodes lock.
+             */
+            int get_num_virtual_losses() const;
+
             /**
              * Returns if this node is planning for a two player game.
              * 
@@ -237,7 +272,7 @@ namespace thts {
              * Returns:
              *      Returns true if node has a child corresponding to 'observation'
              */
-            bool has_child_node_itfc(std::shared_ptr<const Observation> observation) const;
+            bool has_child_node_itfc(const std::shared_ptr<const Observation>& observation) const;
 
             /**
              * Returns a pointer to a child of this node.
@@ -251,7 +286,24 @@ namespace thts {
              *      A pointer to the child decision node.
              */
             virtual std::shared_ptr<ThtsDNode> get_child_node_itfc(
-                std::shared_ptr<const Observation> observation) const;
+                const std::shared_ptr<const Observation>& observation) const;
+
+            /**
+             * Gets the child node for 'observation', and the reward for taking this nodes action in its state and 
+             * recieving 'observation', with a single lookup in 'children'.
+             * 
+             * Uses the reward stored when the child was created if there is one (see 'child_rewards'), and otherwise 
+             * calls the environments 'get_reward_itfc'.
+             * 
+             * Args:
+             *      observation: The observation recieved after taking this nodes action (must have a child node)
+             *      reward: Set to the reward R(state,action,observation)
+             * 
+             * Returns:
+             *      A pointer to the child decision node.
+             */
+            virtual std::shared_ptr<ThtsDNode> get_child_node_and_reward(
+                const std::shared_ptr<const Observation>& observation, double& reward) const;
 
             /**
              * Pretty prints the tree to a string.
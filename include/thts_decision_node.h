@@ -1,5 +1,8 @@
 #pragma once
 
+#include "flat_child_map.h"
+#include "relaxed_atomic.h"
+#include "rewards_view.h"
 #include "thts_chance_node.h"
 #include "thts_env.h"
 #include "thts_manager.h"
@@ -16,9 +19,30 @@ namespace thts {
     class ThtsCNode;
     class ThtsLogger;
     class ThtsPool;
+    class ThtsRootParallelPool;
 
-    // CNodeMap type is lengthy, so typedef
-    typedef std::unordered_map<std::shared_ptr<const Action>,std::shared_ptr<ThtsCNode>> CNodeChildMap;
+    // CNodeMap type is lengthy, so typedef (stored flat, see FlatChildMap)
+    typedef FlatChildMap<std::shared_ptr<const Action>,std::shared_ptr<ThtsCNode>> CNodeChildMap;
+
+    /**
+     * The statistics of a child (chance) node that are used to recommend an action at a decision node. Used to merge 
+     * the recommendations from the roots of independent trees (see ThtsRootParallelPool).
+     * 
+     * Member variables:
+     *      num_visits:
+     *          The number of times the child node has been visited
+     *      value:
+     *          The value estimate of the child node that would be used for recommendations. This is with respect to 
+     *          the agent acting at the decision node (i.e. already multiplied by -1 for opponent nodes), so larger 
+     *          is always better.
+     */
+    struct ChildRecommendationStats {
+        int num_visits;
+        double value;
+    };
+
+    // Map from actions to recommendation stats type is lengthy, so typedef
+    typedef std::unordered_map<std::shared_ptr<const Action>,ChildRecommendationStats> ChildRecommendationStatsMap;
 
     /**
      * An abstract base class for Decision Node.
@@ -41,20 +65,29 @@ namespace thts {
      *          The timestep corresponding to the current state in the larger planning problem. This is necessary 
      *          when the Thts algorithm is used at each timestep to make a decision. For example, this is necessary in 
      *          a two player game to decide who's turn it is
+     *      is_sink_node:
+     *          If 'state' is a sink state in the environment. Computed once when the node is constructed, as it's 
+     *          checked on every visit (see 'is_leaf')
      *      num_visits:
-     *          The number of times the node has been visited (had the 'visit' function called)
+     *          The number of times the node has been visited (had the 'visit' function called). A RelaxedAtomic so 
+     *          that it can be read by the parent node during selection without holding this nodes lock
      *      parent:
      *          A pointer to this nodes parent node. nullptr if this node is the root node
      *      children:
-     *          A map from Action objects to child ThtsCNode objects
+     *          A map from Action objects to child ThtsCNode objects. Subclasses with a fixed vector of 'actions' 
+     *          reserve slots for them (see FlatChildMap::reserve_keys), so that children can be found by position
      *      heuristic_value:
      *          The heuristic value of this decision node
+     *      evaluated_policy_prior:
+     *          The policy prior evaluated by the managers BatchedLeafEvaluator when this node was constructed (if 
+     *          using one), which subclasses get using 'compute_policy_prior'
      */
     class ThtsDNode : public std::enable_shared_from_this<ThtsDNode> {
         // Allow ThtsCNode, Logger and Pool access to private members
         friend ThtsCNode;
         friend ThtsLogger;
         friend ThtsPool;
+        friend ThtsRootParallelPool;
 
         protected:
             std::mutex node_lock;
@@ -63,12 +96,24 @@ namespace thts {
             std::shared_ptr<const State> state;
             int decision_depth;
             int decision_timestep;
+            bool is_sink_node;
             std::weak_ptr<const ThtsCNode> parent;
 
-            int num_visits;
+            RelaxedAtomic<int> num_visits;
             CNodeChildMap children;
 
             double heuristic_value;
+            std::shared_ptr<ActionPrior> evaluated_policy_prior;
+
+            /**
+             * Gets the policy prior for this node's state, for subclasses to call in their constructors. Either 
+             * returns the prior that was evaluated (in a batch) by the managers leaf evaluator, or computes it using 
+             * the managers prior function.
+             * 
+             * Returns:
+             *      The policy prior for 'state', or nullptr if the manager doesn't have a prior function
+             */
+            std::shared_ptr<ActionPrior> compute_policy_prior();
 
         public: 
             /**
@@ -149,6 +194,25 @@ namespace thts {
              */
             virtual std::shared_ptr<const Action> recommend_action_itfc(ThtsEnvContext& ctx) const = 0;
 
+            /**
+             * Fills a map with the statistics of each child that would be used to recommend an action at this node.
+             * 
+             * Used to merge recommendations over multiple independent trees. The default implementation fills in the 
+             * visit counts of the children and a value of zero. Will lock children to read their statistics.
+             * 
+             * Args:
+             *      child_stats: A map to fill with the statistics for each child of this node
+             */
+            virtual void fill_child_recommendation_stats_itfc(ChildRecommendationStatsMap& child_stats) const;
+
+            /**
+             * Returns if this node recommends the most visited action (true), or the action with the best value 
+             * (false). Used with 'fill_child_recommendation_stats_itfc' to merge recommendations over multiple trees.
+             * 
+             * Default implementation returns true.
+             */
+            virtual bool recommends_most_visited_itfc() const;
+
             /**
              * Thts backup function.
              * 
@@ -156,19 +220,20 @@ namespace thts {
              * 
              * Args:
              *      trial_rewards_before_node: 
-             *          A list of rewards recieved (at each timestep) on the trial prior to reaching this node.
+             *          A list of rewards recieved (at each timestep) on the trial prior to reaching this node. (A view 
+             *          that is only valid until this function returns, see RewardsView.)
              *      trial_rewards_after_node:
              *          A list of rewards recieved (at each timestep) on the trial after reaching this node. This list 
              *          includes the reward from R(state,action) that would have been recieved from taking an action 
-             *          from this node.
+             *          from this node. (A view that is only valid until this function returns, see RewardsView.)
              *      trial_cumulative_return_after_node:
              *          Sum of rewards in the 'trial_rewards_after_node' list
              *      trial_cumulative_return:
              *          Sum of rewards in both of the 'trial_rewards_after_node' and 'trial_rewards_before_node' lists
              */
             virtual void backup_itfc(
-                const std::vector<double>& trial_rewards_before_node, 
-                const std::vector<double>& trial_rewards_after_node, 
+                const RewardsView& trial_rewards_before_node, 
+                const RewardsView& trial_rewards_after_node, 
                 const double trial_cumulative_return_after_node, 
                 const double trial_cumulative_return,
                 ThtsEnvContext& ctx) = 0;
@@ -180,7 +245,7 @@ namespace thts {
              * can be expanded).
              * 
              * Returns:
-             *      If this node corresponds to a 'sink state' in the environment
+             *      If this node corresponds to a 'sink state' in the environment (see 'is_sink_node')
              */
             virtual bool is_sink() const;
 
@@ -213,7 +278,8 @@ namespace thts {
              * Returns:
              *      A pointer to the created child node
              */
-            virtual std::shared_ptr<ThtsCNode> create_child_node_itfc(std::shared_ptr<const Action> action) final;
+            virtual std::shared_ptr<ThtsCNode> create_child_node_itfc(
+                const std::shared_ptr<const Action>& action) final;
 
         protected:
             /**
@@ -226,7 +292,7 @@ namespace thts {
              *      A pointer to a newly created child node on the heap
              */
             virtual std::shared_ptr<ThtsCNode> create_child_node_helper_itfc(
-                std::shared_ptr<const Action> action) const = 0;
+                const std::shared_ptr<const Action>& action) const = 0;
 
             /**
              * Helper for pretty printing. Should return some string representing the current 'value' of this node.
@@ -245,6 +311,18 @@ namespace thts {
              */
             bool is_root_node() const;
 
+            /**
+             * Makes this node the root node of its tree, so that the subtree rooted at this node can be reused to 
+             * plan for the next decision. 
+             * 
+             * Clears 'parent', and reduces the 'decision_depth' of every node in the subtree by the current 
+             * 'decision_depth' of this node, so that 'is_root_node' and the 'max_depth' of the search are relative to 
+             * this node. The 'decision_timestep' of nodes are unchanged. 
+             * 
+             * Should only be called when no trials are running in the tree.
+             */
+            void make_root_node();
+
             /**
              * Returns if this node is planning for a two player game.
              * 
@@ -273,6 +351,14 @@ namespace thts {
             */
             int get_num_visits() const;  
 
+            /**
+             * Gets the decision depth of this node in the tree.
+             * 
+             * Returns:
+             *      The decision depth of this node (relative to the current root node).
+            */
+            int get_decision_depth() const;
+
             /**
              * Helper function to get number of children this node currently has.
              * 
@@ -292,7 +378,7 @@ namespace thts {
              * Returns:
              *      Returns true if node has a child corresponding to 'action'
              */
-            bool has_child_node_itfc(std::shared_ptr<const Action> action) const;
+            bool has_child_node_itfc(const std::shared_ptr<const Action>& action) const;
 
             /**
              * Returns a pointer to a child of this node.
@@ -305,7 +391,7 @@ namespace thts {
              * Returns:
              *      A pointer to the child chance node.
              */
-            virtual std::shared_ptr<ThtsCNode> get_child_node_itfc(std::shared_ptr<const Action> action) const;
+            virtual std::shared_ptr<ThtsCNode> get_child_node_itfc(const std::shared_ptr<const Action>& action) const;
 
             /**
              * Pretty prints the tree to a string.
@@ -189,6 +189,8 @@ namespace thts {
              * Sometimes it is useful to place each trial in some sort of context, or a context can be used to cache 
              * information that doesn't need to be stored in the tree search permenantly, but is useful computationally. 
              * This function generates a context to be used. Most of the time it will be something like an empty map. 
+             * The default implementation recycles (cleared) contexts on each thread, rather than allocating a new 
+             * context for every trial.
              * 
              * Args:
              *      state: The initial state
@@ -1,10 +1,51 @@
 #pragma once
 
+#include <cstddef>
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace thts {
+    // forward declare
+    class ThtsEnvContext;
+
+    /**
+     * A typed handle to a slot in ThtsEnvContext objects, for values that are read and written on every trial.
+     * 
+     * Slots are registered by name once (see 'ThtsEnvContext::register_slot'), typically when a node is constructed, 
+     * and are then looked up by index, avoiding building and hashing string keys on every visit. Registering the same 
+     * name again gives the same slot, so for example, all nodes at the same depth can share a slot.
+     * 
+     * A default constructed slot is invalid, and cannot be used to get or put values.
+     * 
+     * Member variables:
+     *      index: The index of the slot in the 'slot_values' of ThtsEnvContext's
+     */
+    template <typename T>
+    class ThtsEnvContextSlot {
+        friend ThtsEnvContext;
+
+        private:
+            static constexpr std::size_t invalid_index = static_cast<std::size_t>(-1);
+
+            std::size_t index;
+
+            ThtsEnvContextSlot(std::size_t index) : index(index) {}
+
+        public:
+            ThtsEnvContextSlot() : index(invalid_index) {}
+
+            /**
+             * Returns if this slot has been registered (and so can be used to get and put values)
+             */
+            bool is_valid() const { return index != invalid_index; }
+    };
+
     /**
      * A base context class for use in ThtsEnv objects (see below).
      * 
@@ -12,14 +53,48 @@ namespace thts {
      * class that can be used by the ThtsEnv abstract class, and can be subclassed if a context more intricate than a 
      * map from strings is necessary.
      * 
+     * Values can either be stored with string keys, or in typed slots (see ThtsEnvContextSlot). Slots are the fast 
+     * path, and should be used for values that are accessed on every trial, as string keys need to be hashed (and 
+     * often built) for every access.
+     * 
+     * Slots can either hold a pointer to a value ('put_value' and 'get_value_ptr'), or hold the value itself 
+     * ('emplace_inline_value' and 'get_inline_value_ptr'). Inline values are owned by the context, and are kept 
+     * (including any memory that they own, such as the capacity of a vector) when the context is cleared, so once a 
+     * (recycled) context has been used for a trial, writing inline values doesn't allocate. Each slot should only be 
+     * used in one of the two ways.
+     * 
+     * The default 'ThtsEnv::sample_context_itfc' recycles contexts on each thread (calling 'clear' between trials), 
+     * so subclasses that add data should also override 'clear'.
+     * 
      * Member variables:
      *      context: A mapping from string keys to abitrary void* pointers for arbitrary data store.
+     *      context_const: A mapping from string keys to abitrary const void* pointers for arbitrary data store.
+     *      slot_values: The values stored in slots, indexed by the slots' indices (nullptr for empty slots).
+     *      inline_slot_values: The inline values of slots, indexed by the slots' indices.
      */
     class ThtsEnvContext {
 
         private:
             std::unordered_map<std::string, std::shared_ptr<void>> context;
             std::unordered_map<std::string, std::shared_ptr<const void>> context_const;
+            std::vector<std::shared_ptr<void>> slot_values;
+
+            /**
+             * The storage for an inline slot value. 'storage' is allocated the first time that the slot is written, 
+             * and then reused, and 'is_set' is if the value has been written since the context was last cleared.
+             */
+            struct InlineSlotValue {
+                std::shared_ptr<void> storage;
+                bool is_set = false;
+            };
+
+            std::vector<InlineSlotValue> inline_slot_values;
+
+            /**
+             * Gets the index for the slot with the name 'name', registering a new slot if necessary. Throws a 
+             * runtime_error if the slot has been registered with a different type.
+             */
+            static std::size_t register_slot_index(const std::string& name, std::type_index type);
 
         public:
             /**
@@ -150,5 +225,95 @@ namespace thts {
              * (Const version) Erase a value from the context
             */
            virtual void erase_const(const std::string& key);
+
+            /**
+             * Registers a slot that values of type T can be stored in. Thread safe.
+             * 
+             * Args:
+             *      name: A unique name for the slot. Registering the same name again returns the same slot
+             * 
+             * Returns:
+             *      A handle to the slot, that can be used with any ThtsEnvContext
+             */
+            template <typename T>
+            static ThtsEnvContextSlot<T> register_slot(const std::string& name) {
+                return ThtsEnvContextSlot<T>(register_slot_index(name, std::type_index(typeid(T))));
+            }
+
+            /**
+             * Gets a value pointer from a slot of this context.
+             * 
+             * Args:
+             *      slot: A (valid) slot to get the value from
+             * Returns:
+             *      The value pointer (type T*) stored in 'slot', or nullptr if no value has been put in the slot
+             */
+            template <typename T>
+            std::shared_ptr<T> get_value_ptr(const ThtsEnvContextSlot<T>& slot) const {
+                if (slot.index >= slot_values.size()) return nullptr;
+                return std::static_pointer_cast<T>(slot_values[slot.index]);
+            }
+
+            /**
+             * Puts a value in a slot of this context.
+             * 
+             * Args:
+             *      slot: A (valid) slot to put the value in
+             *      val: A pointer to data to store in 'slot'
+             */
+            template <typename T>
+            void put_value(const ThtsEnvContextSlot<T>& slot, std::shared_ptr<T> val) {
+                if (slot.index >= slot_values.size()) slot_values.resize(slot.index + 1);
+                slot_values[slot.index] = std::const_pointer_cast<std::remove_const_t<T>>(std::move(val));
+            }
+
+            /**
+             * Gets a reference to the inline value of a slot of this context, to write the value in place, and marks 
+             * the slot as set. If the slot was set in a previous trial, then the old value is returned (to be 
+             * overwritten), so that any memory it owns can be reused.
+             * 
+             * Args:
+             *      slot: A (valid) slot to write the value of
+             * Returns:
+             *      A reference to the value stored inline in 'slot'
+             */
+            template <typename T>
+            T& emplace_inline_value(const ThtsEnvContextSlot<T>& slot) {
+                if (slot.index >= inline_slot_values.size()) inline_slot_values.resize(slot.index + 1);
+                InlineSlotValue& slot_value = inline_slot_values[slot.index];
+                if (slot_value.storage == nullptr) slot_value.storage = std::make_shared<std::remove_const_t<T>>();
+                slot_value.is_set = true;
+                return *std::static_pointer_cast<std::remove_const_t<T>>(slot_value.storage);
+            }
+
+            /**
+             * Gets a pointer to the inline value of a slot of this context.
+             * 
+             * Args:
+             *      slot: A (valid) slot to get the value from
+             * Returns:
+             *      A pointer to the value stored inline in 'slot', or nullptr if it hasn't been set since the context 
+             *      was last cleared
+             */
+            template <typename T>
+            T* get_inline_value_ptr(const ThtsEnvContextSlot<T>& slot) const {
+                if (slot.index >= inline_slot_values.size() || !inline_slot_values[slot.index].is_set) return nullptr;
+                return std::static_pointer_cast<std::remove_const_t<T>>(inline_slot_values[slot.index].storage).get();
+            }
+
+            /**
+             * Erase a value from a slot of the context
+             */
+            template <typename T>
+            void erase(const ThtsEnvContextSlot<T>& slot) {
+                if (slot.index < slot_values.size()) slot_values[slot.index] = nullptr;
+                if (slot.index < inline_slot_values.size()) inline_slot_values[slot.index].is_set = false;
+            }
+
+            /**
+             * Removes all values from the context, so that it can be reused for another trial. Keeps the memory 
+             * allocated for slots (including inline slot values).
+             */
+            virtual void clear();
     };
 }
\ No newline at end of file
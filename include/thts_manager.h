@@ -1,14 +1,22 @@
 #pragma once
 
+#include "batched_leaf_evaluator.h"
 #include "helper.h"
+#include "heuristic_evaluators.h"
+#include "node_arena.h"
 #include "thts_env.h"
 #include "thts_types.h"
+#include "transposition_table.h"
 
+#include <cstdint>
 #include <cstdlib>
 #include <limits>
 #include <memory>
 #include <mutex>
 #include <random>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 
@@ -21,10 +29,33 @@ namespace thts {
      * 
      * Member variables (that are different to RandManager/ThtsManager):
      *      num_transposition_table_mutexes:
-     *          Specifies the size of 'dmap_mutexes' in ThtsManager
+     *          The number of segments (each protected by its own mutex) to split the transposition table into
+     *      transposition_table_max_size:
+     *          The maximum number of entries in the transposition table, or zero for no limit. Entries are replaced 
+     *          when the table is full (see TranspositionTable)
      *      seed:
      *          An integer seed to use for random number generation. Default of zero uses a 'random device' to generate 
      *          a seed 
+     *      virtual_loss:
+     *          The (pessimistic) virtual loss to apply to chance nodes that have been visited by a trial that hasn't 
+     *          finished its backup yet. Used to spread threads across the tree when running with multiple threads. 
+     *          A value of zero (the default) means no virtual loss is used. How the virtual loss is used is 
+     *          algorithm specific (see for example UctDNode::fill_ucb_values and MentsDNode::apply_virtual_loss).
+     *      use_thread_local_rng:
+     *          If each thread should use its own random number generator (stream), derived deterministically from 
+     *          'seed'. If false, a single generator protected by a mutex is shared between threads (compatibility 
+     *          mode, that produces the same random numbers as previous versions for a given seed).
+     *      use_node_arena:
+     *          If nodes should be allocated from a NodeArena owned by the manager (see 'ThtsManager::make_node'), 
+     *          rather than individually on the heap.
+     *      use_batched_evaluation:
+     *          If the heuristic and prior functions should be evaluated in batches, by a BatchedLeafEvaluator owned 
+     *          by the manager (see 'ThtsManager::leaf_evaluator').
+     *      evaluation_batch_size:
+     *          The maximum number of states to evaluate in a batch, when using batched evaluation. Batches are at 
+     *          most as large as the number of threads running trials.
+     *      evaluation_max_latency:
+     *          The maximum time (in seconds) to wait for a batch to fill up, when using batched evaluation.
      */
     struct ThtsManagerArgs {
         static const int max_depth_default = std::numeric_limits<int>::max();
@@ -33,44 +64,133 @@ namespace thts {
         static const bool mcts_mode_default = true;
         static const bool is_two_player_game_default = false;
         static const bool use_transposition_table_default = false;
-        static const int num_transposition_table_mutexes_default = 1;
+        static const int num_transposition_table_mutexes_default = 16;
+        static const std::size_t transposition_table_max_size_default = 0;
         static const int seed_default = 0;
+        static const bool use_thread_local_rng_default = true;
+        static constexpr double virtual_loss_default = 0.0;
+        static const bool use_node_arena_default = true;
+        static const bool use_generative_model_default = false;
+        static const bool cache_rewards_default = true;
+        static const bool use_batched_evaluation_default = false;
+        static const std::size_t evaluation_batch_size_default = 8;
+        static constexpr double evaluation_max_latency_default = 0.001;
         
         std::shared_ptr<ThtsEnv> thts_env;
         int max_depth;
         HeuristicFnPtr heuristic_fn;
         PriorFnPtr prior_fn;
+        BatchHeuristicFnPtr batch_heuristic_fn;
+        BatchPriorFnPtr batch_prior_fn;
+        std::shared_ptr<HeuristicEvaluator> heuristic_evaluator;
+        std::shared_ptr<PriorEvaluator> prior_evaluator;
 
         bool mcts_mode;
         bool is_two_player_game;
         bool use_transposition_table;
+        bool use_generative_model;
+        bool cache_rewards;
 
         int num_transposition_table_mutexes;
+        std::size_t transposition_table_max_size;
+
+        double virtual_loss;
 
         int seed;
+        bool use_thread_local_rng;
+
+        bool use_node_arena;
+
+        bool use_batched_evaluation;
+        std::size_t evaluation_batch_size;
+        double evaluation_max_latency;
 
         ThtsManagerArgs(std::shared_ptr<ThtsEnv> thts_env) :
             thts_env(thts_env),
             max_depth(max_depth_default),
             heuristic_fn(helper::zero_heuristic_fn),
             prior_fn(nullptr),
+            batch_heuristic_fn(nullptr),
+            batch_prior_fn(nullptr),
+            heuristic_evaluator(),
+            prior_evaluator(),
             mcts_mode(mcts_mode_default),
             is_two_player_game(is_two_player_game_default),
             use_transposition_table(use_transposition_table_default),
+            use_generative_model(use_generative_model_default),
+            cache_rewards(cache_rewards_default),
             num_transposition_table_mutexes(num_transposition_table_mutexes_default),
-            seed(seed_default) {}
+            transposition_table_max_size(transposition_table_max_size_default),
+            virtual_loss(virtual_loss_default),
+            seed(seed_default),
+            use_thread_local_rng(use_thread_local_rng_default),
+            use_node_arena(use_node_arena_default),
+            use_batched_evaluation(use_batched_evaluation_default),
+            evaluation_batch_size(evaluation_batch_size_default),
+            evaluation_max_latency(evaluation_max_latency_default) {}
 
         virtual ~ThtsManagerArgs() = default;
     };
 
+    /**
+     * A random number generator stream, used by a single thread.
+     * 
+     * Member variables:
+     *      int_gen:   
+     *          A 'mersenne_twister_engine' used to seed the integer random number generation
+     *      real_gen:   
+     *          A 'mersenne_twister_engine' used to seed the uniform [0,1) random number generation
+     *      int_distr: 
+     *          A random number generator for integer numbers in the range [0,RAND_MAX)
+     *      real_distr: 
+     *          A random number generator for real numbers in the range [0,1)
+     */
+    struct RandStream {
+        std::mt19937 int_gen;
+        std::mt19937 real_gen;
+        std::uniform_int_distribution<int> int_distr;
+        std::uniform_real_distribution<double> real_distr;
+
+        /**
+         * Constructs the 'stream_id'th stream for 'base_seed' (and 'tree_index'). Streams are split by seeding the 
+         * generators with a seed sequence over (base_seed, stream_id, tree_index), so different streams produce 
+         * statistically independent sequences, and the same (base_seed, stream_id, tree_index) always produces the 
+         * same sequence. A 'tree_index' of zero gives the same streams as a search over a single tree.
+         */
+        RandStream(std::uint32_t base_seed, int stream_id, std::uint32_t tree_index=0u);
+    };
+
+    /**
+     * The heuristic and prior evaluators used by a single thread (see ThtsManager::get_heuristic_evaluator).
+     * 
+     * Member variables:
+     *      heuristic_evaluator:
+     *          The threads clone of the managers heuristic evaluator, or the shared evaluator if it can't be cloned
+     *      prior_evaluator:
+     *          The threads clone of the managers prior evaluator, or the shared evaluator if it can't be cloned
+     */
+    struct ThreadEvaluators {
+        std::shared_ptr<HeuristicEvaluator> heuristic_evaluator;
+        std::shared_ptr<PriorEvaluator> prior_evaluator;
+    };
+
     /**
      * Rand Manager. A manager for random number generation.
      * 
      * This class manages any random number generation needed, and is used as a base class for algorithm managers.
      * 
+     * When 'use_thread_local_rng' is true, each thread that calls 'get_rand_int' or 'get_rand_uniform' is given its 
+     * own RandStream, so no lock is needed to generate random numbers. Streams are given ids in the order that threads 
+     * first use this manager, and the 'stream_id'th stream is seeded deterministically from the seed (so running with 
+     * a single thread is reproducible). A (small, per thread) cache is used to look up the calling thread's stream, 
+     * and rng_lock is only taken the first time that a thread uses this manager. Threads should release their stream 
+     * with 'release_thread_rand_stream' before they exit (ThtsPool workers do), so that streams don't accumulate 
+     * across thread pools, and so a new thread that happens to be given the id of an exited thread gets a new stream.
+     * 
      * Member variables:
      *      rng_lock:
-     *          A mutex to protect random number generation function calls.
+     *          A mutex to protect random number generation function calls (in compatibility mode), and to protect 
+     *          'thread_rand_streams'.
      *      rd:
      *          A 'random_device' which is the computers source of (psuedo) random numbers
      *      int_gen:   
@@ -81,6 +201,20 @@ namespace thts {
      *          A random number generator for integer numbers in the range [0,RAND_MAX)
      *      real_distr: 
      *          A random number generator for real numbers in the range [0,1)
+     *      use_thread_local_rng:
+     *          If each thread should use its own RandStream rather than the shared (mutex protected) generators
+     *      base_seed:
+     *          The seed that each RandStream is derived from
+     *      rand_tree_index:
+     *          The index of the tree that this manager is used to search, when searching multiple independent trees 
+     *          (see 'set_rand_tree_index'), which each RandStream is also derived from
+     *      rand_manager_id:
+     *          A unique id for this RandManager, used to check if a thread's cached RandStream belongs to this manager
+     *      next_stream_id:
+     *          The id to give the next RandStream made. Ids aren't reused when streams are released, so that live 
+     *          threads never share a stream
+     *      thread_rand_streams:
+     *          The RandStream for each thread that has used this manager (and not released it)
      */
     class RandManager { 
         protected:
@@ -91,27 +225,79 @@ namespace thts {
             std::uniform_int_distribution<int> int_distr;
             std::uniform_real_distribution<double> real_distr;
 
+            bool use_thread_local_rng;
+            std::uint32_t base_seed;
+            std::uint32_t rand_tree_index;
+            std::uint64_t rand_manager_id;
+            int next_stream_id;
+            std::unordered_map<std::thread::id, std::unique_ptr<RandStream>> thread_rand_streams;
+
             void init_random_seed() {
                 int_gen = std::mt19937(rd());
                 real_gen = std::mt19937(rd());
+                base_seed = rd();
             }
+
+            /**
+             * Returns a unique id for a new RandManager
+             */
+            static std::uint64_t get_new_rand_manager_id();
+
+            /**
+             * Gets the RandStream for the calling thread, creating it if this is the first call from this thread.
+             */
+            RandStream& get_thread_rand_stream();
         
         public:
-            RandManager(const int seed=ThtsManagerArgs::seed_default) :
-                rng_lock(),
-                int_gen(seed),
-                real_gen(seed),
-                int_distr(0,RAND_MAX),
-                real_distr(0.0,1.0) 
+            RandManager(
+                const int seed=ThtsManagerArgs::seed_default, 
+                const bool use_thread_local_rng=ThtsManagerArgs::use_thread_local_rng_default) :
+                    rng_lock(),
+                    int_gen(seed),
+                    real_gen(seed),
+                    int_distr(0,RAND_MAX),
+                    real_distr(0.0,1.0),
+                    use_thread_local_rng(use_thread_local_rng),
+                    base_seed(seed),
+                    rand_tree_index(0u),
+                    rand_manager_id(get_new_rand_manager_id()),
+                    next_stream_id(0),
+                    thread_rand_streams()
             {
                 if (seed == 0) init_random_seed();
             }
 
+            virtual ~RandManager() = default;
+
+            /**
+             * Derives the random number generation of this manager for the 'tree_index'th of a number of independent 
+             * search trees (see ThtsRootParallelPool), so that managers constructed with the same seed still generate 
+             * independent random numbers for each tree. A 'tree_index' of zero leaves random number generation 
+             * unchanged.
+             * 
+             * Any RandStreams already made are discarded, so this should be called before searching with the manager.
+             * 
+             * Args:
+             *      tree_index: The index of the tree that this manager is used to search
+             */
+            void set_rand_tree_index(int tree_index);
+
+            /**
+             * Releases the calling thread's RandStream (if it has one). The thread gets a new stream if it uses this 
+             * manager again. Should be called by threads that have used this manager before they exit.
+             */
+            void release_thread_rand_stream();
+
             /**
              * Returns a uniform random integer in the range [min_included, max_excluded).
              * N.B. Marked virtual so that these functions can be mocked easily.
              */
             virtual int get_rand_int(int min_included, int max_excluded) {
+                if (use_thread_local_rng) {
+                    RandStream& stream = get_thread_rand_stream();
+                    int len = stream.int_distr(stream.int_gen) % (max_excluded - min_included);
+                    return min_included + len;
+                }
                 std::lock_guard<std::mutex> lg(rng_lock);
                 int len = int_distr(int_gen) % (max_excluded - min_included);
                 return min_included + len;
@@ -122,6 +308,10 @@ namespace thts {
              * N.B. Marked virtual so that these functions can be mocked easily.
              */
             virtual double get_rand_uniform() {
+                if (use_thread_local_rng) {
+                    RandStream& stream = get_thread_rand_stream();
+                    return stream.real_distr(stream.real_gen);
+                }
                 std::lock_guard<std::mutex> lg(rng_lock);
                 return real_distr(real_gen);
             };
@@ -149,6 +339,19 @@ namespace thts {
      *      prior_fn:
      *          A pointer to the prior function, that returns a map representing a policy. Defaults to nullptr to 
      *          indicate no prior. Prior may be able to be unormalised depending on the algorithm being used.
+     *      batch_heuristic_fn:
+     *          A pointer to a function that computes the heuristic values of a batch of states, or nullptr. If 
+     *          non-null, it's used instead of 'heuristic_fn'.
+     *      batch_prior_fn:
+     *          A pointer to a function that computes the priors of a batch of states, or nullptr. If non-null, it's 
+     *          used instead of 'prior_fn'.
+     *      heuristic_evaluator:
+     *          A (stateful) HeuristicEvaluator, or nullptr. If non-null, it's used instead of 'heuristic_fn' and 
+     *          'batch_heuristic_fn'. Each thread uses its own clone of it if it can be cloned (see 
+     *          'get_heuristic_evaluator').
+     *      prior_evaluator:
+     *          A (stateful) PriorEvaluator, or nullptr. If non-null, it's used instead of 'prior_fn' and 
+     *          'batch_prior_fn'. Each thread uses its own clone of it if it can be cloned (see 'get_prior_evaluator').
      * Member variables (options):
      *      mcts_mode:
      *          If mcts_mode is true, then only one node is added per trial (and initialised using the heuristic 
@@ -163,14 +366,43 @@ namespace thts {
      *          cause bugs.
      *      is_two_player_game:
      *          If we are planning for a two player game, rather than a reward maximisation environment
+     *      use_generative_model:
+     *          If true, then chance nodes treat the environment as a generative model: they never call 
+     *          'get_transition_distribution_itfc', and instead call 'sample_transition_distribution_itfc' each time 
+     *          they need to sample a next state, adding children as new outcomes are sampled. Use this for 
+     *          environments that can sample next states cheaply (by overriding 'sample_transition_distribution_itfc') 
+     *          but are expensive to enumerate. If false, chance nodes get (and cache) the transition distribution 
+     *          when they are constructed (which happens while the parent decision node's lock is held).
+     *      cache_rewards:
+     *          If true, then chance nodes compute the reward for each of their outcomes once, when the child node is 
+     *          created, and the selection phase reads the stored reward, rather than calling 'get_reward_itfc' on 
+     *          every trial. Set to false for environments with stochastic rewards.
+     *      virtual_loss:
+     *          The virtual loss to apply to chance nodes on the path of trials that are still running (zero if not 
+     *          using virtual loss). Each trial 'adds' a virtual loss to the chance nodes it visits in the selection 
+     *          phase, which is removed again in the backup phase (see ThtsPool).
      * Member variables (transposition table):
      *      dmap:
      *          A transposition table for decision nodes. Note that a transposition table for chance nodes is 
      *          unnecessary, as an chance nodes that are transpositions, will be children of decision nodes that are 
-     *          transpositions.
-     *      dmap_mutexes:
-     *          A vector of mutexes to use for protection around the dmap. Accessing 'dmap[dnode_id]', should be 
-     *          protected by the 'dmap_mutexes[hash(dnode_id) % dmap_mutexes.size()]'.
+     *          transpositions. The table is thread safe (see TranspositionTable).
+     * Member variables (memory):
+     *      node_arena:
+     *          The NodeArena that nodes are allocated in, or nullptr if nodes are allocated individually using 
+     *          'std::make_shared'. Nodes hold a reference to the arena (through their allocator), so the arena is 
+     *          freed once the manager and all nodes allocated in it have been freed. A new arena is started (see 
+     *          'start_new_node_arena') each time the root is advanced (or the pool is given a new root with the same 
+     *          manager), so that the memory of discarded trees is released slab by slab as it's freed.
+     * Member variables (evaluation):
+     *      thread_evaluators_lock:
+     *          A mutex protecting 'thread_evaluators'
+     *      thread_evaluators:
+     *          The evaluators (clones of 'heuristic_evaluator' and 'prior_evaluator') used by each thread that has 
+     *          evaluated a heuristic or prior, and hasn't released them yet (see 'release_thread_state')
+     *      leaf_evaluator:
+     *          The BatchedLeafEvaluator that decision nodes use to evaluate their heuristic values and priors, or 
+     *          nullptr if the heuristic and prior functions are called directly when nodes are constructed. Declared 
+     *          last so that it's destroyed (and its thread joined) before the rest of the manager.
      */
     class ThtsManager : public RandManager {
         public:
@@ -178,13 +410,39 @@ namespace thts {
             int max_depth;
             HeuristicFnPtr heuristic_fn;
             PriorFnPtr prior_fn;
+            BatchHeuristicFnPtr batch_heuristic_fn;
+            BatchPriorFnPtr batch_prior_fn;
+            std::shared_ptr<HeuristicEvaluator> heuristic_evaluator;
+            std::shared_ptr<PriorEvaluator> prior_evaluator;
 
             bool mcts_mode;
             bool use_transposition_table;
             bool is_two_player_game;
+            bool use_generative_model;
+            bool cache_rewards;
+            double virtual_loss;
+
+            TranspositionTable dmap;
+
+            std::shared_ptr<NodeArena> node_arena;
 
-            DNodeTable dmap;
-            std::vector<std::mutex> dmap_mutexes;
+        protected:
+            std::mutex thread_evaluators_lock;
+            std::unordered_map<std::thread::id, ThreadEvaluators> thread_evaluators;
+
+            /**
+             * Gets the evaluators for the calling thread, cloning them if this is the first call from this thread.
+             */
+            ThreadEvaluators& get_thread_evaluators();
+
+        public:
+            /**
+             * Releases the calling thread's evaluators and RandStream (if it has them). Called by ThtsPool workers 
+             * before they exit, so that clones aren't kept (and accumulated) for threads that no longer exist.
+             */
+            void release_thread_state();
+
+            std::unique_ptr<BatchedLeafEvaluator> leaf_evaluator;
 
             /**
              * Constructor. Initialises values directly other than random number generation.
@@ -193,16 +451,30 @@ namespace thts {
              * seed is set to 0, then we use a std::random_device object to generate a random seed.
              */    
             ThtsManager(const ThtsManagerArgs& args) : 
-                RandManager(args.seed),
+                RandManager(args.seed, args.use_thread_local_rng),
                 thts_env(args.thts_env),
                 max_depth(args.max_depth),
                 heuristic_fn(args.heuristic_fn),
                 prior_fn(args.prior_fn),
+                batch_heuristic_fn(args.batch_heuristic_fn),
+                batch_prior_fn(args.batch_prior_fn),
+                heuristic_evaluator(args.heuristic_evaluator),
+                prior_evaluator(args.prior_evaluator),
                 mcts_mode(args.mcts_mode), 
                 use_transposition_table(args.use_transposition_table), 
                 is_two_player_game(args.is_two_player_game),
-                dmap(),
-                dmap_mutexes(args.num_transposition_table_mutexes)
+                use_generative_model(args.use_generative_model),
+                cache_rewards(args.cache_rewards),
+                virtual_loss(args.virtual_loss),
+                dmap(args.num_transposition_table_mutexes, args.transposition_table_max_size),
+                node_arena(args.use_node_arena ? std::make_shared<NodeArena>() : nullptr),
+                thread_evaluators_lock(),
+                thread_evaluators(),
+                leaf_evaluator(
+                    args.use_batched_evaluation 
+                        ? std::make_unique<BatchedLeafEvaluator>(
+                            *this, args.evaluation_batch_size, args.evaluation_max_latency) 
+                        : nullptr)
             {
             }
 
@@ -210,5 +482,85 @@ namespace thts {
              * Any classes intended to be inherited from should make destructor virtual
              */
             virtual ~ThtsManager() = default;
+
+            /**
+             * Returns if the manager has a heuristic function (either 'heuristic_evaluator', 'heuristic_fn' or 
+             * 'batch_heuristic_fn').
+             */
+            bool has_heuristic_fn() const {
+                return heuristic_evaluator != nullptr || heuristic_fn != nullptr || batch_heuristic_fn != nullptr;
+            }
+
+            /**
+             * Returns if the manager has a prior function (either 'prior_evaluator', 'prior_fn' or 'batch_prior_fn').
+             */
+            bool has_prior_fn() const {
+                return prior_evaluator != nullptr || prior_fn != nullptr || batch_prior_fn != nullptr;
+            }
+
+            /**
+             * Gets the heuristic (or prior) evaluator that the calling thread should use. This is the thread's own 
+             * clone of 'heuristic_evaluator' (or 'prior_evaluator') if it can be cloned, created on the first call 
+             * from the thread, and is otherwise the shared evaluator. Requires 'heuristic_evaluator' (or 
+             * 'prior_evaluator') to be non-null, and it shouldn't be changed after threads have started using it.
+             * 
+             * A thread local cache is used to look up the calling threads evaluators, similarly to RandStreams.
+             */
+            HeuristicEvaluator& get_heuristic_evaluator();
+            PriorEvaluator& get_prior_evaluator();
+
+            /**
+             * Computes the heuristic value of a single state, using (in order of preference) the calling threads 
+             * heuristic evaluator, 'batch_heuristic_fn' with a batch of one state, or 'heuristic_fn'. Doesn't use 
+             * the 'leaf_evaluator'.
+             */
+            double compute_heuristic_value(std::shared_ptr<const State> state);
+
+            /**
+             * Computes the heuristic values of a batch of states, using (in order of preference) the calling threads 
+             * heuristic evaluator, 'batch_heuristic_fn', or 'heuristic_fn' on each state.
+             */
+            void compute_heuristic_values(
+                const std::vector<std::shared_ptr<const State>>& states, std::vector<double>& heuristic_values);
+
+            /**
+             * Computes the policy prior of a single state, using (in order of preference) the calling threads prior 
+             * evaluator, 'batch_prior_fn' with a batch of one state, or 'prior_fn'. Doesn't use the 'leaf_evaluator'.
+             */
+            std::shared_ptr<ActionPrior> compute_policy_prior(std::shared_ptr<const State> state);
+
+            /**
+             * Computes the policy priors of a batch of states, using (in order of preference) the calling threads 
+             * prior evaluator, 'batch_prior_fn', or 'prior_fn' on each state.
+             */
+            void compute_policy_priors(
+                const std::vector<std::shared_ptr<const State>>& states, 
+                std::vector<std::shared_ptr<ActionPrior>>& policy_priors);
+
+            /**
+             * Retires 'node_arena' and replaces it with a new arena, so that nodes made from now on are allocated in 
+             * the new arena. Each slab of the retired arena is released once the nodes allocated in it have been freed 
+             * (see NodeArena). Called by 'ThtsPool::advance_root' and 'ThtsPool::set_new_env', and should only be 
+             * called when no trials are running.
+             */
+            void start_new_node_arena();
+
+            /**
+             * Makes a new node of type 'T', allocated in 'node_arena' if using one. Nodes should be created using 
+             * this function in 'create_child_node_helper' implementations.
+             * 
+             * Args:
+             *      args: The arguments to pass to the constructor of 'T'
+             * 
+             * Returns:
+             *      A shared_ptr to the new node
+             */
+            template <typename T, typename... Args>
+            std::shared_ptr<T> make_node(Args&&... args) const {
+                if (node_arena == nullptr) {
+                    return std::make_shared<T>(std::forward<Args>(args)...);
+                }
+                return std::allocate_shared<T>(NodeAllocator<T>(node_arena), std::forward<Args>(args)...);
+            }
     };
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "thts.h"
+#include "thts_decision_node.h"
+#include "thts_manager.h"
+#include "thts_types.h"
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+
+namespace thts {
+    /**
+     * A class for running root parallel (ensemble) thts.
+     * 
+     * Root parallelisation runs a number of independent search trees from the same initial state, and merges the 
+     * statistics at the roots of the trees to make a recommendation. Because the trees share no nodes, there is no 
+     * contention between the threads searching different trees.
+     * 
+     * Each tree is searched with its own ThtsPool (which may itself use multiple threads, for a hybrid of root 
+     * parallelisation and tree parallelisation). Each tree must have its own ThtsManager, and the pool derives a 
+     * distinct random number stream for each tree from its manager's seed and the index of the tree (see 
+     * 'RandManager::set_rand_tree_index'), so the trees perform independent searches even if the managers were 
+     * constructed with the same seed. The first tree's random numbers are the same as if it was searched alone.
+     * 
+     * Recommendations are made by summing the visit counts of the root children over the trees (if the root nodes 
+     * recommend the most visited action), or by taking the visit weighted average of the values of root children over 
+     * the trees otherwise.
+     * 
+     * Member variables:
+     *      thts_managers: 
+     *          The ThtsManager for each tree
+     *      root_nodes:
+     *          The root node of each tree
+     *      thts_pools:
+     *          The ThtsPool used to search each tree
+     */
+    class ThtsRootParallelPool {
+        protected:
+            std::vector<std::shared_ptr<ThtsManager>> thts_managers;
+            std::vector<std::shared_ptr<ThtsDNode>> root_nodes;
+            std::vector<std::unique_ptr<ThtsPool>> thts_pools;
+
+        public:
+            /**
+             * Constructor. Sets the tree index of each manager (see 'RandManager::set_rand_tree_index'), so the managers 
+             * shouldn't be used for any other search.
+             * 
+             * Args:
+             *      thts_managers: The ThtsManager for each tree, each tree must have a distinct manager
+             *      root_nodes: The root node of each tree
+             *      num_threads_per_tree: The number of threads to use in the ThtsPool of each tree
+             *      use_lock_free_dispatch: Passed to the ThtsPool of each tree
+             */
+            ThtsRootParallelPool(
+                std::vector<std::shared_ptr<ThtsManager>> thts_managers,
+                std::vector<std::shared_ptr<ThtsDNode>> root_nodes,
+                int num_threads_per_tree=1,
+                bool use_lock_free_dispatch=true);
+
+            /**
+             * Returns the number of trees being searched.
+             */
+            int num_trees() const;
+
+            /**
+             * Waits for the search of all trees to finish a 'run_trials' call.
+             */
+            void join();
+
+            /**
+             * Runs trials over all of the trees. The trials are split as evenly as possible over the trees, so that a 
+             * total of 'max_trials' trials are run.
+             * 
+             * Args:
+             *      max_trials: The maximum number of thts trials to run, in total over all trees
+             *      max_time: The maximum (human time) to run thts trials for
+             *      blocking: If this call is blocking and will only return when the thts trials have finished
+             */
+            void run_trials(
+                int max_trials=std::numeric_limits<int>::max(), 
+                double max_time=std::numeric_limits<double>::max(), 
+                bool blocking=true);
+
+            /**
+             * Fills 'merged_child_stats' with the statistics of the root children, merged over all of the trees. 
+             * Visit counts are summed and values are averaged, weighted by the visit counts.
+             * 
+             * Should only be called when the trees are not being searched.
+             * 
+             * Args:
+             *      merged_child_stats: A map to fill with the merged statistics for each root child
+             */
+            void fill_merged_child_recommendation_stats(ChildRecommendationStatsMap& merged_child_stats) const;
+
+            /**
+             * Recommends an action using the merged root statistics. Ties are broken randomly using the first 
+             * tree's manager.
+             * 
+             * Should only be called when the trees are not being searched.
+             * 
+             * Returns:
+             *      The recommended action from the ensemble of trees
+             */
+            std::shared_ptr<const Action> recommend_action() const;
+    };
+}
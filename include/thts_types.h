@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <string>
@@ -26,6 +27,54 @@ namespace thts {
     // Forward declare thts env
     class ThtsEnv;
 
+    /**
+     * Storage for a cached hash value, used by Observation and Action to implement (opt-in) hash caching.
+     * 
+     * The hash is computed lazily, the first time that the object is hashed, rather than in the constructor, so that 
+     * objects can still be filled in after they are constructed (e.g. 'make_shared<IntPairState>(...)' followed by 
+     * updating 'state'). Objects that cache their hash must not be modified after they have been hashed (which is 
+     * already the case for any object used as a key in an unordered_map).
+     * 
+     * Multiple threads can hash the same object concurrently, in which case they compute and store the same value. 
+     * The value is stored before the (release) store of 'is_valid', so a thread that sees 'is_valid' reads the value.
+     * 
+     * Copies do not copy the cached value, as the copy may be modified before it is hashed.
+     * 
+     * Member variables:
+     *      value:
+     *          The cached hash value, only meaningful if 'is_valid' is true
+     *      is_valid:
+     *          If 'value' has been set
+     *      is_enabled:
+     *          If hash caching has been enabled for the object that owns this cache
+     */
+    class CachedHash {
+        private:
+            std::atomic<std::size_t> value;
+            std::atomic<bool> is_valid;
+            bool is_enabled;
+
+        public:
+            CachedHash() : value(0), is_valid(false), is_enabled(false) {}
+            CachedHash(const CachedHash& other) : value(0), is_valid(false), is_enabled(other.is_enabled) {}
+
+            CachedHash& operator=(const CachedHash& other) {
+                is_valid.store(false, std::memory_order_relaxed);
+                is_enabled = other.is_enabled;
+                return *this;
+            }
+
+            void enable() { is_enabled = true; }
+            bool enabled() const { return is_enabled; }
+            bool is_cached() const { return is_valid.load(std::memory_order_acquire); }
+            std::size_t get() const { return value.load(std::memory_order_relaxed); }
+
+            void set(std::size_t hash_value) {
+                value.store(hash_value, std::memory_order_relaxed);
+                is_valid.store(true, std::memory_order_release);
+            }
+    };
+
     /**
      * A abstract base type to use for Observations.
      * 
@@ -35,13 +84,51 @@ namespace thts {
      * 
      * N.B. Implementations are provided, but are such that a direct instance of Observation is equivalent to a 
      * 'NullObservation'.
+     * 
+     * Subclasses can opt into hash caching by calling 'enable_hash_caching' in their constructor. Then 'get_hash' 
+     * (used by std::hash) only calls the virtual 'hash' function once, and std::equal_to and operator== return false 
+     * without calling 'equals_itfc' if the cached hashes of two objects differ. See CachedHash for the restrictions 
+     * on objects that cache their hash.
+     * 
+     * Member variables:
+     *      hash_cache:
+     *          The cached hash value of this object (if hash caching is enabled)
      */
     class Observation {
+        protected:
+            mutable CachedHash hash_cache;
+
+            /**
+             * Enables hash caching for this object. Should be called in the constructor of subclasses.
+             */
+            void enable_hash_caching() { hash_cache.enable(); }
+
         public:
             virtual ~Observation() = default;
             virtual std::size_t hash() const;
             virtual bool equals_itfc(const Observation& other) const;
             virtual std::string get_pretty_print_string() const;
+
+            /**
+             * Returns the hash of this object, using the cached value if there is one.
+             */
+            std::size_t get_hash() const {
+                if (hash_cache.is_cached()) return hash_cache.get();
+                std::size_t hash_value = hash();
+                if (hash_cache.enabled()) hash_cache.set(hash_value);
+                return hash_value;
+            }
+
+            /**
+             * Checks equality, returning early if 'other' is this object, or if both objects have cached hashes that 
+             * differ, before calling the virtual 'equals_itfc'.
+             */
+            bool equals_using_cached_hash(const Observation& other) const {
+                if (this == &other) return true;
+                bool both_cached = hash_cache.is_cached() && other.hash_cache.is_cached();
+                if (both_cached && hash_cache.get() != other.hash_cache.get()) return false;
+                return equals_itfc(other);
+            }
     };
 
 
@@ -75,25 +162,61 @@ namespace thts {
      * 
      * N.B. Implementations are provided, but are such that a direct instance of Action is equivalent to a 
      * 'NullAction'.
+     * 
+     * Subclasses can opt into hash caching by calling 'enable_hash_caching' in their constructor, in the same way as 
+     * for Observation.
+     * 
+     * Member variables:
+     *      hash_cache:
+     *          The cached hash value of this object (if hash caching is enabled)
      */
     class Action {
+        protected:
+            mutable CachedHash hash_cache;
+
+            /**
+             * Enables hash caching for this object. Should be called in the constructor of subclasses.
+             */
+            void enable_hash_caching() { hash_cache.enable(); }
+
         public:
             virtual ~Action() = default;
             virtual std::size_t hash() const;
             virtual bool equals_itfc(const Action& other) const;
             virtual std::string get_pretty_print_string() const;
+
+            /**
+             * Returns the hash of this object, using the cached value if there is one.
+             */
+            std::size_t get_hash() const {
+                if (hash_cache.is_cached()) return hash_cache.get();
+                std::size_t hash_value = hash();
+                if (hash_cache.enabled()) hash_cache.set(hash_value);
+                return hash_value;
+            }
+
+            /**
+             * Checks equality, returning early if 'other' is this object, or if both objects have cached hashes that 
+             * differ, before calling the virtual 'equals_itfc'.
+             */
+            bool equals_using_cached_hash(const Action& other) const {
+                if (this == &other) return true;
+                bool both_cached = hash_cache.is_cached() && other.hash_cache.is_cached();
+                if (both_cached && hash_cache.get() != other.hash_cache.get()) return false;
+                return equals_itfc(other);
+            }
     };
 
 
 
     /**
-     * An implementaton of state containing a single integer state.
+     * An implementaton of state containing a single integer state. Caches its hash.
      */
     class IntState : public State {
         public:
             int state;
 
-            IntState(int state) : state(state) {}
+            IntState(int state) : state(state) { enable_hash_caching(); }
             virtual ~IntState() = default;
             virtual std::size_t hash() const;
             bool equals(const IntState& other) const;
@@ -102,14 +225,14 @@ namespace thts {
     };
 
     /**
-     * An implementaton of state containing a pair of integers as the state.
+     * An implementaton of state containing a pair of integers as the state. Caches its hash.
      */
     class IntPairState : public State {
         public:
             std::pair<int,int> state;
 
-            IntPairState(std::pair<int,int> pr) : state(pr) {}
-            IntPairState(int first, int second) : state(std::make_pair(first,second)) {}
+            IntPairState(std::pair<int,int> pr) : state(pr) { enable_hash_caching(); }
+            IntPairState(int first, int second) : state(std::make_pair(first,second)) { enable_hash_caching(); }
             virtual ~IntPairState() = default;
             virtual std::size_t hash() const;
             bool equals(const IntPairState& other) const;
@@ -118,14 +241,16 @@ namespace thts {
     };
 
     /**
-     * An implementaton of state containing a 3 tuple of integers as the state.
+     * An implementaton of state containing a 3 tuple of integers as the state. Caches its hash.
      */
     class Int3TupleState : public State {
         public:
             std::tuple<int,int,int> state;
 
-            Int3TupleState(std::tuple<int,int,int> tpl) : state(tpl) {}
-            Int3TupleState(int first, int second, int third) : state(std::make_tuple(first,second,third)) {}
+            Int3TupleState(std::tuple<int,int,int> tpl) : state(tpl) { enable_hash_caching(); }
+            Int3TupleState(int first, int second, int third) : state(std::make_tuple(first,second,third)) {
+                enable_hash_caching();
+            }
             virtual ~Int3TupleState() = default;
             virtual std::size_t hash() const;
             bool equals(const Int3TupleState& other) const;
@@ -136,13 +261,13 @@ namespace thts {
 
 
     /**
-     * An implementation of action containing a single int as an action
+     * An implementation of action containing a single int as an action. Caches its hash.
      */
     class IntAction : public Action {
         public:
             int action;
 
-            IntAction(int action) : action(action) {}
+            IntAction(int action) : action(action) { enable_hash_caching(); }
             virtual ~IntAction() = default;
             virtual std::size_t hash() const;
             bool equals(const IntAction& other) const;
@@ -151,13 +276,13 @@ namespace thts {
     };
 
     /**
-     * An implementation of action containing a single string as an action
+     * An implementation of action containing a single string as an action. Caches its hash.
      */
     class StringAction : public Action {
         public:
             std::string action;
 
-            StringAction(std::string action) : action(action) {}
+            StringAction(std::string action) : action(action) { enable_hash_caching(); }
             virtual ~StringAction() = default;
             virtual std::size_t hash() const;
             bool equals(const StringAction& other) const;
@@ -184,6 +309,23 @@ namespace thts {
     std::shared_ptr<ActionPrior> _DummyPriorFn(std::shared_ptr<const State> s, std::shared_ptr<ThtsEnv> env);
     typedef decltype(&_DummyPriorFn) PriorFnPtr; 
 
+    /**
+     * Typedefs for batched heuristic and (action) prior function pointers, which evaluate a batch of states at once 
+     * (see BatchedLeafEvaluator). The results for 'states[i]' should be written into index 'i' of the output vector, 
+     * which is already sized to match 'states'.
+     * N.B. The & here is to get address as we want function pointers
+     */
+    void _DummyBatchHeuristicFn(
+        const std::vector<std::shared_ptr<const State>>& states, 
+        std::shared_ptr<ThtsEnv> env, 
+        std::vector<double>& heuristic_values);
+    typedef decltype(&_DummyBatchHeuristicFn) BatchHeuristicFnPtr;
+    void _DummyBatchPriorFn(
+        const std::vector<std::shared_ptr<const State>>& states, 
+        std::shared_ptr<ThtsEnv> env, 
+        std::vector<std::shared_ptr<ActionPrior>>& policy_priors);
+    typedef decltype(&_DummyBatchPriorFn) BatchPriorFnPtr;
+
 
 
     /**
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "thts_types.h"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace thts {
+    // forward declare
+    class ThtsDNode;
+
+    /**
+     * A concurrent transposition table for decision nodes, keyed by (decision_timestep, observation).
+     *
+     * The table is split into segments, each of which is an open addressing (linear probing) hash table protected by
+     * its own mutex, so threads only contend when they access the same segment. The hash of each key is computed
+     * once per operation, and the hash of each entry is cached in the table, so that keys are only compared (with the
+     * virtual 'equals' of the Observation) when their hashes match.
+     *
+     * Entries hold weak_ptrs to nodes (see DNodeTable in thts_types.h). Entries whose node has been freed are turned
+     * into tombstones whenever they are found during a probe, and segments are rebuilt (without their tombstones)
+     * when tombstones make up a large fraction of the segment.
+     *
+     * If 'max_size' is non-zero, then each segment holds at most 'max_size / num_segments' (rounded up) entries.
+     * When inserting into a full segment, an entry is replaced. The replacement policy prefers entries whose node has
+     * been freed, and otherwise replaces the entry with the fewest visits near the home slot of the new key (the node
+     * that is cheapest to lose the transpositions for). Replaced nodes are still in the tree, so replacing an entry
+     * only means that a later transposition to it will create a duplicate node.
+     *
+     * Member variables:
+     *      segments:
+     *          The segments of the table
+     *      max_entries_per_segment:
+     *          The maximum number of entries in each segment, or zero if the size of the table is not limited
+     */
+    class TranspositionTable {
+        public:
+            static constexpr std::size_t initial_segment_capacity = 16;
+            static constexpr std::size_t max_replacement_probes = 8;
+
+        protected:
+            /**
+             * The state of a slot in a segment.
+             */
+            enum class SlotState : unsigned char { empty, occupied, tombstone };
+
+            /**
+             * An entry (slot) in a segment.
+             */
+            struct Entry {
+                std::size_t hash;
+                int decision_timestep;
+                std::shared_ptr<const Observation> observation;
+                std::weak_ptr<ThtsDNode> node;
+                SlotState state = SlotState::empty;
+            };
+
+            /**
+             * A segment of the table.
+             *
+             * Member variables:
+             *      segment_lock:
+             *          Mutex protecting this segment
+             *      entries:
+             *          The slots of this (open addressing) segment. The size is always a power of two
+             *      num_occupied:
+             *          The number of slots that are occupied (including entries whose node has expired, but that
+             *          haven't been found yet)
+             *      num_tombstones:
+             *          The number of tombstone slots
+             */
+            struct Segment {
+                std::mutex segment_lock;
+                std::vector<Entry> entries;
+                std::size_t num_occupied = 0;
+                std::size_t num_tombstones = 0;
+            };
+
+            std::vector<Segment> segments;
+            std::size_t max_entries_per_segment;
+
+            /**
+             * Mixes the bits of a hash, so that both the segment and slot indices are spread evenly.
+             */
+            static std::size_t mix_hash(std::size_t hash);
+
+            /**
+             * Gets the segment for a (mixed) hash.
+             */
+            Segment& get_segment(std::size_t mixed_hash);
+
+            /**
+             * Gets the home slot index for a (mixed) hash in a segment.
+             */
+            std::size_t get_home_slot(const Segment& segment, std::size_t mixed_hash) const;
+
+            /**
+             * Finds the slot index of a key in a segment, turning expired entries found on the way into tombstones.
+             * Should be called holding the segment lock.
+             *
+             * Returns:
+             *      The index of the slot holding the key, or 'entries.size()' if the key isn't in the segment
+             */
+            std::size_t find_slot(
+                Segment& segment,
+                std::size_t hash,
+                std::size_t mixed_hash,
+                int decision_timestep,
+                const std::shared_ptr<const Observation>& observation);
+
+            /**
+             * Turns the entry in a slot into a tombstone. Should be called holding the segment lock.
+             */
+            void make_tombstone(Segment& segment, std::size_t slot);
+
+            /**
+             * Rebuilds a segment with 'new_capacity' slots, dropping tombstones and expired entries. Should be called
+             * holding the segment lock.
+             */
+            void rebuild_segment(Segment& segment, std::size_t new_capacity);
+
+            /**
+             * Makes space in a segment for a new entry, growing or rebuilding the segment, or replacing an entry if
+             * the segment is at its maximum size. Should be called holding the segment lock.
+             */
+            void make_space_for_insert(Segment& segment, std::size_t mixed_hash);
+
+        public:
+            /**
+             * Constructor.
+             *
+             * Args:
+             *      num_segments: The number of segments (and mutexes) to split the table into
+             *      max_size: The maximum number of entries in the table, or zero for no limit
+             */
+            TranspositionTable(int num_segments=1, std::size_t max_size=0);
+
+            /**
+             * Computes the hash of a key (equal to std::hash<DNodeIdTuple> of the key), which can be passed to 'find'
+             * and 'insert' to avoid hashing the key twice.
+             */
+            static std::size_t compute_hash(int decision_timestep, const std::shared_ptr<const Observation>& observation);
+
+            /**
+             * Looks up the node for a key.
+             *
+             * Args:
+             *      hash: The hash of the key, from 'compute_hash'
+             *      decision_timestep: The decision timestep of the key
+             *      observation: The observation of the key
+             *
+             * Returns:
+             *      The node stored for the key, or nullptr if there isn't one (or it has been freed)
+             */
+            std::shared_ptr<ThtsDNode> find(
+                std::size_t hash, int decision_timestep, const std::shared_ptr<const Observation>& observation);
+
+            /**
+             * Inserts a node for a key, unless there is already a (live) node for the key, for example if another
+             * thread inserted one after this thread called 'find'.
+             *
+             * Args:
+             *      hash: The hash of the key, from 'compute_hash'
+             *      decision_timestep: The decision timestep of the key
+             *      observation: The observation of the key
+             *      node: The node to insert
+             *
+             * Returns:
+             *      The node in the table for the key after the call, i.e. either 'node', or the node that was already
+             *      in the table
+             */
+            std::shared_ptr<ThtsDNode> insert(
+                std::size_t hash,
+                int decision_timestep,
+                const std::shared_ptr<const Observation>& observation,
+                const std::shared_ptr<ThtsDNode>& node);
+
+            /**
+             * Removes all entries with a decision timestep less than or equal to 'decision_timestep'.
+             */
+            void erase_up_to_timestep(int decision_timestep);
+
+            /**
+             * Removes all entries.
+             */
+            void clear();
+
+            /**
+             * Returns the number of (occupied) entries in the table. Entries whose nodes have been freed are counted
+             * until they are found and turned into tombstones.
+             */
+            std::size_t size();
+
+            /**
+             * Returns the number of tombstone slots in the table.
+             */
+            std::size_t get_num_tombstones();
+
+            /**
+             * Returns the total number of slots in the table.
+             */
+            std::size_t get_capacity();
+    };
+}
@@ -0,0 +1,233 @@
+#include "algorithms/common/boltzmann_kernel.h"
+
+#include <cmath>
+#include <limits>
+
+#ifdef THTS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+/**
+ * Constants for computing exp(x) for x <= 0. Below EXP_UNDERFLOW_ARG, exp(x) is (at most) a denormal and we just
+ * return zero. Otherwise, exp(x) = 2^n * exp(r), where n = round(x * LOG2E) and r = x - n * ln(2) (computed in two
+ * parts, with LN2_HI + LN2_LO = ln(2), so that n * LN2_HI is exact), and exp(r) is computed with a degree 12 Taylor
+ * polynomial (|r| <= ln(2)/2, so the truncation error is less than 2e-16).
+ *
+ * ROUND_MAGIC = 2^52 + 2^51 is used to round to an integer by adding it, which leaves the integer (as a twos
+ * complement int64) in the low bits of the mantissa.
+ */
+static const double EXP_UNDERFLOW_ARG = -708.0;
+static const double LOG2E = 1.4426950408889634074;
+static const double LN2_HI = 6.93147180369123816490e-01;
+static const double LN2_LO = 1.90821492927058770002e-10;
+static const double ROUND_MAGIC = 6755399441055744.0;
+static const double EXP_COEFFS[13] = {
+    1.0,
+    1.0,
+    5.0e-01,
+    1.66666666666666666667e-01,
+    4.16666666666666666667e-02,
+    8.33333333333333333333e-03,
+    1.38888888888888888889e-03,
+    1.98412698412698412698e-04,
+    2.48015873015873015873e-05,
+    2.75573192239858906526e-06,
+    2.75573192239858906526e-07,
+    2.50521083854417187751e-08,
+    2.08767569878680989792e-09,
+};
+
+namespace {
+    /**
+     * Scalar implementation
+     */
+    double compute_boltzmann_weights_scalar(double* values, size_t n, double& max_value) {
+        max_value = numeric_limits<double>::lowest();
+        for (size_t i=0; i<n; i++) {
+            if (max_value < values[i]) max_value = values[i];
+        }
+
+        double sum_weights = 0.0;
+        for (size_t i=0; i<n; i++) {
+            double arg = values[i] - max_value;
+            double weight = (arg < EXP_UNDERFLOW_ARG) ? 0.0 : exp(arg);
+            values[i] = weight;
+            sum_weights += weight;
+        }
+        return sum_weights;
+    }
+
+    void scale_and_shift_values_scalar(double* values, size_t n, double scale, double shift) {
+        for (size_t i=0; i<n; i++) {
+            values[i] = values[i] * scale + shift;
+        }
+    }
+
+#ifdef THTS_X86_SIMD
+    /**
+     * AVX2 implementation. Tails (when n isn't a multiple of 4) are copied into a padded buffer, so that every value
+     * uses the same approximation of exp.
+     */
+    __attribute__((target("avx2,fma")))
+    __m256d exp_non_positive_avx2(__m256d x) {
+        __m256d underflow_mask = _mm256_cmp_pd(x, _mm256_set1_pd(EXP_UNDERFLOW_ARG), _CMP_LT_OQ);
+        x = _mm256_max_pd(x, _mm256_set1_pd(EXP_UNDERFLOW_ARG));
+
+        __m256d magic = _mm256_set1_pd(ROUND_MAGIC);
+        __m256d n_plus_magic = _mm256_fmadd_pd(x, _mm256_set1_pd(LOG2E), magic);
+        __m256d n = _mm256_sub_pd(n_plus_magic, magic);
+        __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(LN2_HI), x);
+        r = _mm256_fnmadd_pd(n, _mm256_set1_pd(LN2_LO), r);
+
+        __m256d poly = _mm256_set1_pd(EXP_COEFFS[12]);
+        for (int k=11; k>=0; k--) {
+            poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_COEFFS[k]));
+        }
+
+        __m256i n_int = _mm256_sub_epi64(_mm256_castpd_si256(n_plus_magic), _mm256_castpd_si256(magic));
+        __m256i pow2_n_bits = _mm256_slli_epi64(_mm256_add_epi64(n_int, _mm256_set1_epi64x(1023)), 52);
+        __m256d result = _mm256_mul_pd(poly, _mm256_castsi256_pd(pow2_n_bits));
+        return _mm256_andnot_pd(underflow_mask, result);
+    }
+
+    __attribute__((target("avx2,fma")))
+    double compute_boltzmann_weights_avx2(double* values, size_t n, double& max_value) {
+        size_t num_full = n - (n % 4);
+        size_t num_tail = n - num_full;
+        alignas(32) double tail[4];
+        for (size_t i=0; i<4; i++) {
+            tail[i] = (i < num_tail) ? values[num_full+i] : numeric_limits<double>::lowest();
+        }
+
+        __m256d max_vec = _mm256_load_pd(tail);
+        for (size_t i=0; i<num_full; i+=4) {
+            max_vec = _mm256_max_pd(max_vec, _mm256_loadu_pd(values+i));
+        }
+        __m128d max_half = _mm_max_pd(_mm256_castpd256_pd128(max_vec), _mm256_extractf128_pd(max_vec, 1));
+        max_value = max(_mm_cvtsd_f64(max_half), _mm_cvtsd_f64(_mm_unpackhi_pd(max_half, max_half)));
+
+        __m256d max_bcast = _mm256_set1_pd(max_value);
+        __m256d sum_vec = _mm256_setzero_pd();
+        for (size_t i=0; i<num_full; i+=4) {
+            __m256d weights = exp_non_positive_avx2(_mm256_sub_pd(_mm256_loadu_pd(values+i), max_bcast));
+            _mm256_storeu_pd(values+i, weights);
+            sum_vec = _mm256_add_pd(sum_vec, weights);
+        }
+        if (num_tail > 0) {
+            __m256d weights = exp_non_positive_avx2(_mm256_sub_pd(_mm256_load_pd(tail), max_bcast));
+            _mm256_store_pd(tail, weights);
+            sum_vec = _mm256_add_pd(sum_vec, weights);
+            for (size_t i=0; i<num_tail; i++) {
+                values[num_full+i] = tail[i];
+            }
+        }
+        __m128d sum_half = _mm_add_pd(_mm256_castpd256_pd128(sum_vec), _mm256_extractf128_pd(sum_vec, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(sum_half, _mm_unpackhi_pd(sum_half, sum_half)));
+    }
+
+    __attribute__((target("avx2,fma")))
+    void scale_and_shift_values_avx2(double* values, size_t n, double scale, double shift) {
+        __m256d scale_vec = _mm256_set1_pd(scale);
+        __m256d shift_vec = _mm256_set1_pd(shift);
+        size_t i = 0;
+        for (; i+4<=n; i+=4) {
+            _mm256_storeu_pd(values+i, _mm256_fmadd_pd(_mm256_loadu_pd(values+i), scale_vec, shift_vec));
+        }
+        scale_and_shift_values_scalar(values+i, n-i, scale, shift);
+    }
+
+    /**
+     * AVX-512 implementation. Tails are handled with masked loads and stores.
+     * 
+     * Some versions of gcc give false positive uninitialized warnings from inside the AVX-512 intrinsics when 
+     * optimising, so they are silenced for these functions only.
+     */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+    __attribute__((target("avx512f")))
+    __m512d exp_non_positive_avx512(__m512d x) {
+        __mmask8 valid_mask = _mm512_cmp_pd_mask(x, _mm512_set1_pd(EXP_UNDERFLOW_ARG), _CMP_GE_OQ);
+        x = _mm512_max_pd(x, _mm512_set1_pd(EXP_UNDERFLOW_ARG));
+
+        __m512d magic = _mm512_set1_pd(ROUND_MAGIC);
+        __m512d n = _mm512_sub_pd(_mm512_fmadd_pd(x, _mm512_set1_pd(LOG2E), magic), magic);
+        __m512d r = _mm512_fnmadd_pd(n, _mm512_set1_pd(LN2_HI), x);
+        r = _mm512_fnmadd_pd(n, _mm512_set1_pd(LN2_LO), r);
+
+        __m512d poly = _mm512_set1_pd(EXP_COEFFS[12]);
+        for (int k=11; k>=0; k--) {
+            poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_COEFFS[k]));
+        }
+        return _mm512_maskz_scalef_pd(valid_mask, poly, n);
+    }
+
+    __attribute__((target("avx512f")))
+    double compute_boltzmann_weights_avx512(double* values, size_t n, double& max_value) {
+        __m512d lowest = _mm512_set1_pd(numeric_limits<double>::lowest());
+        __m512d max_vec = lowest;
+        for (size_t i=0; i<n; i+=8) {
+            __mmask8 load_mask = (n-i >= 8) ? (__mmask8) 0xFF : (__mmask8) ((1u << (n-i)) - 1u);
+            max_vec = _mm512_max_pd(max_vec, _mm512_mask_loadu_pd(lowest, load_mask, values+i));
+        }
+        max_value = _mm512_reduce_max_pd(max_vec);
+
+        __m512d max_bcast = _mm512_set1_pd(max_value);
+        __m512d sum_vec = _mm512_setzero_pd();
+        for (size_t i=0; i<n; i+=8) {
+            __mmask8 load_mask = (n-i >= 8) ? (__mmask8) 0xFF : (__mmask8) ((1u << (n-i)) - 1u);
+            __m512d args = _mm512_sub_pd(_mm512_mask_loadu_pd(lowest, load_mask, values+i), max_bcast);
+            __m512d weights = exp_non_positive_avx512(args);
+            _mm512_mask_storeu_pd(values+i, load_mask, weights);
+            sum_vec = _mm512_add_pd(sum_vec, weights);
+        }
+        return _mm512_reduce_add_pd(sum_vec);
+    }
+
+    __attribute__((target("avx512f")))
+    void scale_and_shift_values_avx512(double* values, size_t n, double scale, double shift) {
+        __m512d scale_vec = _mm512_set1_pd(scale);
+        __m512d shift_vec = _mm512_set1_pd(shift);
+        for (size_t i=0; i<n; i+=8) {
+            __mmask8 load_mask = (n-i >= 8) ? (__mmask8) 0xFF : (__mmask8) ((1u << (n-i)) - 1u);
+            __m512d vals = _mm512_maskz_loadu_pd(load_mask, values+i);
+            _mm512_mask_storeu_pd(values+i, load_mask, _mm512_fmadd_pd(vals, scale_vec, shift_vec));
+        }
+    }
+#pragma GCC diagnostic pop
+#endif
+}
+
+namespace thts {
+    double compute_boltzmann_weights(double* values, size_t n, double& max_value) {
+        return compute_boltzmann_weights(values, n, max_value, get_supported_simd_level());
+    }
+
+    /**
+     * Dispatches to the implementation for 'simd_level'
+     */
+    double compute_boltzmann_weights(double* values, size_t n, double& max_value, SimdLevel simd_level) {
+#ifdef THTS_X86_SIMD
+        if (simd_level == SimdLevel::avx512) return compute_boltzmann_weights_avx512(values, n, max_value);
+        if (simd_level == SimdLevel::avx2) return compute_boltzmann_weights_avx2(values, n, max_value);
+#endif
+        return compute_boltzmann_weights_scalar(values, n, max_value);
+    }
+
+    void scale_and_shift_values(double* values, size_t n, double scale, double shift) {
+        scale_and_shift_values(values, n, scale, shift, get_supported_simd_level());
+    }
+
+    /**
+     * Dispatches to the implementation for 'simd_level'
+     */
+    void scale_and_shift_values(double* values, size_t n, double scale, double shift, SimdLevel simd_level) {
+#ifdef THTS_X86_SIMD
+        if (simd_level == SimdLevel::avx512) return scale_and_shift_values_avx512(values, n, scale, shift);
+        if (simd_level == SimdLevel::avx2) return scale_and_shift_values_avx2(values, n, scale, shift);
+#endif
+        scale_and_shift_values_scalar(values, n, scale, shift);
+    }
+}
@@ -24,18 +24,22 @@ namespace thts {
      * Consider if we have another trial that also searches this node, it made a new child, but hasn't backed it up 
      * yet. Hence it's necessary to include the line "if (child.num_backups == 0) continue;" to avoid a division by 
      * zero causing NaNs.
+     * 
+     * As children are not locked, each childs 'num_backups' is read once (it may be incremented concurrently), and 
+     * the average is accumulated in a local variable before being stored in 'dp_value'.
      */
-    void DPCNode::backup_dp_impl(DPDNodeChildMap& children, double local_reward, bool is_opponent) {
-        dp_value = 0.0;
+    void DPCNode::backup_dp_impl(const DPDNodeChildMap& children, double local_reward, bool is_opponent) {
+        double new_dp_value = 0.0;
         double sum_child_backups = 0;
-        for (pair<shared_ptr<const Observation>,shared_ptr<DPDNode>> pr : children) {
-            DPDNode& child = (DPDNode&) *pr.second;
-            if (child.num_backups == 0) continue;
-            sum_child_backups += child.num_backups;
-            dp_value *= (sum_child_backups - child.num_backups) / sum_child_backups;
-            dp_value += child.num_backups * child.dp_value / sum_child_backups; 
+        for (const DPDNodeChildMap::value_type& pr : children) {
+            DPDNode& child = pr.second;
+            int child_backups = child.num_backups;
+            if (child_backups == 0) continue;
+            sum_child_backups += child_backups;
+            new_dp_value *= (sum_child_backups - child_backups) / sum_child_backups;
+            new_dp_value += child_backups * child.dp_value / sum_child_backups; 
         }
-        dp_value += local_reward; // +R(s,a)
+        dp_value = new_dp_value + local_reward; // +R(s,a)
 
         num_backups++;
     }
@@ -22,14 +22,14 @@ namespace thts {
      * empty.
      */
     shared_ptr<const Action> DPDNode::recommend_action_best_dp_value_impl(
-        DPCNodeChildMap& children, RandManager& rand_manager, int visit_threshold, bool is_opponent) const 
+        const DPCNodeChildMap& children, RandManager& rand_manager, int visit_threshold, bool is_opponent) const 
     {
         double opp_coeff = is_opponent ? -1.0 : 1.0;
         unordered_map<shared_ptr<const Action>, double> dp_values_thresholded;
         unordered_map<shared_ptr<const Action>, double> dp_values;
-        for (pair<shared_ptr<const Action>,shared_ptr<DPCNode>> pr : children) {
-            shared_ptr<const Action> action = pr.first;
-            DPCNode& child = *pr.second;
+        for (const DPCNodeChildMap::value_type& pr : children) {
+            const shared_ptr<const Action>& action = pr.first;
+            DPCNode& child = pr.second;
             if (child.num_backups >= visit_threshold) {
                 dp_values_thresholded[action] = opp_coeff * child.dp_value;
             } else {
@@ -57,18 +57,23 @@ namespace thts {
      * chance node initialised to 0. In cuncurrent settings, we may erroneously backup a zero. Alternatively, we may 
      * accidentally erase heuristic values that we wanted to use in concurrent settings (which is why this line was 
      * added originally).
+     * 
+     * Children are not locked, so the max is computed in a local variable and stored once, so that threads reading 
+     * 'dp_value' concurrently never read the intermediate -inf.
      */
-    void DPDNode::backup_dp_impl(DPCNodeChildMap& children, bool is_opponent) {
+    void DPDNode::backup_dp_impl(const DPCNodeChildMap& children, bool is_opponent) {
         double opp_coeff = is_opponent ? -1.0 : 1.0;
-        dp_value = opp_coeff * -numeric_limits<double>::infinity();
+        double new_dp_value = opp_coeff * -numeric_limits<double>::infinity();
 
-        for (pair<shared_ptr<const Action>,shared_ptr<DPCNode>> pr : children) {
-            DPCNode& child = *pr.second;
+        for (const DPCNodeChildMap::value_type& pr : children) {
+            DPCNode& child = pr.second;
             if (child.num_backups == 0) continue;
-            if (opp_coeff * child.dp_value > opp_coeff * dp_value) {
-                dp_value = child.dp_value;
+            double child_dp_value = child.dp_value;
+            if (opp_coeff * child_dp_value > opp_coeff * new_dp_value) {
+                new_dp_value = child_dp_value;
             }
         }
+        dp_value = new_dp_value;
 
         num_backups++;
     }
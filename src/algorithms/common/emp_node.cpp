@@ -22,14 +22,14 @@ namespace thts {
      * empty.
      */
     shared_ptr<const Action> EmpNode::recommend_action_best_emp_value_impl(
-        EmpNodeChildMap& children, RandManager& rand_manager, int visit_threshold, bool is_opponent) const 
+        const EmpNodeChildMap& children, RandManager& rand_manager, int visit_threshold, bool is_opponent) const 
     {
         double opp_coeff = is_opponent ? -1.0 : 1.0;
         unordered_map<shared_ptr<const Action>, double> avg_returns_thresholded;
         unordered_map<shared_ptr<const Action>, double> avg_returns;
-        for (pair<shared_ptr<const Action>,shared_ptr<EmpNode>> pr : children) {
-            shared_ptr<const Action> action = pr.first;
-            EmpNode& child = *pr.second;
+        for (const EmpNodeChildMap::value_type& pr : children) {
+            const shared_ptr<const Action>& action = pr.first;
+            EmpNode& child = pr.second;
             if (child.num_backups >= visit_threshold) {
                 avg_returns_thresholded[action] = opp_coeff * child.avg_return;
             } else {
@@ -13,19 +13,22 @@ namespace thts {
      * Entropy = expected value of child entropies (i.e. empirical average)
      * 
      * Adapted from DPDNode DPBackup function
+     * 
+     * The entropy is accumulated in a local variable, so that concurrent (lock free) readers only see the final value
     */
-    void EntCNode::backup_ent_impl(EntDNodeChildMap& children) {
+    void EntCNode::backup_ent_impl(const EntDNodeChildMap& children) {
         num_backups++;
 
-        subtree_entropy = 0.0;
+        double new_subtree_entropy = 0.0;
         double sum_child_backups = 0;
-        for (pair<shared_ptr<const Observation>,shared_ptr<EntDNode>> pr : children) {
-            EntDNode& child = (EntDNode&) *pr.second;
+        for (const EntDNodeChildMap::value_type& pr : children) {
+            EntDNode& child = pr.second;
             int child_backups = child.num_backups;
             if (child_backups == 0) continue;
             sum_child_backups += child_backups;
-            subtree_entropy *= (sum_child_backups - child_backups) / sum_child_backups;
-            subtree_entropy += child_backups * child.subtree_entropy / sum_child_backups; 
+            new_subtree_entropy *= (sum_child_backups - child_backups) / sum_child_backups;
+            new_subtree_entropy += child_backups * child.subtree_entropy / sum_child_backups; 
         }
+        subtree_entropy = new_subtree_entropy;
     }
 }
\ No newline at end of file
@@ -30,26 +30,32 @@ namespace thts {
      * H_local = local entropy
      * Pr(a) = prob select action a
      * H(a) = subtree entropy of child node corresponding to action a
+     * 
+     * Entropies are computed in local variables and stored once, as the parent reads them without holding our lock. 
+     * Actions missing from 'policy' (near zero probability actions are removed from it) have zero probability.
     */
-    void EntDNode::backup_ent_impl(EntCNodeChildMap& children, ActionDistr& policy, bool is_opponent) {
+    void EntDNode::backup_ent_impl(const EntCNodeChildMap& children, const ActionDistr& policy, bool is_opponent) {
         // Remember to update num backups
         num_backups++;
 
         // Compute local entropy 
-        local_entropy = 0.0;
-        for (pair<shared_ptr<const Action>,double> pr : policy) {
+        double new_local_entropy = 0.0;
+        for (const pair<const shared_ptr<const Action>,double>& pr : policy) {
             double prob = pr.second;
             if (prob == 0.0) continue;
-            local_entropy -= prob * log(prob);
+            new_local_entropy -= prob * log(prob);
         }
+        local_entropy = new_local_entropy;
 
         // Update subtree entropy == expected child subtree entropies + local
         double opp_coeff = is_opponent ? -1.0 : 1.0;
-        subtree_entropy = opp_coeff * local_entropy;
-        for (pair<shared_ptr<const Action>,shared_ptr<EntCNode>> pr : children) {
-            shared_ptr<const Action> action = pr.first;
-            EntCNode& child = (EntCNode&) *pr.second;
-            subtree_entropy += policy[action] * child.subtree_entropy;
+        double new_subtree_entropy = opp_coeff * new_local_entropy;
+        for (const EntCNodeChildMap::value_type& pr : children) {
+            auto policy_iter = policy.find(pr.first);
+            if (policy_iter == policy.end()) continue;
+            EntCNode& child = pr.second;
+            new_subtree_entropy += policy_iter->second * child.subtree_entropy;
         }
+        subtree_entropy = new_subtree_entropy;
     }
 }
@@ -0,0 +1,65 @@
+#include "algorithms/common/progressive_widening.h"
+
+#include "thts_decision_node.h"
+#include "thts_manager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+namespace thts {
+    int compute_progressive_widening_limit(int num_visits, double coeff, double exponent) {
+        double num_visits_d = (num_visits > 0) ? (double)num_visits : 0.0;
+        double limit = ceil(coeff * pow(num_visits_d, exponent));
+        if (limit < 1.0) return 1;
+        if (limit > (double) numeric_limits<int>::max()) return numeric_limits<int>::max();
+        return (int) limit;
+    }
+
+    /**
+     * Sorts by prior with a stable sort, so that actions with equal prior probabilities keep the order given by the 
+     * environment. Otherwise uses a Fisher-Yates shuffle.
+     */
+    shared_ptr<ActionVector> get_progressive_widening_action_order(
+        const ActionVector& actions, shared_ptr<ActionPrior> policy_prior, RandManager& rand_manager)
+    {
+        shared_ptr<ActionVector> ordered_actions = make_shared<ActionVector>(actions);
+        if (policy_prior != nullptr) {
+            stable_sort(ordered_actions->begin(), ordered_actions->end(), 
+                [&policy_prior](const shared_ptr<const Action>& a, const shared_ptr<const Action>& b) {
+                    return policy_prior->at(a) > policy_prior->at(b);
+                });
+            return ordered_actions;
+        }
+
+        for (int i=(int)ordered_actions->size()-1; i>0; i--) {
+            int j = rand_manager.get_rand_int(0, i+1);
+            swap((*ordered_actions)[i], (*ordered_actions)[j]);
+        }
+        return ordered_actions;
+    }
+
+    /**
+     * Two passes over the children, the first to sum the (child) visit counts, and the second to find the sampled 
+     * child. Child visit counts are read lock free (see RelaxedAtomic).
+     */
+    shared_ptr<const Observation> sample_existing_child_observation(
+        const DNodeChildMap& children, RandManager& rand_manager)
+    {
+        double total_visits = 0.0;
+        for (const pair<const shared_ptr<const Observation>,shared_ptr<ThtsDNode>>& pr : children) {
+            total_visits += max(1, pr.second->get_num_visits());
+        }
+
+        double sample = rand_manager.get_rand_uniform() * total_visits;
+        shared_ptr<const Observation> sampled_observation;
+        for (const pair<const shared_ptr<const Observation>,shared_ptr<ThtsDNode>>& pr : children) {
+            sampled_observation = pr.first;
+            sample -= max(1, pr.second->get_num_visits());
+            if (sample < 0.0) break;
+        }
+        return sampled_observation;
+    }
+}
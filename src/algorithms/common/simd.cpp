@@ -0,0 +1,19 @@
+#include "algorithms/common/simd.h"
+
+namespace {
+    thts::SimdLevel detect_simd_level() {
+#ifdef THTS_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return thts::SimdLevel::avx512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return thts::SimdLevel::avx2;
+#endif
+        return thts::SimdLevel::scalar;
+    }
+}
+
+namespace thts {
+    SimdLevel get_supported_simd_level() {
+        static const SimdLevel supported_simd_level = detect_simd_level();
+        return supported_simd_level;
+    }
+}
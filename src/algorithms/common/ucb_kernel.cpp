@@ -0,0 +1,209 @@
+#include "algorithms/common/ucb_kernel.h"
+
+#include "thts_manager.h"
+
+#include <cmath>
+#include <limits>
+
+#ifdef THTS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+    /**
+     * Scalar implementation. Computes (coeff * weight) / f(child_visits) and then adds it to the q-value, which the
+     * vectorised implementations do in the same order.
+     */
+    void add_ucb_exploration_terms_scalar(
+        double* values,
+        const double* child_visits,
+        const double* weights,
+        size_t n,
+        double coeff,
+        thts::UcbVisitsScaling scaling)
+    {
+        for (size_t i=0; i<n; i++) {
+            double visits = (child_visits[i] > 1.0) ? child_visits[i] : 1.0;
+            double term = (weights != nullptr) ? coeff * weights[i] : coeff;
+            if (scaling == thts::UcbVisitsScaling::inv_sqrt) {
+                term /= sqrt(visits);
+            } else {
+                term /= visits;
+            }
+            values[i] += term;
+        }
+    }
+
+    double compute_max_value_scalar(const double* values, size_t n) {
+        double max_value = numeric_limits<double>::lowest();
+        for (size_t i=0; i<n; i++) {
+            if (max_value < values[i]) max_value = values[i];
+        }
+        return max_value;
+    }
+
+#ifdef THTS_X86_SIMD
+    /**
+     * AVX2 implementation. Tails (when n isn't a multiple of 4) use the scalar implementation.
+     */
+    __attribute__((target("avx2")))
+    void add_ucb_exploration_terms_avx2(
+        double* values,
+        const double* child_visits,
+        const double* weights,
+        size_t n,
+        double coeff,
+        thts::UcbVisitsScaling scaling)
+    {
+        __m256d coeff_vec = _mm256_set1_pd(coeff);
+        __m256d one_vec = _mm256_set1_pd(1.0);
+        bool use_sqrt = (scaling == thts::UcbVisitsScaling::inv_sqrt);
+        size_t i = 0;
+        for (; i+4<=n; i+=4) {
+            __m256d visits = _mm256_max_pd(_mm256_loadu_pd(child_visits+i), one_vec);
+            if (use_sqrt) visits = _mm256_sqrt_pd(visits);
+            __m256d term = coeff_vec;
+            if (weights != nullptr) term = _mm256_mul_pd(coeff_vec, _mm256_loadu_pd(weights+i));
+            term = _mm256_div_pd(term, visits);
+            _mm256_storeu_pd(values+i, _mm256_add_pd(_mm256_loadu_pd(values+i), term));
+        }
+        const double* tail_weights = (weights != nullptr) ? weights+i : nullptr;
+        add_ucb_exploration_terms_scalar(values+i, child_visits+i, tail_weights, n-i, coeff, scaling);
+    }
+
+    __attribute__((target("avx2")))
+    double compute_max_value_avx2(const double* values, size_t n) {
+        __m256d max_vec = _mm256_set1_pd(numeric_limits<double>::lowest());
+        size_t i = 0;
+        for (; i+4<=n; i+=4) {
+            max_vec = _mm256_max_pd(max_vec, _mm256_loadu_pd(values+i));
+        }
+        __m128d max_half = _mm_max_pd(_mm256_castpd256_pd128(max_vec), _mm256_extractf128_pd(max_vec, 1));
+        double max_value = max(_mm_cvtsd_f64(max_half), _mm_cvtsd_f64(_mm_unpackhi_pd(max_half, max_half)));
+        return max(max_value, compute_max_value_scalar(values+i, n-i));
+    }
+
+    /**
+     * AVX-512 implementation. Tails are handled with masked loads and stores. (As in boltzmann_kernel.cpp, gcc's 
+     * false positive uninitialized warnings from the AVX-512 intrinsics are silenced for these functions.)
+     */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+    __attribute__((target("avx512f")))
+    void add_ucb_exploration_terms_avx512(
+        double* values,
+        const double* child_visits,
+        const double* weights,
+        size_t n,
+        double coeff,
+        thts::UcbVisitsScaling scaling)
+    {
+        __m512d coeff_vec = _mm512_set1_pd(coeff);
+        __m512d one_vec = _mm512_set1_pd(1.0);
+        bool use_sqrt = (scaling == thts::UcbVisitsScaling::inv_sqrt);
+        for (size_t i=0; i<n; i+=8) {
+            __mmask8 load_mask = (n-i >= 8) ? (__mmask8) 0xFF : (__mmask8) ((1u << (n-i)) - 1u);
+            __m512d visits = _mm512_max_pd(_mm512_mask_loadu_pd(one_vec, load_mask, child_visits+i), one_vec);
+            if (use_sqrt) visits = _mm512_sqrt_pd(visits);
+            __m512d term = coeff_vec;
+            if (weights != nullptr) term = _mm512_mul_pd(coeff_vec, _mm512_maskz_loadu_pd(load_mask, weights+i));
+            term = _mm512_div_pd(term, visits);
+            __m512d vals = _mm512_maskz_loadu_pd(load_mask, values+i);
+            _mm512_mask_storeu_pd(values+i, load_mask, _mm512_add_pd(vals, term));
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    double compute_max_value_avx512(const double* values, size_t n) {
+        __m512d lowest = _mm512_set1_pd(numeric_limits<double>::lowest());
+        __m512d max_vec = lowest;
+        for (size_t i=0; i<n; i+=8) {
+            __mmask8 load_mask = (n-i >= 8) ? (__mmask8) 0xFF : (__mmask8) ((1u << (n-i)) - 1u);
+            max_vec = _mm512_max_pd(max_vec, _mm512_mask_loadu_pd(lowest, load_mask, values+i));
+        }
+        return _mm512_reduce_max_pd(max_vec);
+    }
+#pragma GCC diagnostic pop
+#endif
+}
+
+namespace thts {
+    void add_ucb_exploration_terms(
+        double* values,
+        const double* child_visits,
+        const double* weights,
+        size_t n,
+        double coeff,
+        UcbVisitsScaling scaling)
+    {
+        add_ucb_exploration_terms(values, child_visits, weights, n, coeff, scaling, get_supported_simd_level());
+    }
+
+    /**
+     * Dispatches to the implementation for 'simd_level'
+     */
+    void add_ucb_exploration_terms(
+        double* values,
+        const double* child_visits,
+        const double* weights,
+        size_t n,
+        double coeff,
+        UcbVisitsScaling scaling,
+        SimdLevel simd_level)
+    {
+#ifdef THTS_X86_SIMD
+        if (simd_level == SimdLevel::avx512) {
+            return add_ucb_exploration_terms_avx512(values, child_visits, weights, n, coeff, scaling);
+        }
+        if (simd_level == SimdLevel::avx2) {
+            return add_ucb_exploration_terms_avx2(values, child_visits, weights, n, coeff, scaling);
+        }
+#endif
+        add_ucb_exploration_terms_scalar(values, child_visits, weights, n, coeff, scaling);
+    }
+
+    double compute_max_value(const double* values, size_t n) {
+        return compute_max_value(values, n, get_supported_simd_level());
+    }
+
+    /**
+     * Dispatches to the implementation for 'simd_level'
+     */
+    double compute_max_value(const double* values, size_t n, SimdLevel simd_level) {
+#ifdef THTS_X86_SIMD
+        if (simd_level == SimdLevel::avx512) return compute_max_value_avx512(values, n);
+        if (simd_level == SimdLevel::avx2) return compute_max_value_avx2(values, n);
+#endif
+        return compute_max_value_scalar(values, n);
+    }
+
+    /**
+     * Finds the max value with the (vectorised) kernel, and then counts the number of values equal to it. If there is
+     * a tie, then a random one of the tied indices is picked with a second scan.
+     */
+    int get_max_index_break_ties_randomly(const vector<double>& values, RandManager& rand_manager) {
+        double max_value = compute_max_value(values.data(), values.size());
+
+        int first_max_index = -1;
+        int num_max = 0;
+        for (size_t i=0; i<values.size(); i++) {
+            if (values[i] == max_value) {
+                if (num_max == 0) first_max_index = i;
+                num_max++;
+            }
+        }
+        if (num_max <= 1) return first_max_index;
+
+        int tie_index = rand_manager.get_rand_int(0, num_max);
+        for (size_t i=first_max_index; i<values.size(); i++) {
+            if (values[i] == max_value) {
+                if (tie_index == 0) return i;
+                tie_index--;
+            }
+        }
+        return first_max_index;
+    }
+}
@@ -29,8 +29,8 @@ namespace thts {
      * Recall that the dp backup needs to be passed the type of the child nodes (so can keep dp logic in dp node)
      */
     void EstCNode::backup(
-        const std::vector<double>& trial_rewards_before_node, 
-        const std::vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx)
@@ -50,10 +50,10 @@ namespace thts {
      * Make child node
      */
     shared_ptr<EstDNode> EstCNode::create_child_node_helper(
-        shared_ptr<const State> observation, shared_ptr<const State> next_state) const 
+        const shared_ptr<const State>& observation, const shared_ptr<const State>& next_state) const 
     {  
         shared_ptr<const State> mdp_next_state = static_pointer_cast<const State>(observation);
-        return make_shared<EstDNode>(
+        return thts_manager->make_node<EstDNode>(
             static_pointer_cast<DentsManager>(ThtsCNode::thts_manager), 
             mdp_next_state,
             decision_depth+1, 
@@ -77,7 +77,7 @@ namespace thts {
  */
 namespace thts {
     shared_ptr<ThtsDNode> EstCNode::create_child_node_helper_itfc(
-        shared_ptr<const Observation> observation, shared_ptr<const State> next_state) const 
+        const shared_ptr<const Observation>& observation, const shared_ptr<const State>& next_state) const 
     {
         shared_ptr<const State> obsv_itfc = static_pointer_cast<const State>(observation);
         shared_ptr<const State> next_state_itfc = static_pointer_cast<const State>(next_state);
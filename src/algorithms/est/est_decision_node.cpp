@@ -24,15 +24,18 @@ namespace thts {
     /**
      * Gets the q_value to use for a child, calls ments version when there is not a child node
      */
-    double EstDNode::get_soft_q_value(std::shared_ptr<const Action> action, double opp_coeff) const {
-        if (has_child_node(action)) {
-            EstCNode& child = (EstCNode&) *get_child_node(action);
+    double EstDNode::get_soft_q_value(
+        const std::shared_ptr<const Action>& action, double opp_coeff, size_t position_hint) const 
+    {
+        auto child_iter = children.find(action, position_hint);
+        if (child_iter != children.end()) {
+            EstCNode& child = (EstCNode&) *child_iter->second;
             DentsManager& manager = (DentsManager&) *thts_manager;
             double val_estimate = manager.use_dp_value ? child.dp_value : child.avg_return;
             return val_estimate * opp_coeff;
         } 
 
-        return MentsDNode::get_soft_q_value(action, opp_coeff);
+        return MentsDNode::get_soft_q_value(action, opp_coeff, position_hint);
     }
 
     /**
@@ -41,8 +44,8 @@ namespace thts {
      * Recall that the dp backup needs to be passed the type of the child nodes (so can keep dp logic in dp node)
      */
     void EstDNode::backup(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -71,8 +74,8 @@ namespace thts {
     /**
      * Make child node
      */
-    shared_ptr<EstCNode> EstDNode::create_child_node_helper(shared_ptr<const Action> action) const {
-        return make_shared<EstCNode>(
+    shared_ptr<EstCNode> EstDNode::create_child_node_helper(const shared_ptr<const Action>& action) const {
+        return thts_manager->make_node<EstCNode>(
             static_pointer_cast<DentsManager>(ThtsDNode::thts_manager), 
             state, 
             action, 
@@ -86,7 +89,7 @@ namespace thts {
  * Boilerplate ThtsDNode interface implementation. Copied from thts_decision_node_template.h.
  */
 namespace thts {
-    shared_ptr<ThtsCNode> EstDNode::create_child_node_helper_itfc(shared_ptr<const Action> action) const {
+    shared_ptr<ThtsCNode> EstDNode::create_child_node_helper_itfc(const shared_ptr<const Action>& action) const {
         shared_ptr<const Action> act_itfc = static_pointer_cast<const Action>(action);
         shared_ptr<EstCNode> child_node = create_child_node_helper(act_itfc);
         return static_pointer_cast<ThtsCNode>(child_node);
@@ -52,14 +52,27 @@ namespace thts {
         return recommend_action_best_dp_value();
     }
 
+    /**
+     * Child values are the dp values of children, (multiplied by -1.0 if acting as the opponent).
+     */
+    void DBMentsDNode::fill_child_recommendation_stats_itfc(ChildRecommendationStatsMap& child_stats) const {
+        double opp_coeff = is_opponent() ? -1.0 : 1.0;
+        for (const shared_ptr<const Action>& action : *actions) {
+            if (!has_child_node(action)) continue;
+            DBMentsCNode& child = (DBMentsCNode&) *get_child_node(action);
+            lock_guard<mutex> lg(child.get_lock());
+            child_stats[action] = ChildRecommendationStats{child.num_visits, opp_coeff * child.dp_value};
+        }
+    }
+
     /**
      * Calls both the ments soft backup and dp backup
      * 
      * Recall that the dp backup needs to be passed the type of the child nodes (so can keep dp logic in dp node)
      */
     void DBMentsDNode::backup(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -80,8 +93,8 @@ namespace thts {
     /**
      * Make child node
      */
-    shared_ptr<DBMentsCNode> DBMentsDNode::create_child_node_helper(shared_ptr<const Action> action) const {
-        return make_shared<DBMentsCNode>(
+    shared_ptr<DBMentsCNode> DBMentsDNode::create_child_node_helper(const shared_ptr<const Action>& action) const {
+        return thts_manager->make_node<DBMentsCNode>(
             static_pointer_cast<MentsManager>(ThtsDNode::thts_manager), 
             state, 
             action, 
@@ -95,7 +108,7 @@ namespace thts {
  * Boilerplate ThtsDNode interface implementation. Copied from thts_decision_node_template.h.
  */
 namespace thts {
-    shared_ptr<ThtsCNode> DBMentsDNode::create_child_node_helper_itfc(shared_ptr<const Action> action) const {
+    shared_ptr<ThtsCNode> DBMentsDNode::create_child_node_helper_itfc(const shared_ptr<const Action>& action) const {
         shared_ptr<const Action> act_itfc = static_pointer_cast<const Action>(action);
         shared_ptr<DBMentsCNode> child_node = create_child_node_helper(act_itfc);
         return static_pointer_cast<ThtsCNode>(child_node);
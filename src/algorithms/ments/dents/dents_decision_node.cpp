@@ -54,13 +54,16 @@ namespace thts {
      * 
      * Other cases are suitably handled by the implementation in MentsDNode, so just call that
     */
-    double DentsDNode::get_soft_q_value(std::shared_ptr<const Action> action, double opp_coeff) const {
-        if (!has_child_node(action)) {
-            return MentsDNode::get_soft_q_value(action, opp_coeff);
+    double DentsDNode::get_soft_q_value(
+        const std::shared_ptr<const Action>& action, double opp_coeff, size_t position_hint) const 
+    {
+        auto child_iter = children.find(action, position_hint);
+        if (child_iter == children.end()) {
+            return MentsDNode::get_soft_q_value(action, opp_coeff, position_hint);
         }
 
         DentsManager& manager = (DentsManager&) *thts_manager;
-        DentsCNode& child = (DentsCNode&) *get_child_node(action);
+        DentsCNode& child = (DentsCNode&) *child_iter->second;
         double val_estimate = child.dp_value;
         if (!manager.use_dp_value) val_estimate = child.avg_return;
         return opp_coeff * (val_estimate + get_value_temp() * child.subtree_entropy);
@@ -94,14 +97,30 @@ namespace thts {
         return recommend_action_best_empirical_value();
     }
 
+    /**
+     * Child values are the dp values (or average returns) of children, (multiplied by -1.0 if acting as the opponent).
+     * Unlike 'get_soft_q_value' the entropy of the subtrees is not included, matching 'recommend_action'.
+     */
+    void DentsDNode::fill_child_recommendation_stats_itfc(ChildRecommendationStatsMap& child_stats) const {
+        DentsManager& manager = (DentsManager&) *thts_manager;
+        double opp_coeff = is_opponent() ? -1.0 : 1.0;
+        for (const shared_ptr<const Action>& action : *actions) {
+            if (!has_child_node(action)) continue;
+            DentsCNode& child = (DentsCNode&) *get_child_node(action);
+            lock_guard<mutex> lg(child.get_lock());
+            double val_estimate = manager.use_dp_value ? child.dp_value : child.avg_return;
+            child_stats[action] = ChildRecommendationStats{child.num_visits, opp_coeff * val_estimate};
+        }
+    }
+
     /**
      * Calls both the entropy backup and dp backup
      * 
      * Recall that the dp backup needs to be passed the type of the child nodes (so can keep dp logic in dp node)
      */
     void DentsDNode::backup(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -131,8 +150,8 @@ namespace thts {
     /**
      * Make child node
      */
-    shared_ptr<DentsCNode> DentsDNode::create_child_node_helper(shared_ptr<const Action> action) const {
-        return make_shared<DentsCNode>(
+    shared_ptr<DentsCNode> DentsDNode::create_child_node_helper(const shared_ptr<const Action>& action) const {
+        return thts_manager->make_node<DentsCNode>(
             static_pointer_cast<DentsManager>(ThtsDNode::thts_manager), 
             state, 
             action, 
@@ -159,7 +178,7 @@ namespace thts {
  * Boilerplate ThtsDNode interface implementation. Copied from thts_decision_node_template.h.
  */
 namespace thts {
-    shared_ptr<ThtsCNode> DentsDNode::create_child_node_helper_itfc(shared_ptr<const Action> action) const {
+    shared_ptr<ThtsCNode> DentsDNode::create_child_node_helper_itfc(const shared_ptr<const Action>& action) const {
         shared_ptr<const Action> act_itfc = static_pointer_cast<const Action>(action);
         shared_ptr<DentsCNode> child_node = create_child_node_helper(act_itfc);
         return static_pointer_cast<ThtsCNode>(child_node);
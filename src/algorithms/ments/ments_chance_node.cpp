@@ -1,5 +1,6 @@
 #include "algorithms/ments/ments_chance_node.h"
 
+#include "algorithms/common/progressive_widening.h"
 #include "helper_templates.h"
 
 using namespace std;
@@ -25,7 +26,10 @@ namespace thts {
             num_backups(0),
             soft_value(thts_manager->default_q_value),
             local_reward(thts_manager->thts_env->get_reward_itfc(state,action)),
-            next_state_distr(thts_manager->thts_env->get_transition_distribution_itfc(state,action)) 
+            next_state_distr(
+                thts_manager->use_generative_model ? 
+                    nullptr : thts_manager->thts_env->get_transition_distribution_itfc(state,action)),
+            next_state_sampler(next_state_distr, true)
     {
     }
 
@@ -37,10 +41,28 @@ namespace thts {
     }
 
     /**
-     * Implementation of sample_observation, that uses the sample from distribution helper function.
+     * Implementation of sample_observation, that samples from the alias table in O(1) time, or samples from the 
+     * environment directly if using it as a generative model. 
+     * 
+     * If using progressive widening on chance nodes, and this node already has as many children as the widening 
+     * limit allows, then an existing child is sampled instead (in proportion to child visit counts).
      */
     shared_ptr<const State> MentsCNode::sample_observation_random() {
-        shared_ptr<const State> sampled_state = helper::sample_from_distribution(*next_state_distr, *thts_manager);
+        MentsManager& manager = (MentsManager&) *thts_manager;
+        if (manager.use_chance_progressive_widening && get_num_children() > 0) {
+            int limit = compute_progressive_widening_limit(
+                num_visits, manager.chance_progressive_widening_coeff, manager.chance_progressive_widening_exponent);
+            if (get_num_children() >= limit) {
+                return static_pointer_cast<const State>(sample_existing_child_observation(children, manager));
+            }
+        }
+
+        shared_ptr<const State> sampled_state;
+        if (next_state_distr == nullptr) {
+            sampled_state = thts_manager->thts_env->sample_transition_distribution_itfc(state, action, *thts_manager);
+        } else {
+            sampled_state = next_state_sampler.sample(*thts_manager);
+        }
         if (!has_child_node(sampled_state)) {
             create_child_node(sampled_state);
         }
@@ -71,30 +93,32 @@ namespace thts {
      * Consider if we have another trial that also searches this node, it made a new child, but hasn't backed it up 
      * yet. Hence it's necessary to include the line "if (child.num_backups == 0) continue;" to avoid a division by 
      * zero causing NaNs.
+     * 
+     * Children are not locked, so each childs 'num_backups' is read once, and the running average is accumulated in a 
+     * local variable, so that threads selecting from the parent never read a partially computed 'soft_value'.
      */
     void MentsCNode::backup_soft() {
         num_backups++;
 
-        soft_value = 0.0;
+        double new_soft_value = 0.0;
         double sum_child_backups = 0.0;
-        lock_all_children();
-        for (pair<shared_ptr<const Observation>,shared_ptr<ThtsDNode>> pr : children) {
+        for (const pair<const shared_ptr<const Observation>,shared_ptr<ThtsDNode>>& pr : children) {
             MentsDNode& child = (MentsDNode&) *pr.second;
-            if (child.num_backups == 0) continue;
-            sum_child_backups += child.num_backups;
-            soft_value *= (sum_child_backups - child.num_backups) / sum_child_backups;
-            soft_value += child.num_backups * child.soft_value / sum_child_backups; 
+            int child_backups = child.num_backups;
+            if (child_backups == 0) continue;
+            sum_child_backups += child_backups;
+            new_soft_value *= (sum_child_backups - child_backups) / sum_child_backups;
+            new_soft_value += child_backups * child.soft_value / sum_child_backups; 
         }
-        unlock_all_children();
-        soft_value += local_reward; // +R(s,a)
+        soft_value = new_soft_value + local_reward; // +R(s,a)
     }
 
     /**
      * Calls ments soft backup
      */
     void MentsCNode::backup(
-        const std::vector<double>& trial_rewards_before_node, 
-        const std::vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx)
@@ -106,10 +130,10 @@ namespace thts {
      * Make child node
      */
     shared_ptr<MentsDNode> MentsCNode::create_child_node_helper(
-        shared_ptr<const State> observation, shared_ptr<const State> next_state) const 
+        const shared_ptr<const State>& observation, const shared_ptr<const State>& next_state) const 
     {  
         shared_ptr<const State> mdp_next_state = static_pointer_cast<const State>(observation);
-        return make_shared<MentsDNode>(
+        return thts_manager->make_node<MentsDNode>(
             static_pointer_cast<MentsManager>(thts_manager), 
             mdp_next_state,
             decision_depth+1, 
@@ -132,18 +156,19 @@ namespace thts {
  * All this code basically calls the corresponding base implementation function, with approprtiate casts before/after.
  */
 namespace thts {
-    shared_ptr<MentsDNode> MentsCNode::create_child_node(shared_ptr<const State> observation, shared_ptr<const State> next_state) {
+    shared_ptr<MentsDNode> MentsCNode::create_child_node(
+        const shared_ptr<const State>& observation, const shared_ptr<const State>& next_state) {
         shared_ptr<const Observation> obsv_itfc = static_pointer_cast<const Observation>(observation);
         shared_ptr<const State> next_state_itfc = static_pointer_cast<const State>(next_state);
         shared_ptr<ThtsDNode> new_child = ThtsCNode::create_child_node_itfc(obsv_itfc, next_state_itfc);
         return static_pointer_cast<MentsDNode>(new_child);
     }
 
-    bool MentsCNode::has_child_node(std::shared_ptr<const State> observation) const {
+    bool MentsCNode::has_child_node(const std::shared_ptr<const State>& observation) const {
         return ThtsCNode::has_child_node_itfc(static_pointer_cast<const Observation>(observation));
     }
     
-    shared_ptr<MentsDNode> MentsCNode::get_child_node(shared_ptr<const State> observation) const {
+    shared_ptr<MentsDNode> MentsCNode::get_child_node(const shared_ptr<const State>& observation) const {
         shared_ptr<const Observation> obsv_itfc = static_pointer_cast<const Observation>(observation);
         shared_ptr<ThtsDNode> new_child = ThtsCNode::get_child_node_itfc(obsv_itfc);
         return static_pointer_cast<MentsDNode>(new_child);
@@ -166,8 +191,8 @@ namespace thts {
     }
 
     void MentsCNode::backup_itfc(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -182,7 +207,7 @@ namespace thts {
     }
 
     shared_ptr<ThtsDNode> MentsCNode::create_child_node_helper_itfc(
-        shared_ptr<const Observation> observation, shared_ptr<const State> next_state) const 
+        const shared_ptr<const Observation>& observation, const shared_ptr<const State>& next_state) const 
     {
         shared_ptr<const State> obsv_itfc = static_pointer_cast<const State>(observation);
         shared_ptr<const State> next_state_itfc = static_pointer_cast<const State>(next_state);
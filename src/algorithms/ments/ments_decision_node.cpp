@@ -1,7 +1,11 @@
 #include "algorithms/ments/ments_decision_node.h"
 
+#include "algorithms/common/boltzmann_kernel.h"
+#include "algorithms/common/progressive_widening.h"
+#include "helper.h"
 #include "helper_templates.h"
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
@@ -15,6 +19,26 @@ static double LOG_MIN_ARG = 1e-32;
 static double LOG_MAX_ARG = 1e32;
 static double MIN_LOG_WEIGHT = -32.0;
 static double MAX_LOG_WEIGHT = 32.0;
+// Incremental soft backups recompute if less than this fraction of the sum of weights would remain after removing a 
+// term, or if the sum of weights falls below the minimum (i.e. the normalisation term is far above the max value)
+static double INCREMENTAL_MIN_REMAINING_WEIGHT_FRACTION = 1e-4;
+static double INCREMENTAL_MIN_SUM_WEIGHTS = 1e-8;
+
+/**
+ * Scratch buffer for computing dense distributions before copying them into an ActionDistr, reused between calls so 
+ * that the ActionDistr version of 'compute_action_distribution' doesn't allocate a vector each call.
+ */
+namespace {
+    thread_local vector<double> action_probs_scratch;
+}
+
+/**
+ * Cache of the incremental selected index slots, indexed by decision depth (see 
+ * 'MentsDNode::get_incremental_selected_index_slot').
+ */
+namespace {
+    thread_local vector<thts::ThtsEnvContextSlot<size_t>> incremental_selected_index_slots_cache;
+}
 
 namespace thts {
     MentsDNode::MentsDNode(
@@ -33,19 +57,31 @@ namespace thts {
             soft_value(0.0),
             actions(thts_manager->thts_env->get_valid_actions_itfc(state)),
             policy_prior(),
-            psuedo_q_value_offset(0.0)
+            psuedo_q_value_offset(0.0),
+            action_values_buffer(),
+            incremental_soft_q_values(),
+            incremental_max_value(0.0),
+            incremental_sum_weights(0.0),
+            incremental_temp(0.0),
+            num_incremental_updates(-1),
+            _incremental_selected_index_slot(),
+            widening_actions()
     {
-        if (thts_manager->heuristic_fn != nullptr) {
+        if (thts_manager->incremental_soft_backup && !thts_manager->use_transposition_table) {
+            _incremental_selected_index_slot = get_incremental_selected_index_slot(decision_depth);
+        }
+
+        if (thts_manager->has_heuristic_fn()) {
             soft_value = heuristic_value;
         }
 
-        if (thts_manager->prior_fn != nullptr) {
-            policy_prior = thts_manager->prior_fn(state, thts_manager->thts_env);
+        if (thts_manager->has_prior_fn()) {
+            policy_prior = compute_policy_prior();
 
             if (thts_manager->shift_pseudo_q_values) {
                 double mean_log_weight = 0.0;
                 double i = 1.0;
-                for (pair<shared_ptr<const Action>,double> pr : *policy_prior) {
+                for (const pair<const shared_ptr<const Action>,double>& pr : *policy_prior) {
                     double weight = pr.second;
                     double log_weight = MIN_LOG_WEIGHT;
                     if (weight >= LOG_MAX_ARG) {
@@ -59,6 +95,37 @@ namespace thts {
                 psuedo_q_value_offset = thts_manager->psuedo_q_value_offset - mean_log_weight;
             }
         }
+
+        if (thts_manager->use_progressive_widening) {
+            widening_actions = get_progressive_widening_action_order(*actions, policy_prior, *thts_manager);
+            actions = make_shared<ActionVector>();
+            widen_actions();
+            return;
+        }
+
+        children.reserve_keys(*actions);
+    }
+
+    /**
+     * Appends actions to 'actions', reserving their slots in 'children', so that they can still be looked up by 
+     * position in 'actions'. Admitting an action changes the terms of the soft 
+     * backup, so incremental soft backup terms are marked to be recomputed.
+     */
+    void MentsDNode::widen_actions() {
+        if (widening_actions == nullptr) return;
+
+        MentsManager& manager = (MentsManager&) *thts_manager;
+        size_t limit = compute_progressive_widening_limit(
+            num_visits, manager.progressive_widening_coeff, manager.progressive_widening_exponent);
+        limit = min(limit, widening_actions->size());
+        while (actions->size() < limit) {
+            const shared_ptr<const Action>& action = (*widening_actions)[actions->size()];
+            actions->push_back(action);
+            children.reserve_key(action);
+            if (manager.incremental_soft_backup) {
+                num_incremental_updates = -1;
+            }
+        }
     }
     
     /**
@@ -66,7 +133,7 @@ namespace thts {
      */
     bool MentsDNode::has_prior() const {
         MentsManager& manager = (MentsManager&) *thts_manager;
-        return manager.prior_fn != nullptr;
+        return manager.has_prior_fn();
     }
 
     /**
@@ -91,9 +158,12 @@ namespace thts {
      * The main nuance is making sure that 'num_backups' is updated for leaf nodes, where thts will only ever call 
      * visit on these nodes. If this node is a leaf, then a backup should essentially be a no-op. However, for the 
      * soft_backup in chance nodes to work, the number of backups needs to be updated, even at leaf nodes.
+     * 
+     * If using progressive widening, then any new actions are admitted after incrementing 'num_visits'.
      */
     void MentsDNode::visit(ThtsEnvContext& ctx) {
         ThtsDNode::visit_itfc(ctx);
+        widen_actions();
         if (is_leaf()) {
             num_backups++;
         }
@@ -105,9 +175,12 @@ namespace thts {
      * Handle numerical instability for the prior_prob=0 case
      * log
      */
-    double MentsDNode::get_soft_q_value(std::shared_ptr<const Action> action, double opp_coeff) const {
-        if (has_child_node(action)) {
-            MentsCNode& child = (MentsCNode&) *get_child_node(action);
+    double MentsDNode::get_soft_q_value(
+        const std::shared_ptr<const Action>& action, double opp_coeff, size_t position_hint) const 
+    {
+        auto child_iter = children.find(action, position_hint);
+        if (child_iter != children.end()) {
+            MentsCNode& child = (MentsCNode&) *child_iter->second;
             return child.soft_value * opp_coeff;
         } 
 
@@ -145,9 +218,12 @@ namespace thts {
      * The normalisation term is still returned via reference for when we do need to know the exact values of these 
      * weights (which is the case in backups).
      * 
+     * Each q-value is read once into the contiguous 'action_weights' buffer (using the index of each action as the 
+     * position hint for its child, so filling the buffer is O(|A|)), and then the max, exp and sum are computed over 
+     * the buffer by the (vectorised) boltzmann kernel.
      */
     void MentsDNode::compute_action_weights(
-        ActionDistr& action_weights, 
+        vector<double>& action_weights, 
         double& sum_action_weights, 
         double& normalisation_term, 
         ThtsEnvContext& context) const
@@ -156,23 +232,15 @@ namespace thts {
         double opp_coeff = is_opponent() ? -1.0 : 1.0;
         double temp = get_temp();
 
-        // compute normalisation term
-        normalisation_term = numeric_limits<double>::lowest();
-        for (shared_ptr<const Action> action : *actions) {
-            double q_value_over_temp = get_soft_q_value(action,opp_coeff) / temp;
-            if (normalisation_term < q_value_over_temp) {
-                normalisation_term = q_value_over_temp;
-            }
+        // fill q_value / temp buffer
+        size_t num_actions = actions->size();
+        action_weights.resize(num_actions);
+        for (size_t i=0; i<num_actions; i++) {
+            action_weights[i] = get_soft_q_value((*actions)[i], opp_coeff, i) / temp;
         }
 
-        // compute action weights
-        sum_action_weights = 0.0;
-        for (shared_ptr<const Action> action : *actions) {
-            double soft_q_value = get_soft_q_value(action,opp_coeff);
-            double action_weight = exp((soft_q_value/temp) - normalisation_term);
-            action_weights[action] = action_weight;
-            sum_action_weights += action_weight;
-        }
+        // compute normalisation term and action weights
+        sum_action_weights = compute_boltzmann_weights(action_weights.data(), num_actions, normalisation_term);
     }
 
     /**
@@ -185,18 +253,20 @@ namespace thts {
      * boltzmann distribution is then normalised and interpolated with a uniform distribution, according to the value 
      * of lambda above.
      * 
-     * Additionally, protects the computation of action weights by grabbing the children's locks.
+     * Children are not locked while computing the action weights, as child soft values are RelaxedAtomics that can be 
+     * read lock free (see RelaxedAtomic).
+     * 
+     * Normalising and mixing with the uniform distribution is a single scale and shift of every weight, and then the 
+     * prior (if 'prior_policy_search_weight' is used) is mixed in per action.
      */
     void MentsDNode::compute_action_distribution(
-        ActionDistr& action_distr, 
+        vector<double>& action_probs, 
         ThtsEnvContext& context) const 
     {  
         // compute boltzmann weights
         double sum_weights;
         double _normalisation_term;
-        lock_all_children();
-        compute_action_weights(action_distr, sum_weights, _normalisation_term, context);
-        unlock_all_children();
+        compute_action_weights(action_probs, sum_weights, _normalisation_term, context);
 
         // compute lambda
         MentsManager& manager = (MentsManager&) *thts_manager;
@@ -207,43 +277,128 @@ namespace thts {
             lambda = manager.max_explore_prob;
         }
 
-        // normalise and interpolate masses with uniform masses
-        double num_actions = actions->size();
+        // normalise and interpolate masses with uniform (and prior) masses
+        size_t num_actions = actions->size();
         double uniform_distr_mass = 1.0 / num_actions;
-        vector<shared_ptr<const Action>> near_zero_prob_actions;
-        for (shared_ptr<const Action> action : *actions) {
-            action_distr[action] *= (1.0 - lambda) / sum_weights;
-            if (manager.prior_policy_search_weight > 0.0) {
-                double lambda_tilde = manager.prior_policy_search_weight / log(num_visits+3);
-                action_distr[action] *= (1.0 - lambda_tilde);
-                action_distr[action] += (1.0 - lambda) * lambda_tilde * policy_prior->at(action);
+        double boltzmann_coeff = (1.0 - lambda) / sum_weights;
+        double lambda_tilde = 0.0;
+        if (manager.prior_policy_search_weight > 0.0) {
+            lambda_tilde = manager.prior_policy_search_weight / log(num_visits+3);
+            boltzmann_coeff *= (1.0 - lambda_tilde);
+        }
+        scale_and_shift_values(action_probs.data(), num_actions, boltzmann_coeff, lambda * uniform_distr_mass);
+        if (manager.prior_policy_search_weight > 0.0) {
+            for (size_t i=0; i<num_actions; i++) {
+                action_probs[i] += (1.0 - lambda) * lambda_tilde * policy_prior->at((*actions)[i]);
+            }
+        }
+
+        // Zero close to zero probabilities (never going to sample + leads to numerical ick later)
+        for (double& prob : action_probs) {
+            if (prob < EPS) prob = 0.0;
+        }
+    }
+
+    /**
+     * Computes the dense distribution (into the thread local scratch buffer) and copies the non-zero probabilities 
+     * into 'action_distr'.
+     */
+    void MentsDNode::compute_action_distribution(
+        ActionDistr& action_distr, 
+        ThtsEnvContext& context) const 
+    {
+        vector<double>& action_probs = action_probs_scratch;
+        compute_action_distribution(action_probs, context);
+        for (size_t i=0; i<action_probs.size(); i++) {
+            if (action_probs[i] > 0.0) {
+                action_distr[(*actions)[i]] = action_probs[i];
             }
-            action_distr[action] += lambda * uniform_distr_mass;
-            if (action_distr[action] < EPS) {
-                near_zero_prob_actions.push_back(action);
+        }
+    }
+
+    /**
+     * Applies the virtual loss multiplicatively to the probabilities of actions whose children currently have 
+     * virtual losses. The virtual loss counters are atomic and 'num_backups' is a RelaxedAtomic, so children are not 
+     * locked.
+     */
+    bool MentsDNode::apply_virtual_loss(ActionDistr& action_distr) const {
+        MentsManager& manager = (MentsManager&) *thts_manager;
+        if (manager.virtual_loss <= 0.0) return false;
+
+        bool modified = false;
+        double temp = get_temp();
+        double sum_probs = 0.0;
+        for (pair<const shared_ptr<const Action>,double>& pr : action_distr) {
+            if (has_child_node(pr.first)) {
+                MentsCNode& child = *get_child_node(pr.first);
+                int child_virtual_losses = child.get_num_virtual_losses();
+                if (child_virtual_losses > 0) {
+                    double num_provisional_backups = child.num_backups + child_virtual_losses;
+                    double value_decrease = manager.virtual_loss * child_virtual_losses / num_provisional_backups;
+                    pr.second *= exp(-value_decrease / temp);
+                    modified = true;
+                }
+            }
+            sum_probs += pr.second;
+        }
+
+        if (modified) {
+            for (pair<const shared_ptr<const Action>,double>& pr : action_distr) {
+                pr.second /= sum_probs;
+            }
+        }
+        return modified;
+    }
+
+    /**
+     * Same as above, but indexing children by the index of their action in 'actions'.
+     */
+    bool MentsDNode::apply_virtual_loss(vector<double>& action_probs) const {
+        MentsManager& manager = (MentsManager&) *thts_manager;
+        if (manager.virtual_loss <= 0.0) return false;
+
+        bool modified = false;
+        double temp = get_temp();
+        double sum_probs = 0.0;
+        for (size_t i=0; i<action_probs.size(); i++) {
+            if (action_probs[i] > 0.0 && has_child_node((*actions)[i])) {
+                MentsCNode& child = *get_child_node((*actions)[i]);
+                int child_virtual_losses = child.get_num_virtual_losses();
+                if (child_virtual_losses > 0) {
+                    double num_provisional_backups = child.num_backups + child_virtual_losses;
+                    double value_decrease = manager.virtual_loss * child_virtual_losses / num_provisional_backups;
+                    action_probs[i] *= exp(-value_decrease / temp);
+                    modified = true;
+                }
             }
+            sum_probs += action_probs[i];
         }
 
-        // Remove close to zero probabilities (never going to sample + leads to numerical ick later)
-        for (shared_ptr<const Action> action : near_zero_prob_actions) {
-            action_distr.erase(action);
+        if (modified) {
+            scale_and_shift_values(action_probs.data(), action_probs.size(), 1.0 / sum_probs, 0.0);
         }
+        return modified;
     }
 
     /**
      * Implements selct action for ments
      * 
-     * - Computes the action distribution.
+     * - Computes the action distribution (and applies virtual loss if using), in the nodes 'action_values_buffer'
      * - Samples an action
      * - Creates the node if it doesn't exist already
+     * - Stores the index of the selected action in the context, if using incremental soft backups
      */
     shared_ptr<const Action> MentsDNode::select_action_ments(ThtsEnvContext& ctx) {
-        ActionDistr action_distr;
-        compute_action_distribution(action_distr, ctx);
-        shared_ptr<const Action> selected_action = helper::sample_from_distribution(action_distr, *thts_manager);
+        compute_action_distribution(action_values_buffer, ctx);
+        apply_virtual_loss(action_values_buffer);
+        int selected_index = helper::sample_index_from_weights(action_values_buffer, *thts_manager);
+        shared_ptr<const Action> selected_action = (*actions)[selected_index];
         if (!has_child_node(selected_action)) {
             create_child_node(selected_action);
         }
+        if (use_incremental_soft_backup()) {
+            ctx.emplace_inline_value(_incremental_selected_index_slot) = selected_index;
+        }
         return selected_action;
     }
 
@@ -265,7 +420,7 @@ namespace thts {
         unordered_map<shared_ptr<const Action>, double> soft_values_thresholded;
         unordered_map<shared_ptr<const Action>, double> soft_values;
 
-        for (shared_ptr<const Action> action : *actions) {
+        for (const shared_ptr<const Action>& action : *actions) {
             double q_value = get_soft_q_value(action, opp_coeff);
             if (has_child_node(action) && get_child_node(action)->num_visits >= manager.recommend_visit_threshold) {
                 soft_values_thresholded[action] = q_value;
@@ -286,7 +441,7 @@ namespace thts {
     shared_ptr<const Action> MentsDNode::recommend_action_most_visited() const {
         unordered_map<shared_ptr<const Action>, int> visit_counts;
 
-        for (shared_ptr<const Action> action : *actions) {
+        for (const shared_ptr<const Action>& action : *actions) {
             if (!has_child_node(action)) continue;
             visit_counts[action] = get_child_node(action)->num_visits;
         }
@@ -313,6 +468,120 @@ namespace thts {
         return recommend_action_best_soft_value();
     }
     
+    /**
+     * Child values are given by 'get_soft_q_value', so that subclasses that override 'get_soft_q_value' (for example 
+     * to use dp values) also provide the correct values here.
+     */
+    void MentsDNode::fill_child_recommendation_stats_itfc(ChildRecommendationStatsMap& child_stats) const {
+        double opp_coeff = is_opponent() ? -1.0 : 1.0;
+        for (const shared_ptr<const Action>& action : *actions) {
+            if (!has_child_node(action)) continue;
+            shared_ptr<MentsCNode> child = get_child_node(action);
+            lock_guard<mutex> lg(child->get_lock());
+            child_stats[action] = ChildRecommendationStats{child->num_visits, get_soft_q_value(action, opp_coeff)};
+        }
+    }
+
+    /**
+     * Recommends most visited iff the manager says to.
+     */
+    bool MentsDNode::recommends_most_visited_itfc() const {
+        MentsManager& manager = (MentsManager&) *thts_manager;
+        return manager.recommend_most_visited;
+    }
+
+    /**
+     * MENTS action weights only depend on the soft q-values, so incremental soft backups are supported.
+     */
+    bool MentsDNode::supports_incremental_soft_backup() const {
+        return true;
+    }
+
+    bool MentsDNode::use_incremental_soft_backup() const {
+        MentsManager& manager = (MentsManager&) *thts_manager;
+        return manager.incremental_soft_backup 
+            && !manager.use_transposition_table 
+            && supports_incremental_soft_backup();
+    }
+
+    /**
+     * Slots are registered (by name) with the global registry the first time that each thread needs the slot for a 
+     * depth, and then read from the thread local cache.
+     */
+    ThtsEnvContextSlot<size_t> MentsDNode::get_incremental_selected_index_slot(int decision_depth) {
+        vector<ThtsEnvContextSlot<size_t>>& slots_cache = incremental_selected_index_slots_cache;
+        size_t depth = (size_t) decision_depth;
+        if (depth >= slots_cache.size()) {
+            slots_cache.resize(depth+1);
+        }
+        if (!slots_cache[depth].is_valid()) {
+            stringstream ss;
+            ss << decision_depth << "_ments_selected_index";
+            slots_cache[depth] = ThtsEnvContext::register_slot<size_t>(ss.str());
+        }
+        return slots_cache[depth];
+    }
+
+    /**
+     * Fills 'incremental_soft_q_values' and 'action_values_buffer' with the values of Q(s,a)/temp, and then computes 
+     * the normalisation term and sum of weights with the boltzmann kernel (as in 'compute_action_weights').
+     */
+    void MentsDNode::recompute_incremental_soft_backup_terms(double temp) {
+        double opp_coeff = is_opponent() ? -1.0 : 1.0;
+        size_t num_actions = actions->size();
+        action_values_buffer.resize(num_actions);
+        incremental_soft_q_values.resize(num_actions);
+        for (size_t i=0; i<num_actions; i++) {
+            double value = get_soft_q_value((*actions)[i], opp_coeff, i) / temp;
+            incremental_soft_q_values[i] = value;
+            action_values_buffer[i] = value;
+        }
+        incremental_sum_weights = compute_boltzmann_weights(
+            action_values_buffer.data(), num_actions, incremental_max_value);
+        incremental_temp = temp;
+        num_incremental_updates = 0;
+    }
+
+    /**
+     * Replaces the term exp(old_value - max_value) with exp(new_value - max_value) in the sum of weights, where 
+     * old_value and new_value are the old and new values of Q(s,a)/temp for the selected action.
+     * 
+     * If the new value is larger than the current normalisation term, then the sum is first rescaled so that the new 
+     * value becomes the normalisation term. If the max value decreases the normalisation term is left as is, which 
+     * is still correct, but the sum gets smaller. So to avoid catastrophic cancellation (or underflow) we recompute if 
+     * the old term makes up almost all of the sum, or if the sum gets too small.
+     * 
+     * Temperature decay changes every value of Q(s,a)/temp, so a change in temperature always needs a recompute.
+     */
+    bool MentsDNode::update_incremental_soft_backup_terms(double temp, ThtsEnvContext& ctx) {
+        MentsManager& manager = (MentsManager&) *thts_manager;
+        if (num_incremental_updates < 0 || temp != incremental_temp) return false;
+        if (num_incremental_updates >= manager.incremental_soft_backup_recompute_period) return false;
+
+        size_t selected_index = *ctx.get_inline_value_ptr(_incremental_selected_index_slot);
+        double opp_coeff = is_opponent() ? -1.0 : 1.0;
+        double new_value = get_soft_q_value((*actions)[selected_index], opp_coeff, selected_index) / temp;
+        double& value = incremental_soft_q_values[selected_index];
+
+        double max_value = incremental_max_value;
+        double sum_weights = incremental_sum_weights;
+        if (new_value > max_value) {
+            sum_weights *= exp(max_value - new_value);
+            max_value = new_value;
+        }
+
+        double remaining_sum_weights = sum_weights - exp(value - max_value);
+        if (remaining_sum_weights < INCREMENTAL_MIN_REMAINING_WEIGHT_FRACTION * sum_weights) return false;
+        sum_weights = remaining_sum_weights + exp(new_value - max_value);
+        if (sum_weights < INCREMENTAL_MIN_SUM_WEIGHTS) return false;
+
+        value = new_value;
+        incremental_max_value = max_value;
+        incremental_sum_weights = sum_weights;
+        num_incremental_updates++;
+        return true;
+    }
+
     /**
      * Implements a soft backup for ments.
      * 
@@ -325,20 +594,28 @@ namespace thts {
      * 
      * Additionally, we need to add the normalisation term from 'compute_action_weights' at the end. 
      * 
+     * If using incremental soft backups, the sum and normalisation term are maintained in 'incremental_sum_weights' 
+     * and 'incremental_max_value' instead, and are fully recomputed only when an incremental update can't be made.
+     * 
      * Also don't forget to increment num_backups
      */
     void MentsDNode::backup_soft(ThtsEnvContext& ctx) {
         num_backups++;
 
-        ActionDistr action_weights;
-        double sum_weights;
-        double normalisation_term;
-        lock_all_children();
-        compute_action_weights(action_weights, sum_weights, normalisation_term, ctx);
-        unlock_all_children();
-
         double opp_coeff = is_opponent() ? -1.0 : 1.0;
         double temp = get_temp();
+
+        if (use_incremental_soft_backup()) {
+            if (!update_incremental_soft_backup_terms(temp, ctx)) {
+                recompute_incremental_soft_backup_terms(temp);
+            }
+            soft_value = opp_coeff * temp * (log(incremental_sum_weights) + incremental_max_value);
+            return;
+        }
+
+        double sum_weights;
+        double normalisation_term;
+        compute_action_weights(action_values_buffer, sum_weights, normalisation_term, ctx);
         soft_value = opp_coeff * temp * (log(sum_weights) + normalisation_term);
     }
 
@@ -346,8 +623,8 @@ namespace thts {
      * Calls the ments implementation of backup, performing soft backup
      */
     void MentsDNode::backup(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -358,8 +635,8 @@ namespace thts {
     /**
      * Make child node
      */
-    shared_ptr<MentsCNode> MentsDNode::create_child_node_helper(shared_ptr<const Action> action) const {
-        return make_shared<MentsCNode>(
+    shared_ptr<MentsCNode> MentsDNode::create_child_node_helper(const shared_ptr<const Action>& action) const {
+        return thts_manager->make_node<MentsCNode>(
             static_pointer_cast<MentsManager>(thts_manager), 
             state, 
             action, 
@@ -385,17 +662,17 @@ namespace thts {
  * All this code basically calls the corresponding base implementation function, with approprtiate casts before/after.
  */
 namespace thts {
-    shared_ptr<MentsCNode> MentsDNode::create_child_node(shared_ptr<const Action> action) {
+    shared_ptr<MentsCNode> MentsDNode::create_child_node(const shared_ptr<const Action>& action) {
         shared_ptr<const Action> act_itfc = static_pointer_cast<const Action>(action);
         shared_ptr<ThtsCNode> new_child = ThtsDNode::create_child_node_itfc(act_itfc);
         return static_pointer_cast<MentsCNode>(new_child);
     }
 
-    bool MentsDNode::has_child_node(shared_ptr<const Action> action) const {
-        return ThtsDNode::has_child_node_itfc(static_pointer_cast<const Action>(action));
+    bool MentsDNode::has_child_node(const shared_ptr<const Action>& action) const {
+        return ThtsDNode::has_child_node_itfc(action);
     }
 
-    shared_ptr<MentsCNode> MentsDNode::get_child_node(shared_ptr<const Action> action) const {
+    shared_ptr<MentsCNode> MentsDNode::get_child_node(const shared_ptr<const Action>& action) const {
         shared_ptr<const Action> act_itfc = static_pointer_cast<const Action>(action);
         shared_ptr<ThtsCNode> new_child = ThtsDNode::get_child_node_itfc(act_itfc);
         return static_pointer_cast<MentsCNode>(new_child);
@@ -426,8 +703,8 @@ namespace thts {
     }
 
     void MentsDNode::backup_itfc(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -441,7 +718,7 @@ namespace thts {
             ctx_itfc);
     }
 
-    shared_ptr<ThtsCNode> MentsDNode::create_child_node_helper_itfc(shared_ptr<const Action> action) const {
+    shared_ptr<ThtsCNode> MentsDNode::create_child_node_helper_itfc(const shared_ptr<const Action>& action) const {
         shared_ptr<const Action> act_itfc = static_pointer_cast<const Action>(action);
         shared_ptr<MentsCNode> child_node = create_child_node_helper(act_itfc);
         return static_pointer_cast<ThtsCNode>(child_node);
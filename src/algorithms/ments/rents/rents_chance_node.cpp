@@ -27,10 +27,10 @@ namespace thts {
      * Make child node
      */
     shared_ptr<RentsDNode> RentsCNode::create_child_node_helper(
-        shared_ptr<const State> observation, shared_ptr<const State> next_state) const 
+        const shared_ptr<const State>& observation, const shared_ptr<const State>& next_state) const 
     {  
         shared_ptr<const State> mdp_next_state = static_pointer_cast<const State>(observation);
-        return make_shared<RentsDNode>(
+        return thts_manager->make_node<RentsDNode>(
             static_pointer_cast<MentsManager>(thts_manager), 
             mdp_next_state,
             decision_depth+1, 
@@ -44,7 +44,7 @@ namespace thts {
  */
 namespace thts {
     shared_ptr<ThtsDNode> RentsCNode::create_child_node_helper_itfc(
-        shared_ptr<const Observation> observation, shared_ptr<const State> next_state) const 
+        const shared_ptr<const Observation>& observation, const shared_ptr<const State>& next_state) const 
     {
         shared_ptr<const State> obsv_itfc = static_pointer_cast<const State>(observation);
         shared_ptr<const State> next_state_itfc = static_pointer_cast<const State>(next_state);
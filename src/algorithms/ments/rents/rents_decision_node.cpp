@@ -10,6 +10,13 @@ using namespace std;
 
 static double EPS = 1e-16;
 
+/**
+ * Cache of the distribution slots, indexed by decision depth (see 'RentsDNode::get_distr_slot').
+ */
+namespace {
+    thread_local vector<thts::ThtsEnvContextSlot<thts::RentsActionDistr>> distr_slots_cache;
+}
+
 namespace thts {
     RentsDNode::RentsDNode(
         shared_ptr<MentsManager> thts_manager,
@@ -22,49 +29,74 @@ namespace thts {
                 state,
                 decision_depth,
                 decision_timestep,
-                static_pointer_cast<const MentsCNode>(parent))
+                static_pointer_cast<const MentsCNode>(parent)),
+            parent_actions_id(nullptr),
+            parent_action_indices()
     {
-        stringstream ss_n;
-        ss_n << "d_" << decision_depth;
-        _node_distr_key = ss_n.str();
-
+        _node_distr_slot = get_distr_slot(decision_depth);
         if (decision_depth > 0) {
-            stringstream ss_p;
-            ss_p << "d_" << decision_depth-1;
-            _parent_distr_key = ss_p.str();
+            _parent_distr_slot = get_distr_slot(decision_depth-1);
         }
     }
 
+    /**
+     * Registers (or looks up) the slot for 'decision_depth' the first time that each thread needs it, and then reads 
+     * it from the thread local cache. Only called when nodes are constructed, so that visits don't need to build or 
+     * hash any keys.
+     */
+    ThtsEnvContextSlot<RentsActionDistr> RentsDNode::get_distr_slot(int decision_depth) {
+        vector<ThtsEnvContextSlot<RentsActionDistr>>& slots_cache = distr_slots_cache;
+        size_t depth = (size_t) decision_depth;
+        if (depth >= slots_cache.size()) {
+            slots_cache.resize(depth+1);
+        }
+        if (!slots_cache[depth].is_valid()) {
+            stringstream ss;
+            ss << "rents_distr_d_" << decision_depth;
+            slots_cache[depth] = ThtsEnvContext::register_slot<RentsActionDistr>(ss.str());
+        }
+        return slots_cache[depth];
+    }
+
     /**
      * Gets the action distribution for a parent node 
      * Or just null pointer if we're the root node
     */
-    shared_ptr<ActionDistr> RentsDNode::get_parent_distr_from_context(ThtsEnvContext& ctx) const {
+    const RentsActionDistr* RentsDNode::get_parent_distr_from_context(ThtsEnvContext& ctx) const {
         if (decision_depth < 1) return nullptr;
-        return ctx.get_value_ptr<ActionDistr>(_parent_distr_key);
+        return ctx.get_inline_value_ptr(_parent_distr_slot);
     }
 
     /**
-     * Puts the action distribution for this node into the thts env context
+     * Checks the parent's action at the same index first (parents and children often have the same actions in the 
+     * same order), and otherwise searches the parent's actions. Only called when the cached indices are stale.
     */
-    void RentsDNode::put_node_distr_in_context(shared_ptr<ActionDistr> action_distr, ThtsEnvContext& ctx) const {
-        ctx.put_value(_node_distr_key, action_distr);
-    }
+    const vector<size_t>& RentsDNode::get_parent_action_indices(const RentsActionDistr& parent_distr) const {
+        if (parent_distr.actions_id == parent_actions_id 
+            && parent_action_indices.size() == actions->size() 
+            && parent_action_indices.size() <= parent_distr.actions.size()) 
+        {
+            return parent_action_indices;
+        }
 
-    /**
-    * Get prob from parent distribution (handling boundary cases at the root node and when parent didn't have the 
-    * action passed in as an option).
-    * 
-    * Just returns the value stored in the distribution.
-    * If the action is not in the distribution return 0.0
-    * If the distribution is nullptr (then we are root node) and return 1.0 so can compute normal ments distr.
-    */
-    double RentsDNode::get_parent_action_prob(
-        shared_ptr<ActionDistr> parent_distr, shared_ptr<const Action> action) const 
-    {
-        if (parent_distr == nullptr) return 1.0;
-        if (parent_distr->find(action) == parent_distr->end()) return 0.0;
-        return parent_distr->at(action);
+        parent_actions_id = parent_distr.actions_id;
+        parent_action_indices.resize(actions->size());
+        const vector<const Action*>& parent_actions = parent_distr.actions;
+        for (size_t i=0; i<actions->size(); i++) {
+            const Action& action = *(*actions)[i];
+            parent_action_indices[i] = npos;
+            if (i < parent_actions.size() && action.equals_using_cached_hash(*parent_actions[i])) {
+                parent_action_indices[i] = i;
+                continue;
+            }
+            for (size_t j=0; j<parent_actions.size(); j++) {
+                if (action.equals_using_cached_hash(*parent_actions[j])) {
+                    parent_action_indices[i] = j;
+                    break;
+                }
+            }
+        }
+        return parent_action_indices;
     }
 
     /**
@@ -73,63 +105,78 @@ namespace thts {
      * Computes the distribution from the paper 
      * Paper: http://proceedings.mlr.press/v139/dam21a/dam21a.pdf
      * 
-     * Multiplies weights from parent decision node into weights for actions at this node.
+     * Multiplies weights from parent decision node into the (ments) boltzmann weights for actions at this node.
      */
     void RentsDNode::compute_action_weights(
-        ActionDistr& action_weights, 
+        vector<double>& action_weights, 
         double& sum_action_weights, 
         double& normalisation_term, 
         ThtsEnvContext& context) const
     {
-        // get temp
-        double opp_coeff = is_opponent() ? -1.0 : 1.0;
-        double temp = get_temp();
-
-        // compute normalisation term
-        normalisation_term = numeric_limits<double>::lowest();
-        for (shared_ptr<const Action> action : *actions) {
-            double q_value_over_temp = get_soft_q_value(action,opp_coeff) / temp;
-            if (normalisation_term < q_value_over_temp) {
-                normalisation_term = q_value_over_temp;
+        // compute boltzmann weights
+        MentsDNode::compute_action_weights(action_weights, sum_action_weights, normalisation_term, context);
+
+        // Get parent distribution (nullptr at the root node, where the normal ments distribution is used)
+        const RentsActionDistr* parent_distr = get_parent_distr_from_context(context);
+
+        // multiply in parent action probabilities (zero if the parent didn't have the action)
+        if (parent_distr != nullptr) {
+            const vector<size_t>& parent_indices = get_parent_action_indices(*parent_distr);
+            sum_action_weights = 0.0;
+            for (size_t i=0; i<actions->size(); i++) {
+                size_t parent_index = parent_indices[i];
+                action_weights[i] *= (parent_index == npos) ? 0.0 : parent_distr->probs[parent_index];
+                sum_action_weights += action_weights[i];
             }
         }
-
-        // Get parent distribution
-        shared_ptr<ActionDistr> parent_distr = get_parent_distr_from_context(context);
-
-        // compute action weights
-        sum_action_weights = 0.0;
-        for (shared_ptr<const Action> action : *actions) {
-            double soft_q_value = get_soft_q_value(action,opp_coeff);
-            double action_weight = exp((soft_q_value/temp) - normalisation_term);
-            action_weight *= get_parent_action_prob(parent_distr, action);
-            action_weights[action] = action_weight;
-            sum_action_weights += action_weight;
-        }
         
         // If all action weights extremely small, then just make it uniform random, for numerical stability
         if (sum_action_weights < EPS) {
             double uniform_weight = 1.0 / actions->size();
-            for (shared_ptr<const Action> action : *actions) {
-                action_weights[action] = uniform_weight;
+            for (double& weight : action_weights) {
+                weight = uniform_weight;
             }
             sum_action_weights = 1.0;
         }
     }
 
+    /**
+     * Incremental soft backups only account for changes in child values, not in the parent distribution.
+     */
+    bool RentsDNode::supports_incremental_soft_backup() const {
+        return false;
+    }
+
     /**
      * Implements selct action for rents
      * 
-     * - Computes the action distribution.
-     * - Stores the distribution in the context
-     * - Samples an action
+     * - Computes the (dense) action distribution, directly into this node's inline slot in the context
+     * - Samples an action (from a copy of the distribution in 'action_values_buffer' with virtual loss applied, if 
+     *      using virtual loss, so that the virtual loss is not used in the child's distribution)
      * - Creates the node if it doesn't exist already
+     * 
+     * The context is recycled between trials, so once the slot's buffers have grown this doesn't allocate.
      */
     shared_ptr<const Action> RentsDNode::select_action_rents(ThtsEnvContext& ctx) {
-        shared_ptr<ActionDistr> action_distr = make_shared<ActionDistr>();
-        compute_action_distribution(*action_distr, ctx);
-        put_node_distr_in_context(action_distr, ctx);
-        shared_ptr<const Action> selected_action = helper::sample_from_distribution(*action_distr, *thts_manager);
+        RentsActionDistr& action_distr = ctx.emplace_inline_value(_node_distr_slot);
+        action_distr.actions_id = actions.get();
+        action_distr.actions.resize(actions->size());
+        for (size_t i=0; i<actions->size(); i++) {
+            action_distr.actions[i] = (*actions)[i].get();
+        }
+        compute_action_distribution(action_distr.probs, ctx);
+
+        const vector<double>* sample_probs = &action_distr.probs;
+        MentsManager& manager = (MentsManager&) *thts_manager;
+        if (manager.virtual_loss > 0.0) {
+            action_values_buffer = action_distr.probs;
+            if (apply_virtual_loss(action_values_buffer)) {
+                sample_probs = &action_values_buffer;
+            }
+        }
+
+        int selected_index = helper::sample_index_from_weights(*sample_probs, *thts_manager);
+        shared_ptr<const Action> selected_action = (*actions)[selected_index];
         if (!has_child_node(selected_action)) {
             create_child_node(selected_action);
         }
@@ -146,8 +193,8 @@ namespace thts {
     /**
      * Make child node
      */
-    shared_ptr<RentsCNode> RentsDNode::create_child_node_helper(shared_ptr<const Action> action) const {
-        return make_shared<RentsCNode>(
+    shared_ptr<RentsCNode> RentsDNode::create_child_node_helper(const shared_ptr<const Action>& action) const {
+        return thts_manager->make_node<RentsCNode>(
             static_pointer_cast<MentsManager>(thts_manager), 
             state, 
             action, 
@@ -163,7 +210,7 @@ namespace thts {
  * Boilerplate ThtsDNode interface implementation. Copied from thts_decision_node_template.h.
  */
 namespace thts {
-    shared_ptr<ThtsCNode> RentsDNode::create_child_node_helper_itfc(shared_ptr<const Action> action) const {
+    shared_ptr<ThtsCNode> RentsDNode::create_child_node_helper_itfc(const shared_ptr<const Action>& action) const {
         shared_ptr<const Action> act_itfc = static_pointer_cast<const Action>(action);
         shared_ptr<RentsCNode> child_node = create_child_node_helper(act_itfc);
         return static_pointer_cast<ThtsCNode>(child_node);
@@ -30,7 +30,7 @@ namespace thts {
                 decision_timestep,
                 static_pointer_cast<const MentsCNode>(parent))
     {
-        for (shared_ptr<const Action> action : *actions) {
+        for (const shared_ptr<const Action>& action : *actions) {
             double qval = get_soft_q_value_over_temp(action);
             qval_to_act.insert(make_pair(qval, action));
             act_to_qval.insert_or_assign(action, qval);
@@ -44,16 +44,16 @@ namespace thts {
     /**
      * Get the value of Q(s,a)/temp from the best available source (see ments get_soft_q_value, tries child, then prior)
     */
-    double TentsDNode::get_soft_q_value_over_temp(shared_ptr<const Action> action) const {
+    double TentsDNode::get_soft_q_value_over_temp(const shared_ptr<const Action>& action, size_t position_hint) const {
         double opp_coeff = is_opponent() ? -1.0 : 1.0;
-        double qval = get_soft_q_value(action, opp_coeff);
+        double qval = get_soft_q_value(action, opp_coeff, position_hint);
         return qval / get_temp();
     }
 
     /**
      * Updates the tents mapping for 'action' to/from 'neq_q_value'
     */
-    void TentsDNode::update_maps(shared_ptr<const Action> action, double new_q_value) {
+    void TentsDNode::update_maps(const shared_ptr<const Action>& action, double new_q_value) {
         double old_q_value = act_to_qval[action];
         act_to_qval.erase(action);
         for (auto it=qval_to_act.find(old_q_value); it != qval_to_act.end(); it++) {
@@ -100,13 +100,13 @@ namespace thts {
         unique_ptr<ActionVector> sparse_action_set = get_sparse_action_set();
 
         double sum_sparse_values = 0.0;
-        for (shared_ptr<const Action> action : *sparse_action_set) {
+        for (const shared_ptr<const Action>& action : *sparse_action_set) {
             sum_sparse_values += act_to_qval.at(action);
         }
 
         double spmax_common_term = 0.5 * pow(sum_sparse_values-1.0, 2.0) / pow(sparse_action_set->size(), 2.0);
         double spmax = 0.5;
-        for (shared_ptr<const Action> action : *sparse_action_set) {
+        for (const shared_ptr<const Action>& action : *sparse_action_set) {
             double action_val = act_to_qval.at(action);
             spmax += pow(action_val, 2.0) / 2.0 - spmax_common_term;
         }
@@ -120,10 +120,11 @@ namespace thts {
      * Computes the distribution according to the paper:
      * http://proceedings.mlr.press/v139/dam21a/dam21a.pdf
      * 
-     * N.B. ments locks children around calling this, so have lock on children
+     * N.B. children are not locked around calling this, which is fine as this only reads the q-values cached in this 
+     * node ('qval_to_act'), which are protected by this nodes lock.
      */
     void TentsDNode::compute_action_weights(
-        ActionDistr& action_weights, 
+        vector<double>& action_weights, 
         double& sum_action_weights, 
         double& normalisation_term, 
         ThtsEnvContext& context) const
@@ -134,24 +135,25 @@ namespace thts {
         // compute the common term
         unique_ptr<ActionVector> sparse_action_set = get_sparse_action_set();
         double sum_sparse_values = 0.0;
-        for (shared_ptr<const Action> action : *sparse_action_set) {
+        for (const shared_ptr<const Action>& action : *sparse_action_set) {
             sum_sparse_values += get_soft_q_value_over_temp(action);
         }
         double common_term = (sum_sparse_values - 1.0) / sparse_action_set->size();
 
         // compute weights and store
-        for (shared_ptr<const Action> action : *actions) {
-            double weight = get_soft_q_value_over_temp(action) - common_term;
+        action_weights.resize(actions->size());
+        for (size_t i=0; i<actions->size(); i++) {
+            double weight = get_soft_q_value_over_temp((*actions)[i], i) - common_term;
             if (weight < 0.0) weight = 0.0;
-            action_weights[action] = weight;
+            action_weights[i] = weight;
             sum_action_weights += weight;
         }
         
         // If all action weights extremely small, then just make it uniform random, for numerical stability
         if (sum_action_weights < EPS) {
             double uniform_weight = 1.0 / actions->size();
-            for (shared_ptr<const Action> action : *actions) {
-                action_weights[action] = uniform_weight;
+            for (double& weight : action_weights) {
+                weight = uniform_weight;
             }
             sum_action_weights = 1.0;
         }
@@ -174,17 +176,7 @@ namespace thts {
     */
    void TentsDNode::backup_update_map(ThtsEnvContext& ctx) {
         shared_ptr<const Action> selected_action = ctx.get_value_ptr_const<Action>(_selected_action_key);
-        double new_q_value;
-
-        if (has_child_node(selected_action)) {
-            ThtsCNode& child_node = *get_child_node(selected_action);
-            child_node.lock();
-            new_q_value = get_soft_q_value_over_temp(selected_action);
-            child_node.unlock();
-        } else {
-            new_q_value = get_soft_q_value_over_temp(selected_action);
-        }
-
+        double new_q_value = get_soft_q_value_over_temp(selected_action);
         update_maps(selected_action, new_q_value);
    }
 
@@ -208,8 +200,8 @@ namespace thts {
      * Calls the ments implementation of backup, performing soft backup
      */
     void TentsDNode::backup(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -220,8 +212,8 @@ namespace thts {
     /**
      * Make child node
      */
-    shared_ptr<TentsCNode> TentsDNode::create_child_node_helper(shared_ptr<const Action> action) const {
-        return make_shared<TentsCNode>(
+    shared_ptr<TentsCNode> TentsDNode::create_child_node_helper(const shared_ptr<const Action>& action) const {
+        return thts_manager->make_node<TentsCNode>(
             static_pointer_cast<MentsManager>(thts_manager), 
             state, 
             action, 
@@ -238,7 +230,7 @@ namespace thts {
  */
 namespace thts {
 
-    shared_ptr<ThtsCNode> TentsDNode::create_child_node_helper_itfc(shared_ptr<const Action> action) const {
+    shared_ptr<ThtsCNode> TentsDNode::create_child_node_helper_itfc(const shared_ptr<const Action>& action) const {
         shared_ptr<const Action> act_itfc = static_pointer_cast<const Action>(action);
         shared_ptr<TentsCNode> child_node = create_child_node_helper(act_itfc);
         return static_pointer_cast<ThtsCNode>(child_node);
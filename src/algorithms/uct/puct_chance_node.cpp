@@ -20,10 +20,10 @@ namespace thts {
     /**
      * Make a new PuctDNode on the heap, with correct arguments for a child node.
      */
-    shared_ptr<PuctDNode> PuctCNode::create_child_node_helper(shared_ptr<const State> observation) const
+    shared_ptr<PuctDNode> PuctCNode::create_child_node_helper(const shared_ptr<const State>& observation) const
     {
         shared_ptr<const State> next_state = static_pointer_cast<const State>(observation);
-        return make_shared<PuctDNode>(
+        return thts_manager->make_node<PuctDNode>(
             static_pointer_cast<PuctManager>(thts_manager), 
             next_state,
             decision_depth+1, 
@@ -35,7 +35,7 @@ namespace thts {
      * Make create_child functions make a Puct child rather than a UctCNode or ThtsCNode
      */
     shared_ptr<ThtsDNode> PuctCNode::create_child_node_helper_itfc(
-        shared_ptr<const Observation> observation, shared_ptr<const State> next_state) const 
+        const shared_ptr<const Observation>& observation, const shared_ptr<const State>& next_state) const 
     {
         shared_ptr<const State> obsv_itfc = static_pointer_cast<const State>(observation);
         shared_ptr<PuctDNode> child_node = create_child_node_helper(obsv_itfc);
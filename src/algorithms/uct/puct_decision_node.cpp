@@ -22,20 +22,33 @@ namespace thts {
      * Computes the ucb term used in action selection. I.e. sqrt(log N(s) / N(s,a)).
      */
     double PuctDNode::compute_ucb_term(int num_visits, int child_visits) const {
-        shared_ptr<PuctManager> manager = static_pointer_cast<PuctManager>(thts_manager);
+        PuctManager& manager = (PuctManager&) *thts_manager;
         double num_visits_d = (num_visits > 0) ? (double)num_visits : 1.0;
         double child_visits_d = (child_visits > 0) ? (double)child_visits : 1.0;
-        if (manager->puct_power != 0.5) {
-            return pow(num_visits_d, manager->puct_power) / child_visits_d;
+        if (manager.puct_power != 0.5) {
+            return pow(num_visits_d, manager.puct_power) / child_visits_d;
         }
         return sqrt(num_visits_d) / child_visits_d;
     }
+
+    /**
+     * The puct term is N(s)^puct_power / N(s,a).
+     */
+    double PuctDNode::compute_ucb_term_coeff(int num_visits, UcbVisitsScaling& scaling) const {
+        PuctManager& manager = (PuctManager&) *thts_manager;
+        scaling = UcbVisitsScaling::inv;
+        double num_visits_d = (num_visits > 0) ? (double)num_visits : 1.0;
+        if (manager.puct_power != 0.5) {
+            return pow(num_visits_d, manager.puct_power);
+        }
+        return sqrt(num_visits_d);
+    }
     
     /**
      * Make a new PuctCNode on the heap, with correct arguments for a child node.
      */
-    shared_ptr<PuctCNode> PuctDNode::create_child_node_helper(shared_ptr<const Action> action) const {
-        return make_shared<PuctCNode>(
+    shared_ptr<PuctCNode> PuctDNode::create_child_node_helper(const shared_ptr<const Action>& action) const {
+        return thts_manager->make_node<PuctCNode>(
             static_pointer_cast<PuctManager>(thts_manager), 
             state, 
             action, 
@@ -47,7 +60,7 @@ namespace thts {
     /**
      * Make create_child functions make a Puct child rather than a UctCNode or ThtsCNode
      */
-    shared_ptr<ThtsCNode> PuctDNode::create_child_node_helper_itfc(shared_ptr<const Action> action) const {
+    shared_ptr<ThtsCNode> PuctDNode::create_child_node_helper_itfc(const shared_ptr<const Action>& action) const {
         shared_ptr<PuctCNode> child_node = create_child_node_helper(action);
         return static_pointer_cast<ThtsCNode>(child_node);
     }
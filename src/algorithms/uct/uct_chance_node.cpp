@@ -1,5 +1,6 @@
 #include "algorithms/uct/uct_chance_node.h"
 
+#include "algorithms/common/progressive_widening.h"
 #include "helper_templates.h"
 
 using namespace std; 
@@ -24,7 +25,10 @@ namespace thts {
                 static_pointer_cast<const ThtsDNode>(parent)),
             num_backups(0),
             avg_return(0.0),
-            next_state_distr(thts_manager->thts_env->get_transition_distribution_itfc(state,action))
+            next_state_distr(
+                thts_manager->use_generative_model ? 
+                    nullptr : thts_manager->thts_env->get_transition_distribution_itfc(state,action)),
+            next_state_sampler(next_state_distr, true)
     {  
     }
 
@@ -36,10 +40,28 @@ namespace thts {
     }
 
     /**
-     * Implementation of sample_observation, that uses the sample from distribution helper function.
+     * Implementation of sample_observation, that samples from the alias table in O(1) time, or samples from the 
+     * environment directly if using it as a generative model. 
+     * 
+     * If using progressive widening on chance nodes, and this node already has as many children as the widening 
+     * limit allows, then an existing child is sampled instead (in proportion to child visit counts).
      */
     shared_ptr<const State> UctCNode::sample_observation_random() {
-        shared_ptr<const State> sampled_state = helper::sample_from_distribution(*next_state_distr, *thts_manager);
+        UctManager& manager = (UctManager&) *thts_manager;
+        if (manager.use_chance_progressive_widening && get_num_children() > 0) {
+            int limit = compute_progressive_widening_limit(
+                num_visits, manager.chance_progressive_widening_coeff, manager.chance_progressive_widening_exponent);
+            if (get_num_children() >= limit) {
+                return static_pointer_cast<const State>(sample_existing_child_observation(children, manager));
+            }
+        }
+
+        shared_ptr<const State> sampled_state;
+        if (next_state_distr == nullptr) {
+            sampled_state = thts_manager->thts_env->sample_transition_distribution_itfc(state, action, *thts_manager);
+        } else {
+            sampled_state = next_state_sampler.sample(*thts_manager);
+        }
         if (!has_child_node(sampled_state)) {
             create_child_node(sampled_state);
         }
@@ -65,8 +87,8 @@ namespace thts {
      * Calls the running average return backup function.
      */
     void UctCNode::backup(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -77,10 +99,10 @@ namespace thts {
     /**
      * Make a new UctDNode on the heap, with correct arguments for a child node.
      */
-    shared_ptr<UctDNode> UctCNode::create_child_node_helper(shared_ptr<const State> observation) const
+    shared_ptr<UctDNode> UctCNode::create_child_node_helper(const shared_ptr<const State>& observation) const
     {
         shared_ptr<const State> next_state = static_pointer_cast<const State>(observation);
-        return make_shared<UctDNode>(
+        return thts_manager->make_node<UctDNode>(
             static_pointer_cast<UctManager>(thts_manager), 
             next_state,
             decision_depth+1, 
@@ -103,18 +125,18 @@ namespace thts {
  * All this code basically calls the corresponding base implementation function, with approprtiate casts before/after.
  */
 namespace thts {
-    shared_ptr<UctDNode> UctCNode::create_child_node(shared_ptr<const State> observation) 
+    shared_ptr<UctDNode> UctCNode::create_child_node(const shared_ptr<const State>& observation) 
     {
         shared_ptr<const Observation> obsv_itfc = static_pointer_cast<const Observation>(observation);
         shared_ptr<ThtsDNode> new_child = ThtsCNode::create_child_node_itfc(obsv_itfc);
         return static_pointer_cast<UctDNode>(new_child);
     }
 
-    bool UctCNode::has_child_node(std::shared_ptr<const State> observation) const {
+    bool UctCNode::has_child_node(const std::shared_ptr<const State>& observation) const {
         return ThtsCNode::has_child_node_itfc(static_pointer_cast<const Observation>(observation));
     }
     
-    shared_ptr<UctDNode> UctCNode::get_child_node(shared_ptr<const State> observation) const {
+    shared_ptr<UctDNode> UctCNode::get_child_node(const shared_ptr<const State>& observation) const {
         shared_ptr<const Observation> obsv_itfc = static_pointer_cast<const Observation>(observation);
         shared_ptr<ThtsDNode> new_child = ThtsCNode::get_child_node_itfc(obsv_itfc);
         return static_pointer_cast<UctDNode>(new_child);
@@ -137,8 +159,8 @@ namespace thts {
     }
 
     void UctCNode::backup_itfc(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -153,7 +175,7 @@ namespace thts {
     }
 
     shared_ptr<ThtsDNode> UctCNode::create_child_node_helper_itfc(
-        shared_ptr<const Observation> observation, shared_ptr<const State> next_state) const 
+        const shared_ptr<const Observation>& observation, const shared_ptr<const State>& next_state) const 
     {
         shared_ptr<const State> obsv_itfc = static_pointer_cast<const State>(observation);
         shared_ptr<UctDNode> child_node = create_child_node_helper(obsv_itfc);
@@ -1,7 +1,9 @@
 #include "algorithms/uct/uct_decision_node.h"
 
+#include "algorithms/common/progressive_widening.h"
 #include "helper_templates.h"
 
+#include <algorithm>
 #include <cmath>
 #include <float.h>
 #include <sstream>
@@ -14,7 +16,10 @@ namespace thts {
      * Constructor, inits members. 
      * 
      * If we have a heuristic function, then initialises 'num_visits' and 'avg_return' according to the heuristic in 
-     * the manager. If we have a prior function, then
+     * the manager. If we have a prior function, then gets the prior for this node.
+     * 
+     * If using progressive widening, then 'actions' starts with the first action(s) in the widening order, and 
+     * 'children' and 'dense_policy_prior' are extended as actions are admitted.
      */
     UctDNode::UctDNode(
         shared_ptr<UctManager> thts_manager,
@@ -31,16 +36,56 @@ namespace thts {
             num_backups(0),
             avg_return(0.0),
             actions(thts_manager->thts_env->get_valid_actions_itfc(state)),
-            policy_prior() 
+            policy_prior(),
+            dense_policy_prior(),
+            ucb_values_buffer(),
+            child_visits_buffer(),
+            widening_actions()
     {   
-        if (thts_manager->heuristic_fn != nullptr) {
+        if (thts_manager->has_heuristic_fn()) {
             num_visits = thts_manager->heuristic_psuedo_trials;
             num_backups = thts_manager->heuristic_psuedo_trials;
             avg_return = heuristic_value;
         }
 
-        if (thts_manager->prior_fn != nullptr) {
-            policy_prior = thts_manager->prior_fn(state, thts_manager->thts_env);
+        if (thts_manager->has_prior_fn()) {
+            policy_prior = compute_policy_prior();
+        }
+
+        if (thts_manager->use_progressive_widening) {
+            widening_actions = get_progressive_widening_action_order(*actions, policy_prior, *thts_manager);
+            actions = make_shared<ActionVector>();
+            widen_actions();
+            return;
+        }
+
+        children.reserve_keys(*actions);
+        if (policy_prior != nullptr) {
+            dense_policy_prior.reserve(actions->size());
+            for (const shared_ptr<const Action>& action : *actions) {
+                dense_policy_prior.push_back(policy_prior->at(action));
+            }
+        }
+    }
+
+    /**
+     * Appends actions to 'actions' (reserving their slots in 'children', so that children can still be looked up by 
+     * position in 'actions'), and their prior probabilities to 'dense_policy_prior'.
+     */
+    void UctDNode::widen_actions() {
+        if (widening_actions == nullptr) return;
+
+        UctManager& manager = (UctManager&) *thts_manager;
+        size_t limit = compute_progressive_widening_limit(
+            num_visits, manager.progressive_widening_coeff, manager.progressive_widening_exponent);
+        limit = min(limit, widening_actions->size());
+        while (actions->size() < limit) {
+            const shared_ptr<const Action>& action = (*widening_actions)[actions->size()];
+            actions->push_back(action);
+            children.reserve_key(action);
+            if (policy_prior != nullptr) {
+                dense_policy_prior.push_back(policy_prior->at(action));
+            }
         }
     }
     
@@ -51,14 +96,16 @@ namespace thts {
      */
     bool UctDNode::has_prior() const {
         UctManager& manager = *static_pointer_cast<UctManager>(thts_manager);
-        return manager.prior_fn != nullptr;
+        return manager.has_prior_fn();
     }
 
     /**
-     * Visit just needs to call base implmentation in ThtsDNode: increments num_visits
+     * Visit just needs to call base implmentation in ThtsDNode: increments num_visits, and then admits any new actions 
+     * if using progressive widening.
      */
     void UctDNode::visit(ThtsEnvContext& ctx) {
         ThtsDNode::visit_itfc(ctx);
+        widen_actions();
     }
 
     /**
@@ -88,47 +135,114 @@ namespace thts {
      * minimise the value, so we use the value of form (where opp_coeff is -1 or 1):
      *      opp_coeff * q_value + prior(action) * bias * ucb_term
      * 
-     * TODO: Consider fine grained locking if want to optimise. Probably don't need bias and values to be held super 
-     *      consistent throughout function.
+     * If using a virtual loss, then each of the 'k' trials currently running through a child is treated as if it had 
+     * been backed up with a return 'virtual_loss' worse than the childs current average (from the perspective of the 
+     * agent acting at this node). So with 'n' backups, the childs value is lowered by: 
+     *      virtual_loss * k / (n + k)
+     * N.B. 'num_visits' is incremented in the selection phase, so the ucb_term already accounts for the 'virtual 
+     * visits' of running trials.
+     * 
+     * Children are looked up by position in 'actions' (see FlatChildMap::find), to avoid hashing actions.
+     * 
+     * Children are not locked, as child statistics are RelaxedAtomics that can be read lock free (see RelaxedAtomic).
      */
     void UctDNode::fill_ucb_values(unordered_map<shared_ptr<const Action>,double>& ucb_values, ThtsEnvContext& ctx) const {
-        shared_ptr<UctManager> manager = static_pointer_cast<UctManager>(thts_manager);
+        UctManager& manager = (UctManager&) *thts_manager;
         double opp_coeff = is_opponent() ? -1.0 : 1.0;
 
-        // Lock all children
-        lock_all_children();
-
         // Compute adaptive bias if using
-        double bias = manager->bias; 
+        double bias = manager.bias; 
         if (bias == UctManager::USE_AUTO_BIAS) {
             bias = UctManager::AUTO_BIAS_MIN_BIAS;
-            for (shared_ptr<const Action> action : *actions) {
-                if (!has_child_node(action)) continue;
-                double child_abs_val = abs(get_child_node(action)->avg_return);
+            for (const pair<const shared_ptr<const Action>,shared_ptr<ThtsCNode>>& pr : children) {
+                double child_abs_val = abs(((UctCNode&) *pr.second).avg_return);
                 if (child_abs_val > bias) bias = child_abs_val;
             }
         }
 
         // Compute usb values
-        for (shared_ptr<const Action> action : *actions) {
-            double action_ucb_value = 0.0;
+        for (size_t i=0; i<actions->size(); i++) {
+            const shared_ptr<const Action>& action = (*actions)[i];
+            auto child_iter = children.find(action, i);
+            UctCNode* child = (child_iter != children.end()) ? (UctCNode*) child_iter->second.get() : nullptr;
 
-            int child_visits = (has_child_node(action)) ? get_child_node(action)->num_visits : 0;
+            double action_ucb_value = 0.0;
+            int child_visits = (child != nullptr) ? child->num_visits.load() : 0;
             action_ucb_value += compute_ucb_term(num_visits, child_visits);
             action_ucb_value *= bias;
             if (has_prior()) {
                 action_ucb_value *= policy_prior->at(action);
             }
             
-            if (has_child_node(action)) {
-                action_ucb_value += opp_coeff * get_child_node(action)->avg_return;
+            if (child != nullptr) {
+                action_ucb_value += opp_coeff * child->avg_return.load();
+
+                int child_virtual_losses = child->get_num_virtual_losses();
+                if (child_virtual_losses > 0) {
+                    double num_provisional_backups = child->num_backups.load() + child_virtual_losses;
+                    action_ucb_value -= manager.virtual_loss * child_virtual_losses / num_provisional_backups;
+                }
             }
 
             ucb_values[action] = action_ucb_value;
         }  
+    }
+
+    /**
+     * The ucb term is sqrt(log N(s) / N(s,a)) = sqrt(log N(s)) / sqrt(N(s,a)).
+     */
+    double UctDNode::compute_ucb_term_coeff(int num_visits, UcbVisitsScaling& scaling) const {
+        scaling = UcbVisitsScaling::inv_sqrt;
+        double num_visits_d = (num_visits > 0) ? (double)num_visits : 1.0;
+        return sqrt(log(num_visits_d));
+    }
 
-        // unlock all children
-        unlock_all_children();      
+    /**
+     * Computes the same values as 'fill_ucb_values' (see above). 
+     * 
+     * The first pass over actions reads the child statistics (and the adaptive bias) and writes 
+     * 'opp_coeff * q_value - virtual_loss_term' and the child visit counts into contiguous arrays. Then the kernel adds 
+     * 'bias * prior(action) * ucb_term' to every value, where the log in the ucb term is only computed once.
+     */
+    void UctDNode::fill_dense_ucb_values(
+        vector<double>& ucb_values, vector<double>& child_visits, ThtsEnvContext& ctx) const 
+    {
+        UctManager& manager = (UctManager&) *thts_manager;
+        double opp_coeff = is_opponent() ? -1.0 : 1.0;
+        bool use_auto_bias = (manager.bias == UctManager::USE_AUTO_BIAS);
+        double bias = use_auto_bias ? UctManager::AUTO_BIAS_MIN_BIAS : manager.bias;
+
+        // Gather child statistics
+        size_t num_actions = actions->size();
+        ucb_values.resize(num_actions);
+        child_visits.resize(num_actions);
+        for (size_t i=0; i<num_actions; i++) {
+            auto child_iter = children.find((*actions)[i], i);
+            if (child_iter == children.end()) {
+                ucb_values[i] = 0.0;
+                child_visits[i] = 0.0;
+                continue;
+            }
+
+            UctCNode& child = (UctCNode&) *child_iter->second;
+            double child_avg_return = child.avg_return.load();
+            if (use_auto_bias && abs(child_avg_return) > bias) bias = abs(child_avg_return);
+
+            double value = opp_coeff * child_avg_return;
+            int child_virtual_losses = child.get_num_virtual_losses();
+            if (child_virtual_losses > 0) {
+                double num_provisional_backups = child.num_backups.load() + child_virtual_losses;
+                value -= manager.virtual_loss * child_virtual_losses / num_provisional_backups;
+            }
+            ucb_values[i] = value;
+            child_visits[i] = child.num_visits.load();
+        }
+
+        // Add exploration terms
+        UcbVisitsScaling scaling;
+        double coeff = bias * compute_ucb_term_coeff(num_visits, scaling);
+        const double* weights = has_prior() ? dense_policy_prior.data() : nullptr;
+        add_ucb_exploration_terms(ucb_values.data(), child_visits.data(), weights, num_actions, coeff, scaling);
     }
 
     /**
@@ -137,14 +251,17 @@ namespace thts {
      * If we have a policy prior, just go ahead and compute a ucb value for all actions, and pick the best. 
      * 
      * Otherwise we do standard UCB, by 'pulling each arm' (action) once first.
+     * 
+     * Ucb values are computed densely with 'fill_dense_ucb_values' if 'use_dense_ucb_values' is set in the manager, 
+     * and otherwise with 'fill_ucb_values'.
      */
     shared_ptr<const Action> UctDNode::select_action_ucb(ThtsEnvContext& ctx) {
         // Pull uninitialised arms if needed
-        if (!has_prior()) {
+        if (!has_prior() && children.size() < actions->size()) {
             vector<shared_ptr<const Action>> actions_yet_to_try;
-            for (shared_ptr<const Action> action : *actions) {
-                if (!has_child_node(action)) {
-                    actions_yet_to_try.push_back(action);
+            for (size_t i=0; i<actions->size(); i++) {
+                if (children.find((*actions)[i], i) == children.end()) {
+                    actions_yet_to_try.push_back((*actions)[i]);
                 }
             }
 
@@ -157,9 +274,17 @@ namespace thts {
         }
         
         // Compute ucb values and return action with max value
-        unordered_map<shared_ptr<const Action>,double> ucb_values;
-        fill_ucb_values(ucb_values, ctx);
-        shared_ptr<const Action> result_action = helper::get_max_key_break_ties_randomly(ucb_values, *thts_manager);
+        UctManager& manager = (UctManager&) *thts_manager;
+        shared_ptr<const Action> result_action;
+        if (manager.use_dense_ucb_values) {
+            fill_dense_ucb_values(ucb_values_buffer, child_visits_buffer, ctx);
+            int index = get_max_index_break_ties_randomly(ucb_values_buffer, *thts_manager);
+            result_action = (*actions)[index];
+        } else {
+            unordered_map<shared_ptr<const Action>,double> ucb_values;
+            fill_ucb_values(ucb_values, ctx);
+            result_action = helper::get_max_key_break_ties_randomly(ucb_values, *thts_manager);
+        }
 
         // Remember to create the child node if it doesnt exist!
         if (!has_child_node(result_action)) {
@@ -187,9 +312,9 @@ namespace thts {
      * function for if we didn't (or did) want to explore this trial.
      */
     shared_ptr<const Action> UctDNode::select_action(ThtsEnvContext& ctx) {
-        shared_ptr<UctManager> manager = static_pointer_cast<UctManager>(thts_manager);
-        if (manager->epsilon_exploration > 0.0) {
-            if (manager->get_rand_uniform() < manager->epsilon_exploration) {
+        UctManager& manager = (UctManager&) *thts_manager;
+        if (manager.epsilon_exploration > 0.0) {
+            if (manager.get_rand_uniform() < manager.epsilon_exploration) {
                 return select_action_random();
             }
         }
@@ -205,7 +330,7 @@ namespace thts {
         double opp_coeff = is_opponent() ? -1.0 : 1.0;
         unordered_map<shared_ptr<const Action>, double> action_values;
 
-        for (shared_ptr<const Action> action : *actions) {
+        for (const shared_ptr<const Action>& action : *actions) {
             if (!has_child_node(action)) continue;
             action_values[action] = opp_coeff * get_child_node(action)->avg_return;
         }
@@ -225,7 +350,7 @@ namespace thts {
     shared_ptr<const Action> UctDNode::recommend_action_most_visited() const {
         unordered_map<shared_ptr<const Action>, int> visit_counts;
 
-        for (shared_ptr<const Action> action : *actions) {
+        for (const shared_ptr<const Action>& action : *actions) {
             if (!has_child_node(action)) continue;
             visit_counts[action] = get_child_node(action)->num_visits;
         }
@@ -252,6 +377,27 @@ namespace thts {
         return recommend_action_best_empirical();
     }
 
+    /**
+     * Child values are the avg_return of children, (multiplied by -1.0 if acting as the opponent).
+     */
+    void UctDNode::fill_child_recommendation_stats_itfc(ChildRecommendationStatsMap& child_stats) const {
+        double opp_coeff = is_opponent() ? -1.0 : 1.0;
+        for (const shared_ptr<const Action>& action : *actions) {
+            if (!has_child_node(action)) continue;
+            shared_ptr<UctCNode> child = get_child_node(action);
+            lock_guard<mutex> lg(child->get_lock());
+            child_stats[action] = ChildRecommendationStats{child->num_visits, opp_coeff * child->avg_return};
+        }
+    }
+
+    /**
+     * Recommends most visited iff the manager says to.
+     */
+    bool UctDNode::recommends_most_visited_itfc() const {
+        UctManager& manager = (UctManager&) *thts_manager;
+        return manager.recommend_most_visited;
+    }
+
     /**
      * Computes running average.
      */
@@ -264,8 +410,8 @@ namespace thts {
      * Calls the running average return backup function.
      */
     void UctDNode::backup(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -276,8 +422,8 @@ namespace thts {
     /**
      * Make a child
      */
-    shared_ptr<UctCNode> UctDNode::create_child_node_helper(shared_ptr<const Action> action) const {
-        return make_shared<UctCNode>(
+    shared_ptr<UctCNode> UctDNode::create_child_node_helper(const shared_ptr<const Action>& action) const {
+        return thts_manager->make_node<UctCNode>(
             static_pointer_cast<UctManager>(thts_manager), 
             state, 
             action, 
@@ -301,15 +447,15 @@ namespace thts {
  * All this code basically calls the corresponding base implementation function, with approprtiate casts before/after.
  */
 namespace thts {
-    shared_ptr<UctCNode> UctDNode::create_child_node(shared_ptr<const Action> action) {
+    shared_ptr<UctCNode> UctDNode::create_child_node(const shared_ptr<const Action>& action) {
         shared_ptr<ThtsCNode> new_child = ThtsDNode::create_child_node_itfc(action);
         return static_pointer_cast<UctCNode>(new_child);
     }
 
-    bool UctDNode::has_child_node(shared_ptr<const Action> action) const {
-        return ThtsDNode::has_child_node_itfc(static_pointer_cast<const Action>(action));
+    bool UctDNode::has_child_node(const shared_ptr<const Action>& action) const {
+        return ThtsDNode::has_child_node_itfc(action);
     }
-    shared_ptr<UctCNode> UctDNode::get_child_node(shared_ptr<const Action> action) const {
+    shared_ptr<UctCNode> UctDNode::get_child_node(const shared_ptr<const Action>& action) const {
         shared_ptr<const Action> act_itfc = static_pointer_cast<const Action>(action);
         shared_ptr<ThtsCNode> new_child = ThtsDNode::get_child_node_itfc(act_itfc);
         return static_pointer_cast<UctCNode>(new_child);
@@ -333,8 +479,8 @@ namespace thts {
     }
 
     void UctDNode::backup_itfc(
-        const vector<double>& trial_rewards_before_node, 
-        const vector<double>& trial_rewards_after_node, 
+        const RewardsView& trial_rewards_before_node, 
+        const RewardsView& trial_rewards_after_node, 
         const double trial_cumulative_return_after_node, 
         const double trial_cumulative_return,
         ThtsEnvContext& ctx) 
@@ -347,7 +493,7 @@ namespace thts {
             ctx);
     }
 
-    shared_ptr<ThtsCNode> UctDNode::create_child_node_helper_itfc(shared_ptr<const Action> action) const {
+    shared_ptr<ThtsCNode> UctDNode::create_child_node_helper_itfc(const shared_ptr<const Action>& action) const {
         shared_ptr<UctCNode> child_node = create_child_node_helper(action);
         return static_pointer_cast<ThtsCNode>(child_node);
     }
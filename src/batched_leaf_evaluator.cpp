@@ -0,0 +1,187 @@
+#include "batched_leaf_evaluator.h"
+
+#include "thts_manager.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+namespace thts {
+    /**
+     * Constructor, initialises members and starts the evaluator thread.
+     */
+    BatchedLeafEvaluator::BatchedLeafEvaluator(ThtsManager& thts_manager, size_t batch_size, double max_latency) :
+        thts_manager(thts_manager),
+        batch_size(max((size_t) 1, batch_size)),
+        max_latency(max_latency),
+        evaluator_lock(),
+        queue_cv(),
+        evaluated_cv(),
+        queue(),
+        num_active_workers(0),
+        num_batches(0),
+        num_evaluations(0),
+        is_alive(true),
+        evaluator_thread()
+    {
+        evaluator_thread = thread(&BatchedLeafEvaluator::evaluator_fn, this);
+    }
+
+    /**
+     * Destructor, signals the evaluator thread to exit and joins it. The evaluator thread evaluates any queued
+     * requests before exiting.
+     */
+    BatchedLeafEvaluator::~BatchedLeafEvaluator() {
+        {
+            lock_guard<mutex> lg(evaluator_lock);
+            is_alive = false;
+        }
+        queue_cv.notify_all();
+        evaluator_thread.join();
+    }
+
+    /**
+     * A batch is dispatched when it's full, or if every active worker is parked waiting on a request in the queue.
+     * There is always at least one request waiting if the evaluator thread can check this (parked threads are
+     * waiting on a request in the queue or in the batch being evaluated), so treat having no active workers the same
+     * as having one.
+     */
+    bool BatchedLeafEvaluator::should_dispatch_batch() const {
+        size_t num_workers = (size_t) max(1, num_active_workers);
+        return queue.size() >= min(batch_size, num_workers);
+    }
+
+    /**
+     * Evaluates the heuristic for the states that requested it, and the prior for all states, using the managers 
+     * batch functions (see ThtsManager::compute_heuristic_values and ThtsManager::compute_policy_priors). If any 
+     * function throws, then the exception is passed to every request in the batch.
+     */
+    void BatchedLeafEvaluator::evaluate_batch(const vector<Request*>& batch) {
+        try {
+            if (thts_manager.has_heuristic_fn()) {
+                vector<shared_ptr<const State>> states;
+                vector<Request*> requests;
+                for (Request* request : batch) {
+                    if (request->evaluate_heuristic) {
+                        states.push_back(request->state);
+                        requests.push_back(request);
+                    }
+                }
+
+                if (states.size() > 0) {
+                    vector<double> heuristic_values(states.size(), 0.0);
+                    thts_manager.compute_heuristic_values(states, heuristic_values);
+                    for (size_t i=0; i<requests.size(); i++) {
+                        requests[i]->evaluation.heuristic_value = heuristic_values[i];
+                    }
+                }
+            }
+
+            if (thts_manager.has_prior_fn()) {
+                vector<shared_ptr<const State>> states;
+                for (Request* request : batch) {
+                    states.push_back(request->state);
+                }
+
+                vector<shared_ptr<ActionPrior>> policy_priors(states.size());
+                thts_manager.compute_policy_priors(states, policy_priors);
+                for (size_t i=0; i<batch.size(); i++) {
+                    batch[i]->evaluation.policy_prior = move(policy_priors[i]);
+                }
+            }
+        } catch (...) {
+            exception_ptr error = current_exception();
+            for (Request* request : batch) {
+                request->error = error;
+            }
+        }
+    }
+
+    /**
+     * Waits for a request to be queued, and then waits until 'should_dispatch_batch' is true, or the oldest request
+     * has waited for 'max_latency'. Then takes (up to) 'batch_size' requests off the front of the queue, evaluates
+     * them without holding 'evaluator_lock', and wakes the parked threads.
+     */
+    void BatchedLeafEvaluator::evaluator_fn() {
+        vector<Request*> batch;
+        unique_lock<mutex> ul(evaluator_lock);
+        while (true) {
+            queue_cv.wait(ul, [this]() { return !is_alive || !queue.empty(); });
+            if (queue.empty()) return;
+
+            chrono::steady_clock::time_point deadline =
+                queue.front()->queued_time + chrono::duration_cast<chrono::steady_clock::duration>(max_latency);
+            queue_cv.wait_until(ul, deadline, [this]() { return !is_alive || should_dispatch_batch(); });
+
+            batch.clear();
+            while (!queue.empty() && batch.size() < batch_size) {
+                batch.push_back(queue.front());
+                queue.pop_front();
+            }
+
+            ul.unlock();
+            evaluate_batch(batch);
+            ul.lock();
+
+            for (Request* request : batch) {
+                request->is_evaluated = true;
+            }
+            num_batches++;
+            num_evaluations += batch.size();
+            evaluated_cv.notify_all();
+        }
+    }
+
+    /**
+     * Queues a request (that lives on this threads stack), and waits on 'evaluated_cv' until the evaluator thread
+     * has evaluated it.
+     */
+    LeafEvaluation BatchedLeafEvaluator::evaluate(shared_ptr<const State> state, bool evaluate_heuristic) {
+        Request request;
+        request.state = move(state);
+        request.evaluate_heuristic = evaluate_heuristic;
+        request.queued_time = chrono::steady_clock::now();
+
+        unique_lock<mutex> ul(evaluator_lock);
+        queue.push_back(&request);
+        queue_cv.notify_one();
+        evaluated_cv.wait(ul, [&request]() { return request.is_evaluated; });
+        ul.unlock();
+
+        if (request.error != nullptr) {
+            rethrow_exception(request.error);
+        }
+        return move(request.evaluation);
+    }
+
+    /**
+     * Updates the number of active workers. Removing a worker may mean that all of the remaining workers are parked,
+     * so the evaluator thread is notified to check if it should dispatch a batch.
+     */
+    void BatchedLeafEvaluator::add_active_worker() {
+        lock_guard<mutex> lg(evaluator_lock);
+        num_active_workers++;
+    }
+
+    void BatchedLeafEvaluator::remove_active_worker() {
+        {
+            lock_guard<mutex> lg(evaluator_lock);
+            num_active_workers--;
+        }
+        queue_cv.notify_one();
+    }
+
+    /**
+     * Getters
+     */
+    size_t BatchedLeafEvaluator::get_num_batches() {
+        lock_guard<mutex> lg(evaluator_lock);
+        return num_batches;
+    }
+
+    size_t BatchedLeafEvaluator::get_num_evaluations() {
+        lock_guard<mutex> lg(evaluator_lock);
+        return num_evaluations;
+    }
+}
@@ -13,7 +13,8 @@ namespace thts {
     using namespace std;
 
     /**
-     * Constructor 
+     * Constructor. If 'distr' is a nullptr, then the alias table is constructed when a distribution is provided with 
+     * 'update'.
     */
     template <typename T>
     CategoricalDistribution<T>::CategoricalDistribution(
@@ -26,7 +27,7 @@ namespace thts {
             num_updates(0),
             alias_table()
     {
-        if (use_alias_method) {
+        if (use_alias_method && distr != nullptr) {
             construct_alias_table();
         }
     }
@@ -62,10 +63,11 @@ namespace thts {
     */
     template <typename T>
     void CategoricalDistribution<T>::update(shared_ptr<unordered_map<T,double>> new_distr) {
+        bool same_size = distr != nullptr && new_distr->size() == distr->size();
         distr = new_distr;
         num_updates = 0;
         if (use_alias_method) {
-            if (new_distr->size() == distr->size()) {
+            if (same_size) {
                 reconstruct_alias_table(false);
             } else {
                 alias_table.clear();
@@ -0,0 +1,260 @@
+#include "flat_child_map.h"
+
+#include <stdexcept>
+
+namespace thts {
+    template <typename K, typename V>
+    FlatChildMap<K,V>::FlatChildMap() :
+        entries(),
+        occupied(),
+        num_occupied(0),
+        key_index(nullptr)
+    {
+    }
+
+    /**
+     * The key index isn't copied, and is rebuilt lazily if it's needed.
+     */
+    template <typename K, typename V>
+    FlatChildMap<K,V>::FlatChildMap(const FlatChildMap& other) :
+        entries(other.entries),
+        occupied(other.occupied),
+        num_occupied(other.num_occupied),
+        key_index(nullptr)
+    {
+    }
+
+    template <typename K, typename V>
+    FlatChildMap<K,V>::FlatChildMap(FlatChildMap&& other) :
+        entries(std::move(other.entries)),
+        occupied(std::move(other.occupied)),
+        num_occupied(other.num_occupied),
+        key_index(other.key_index.exchange(nullptr))
+    {
+        other.num_occupied = 0;
+    }
+
+    template <typename K, typename V>
+    FlatChildMap<K,V>::~FlatChildMap() {
+        delete key_index.load();
+    }
+
+    /**
+     * Copy and swap, as 'value_type' has a const key, so the vector of entries can't be copy assigned.
+     */
+    template <typename K, typename V>
+    FlatChildMap<K,V>& FlatChildMap<K,V>::operator=(const FlatChildMap& other) {
+        FlatChildMap tmp(other);
+        swap(tmp);
+        return *this;
+    }
+
+    template <typename K, typename V>
+    FlatChildMap<K,V>& FlatChildMap<K,V>::operator=(FlatChildMap&& other) {
+        FlatChildMap tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    template <typename K, typename V>
+    void FlatChildMap<K,V>::swap(FlatChildMap& other) {
+        entries.swap(other.entries);
+        occupied.swap(other.occupied);
+        std::swap(num_occupied, other.num_occupied);
+        KeyIndex* other_key_index = other.key_index.exchange(key_index.load());
+        key_index.store(other_key_index);
+    }
+
+    /**
+     * Builds the index outside of any lock, and publishes it with a compare and swap. If another thread published an 
+     * index first, then ours is discarded and theirs is used.
+     */
+    template <typename K, typename V>
+    const typename FlatChildMap<K,V>::KeyIndex& FlatChildMap<K,V>::get_key_index() const {
+        KeyIndex* index = key_index.load(std::memory_order_acquire);
+        if (index != nullptr) return *index;
+
+        KeyIndex* new_index = new KeyIndex();
+        new_index->reserve(entries.size());
+        for (size_type i=0; i<entries.size(); i++) {
+            new_index->emplace(entries[i].first, i);
+        }
+        if (key_index.compare_exchange_strong(index, new_index, std::memory_order_acq_rel)) {
+            return *new_index;
+        }
+        delete new_index;
+        return *index;
+    }
+
+    /**
+     * Small maps do a linear search comparing pointers, and then comparing values. Large maps go straight to the 
+     * (lazily built) key index, so that lookups without a position hint stay O(1) for wide nodes.
+     */
+    template <typename K, typename V>
+    typename FlatChildMap<K,V>::size_type FlatChildMap<K,V>::find_position(const K& key) const {
+        if (entries.size() <= small_size) {
+            const void* key_ptr = key.get();
+            for (size_type i=0; i<entries.size(); i++) {
+                if (entries[i].first.get() == key_ptr) return i;
+            }
+            std::equal_to<K> key_equal;
+            for (size_type i=0; i<entries.size(); i++) {
+                if (key_equal(entries[i].first, key)) return i;
+            }
+            return npos;
+        }
+
+        const KeyIndex& index = get_key_index();
+        auto key_iter = index.find(key);
+        if (key_iter != index.end()) return key_iter->second;
+        return npos;
+    }
+
+    /**
+     * If the key index has been built, then it's kept up to date.
+     */
+    template <typename K, typename V>
+    typename FlatChildMap<K,V>::size_type FlatChildMap<K,V>::add_slot(const K& key) {
+        size_type pos = entries.size();
+        entries.emplace_back(key, V());
+        occupied.push_back(false);
+
+        KeyIndex* index = key_index.load(std::memory_order_relaxed);
+        if (index != nullptr) {
+            index->emplace(key, pos);
+        }
+        return pos;
+    }
+
+    template <typename K, typename V>
+    void FlatChildMap<K,V>::reserve_keys(const std::vector<K>& keys) {
+        bool was_empty = entries.empty();
+        entries.reserve(entries.size() + keys.size());
+        occupied.reserve(occupied.size() + keys.size());
+        for (const K& key : keys) {
+            if (was_empty || find_position(key) == npos) add_slot(key);
+        }
+    }
+
+    template <typename K, typename V>
+    void FlatChildMap<K,V>::reserve_key(const K& key) {
+        if (find_position(key) == npos) add_slot(key);
+    }
+
+    template <typename K, typename V>
+    typename FlatChildMap<K,V>::size_type FlatChildMap<K,V>::size() const {
+        return num_occupied;
+    }
+
+    template <typename K, typename V>
+    bool FlatChildMap<K,V>::empty() const {
+        return num_occupied == 0;
+    }
+
+    template <typename K, typename V>
+    void FlatChildMap<K,V>::clear() {
+        entries.clear();
+        occupied.clear();
+        num_occupied = 0;
+        delete key_index.exchange(nullptr);
+    }
+
+    template <typename K, typename V>
+    typename FlatChildMap<K,V>::iterator FlatChildMap<K,V>::begin() {
+        return iterator(this, 0);
+    }
+
+    template <typename K, typename V>
+    typename FlatChildMap<K,V>::iterator FlatChildMap<K,V>::end() {
+        return iterator(this, entries.size());
+    }
+
+    template <typename K, typename V>
+    typename FlatChildMap<K,V>::const_iterator FlatChildMap<K,V>::begin() const {
+        return const_iterator(this, 0);
+    }
+
+    template <typename K, typename V>
+    typename FlatChildMap<K,V>::const_iterator FlatChildMap<K,V>::end() const {
+        return const_iterator(this, entries.size());
+    }
+
+    template <typename K, typename V>
+    typename FlatChildMap<K,V>::iterator FlatChildMap<K,V>::find(const K& key) {
+        size_type pos = find_position(key);
+        if (pos == npos || !occupied[pos]) return end();
+        return iterator(this, pos);
+    }
+
+    template <typename K, typename V>
+    typename FlatChildMap<K,V>::const_iterator FlatChildMap<K,V>::find(const K& key) const {
+        size_type pos = find_position(key);
+        if (pos == npos || !occupied[pos]) return end();
+        return const_iterator(this, pos);
+    }
+
+    template <typename K, typename V>
+    typename FlatChildMap<K,V>::iterator FlatChildMap<K,V>::find(const K& key, size_type position_hint) {
+        if (position_hint < entries.size() && entries[position_hint].first.get() == key.get()) {
+            if (!occupied[position_hint]) return end();
+            return iterator(this, position_hint);
+        }
+        return find(key);
+    }
+
+    template <typename K, typename V>
+    typename FlatChildMap<K,V>::const_iterator FlatChildMap<K,V>::find(
+        const K& key, size_type position_hint) const 
+    {
+        if (position_hint < entries.size() && entries[position_hint].first.get() == key.get()) {
+            if (!occupied[position_hint]) return end();
+            return const_iterator(this, position_hint);
+        }
+        return find(key);
+    }
+
+    template <typename K, typename V>
+    typename FlatChildMap<K,V>::size_type FlatChildMap<K,V>::count(const K& key) const {
+        return (find(key) != end()) ? 1 : 0;
+    }
+
+    template <typename K, typename V>
+    V& FlatChildMap<K,V>::at(const K& key) {
+        size_type pos = find_position(key);
+        if (pos == npos || !occupied[pos]) throw std::out_of_range("FlatChildMap::at: key not in map");
+        return entries[pos].second;
+    }
+
+    template <typename K, typename V>
+    const V& FlatChildMap<K,V>::at(const K& key) const {
+        size_type pos = find_position(key);
+        if (pos == npos || !occupied[pos]) throw std::out_of_range("FlatChildMap::at: key not in map");
+        return entries[pos].second;
+    }
+
+    template <typename K, typename V>
+    V& FlatChildMap<K,V>::operator[](const K& key) {
+        size_type pos = find_position(key);
+        if (pos == npos) pos = add_slot(key);
+        if (!occupied[pos]) {
+            occupied[pos] = true;
+            num_occupied++;
+        }
+        return entries[pos].second;
+    }
+
+    template <typename K, typename V>
+    std::pair<typename FlatChildMap<K,V>::iterator,bool> FlatChildMap<K,V>::insert_or_assign(
+        const K& key, const V& value) 
+    {
+        size_type pos = find_position(key);
+        if (pos == npos) pos = add_slot(key);
+        bool inserted = !occupied[pos];
+        if (inserted) {
+            occupied[pos] = true;
+            num_occupied++;
+        }
+        entries[pos].second = value;
+        return std::make_pair(iterator(this, pos), inserted);
+    }
+}
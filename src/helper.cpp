@@ -1,5 +1,10 @@
 #include "helper.h"
 
+#include "thts_manager.h"
+
+#include <sstream>
+#include <stdexcept>
+
 using namespace std;
 
 namespace thts::helper {
@@ -9,4 +14,30 @@ namespace thts::helper {
     double zero_heuristic_fn(shared_ptr<const State> state, shared_ptr<ThtsEnv> env) {
         return 0.0;
     }
+
+    /**
+     * Scans through the weights until the running sum passes 'rand_val * sum_weights'. If floating point rounding means 
+     * that the running sum never passes it, then returns the last index with a positive weight.
+     */
+    int sample_index_from_weights(const vector<double>& weights, RandManager& rand_manager) {
+        double sum_weights = 0.0;
+        int last_positive_index = -1;
+        for (size_t i=0; i<weights.size(); i++) {
+            sum_weights += weights[i];
+            if (weights[i] > 0.0) last_positive_index = i;
+        }
+        if (last_positive_index < 0) {
+            stringstream error_msg_ss;
+            error_msg_ss << "Trying to sample an index from " << weights.size() << " weights that are all zero.";
+            throw runtime_error(error_msg_ss.str());
+        }
+
+        double threshold = rand_manager.get_rand_uniform() * sum_weights;
+        double running_sum = 0.0;
+        for (int i=0; i<last_positive_index; i++) {
+            running_sum += weights[i];
+            if (threshold < running_sum) return i;
+        }
+        return last_positive_index;
+    }
 }
\ No newline at end of file
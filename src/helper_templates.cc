@@ -65,7 +65,7 @@ namespace thts::helper {
         double sum_weights = 1.0;
         if (!normalised) {
             sum_weights = 0.0;
-            for (auto pr : distribution) {
+            for (const auto& pr : distribution) {
                 sum_weights += pr.second;
             }
         }
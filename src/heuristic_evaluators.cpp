@@ -0,0 +1,37 @@
+#include "heuristic_evaluators.h"
+
+using namespace std;
+
+namespace thts {
+    /**
+     * HeuristicEvaluator default implementations
+     */
+    void HeuristicEvaluator::evaluate_batch(
+        const vector<shared_ptr<const State>>& states, shared_ptr<ThtsEnv> env, vector<double>& heuristic_values)
+    {
+        for (size_t i=0; i<states.size(); i++) {
+            heuristic_values[i] = evaluate(states[i], env);
+        }
+    }
+
+    shared_ptr<HeuristicEvaluator> HeuristicEvaluator::clone_for_thread() const {
+        return nullptr;
+    }
+
+    /**
+     * PriorEvaluator default implementations
+     */
+    void PriorEvaluator::evaluate_batch(
+        const vector<shared_ptr<const State>>& states,
+        shared_ptr<ThtsEnv> env,
+        vector<shared_ptr<ActionPrior>>& policy_priors)
+    {
+        for (size_t i=0; i<states.size(); i++) {
+            policy_priors[i] = evaluate(states[i], env);
+        }
+    }
+
+    shared_ptr<PriorEvaluator> PriorEvaluator::clone_for_thread() const {
+        return nullptr;
+    }
+}
@@ -1,6 +1,9 @@
 #include "mc_eval.h"
 
+#include <algorithm>
+#include <climits>
 #include <cmath>
+#include <limits>
 #include <thread>
 
 using namespace std;
@@ -18,6 +21,12 @@ namespace thts {
         cur_node(policy.root_node), 
         thts_env(policy.thts_env), 
         rand_manager(policy.rand_manager) {}
+
+    EvalPolicy::EvalPolicy(const EvalPolicy& policy, RandManager& rand_manager) :
+        root_node(policy.root_node), 
+        cur_node(policy.root_node), 
+        thts_env(policy.thts_env), 
+        rand_manager(rand_manager) {}
     
     /**
      * Resets cur_node back to root node.
@@ -61,6 +70,41 @@ namespace thts {
     }
 }
 
+/**
+ * Return accumulator implementation
+*/
+namespace thts {
+    ReturnAccumulator::ReturnAccumulator() : num_samples(0), mean(0.0), sum_squared_deviations(0.0) {}
+
+    /**
+     * Welford's update.
+    */
+    void ReturnAccumulator::add(double sample_return) {
+        num_samples++;
+        double delta = sample_return - mean;
+        mean += delta / num_samples;
+        sum_squared_deviations += delta * (sample_return - mean);
+    }
+
+    /**
+     * Chan et al.'s parallel update, combining the means and sums of squared deviations of the two sets of returns.
+    */
+    void ReturnAccumulator::merge(const ReturnAccumulator& other) {
+        if (other.num_samples == 0) return;
+        int total_samples = num_samples + other.num_samples;
+        double delta = other.mean - mean;
+        mean += delta * other.num_samples / total_samples;
+        sum_squared_deviations += other.sum_squared_deviations 
+            + delta * delta * ((double) num_samples * other.num_samples / total_samples);
+        num_samples = total_samples;
+    }
+
+    double ReturnAccumulator::get_variance() const {
+        if (num_samples < 2) return 0.0;
+        return sum_squared_deviations / (num_samples - 1.0);
+    }
+}
+
 /**
  * MC Eval implementation
 */
@@ -69,17 +113,26 @@ namespace thts {
         shared_ptr<const ThtsEnv> thts_env, 
         EvalPolicy& policy, 
         int max_trial_length, 
-        RandManager& rand_manager) :
+        RandManager& rand_manager,
+        bool store_sampled_returns) :
             thts_env(thts_env), 
             policy(policy), 
             max_trial_length(max_trial_length), 
+            store_sampled_returns(store_sampled_returns),
             sampled_returns(), 
-            rand_manager(rand_manager) {}
+            return_stats(),
+            rand_manager(rand_manager),
+            lock(),
+            next_rollout(0),
+            stop_rollouts(false),
+            target_confidence_interval_width(0.0),
+            confidence_z_score(confidence_z_score_default),
+            min_num_rollouts(0) {}
 
     /**
-     * Runs a single rollout and stores the result in 'sampled_returns'.
+     * Runs a single rollout and returns the sampled return.
     */
-    void MCEvaluator::run_rollout(EvalPolicy& thread_policy) {
+    double MCEvaluator::run_rollout(EvalPolicy& thread_policy, RandManager& thread_rand_manager) {
         // Reset
         thread_policy.reset();
 
@@ -87,87 +140,149 @@ namespace thts {
         int num_actions_taken = 0;
         double sample_return = 0.0;
         shared_ptr<const State> state = thts_env->get_initial_state_itfc();
-        ThtsEnvContext& context = *thts_env->sample_context_itfc(state);
+        shared_ptr<ThtsEnvContext> context_ptr = thts_env->sample_context_itfc(state);
+        ThtsEnvContext& context = *context_ptr;
 
         // Run trial
         while (num_actions_taken < max_trial_length && !thts_env->is_sink_state_itfc(state)) {
             shared_ptr<const Action> action = thread_policy.get_action(state, context);
             shared_ptr<const State> next_state = thts_env->sample_transition_distribution_itfc(
-                state, action, rand_manager);
+                state, action, thread_rand_manager);
             shared_ptr<const Observation> obsv = thts_env->sample_observation_distribution_itfc(
-                action, next_state, rand_manager);
+                action, next_state, thread_rand_manager);
             
             sample_return += thts_env->get_reward_itfc(state, action, obsv);
 
             thread_policy.update_step(action, obsv);
             state = next_state;
+            num_actions_taken++;
         }
 
-        // store
-        lock_guard lg(lock);
-        sampled_returns.push_back(sample_return);
+        return sample_return;
     }
     
     /**
-     * Called as a thread. Runs this threads portion of 'total_rollouts' many rollouts. To make coding simple as we 
-     * know exactly how many rollouts to perform ahead of time in this case, this thread will just be allocated all of 
-     * the rollouts numbered == thread_id mod num_threads.
+     * Called as a thread. Threads claim rollouts to run using the atomic 'next_rollout' counter, so that when 
+     * stopping early all of the threads stop at about the same time. Each thread uses its own RandManager and 
+     * EvalPolicy (copied from 'policy'), and accumulates stats locally, merging them at the end (and every 
+     * 'rollouts_per_merge' rollouts if stopping early).
     */
-    void MCEvaluator::thread_run_rollouts(
-        int total_rollouts, int thread_id, int num_threads, unique_ptr<EvalPolicy> thread_policy) 
-    {
-        for (int i=thread_id; i < total_rollouts; i+=num_threads) {
-            run_rollout(*thread_policy);
+    void MCEvaluator::thread_run_rollouts(int total_rollouts, int thread_seed) {
+        RandManager thread_rand_manager(thread_seed);
+        EvalPolicy thread_policy(policy, thread_rand_manager);
+        ReturnAccumulator thread_stats;
+        vector<double> thread_returns;
+        bool stopping_early = target_confidence_interval_width > 0.0;
+
+        while (!stop_rollouts.load(memory_order_relaxed) 
+            && next_rollout.fetch_add(1, memory_order_relaxed) < total_rollouts) 
+        {
+            double sample_return = run_rollout(thread_policy, thread_rand_manager);
+            thread_stats.add(sample_return);
+            if (store_sampled_returns) {
+                thread_returns.push_back(sample_return);
+            }
+            if (stopping_early && thread_stats.num_samples >= rollouts_per_merge) {
+                merge_thread_stats(thread_stats, thread_returns);
+            }
         }
+
+        merge_thread_stats(thread_stats, thread_returns);
     }
 
     /**
-     * Runs 'num_rollouts' using 'num_threads'. Just sets each thread up, starts it running and then waits for them. 
-     * Note that a pointer to a copy constructed policy is passed to each thread for it to use. (So each thread can 
-     * assume that it has it's own thread_policy, copied from 'policy')
+     * Merges under 'lock', and checks the confidence interval width if stopping early.
     */
-    void MCEvaluator::run_rollouts(int num_rollouts, int num_threads) {
+    void MCEvaluator::merge_thread_stats(ReturnAccumulator& thread_stats, vector<double>& thread_returns) {
+        lock_guard<mutex> lg(lock);
+        return_stats.merge(thread_stats);
+        sampled_returns.insert(sampled_returns.end(), thread_returns.begin(), thread_returns.end());
+        thread_stats = ReturnAccumulator();
+        thread_returns.clear();
+
+        if (target_confidence_interval_width > 0.0 && return_stats.num_samples >= min_num_rollouts) {
+            double stderr_mean = sqrt(return_stats.get_variance() / return_stats.num_samples);
+            if (2.0 * confidence_z_score * stderr_mean <= target_confidence_interval_width) {
+                stop_rollouts.store(true, memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Sets each thread up, starts it running and then waits for them. The seed for each threads RandManager is drawn 
+     * from 'rand_manager' (in order, before starting threads, so that runs are reproducible for a given seed and 
+     * number of threads).
+    */
+    void MCEvaluator::spawn_rollout_threads(int num_rollouts, int num_threads) {
+        next_rollout.store(0, memory_order_relaxed);
+        stop_rollouts.store(false, memory_order_relaxed);
+
         // spawn
         vector<thread> threads;
         for (int i=0; i<num_threads; i++) {
-            threads.push_back(thread(
-                &MCEvaluator::thread_run_rollouts, 
-                this, 
-                num_rollouts, 
-                i, 
-                num_threads, 
-                make_unique<EvalPolicy>(policy)));
+            int thread_seed = rand_manager.get_rand_int(1, INT_MAX);
+            threads.push_back(thread(&MCEvaluator::thread_run_rollouts, this, num_rollouts, thread_seed));
         }
 
         // wait
         for (int i=0; i<num_threads; i++) {
             threads[i].join();
         }
+    }
 
+    /**
+     * Runs 'num_rollouts' using 'num_threads', without stopping early.
+    */
+    void MCEvaluator::run_rollouts(int num_rollouts, int num_threads) {
+        target_confidence_interval_width = 0.0;
+        spawn_rollout_threads(num_rollouts, num_threads);
     }
 
     /**
-     * Returns the mean return of 'sampled_returns'
+     * Sets the early stopping parameters, and runs rollouts.
     */
+    void MCEvaluator::run_rollouts_until_confident(
+        int max_num_rollouts, 
+        int num_threads, 
+        double target_confidence_interval_width, 
+        double confidence_z_score, 
+        int min_num_rollouts)
+    {
+        this->target_confidence_interval_width = target_confidence_interval_width;
+        this->confidence_z_score = confidence_z_score;
+        this->min_num_rollouts = max(2, min_num_rollouts);
+        spawn_rollout_threads(max_num_rollouts, num_threads);
+        this->target_confidence_interval_width = 0.0;
+    }
+
+    int MCEvaluator::get_num_rollouts() {
+        lock_guard<mutex> lg(lock);
+        return return_stats.num_samples;
+    }
+
     double MCEvaluator::get_mean_return() {
-        double weight = 1.0 / sampled_returns.size();
-        double mean = 0.0;
-        for (double val : sampled_returns) {
-            mean += weight * val;
-        }
-        return mean;
+        lock_guard<mutex> lg(lock);
+        return return_stats.mean;
     }
 
     /**
-    * Returns the stddev of 'sampled_returns'
+     * Returns the sqrt of the (unbiased) sample variance
     */
     double MCEvaluator::get_stddev_return() {
-        double mean = get_mean_return();
-        double weight = 1.0 / (sampled_returns.size() - 1.0);
-        double stddev = 0.0;
-        for (double val : sampled_returns) {
-            stddev += weight * pow(val - mean, 2.0);
-        }
-        return stddev;
+        lock_guard<mutex> lg(lock);
+        return sqrt(return_stats.get_variance());
+    }
+
+    /**
+     * Width of the interval mean +/- z_score * stddev / sqrt(num_rollouts)
+    */
+    double MCEvaluator::get_confidence_interval_width(double z_score) {
+        lock_guard<mutex> lg(lock);
+        if (return_stats.num_samples < 2) return numeric_limits<double>::infinity();
+        return 2.0 * z_score * sqrt(return_stats.get_variance() / return_stats.num_samples);
     }
-}
\ No newline at end of file
+
+    const vector<double>& MCEvaluator::get_sampled_returns() const {
+        return sampled_returns;
+    }
+}
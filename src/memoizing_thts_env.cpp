@@ -0,0 +1,155 @@
+#include "memoizing_thts_env.h"
+
+#include "helper_templates.h"
+
+using namespace std;
+
+namespace thts {
+    /**
+     * Hash and equality functions for cache keys. The hashes of the state and action are combined using
+     * 'hash_combine', and a nullptr observation hashes to zero.
+     */
+    size_t StateActionKeyHash::operator()(const StateActionKey& key) const {
+        size_t cur_hash = 0;
+        cur_hash = helper::hash_combine(cur_hash, key.first);
+        cur_hash = helper::hash_combine(cur_hash, key.second);
+        return cur_hash;
+    }
+
+    bool StateActionKeyEqual::operator()(const StateActionKey& lhs, const StateActionKey& rhs) const {
+        return equal_to<shared_ptr<const State>>()(lhs.first, rhs.first)
+            && equal_to<shared_ptr<const Action>>()(lhs.second, rhs.second);
+    }
+
+    size_t RewardKeyHash::operator()(const RewardKey& key) const {
+        size_t cur_hash = 0;
+        cur_hash = helper::hash_combine(cur_hash, get<0>(key));
+        cur_hash = helper::hash_combine(cur_hash, get<1>(key));
+        size_t observation_hash = (get<2>(key) != nullptr) ? get<2>(key)->get_hash() : 0u;
+        cur_hash = helper::hash_combine(cur_hash, observation_hash);
+        return cur_hash;
+    }
+
+    bool RewardKeyEqual::operator()(const RewardKey& lhs, const RewardKey& rhs) const {
+        if (!equal_to<shared_ptr<const State>>()(get<0>(lhs), get<0>(rhs))) return false;
+        if (!equal_to<shared_ptr<const Action>>()(get<1>(lhs), get<1>(rhs))) return false;
+        const shared_ptr<const Observation>& lhs_observation = get<2>(lhs);
+        const shared_ptr<const Observation>& rhs_observation = get<2>(rhs);
+        if (lhs_observation == nullptr || rhs_observation == nullptr) {
+            return lhs_observation == nullptr && rhs_observation == nullptr;
+        }
+        return equal_to<shared_ptr<const Observation>>()(lhs_observation, rhs_observation);
+    }
+}
+
+namespace thts {
+    /**
+     * Constructor, the observability of the wrapped environment is copied.
+     */
+    MemoizingThtsEnv::MemoizingThtsEnv(
+        shared_ptr<ThtsEnv> env, bool cache_rewards, size_t max_cache_size, size_t num_cache_shards) :
+            ThtsEnv(env->is_fully_observable()),
+            env(env),
+            cache_rewards(cache_rewards),
+            is_sink_state_cache(num_cache_shards, max_cache_size),
+            valid_actions_cache(num_cache_shards, max_cache_size),
+            transition_distribution_cache(num_cache_shards, max_cache_size),
+            reward_cache(num_cache_shards, max_cache_size)
+    {
+    }
+
+    shared_ptr<ThtsEnv> MemoizingThtsEnv::get_wrapped_env() const {
+        return env;
+    }
+
+    /**
+     * Cache stats getters
+     */
+    CacheStats MemoizingThtsEnv::get_is_sink_state_cache_stats() const {
+        return is_sink_state_cache.get_stats();
+    }
+
+    CacheStats MemoizingThtsEnv::get_valid_actions_cache_stats() const {
+        return valid_actions_cache.get_stats();
+    }
+
+    CacheStats MemoizingThtsEnv::get_transition_distribution_cache_stats() const {
+        return transition_distribution_cache.get_stats();
+    }
+
+    CacheStats MemoizingThtsEnv::get_reward_cache_stats() const {
+        return reward_cache.get_stats();
+    }
+
+    void MemoizingThtsEnv::clear_caches() {
+        is_sink_state_cache.clear();
+        valid_actions_cache.clear();
+        transition_distribution_cache.clear();
+        reward_cache.clear();
+    }
+
+    /**
+     * Memoized functions. Each looks in its cache, and on a miss, calls the wrapped environment and inserts the
+     * result. If another thread inserted a result in the meantime, then that one is returned (so that all callers
+     * share the same objects).
+     */
+    bool MemoizingThtsEnv::is_sink_state_itfc(shared_ptr<const State> state) const {
+        bool is_sink;
+        if (is_sink_state_cache.find(state, is_sink)) return is_sink;
+        return is_sink_state_cache.insert(state, env->is_sink_state_itfc(state));
+    }
+
+    shared_ptr<ActionVector> MemoizingThtsEnv::get_valid_actions_itfc(shared_ptr<const State> state) const {
+        shared_ptr<ActionVector> actions;
+        if (valid_actions_cache.find(state, actions)) return actions;
+        return valid_actions_cache.insert(state, env->get_valid_actions_itfc(state));
+    }
+
+    shared_ptr<StateDistr> MemoizingThtsEnv::get_transition_distribution_itfc(
+        shared_ptr<const State> state, shared_ptr<const Action> action) const
+    {
+        StateActionKey key = make_pair(state, action);
+        shared_ptr<StateDistr> distr;
+        if (transition_distribution_cache.find(key, distr)) return distr;
+        return transition_distribution_cache.insert(key, env->get_transition_distribution_itfc(state, action));
+    }
+
+    double MemoizingThtsEnv::get_reward_itfc(
+        shared_ptr<const State> state, shared_ptr<const Action> action, shared_ptr<const Observation> observation) const
+    {
+        if (!cache_rewards) return env->get_reward_itfc(state, action, observation);
+        RewardKey key = make_tuple(state, action, observation);
+        double reward;
+        if (reward_cache.find(key, reward)) return reward;
+        return reward_cache.insert(key, env->get_reward_itfc(state, action, observation));
+    }
+
+    /**
+     * Forwarded functions.
+     */
+    shared_ptr<const State> MemoizingThtsEnv::get_initial_state_itfc() const {
+        return env->get_initial_state_itfc();
+    }
+
+    shared_ptr<const State> MemoizingThtsEnv::sample_transition_distribution_itfc(
+        shared_ptr<const State> state, shared_ptr<const Action> action, RandManager& rand_manager) const
+    {
+        return env->sample_transition_distribution_itfc(state, action, rand_manager);
+    }
+
+    shared_ptr<ObservationDistr> MemoizingThtsEnv::get_observation_distribution_itfc(
+        shared_ptr<const Action> action, shared_ptr<const State> next_state) const
+    {
+        return env->get_observation_distribution_itfc(action, next_state);
+    }
+
+    shared_ptr<const Observation> MemoizingThtsEnv::sample_observation_distribution_itfc(
+        shared_ptr<const Action> action, shared_ptr<const State> next_state, RandManager& rand_manager) const
+    {
+        return env->sample_observation_distribution_itfc(action, next_state, rand_manager);
+    }
+
+    shared_ptr<ThtsEnvContext> MemoizingThtsEnv::sample_context_itfc(shared_ptr<const State> state) const {
+        return env->sample_context_itfc(state);
+    }
+}
@@ -0,0 +1,299 @@
+#include "node_arena.h"
+
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * Thread local cache of the ThreadCache used by the calling thread, tagged with the id of the NodeArena it belongs to.
+ * 
+ * NodeArena ids are never reused, so a cached ThreadCache from a NodeArena that has since been destroyed can never be 
+ * matched against a new NodeArena.
+ */
+namespace {
+    struct ThreadCacheCache {
+        uint64_t node_arena_id = 0;
+        void* thread_cache = nullptr;
+    };
+
+    thread_local ThreadCacheCache thread_cache_cache;
+    atomic<uint64_t> next_node_arena_id(1);
+}
+
+namespace thts {
+    NodeArena::NodeArena(size_t slab_size) :
+        slab_size(round_up(slab_size)),
+        node_arena_id(get_new_node_arena_id()),
+        retired(false),
+        arena_lock(),
+        slabs(),
+        individual_blocks(),
+        num_slabs(0),
+        thread_caches(),
+        shared_free_lists()
+    {
+    }
+
+    /**
+     * Slabs and individual blocks are released (in bulk) by the destructors of 'slabs' and 'individual_blocks'.
+     */
+    NodeArena::~NodeArena() = default;
+
+    uint64_t NodeArena::get_new_node_arena_id() {
+        return next_node_arena_id.fetch_add(1, memory_order_relaxed);
+    }
+
+    size_t NodeArena::round_up(size_t num_bytes) {
+        return ((num_bytes + alignment - 1) / alignment) * alignment;
+    }
+
+    /**
+     * Only the owning thread writes to its count, so a load and store is enough (rather than an atomic 
+     * read-modify-write). The count is atomic so that 'get_num_bytes_in_use' can read it.
+     */
+    void NodeArena::add_thread_bytes(ThreadCache& thread_cache, ptrdiff_t num_bytes) {
+        thread_cache.num_bytes.store(
+            thread_cache.num_bytes.load(memory_order_relaxed) + num_bytes, memory_order_relaxed);
+    }
+
+    /**
+     * Checks the thread local cache first (lock free). If the cache misses, grabs the arena_lock and looks up (or 
+     * creates) the ThreadCache for this thread, and updates the cache. New ThreadCaches have an empty slab, so that 
+     * the first allocation allocates a slab.
+     */
+    NodeArena::ThreadCache& NodeArena::get_thread_cache() {
+        if (thread_cache_cache.node_arena_id == node_arena_id) {
+            return *static_cast<ThreadCache*>(thread_cache_cache.thread_cache);
+        }
+
+        lock_guard<mutex> lg(arena_lock);
+        thread::id thread_id = this_thread::get_id();
+        auto iter = thread_caches.find(thread_id);
+        if (iter == thread_caches.end()) {
+            unique_ptr<ThreadCache> thread_cache = make_unique<ThreadCache>();
+            thread_cache->slab = nullptr;
+            thread_cache->next = nullptr;
+            thread_cache->end = nullptr;
+            thread_cache->num_bytes.store(0, memory_order_relaxed);
+            iter = thread_caches.emplace(thread_id, move(thread_cache)).first;
+        }
+
+        thread_cache_cache.node_arena_id = node_arena_id;
+        thread_cache_cache.thread_cache = iter->second.get();
+        return *iter->second;
+    }
+
+    /**
+     * Doesn't use make_unique for the memory, to avoid zero initialising the slab.
+     */
+    NodeArena::Slab* NodeArena::new_slab() {
+        unique_ptr<Slab> slab = make_unique<Slab>();
+        slab->memory = unique_ptr<char[]>(new char[slab_size]);
+        slab->begin = slab->memory.get();
+        slab->size = slab_size;
+        slab->num_blocks = 0;
+        slab->num_live_blocks.store(0, memory_order_relaxed);
+        slabs.push_back(move(slab));
+        num_slabs++;
+        return slabs.back().get();
+    }
+
+    void* NodeArena::allocate_individual_block(size_t num_bytes) {
+        lock_guard<mutex> lg(arena_lock);
+        unique_ptr<char[]> block(new char[num_bytes]);
+        void* ptr = block.get();
+        individual_blocks.emplace(ptr, move(block));
+        num_slabs++;
+        return ptr;
+    }
+
+    void NodeArena::deallocate_individual_block(void* ptr) {
+        lock_guard<mutex> lg(arena_lock);
+        if (individual_blocks.erase(ptr) > 0) num_slabs--;
+    }
+
+    /**
+     * Binary searches the slabs, which are sorted by address when the arena is retired, and are not modified after.
+     */
+    size_t NodeArena::find_sorted_slab_index(void* ptr) const {
+        char* block = static_cast<char*>(ptr);
+        auto iter = upper_bound(slabs.begin(), slabs.end(), block, 
+            [](char* block, const unique_ptr<Slab>& slab) { return less<char*>()(block, slab->begin); });
+        if (iter == slabs.begin()) return slabs.size();
+        size_t index = (iter - slabs.begin()) - 1;
+        if (!less<char*>()(block, slabs[index]->begin + slabs[index]->size)) return slabs.size();
+        return index;
+    }
+
+    /**
+     * Reuses a block freed by this thread if there is one, and otherwise bump allocates from the calling thread's 
+     * slab. Neither takes a lock. Only when both are empty does 'allocate_slow_path' take the lock. Large allocations 
+     * (and allocations in a retired arena) are allocated individually.
+     */
+    void* NodeArena::allocate(size_t num_bytes) {
+        num_bytes = round_up(num_bytes);
+        ThreadCache& thread_cache = get_thread_cache();
+        add_thread_bytes(thread_cache, num_bytes);
+
+        if (num_bytes > slab_size || retired.load(memory_order_relaxed)) {
+            return allocate_individual_block(num_bytes);
+        }
+
+        if (!thread_cache.free_lists.empty()) {
+            auto iter = thread_cache.free_lists.find(num_bytes);
+            if (iter != thread_cache.free_lists.end() && !iter->second.empty()) {
+                void* ptr = iter->second.back();
+                iter->second.pop_back();
+                return ptr;
+            }
+        }
+
+        if (thread_cache.next == nullptr || (size_t) (thread_cache.end - thread_cache.next) < num_bytes) {
+            return allocate_slow_path(thread_cache, num_bytes);
+        }
+
+        void* ptr = thread_cache.next;
+        thread_cache.next += num_bytes;
+        thread_cache.slab->num_blocks++;
+        return ptr;
+    }
+
+    /**
+     * Prefers reusing a batch of freed blocks over allocating a new slab. The remainder of the old slab is abandoned 
+     * when a new slab is allocated.
+     */
+    void* NodeArena::allocate_slow_path(ThreadCache& thread_cache, size_t num_bytes) {
+        lock_guard<mutex> lg(arena_lock);
+        auto iter = shared_free_lists.find(num_bytes);
+        if (iter != shared_free_lists.end() && !iter->second.empty()) {
+            vector<void*>& free_list = thread_cache.free_lists[num_bytes];
+            free_list.swap(iter->second.back());
+            iter->second.pop_back();
+            void* ptr = free_list.back();
+            free_list.pop_back();
+            return ptr;
+        }
+
+        thread_cache.slab = new_slab();
+        thread_cache.next = thread_cache.slab->begin;
+        thread_cache.end = thread_cache.next + slab_size;
+        void* ptr = thread_cache.next;
+        thread_cache.next += num_bytes;
+        thread_cache.slab->num_blocks++;
+        return ptr;
+    }
+
+    /**
+     * Blocks may be freed from any thread (for example when an old tree is freed on a background thread), so they're 
+     * put on the freeing thread's free list, which is moved to the shared free lists in batches of 
+     * 'free_batch_size', so 'arena_lock' is taken once per batch. 
+     * 
+     * Blocks freed in a retired arena are not reused, and instead decrement the live count of their slab, releasing 
+     * the slab when it reaches zero. Only the thread that frees the last block in a slab touches the slab after 
+     * that, so the slab can be released without taking 'arena_lock'.
+     */
+    void NodeArena::deallocate(void* ptr, size_t num_bytes) {
+        num_bytes = round_up(num_bytes);
+        ThreadCache& thread_cache = get_thread_cache();
+        add_thread_bytes(thread_cache, -(ptrdiff_t) num_bytes);
+
+        if (num_bytes > slab_size) {
+            deallocate_individual_block(ptr);
+            return;
+        }
+
+        if (retired.load(memory_order_acquire)) {
+            size_t slab_index = find_sorted_slab_index(ptr);
+            if (slab_index == slabs.size()) {
+                deallocate_individual_block(ptr);
+                return;
+            }
+            Slab& slab = *slabs[slab_index];
+            if (slab.num_live_blocks.fetch_sub(1, memory_order_acq_rel) == 1) {
+                slab.memory.reset();
+                num_slabs--;
+            }
+            return;
+        }
+
+        vector<void*>& free_list = thread_cache.free_lists[num_bytes];
+        free_list.push_back(ptr);
+        if (free_list.size() >= free_batch_size) {
+            lock_guard<mutex> lg(arena_lock);
+            shared_free_lists[num_bytes].push_back(move(free_list));
+            free_list.clear();
+        }
+    }
+
+    /**
+     * Sorts the slabs by address, and counts the live blocks in each slab, as the number of blocks bump allocated 
+     * from it minus the number of its blocks in the (thread and shared) free lists. Slabs with no live blocks are 
+     * released now, and the free lists (which are no longer needed) are released too. Threads' bump allocation 
+     * regions are reset, as their slab may have been released.
+     */
+    void NodeArena::retire() {
+        lock_guard<mutex> lg(arena_lock);
+        sort(slabs.begin(), slabs.end(), 
+            [](const unique_ptr<Slab>& lhs, const unique_ptr<Slab>& rhs) { 
+                return less<char*>()(lhs->begin, rhs->begin); 
+            });
+
+        vector<size_t> num_free_blocks(slabs.size(), 0);
+        auto count_free_blocks = [&](const vector<void*>& free_list) {
+            for (void* ptr : free_list) {
+                size_t slab_index = find_sorted_slab_index(ptr);
+                if (slab_index < slabs.size()) num_free_blocks[slab_index]++;
+            }
+        };
+        for (pair<const thread::id,unique_ptr<ThreadCache>>& pr : thread_caches) {
+            for (pair<const size_t,vector<void*>>& free_list_pr : pr.second->free_lists) {
+                count_free_blocks(free_list_pr.second);
+            }
+            pr.second->free_lists.clear();
+            pr.second->slab = nullptr;
+            pr.second->next = nullptr;
+            pr.second->end = nullptr;
+        }
+        for (pair<const size_t,vector<vector<void*>>>& pr : shared_free_lists) {
+            for (vector<void*>& free_list : pr.second) {
+                count_free_blocks(free_list);
+            }
+        }
+        shared_free_lists.clear();
+
+        for (size_t i=0; i<slabs.size(); i++) {
+            size_t num_live_blocks = slabs[i]->num_blocks - num_free_blocks[i];
+            slabs[i]->num_live_blocks.store(num_live_blocks, memory_order_relaxed);
+            if (num_live_blocks == 0) {
+                slabs[i]->memory.reset();
+                num_slabs--;
+            }
+        }
+
+        retired.store(true, memory_order_release);
+    }
+
+    bool NodeArena::is_retired() const {
+        return retired.load(memory_order_relaxed);
+    }
+
+    size_t NodeArena::get_slab_size() const {
+        return slab_size;
+    }
+
+    int NodeArena::get_num_slabs() {
+        return num_slabs.load(memory_order_relaxed);
+    }
+
+    /**
+     * Sums the per thread byte counts.
+     */
+    size_t NodeArena::get_num_bytes_in_use() const {
+        lock_guard<mutex> lg(arena_lock);
+        ptrdiff_t num_bytes_in_use = 0;
+        for (const pair<const thread::id,unique_ptr<ThreadCache>>& pr : thread_caches) {
+            num_bytes_in_use += pr.second->num_bytes.load(memory_order_relaxed);
+        }
+        return (size_t) num_bytes_in_use;
+    }
+}
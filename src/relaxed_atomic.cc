@@ -0,0 +1,91 @@
+#include "relaxed_atomic.h"
+
+namespace thts {
+    template <typename T>
+    RelaxedAtomic<T>::RelaxedAtomic() : val(T()) {}
+
+    template <typename T>
+    RelaxedAtomic<T>::RelaxedAtomic(T init_val) : val(init_val) {}
+
+    template <typename T>
+    RelaxedAtomic<T>::RelaxedAtomic(const RelaxedAtomic& other) : val(other.load()) {}
+
+    template <typename T>
+    T RelaxedAtomic<T>::load() const {
+        return val.load(std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    RelaxedAtomic<T>::operator T() const {
+        return load();
+    }
+
+    template <typename T>
+    void RelaxedAtomic<T>::store(T new_val) {
+        val.store(new_val, std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    RelaxedAtomic<T>& RelaxedAtomic<T>::operator=(T new_val) {
+        store(new_val);
+        return *this;
+    }
+
+    template <typename T>
+    RelaxedAtomic<T>& RelaxedAtomic<T>::operator=(const RelaxedAtomic& other) {
+        store(other.load());
+        return *this;
+    }
+
+    template <typename T>
+    RelaxedAtomic<T>& RelaxedAtomic<T>::operator+=(T delta) {
+        store(load() + delta);
+        return *this;
+    }
+
+    template <typename T>
+    RelaxedAtomic<T>& RelaxedAtomic<T>::operator-=(T delta) {
+        store(load() - delta);
+        return *this;
+    }
+
+    template <typename T>
+    RelaxedAtomic<T>& RelaxedAtomic<T>::operator*=(T factor) {
+        store(load() * factor);
+        return *this;
+    }
+
+    template <typename T>
+    RelaxedAtomic<T>& RelaxedAtomic<T>::operator/=(T divisor) {
+        store(load() / divisor);
+        return *this;
+    }
+
+    template <typename T>
+    T RelaxedAtomic<T>::operator++() {
+        T new_val = load() + 1;
+        store(new_val);
+        return new_val;
+    }
+
+    template <typename T>
+    T RelaxedAtomic<T>::operator++(int) {
+        T old_val = load();
+        store(old_val + 1);
+        return old_val;
+    }
+
+    template <typename T>
+    T RelaxedAtomic<T>::operator--() {
+        T new_val = load() - 1;
+        store(new_val);
+        return new_val;
+    }
+
+    template <typename T>
+    T RelaxedAtomic<T>::operator--(int) {
+        T old_val = load();
+        store(old_val - 1);
+        return old_val;
+    }
+}
@@ -0,0 +1,18 @@
+#include "rewards_view.h"
+
+using namespace std;
+
+namespace thts {
+    /**
+     * Constructor, summing the rewards in the same order as the backup phase does.
+     */
+    RewardsView::RewardsView(const vector<double>& rewards) :
+        rewards(rewards.data()), num_rewards(rewards.size()), rewards_sum(0.0) 
+    {
+        for (double reward : rewards) rewards_sum += reward;
+    }
+
+    vector<double> RewardsView::to_vector() const {
+        return vector<double>(begin(), end());
+    }
+}
@@ -0,0 +1,108 @@
+#include "sharded_cache.h"
+
+#include <algorithm>
+
+namespace thts {
+    /**
+     * Hit rate of a cache (inline, as this file is included in every file that includes sharded_cache.h)
+     */
+    inline double CacheStats::get_hit_rate() const {
+        std::size_t num_lookups = num_hits + num_misses;
+        if (num_lookups == 0) return 0.0;
+        return (double) num_hits / (double) num_lookups;
+    }
+
+    /**
+     * Constructs the shards, dividing 'max_size' between them (rounding up).
+     */
+    template <typename K, typename V, typename Hash, typename KeyEqual>
+    ShardedCache<K,V,Hash,KeyEqual>::ShardedCache(std::size_t num_shards, std::size_t max_size) :
+        shards(),
+        max_entries_per_shard(0),
+        hasher(),
+        num_hits(0),
+        num_misses(0)
+    {
+        num_shards = std::max((std::size_t) 1, num_shards);
+        for (std::size_t i=0; i<num_shards; i++) {
+            shards.push_back(std::make_unique<Shard>());
+        }
+        if (max_size > 0) {
+            max_entries_per_shard = (max_size + num_shards - 1) / num_shards;
+        }
+    }
+
+    /**
+     * The shard is picked using the hash of the key. (The hash is recomputed by the shards unordered_map.)
+     */
+    template <typename K, typename V, typename Hash, typename KeyEqual>
+    typename ShardedCache<K,V,Hash,KeyEqual>::Shard& ShardedCache<K,V,Hash,KeyEqual>::get_shard(const K& key) {
+        return *shards[hasher(key) % shards.size()];
+    }
+
+    template <typename K, typename V, typename Hash, typename KeyEqual>
+    bool ShardedCache<K,V,Hash,KeyEqual>::find(const K& key, V& value) {
+        Shard& shard = get_shard(key);
+        std::lock_guard<std::mutex> lg(shard.shard_lock);
+        auto iter = shard.entries.find(key);
+        if (iter == shard.entries.end()) {
+            num_misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        num_hits.fetch_add(1, std::memory_order_relaxed);
+        value = iter->second;
+        return true;
+    }
+
+    /**
+     * If the shard is full, then evicts the oldest entries in the shard before inserting.
+     */
+    template <typename K, typename V, typename Hash, typename KeyEqual>
+    V ShardedCache<K,V,Hash,KeyEqual>::insert(const K& key, const V& value) {
+        Shard& shard = get_shard(key);
+        std::lock_guard<std::mutex> lg(shard.shard_lock);
+        auto iter = shard.entries.find(key);
+        if (iter != shard.entries.end()) {
+            return iter->second;
+        }
+
+        if (max_entries_per_shard > 0) {
+            while (shard.entries.size() >= max_entries_per_shard) {
+                shard.entries.erase(shard.insertion_order.front());
+                shard.insertion_order.pop_front();
+            }
+        }
+
+        shard.entries.emplace(key, value);
+        shard.insertion_order.push_back(key);
+        return value;
+    }
+
+    template <typename K, typename V, typename Hash, typename KeyEqual>
+    void ShardedCache<K,V,Hash,KeyEqual>::clear() {
+        for (std::unique_ptr<Shard>& shard : shards) {
+            std::lock_guard<std::mutex> lg(shard->shard_lock);
+            shard->entries.clear();
+            shard->insertion_order.clear();
+        }
+    }
+
+    template <typename K, typename V, typename Hash, typename KeyEqual>
+    std::size_t ShardedCache<K,V,Hash,KeyEqual>::size() {
+        std::size_t total_size = 0;
+        for (std::unique_ptr<Shard>& shard : shards) {
+            std::lock_guard<std::mutex> lg(shard->shard_lock);
+            total_size += shard->entries.size();
+        }
+        return total_size;
+    }
+
+    template <typename K, typename V, typename Hash, typename KeyEqual>
+    CacheStats ShardedCache<K,V,Hash,KeyEqual>::get_stats() {
+        CacheStats stats;
+        stats.num_hits = num_hits.load(std::memory_order_relaxed);
+        stats.num_misses = num_misses.load(std::memory_order_relaxed);
+        stats.size = size();
+        return stats;
+    }
+}
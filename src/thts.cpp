@@ -1,12 +1,32 @@
 #include "thts.h"
 
+#include "rewards_view.h"
 #include "thts_chance_node.h"
 #include "thts_types.h"
 
+#include <algorithm>
+#include <tuple>
 #include <utility>
 
 using namespace std;
 
+/**
+ * Thread local buffers that are reused by each trial run on a thread, so that the selection and backup phases don't 
+ * allocate once the buffers have grown to the depth of the tree.
+ * 
+ * Trials are never nested on a single thread (worker threads of ThtsPools only run trials from their own pool), so 
+ * each thread needs a single set of buffers, which is shared between all of the pools that run trials on it.
+ */
+namespace {
+    struct ThreadTrialBuffers {
+        vector<pair<shared_ptr<thts::ThtsDNode>,shared_ptr<thts::ThtsCNode>>> nodes_to_backup;
+        vector<double> rewards;
+        vector<double> reversed_rewards;
+        vector<double> reward_prefix_sums;
+    };
+
+    thread_local ThreadTrialBuffers thread_trial_buffers;
+}
 
 namespace thts {
     /**
@@ -26,16 +46,21 @@ namespace thts {
         shared_ptr<ThtsManager> thts_manager, 
         shared_ptr<ThtsDNode> root_node, 
         int num_threads, 
-        shared_ptr<ThtsLogger> logger) :
+        shared_ptr<ThtsLogger> logger,
+        bool use_lock_free_dispatch,
+        int max_trial_chunk_size) :
             workers(num_threads),
             work_left_cv(),
             work_left_lock(),
             logging_lock(),
             thread_pool_alive(true),
             num_threads(num_threads),
+            use_lock_free_dispatch(use_lock_free_dispatch),
+            max_trial_chunk_size(max(1, max_trial_chunk_size)),
             num_trials(0),
-            start_time(std::chrono::system_clock::now()),
+            start_time(chrono::steady_clock::now()),
             max_run_time(0.0),
+            deadline(start_time),
             trials_remaining(0),
             num_threads_working(num_threads),
             trials_completed(0),
@@ -68,10 +93,17 @@ namespace thts {
         for (int i=0; i<num_threads; i++) {
             workers[i].join();
         }
+        if (old_tree_deleter.joinable()) {
+            old_tree_deleter.join();
+        }
     }
 
     /**
      * Setter for root node, so thread pool can be reused
+     * 
+     * If the manager is being reused, then the old tree was allocated in its current node arena, so a new arena is 
+     * started (as in 'advance_root'), so that the old tree's slabs are released as it's freed rather than staying 
+     * mixed in with the new tree. Waits for any trials that are still running to finish first.
     */
     void ThtsPool::set_new_env(
         shared_ptr<ThtsManager> new_thts_manager, 
@@ -81,11 +113,65 @@ namespace thts {
         if (work_left()) {
             throw runtime_error("Tried to change root node in thts pool while it was working.");
         }
+        join();
+        if (new_thts_manager == thts_manager) {
+            thts_manager->start_new_node_arena();
+        }
         thts_manager = new_thts_manager;
         root_node = new_root_node;
         logger = new_logger;
     }
 
+    /**
+     * Waits for the workers to be idle, then looks up the new root in the tree, makes it the root node and releases 
+     * the old tree. 
+     * 
+     * 'work_left' alone isn't enough to check that the pool is idle, as it is false as soon as the last trials have 
+     * been claimed (or the time limit has passed), while those trials may still be running. So we 'join' first, 
+     * which also waits for 'num_threads_working' to reach zero. Only then is it safe to modify the tree, the 
+     * transposition table and the node arena.
+     * 
+     * To free the old tree in the background, the only reference to the old root held by the pool is moved into the 
+     * 'old_tree_deleter' thread (after waiting for any previous deleter thread). The old tree never references the new 
+     * root's subtree other than through shared_ptrs, so once the workers are idle, freeing it concurrently with any 
+     * trials started by later calls to 'run_trials' is safe.
+     * 
+     * New nodes are allocated in a new node arena from now on (see 'ThtsManager::start_new_node_arena'), so freeing 
+     * the old tree doesn't contend with new nodes being allocated. The old arena releases each of its slabs once the 
+     * nodes in it have been freed, so the new root's subtree only keeps the slabs that its nodes are in alive.
+     */
+    shared_ptr<ThtsDNode> ThtsPool::advance_root(
+        shared_ptr<const Action> action, 
+        shared_ptr<const Observation> observation,
+        bool free_old_tree_in_background) 
+    {
+        join();
+
+        if (!root_node->has_child_node_itfc(action)) return nullptr;
+        shared_ptr<ThtsCNode> chance_node = root_node->get_child_node_itfc(action);
+        if (!chance_node->has_child_node_itfc(observation)) return nullptr;
+        shared_ptr<ThtsDNode> new_root_node = chance_node->get_child_node_itfc(observation);
+        chance_node.reset();
+
+        new_root_node->make_root_node();
+
+        if (thts_manager->use_transposition_table) {
+            thts_manager->dmap.erase_up_to_timestep(new_root_node->decision_timestep);
+        }
+        thts_manager->start_new_node_arena();
+
+        shared_ptr<ThtsDNode> old_root_node = root_node;
+        root_node = new_root_node;
+        if (free_old_tree_in_background) {
+            if (old_tree_deleter.joinable()) {
+                old_tree_deleter.join();
+            }
+            old_tree_deleter = thread([old_root_node = move(old_root_node)]() mutable { old_root_node.reset(); });
+        }
+
+        return new_root_node;
+    }
+
     /**
      * Trial should be ended when we reach a leaf node for the search (that is, it is a leaf in the thts_env, or, it is 
      * at the maximum depth).
@@ -93,7 +179,7 @@ namespace thts {
      * Additionally when running in mcts mode, we want to end a trial once a new node has been made.
      */
     bool ThtsPool::should_continue_selection_phase(
-        shared_ptr<ThtsDNode> cur_node, bool new_decision_node_created_this_trial) 
+        const shared_ptr<ThtsDNode>& cur_node, bool new_decision_node_created_this_trial) 
     {
         if (cur_node->is_leaf()) return false;
         // if (cur_node->is_sink()) return false;
@@ -108,18 +194,24 @@ namespace thts {
      * Performs the following while 'should_continue_selection_phase' evaluates to true:
      * - decision node visit
      * - decision node select action
-     * - chance node visit
+     * - chance node visit (and add virtual loss if using)
      * - chance node sample outcome
      * - add nodes and rewards to 'nodes_to_backup' and 'rewards' vectors
      * 
      * Note that we don't lock cur_node when checking 'should_continue_selection_phase' because it only accesses values 
      * that should remain constant throughout the run.
      * 
+     * Rewards are read from the chance node (see 'ThtsCNode::get_child_node_and_reward'), which stores the reward for 
+     * each of its children when they're created (unless the managers 'cache_rewards' option is false).
+     * 
      * Throughout the function, whenever a decision/chance node is being used in a function/has function being called, 
      * it is protected by its appropriate lock.
      * 
      * At the end, to make the list of rewards sum to the total return of the trial (consider when the heuristic_fn is 
      * a rollout), we also add the heuristic_value of the last node considered this trial.
+     * 
+     * Node pointers are moved (rather than copied) where possible, to avoid atomic reference count updates on nodes 
+     * that are shared between threads. 
      */
     void ThtsPool::run_selection_phase(
         vector<pair<shared_ptr<ThtsDNode>,shared_ptr<ThtsCNode>>>& nodes_to_backup, 
@@ -141,21 +233,23 @@ namespace thts {
             chance_node->lock();
             int pre_visit_children = chance_node->get_num_children();
             chance_node->visit_itfc(context);
+            if (thts_manager->virtual_loss > 0.0) {
+                chance_node->add_virtual_loss();
+            }
             shared_ptr<const Observation> observation = chance_node->sample_observation_itfc(context);
             int post_visit_children = chance_node->get_num_children();
             if (post_visit_children > pre_visit_children) {
                 new_decision_node_created_this_trial = true;
             }
-            shared_ptr<ThtsDNode> decision_node = chance_node->get_child_node_itfc(observation);
+            double reward;
+            shared_ptr<ThtsDNode> decision_node = chance_node->get_child_node_and_reward(observation, reward);
             chance_node->unlock();
 
             // push onto 'nodes_to_backup' and 'rewards'
-            shared_ptr<const State> state = cur_node->state;
-            double reward = thts_manager->thts_env->get_reward_itfc(state, action, observation);
-            nodes_to_backup.push_back(make_pair(cur_node, chance_node));
+            nodes_to_backup.emplace_back(std::move(cur_node), std::move(chance_node));
             rewards.push_back(reward);
 
-            cur_node = decision_node;
+            cur_node = std::move(decision_node);
         }
 
         // visit the final node and add heuristic value to list of rewards at end
@@ -169,7 +263,7 @@ namespace thts {
     /**
      * Used by a worker thread to run the backup phase of a trial.
      * 
-     * Iterates through the nodes that are needed to be backed up, computes the vectors and sums of rewards that the 
+     * Iterates through the nodes that are needed to be backed up, computes the lists and sums of rewards that the 
      * backup function expects, and calls backup on each of them. Noting that we are backing up from the bottom, so 
      * we call backup on chance node before decision node.
      * 
@@ -180,42 +274,58 @@ namespace thts {
      * - rewards_before = [r0,r1,r2,...,r(i-1)]
      * - total_return_after = sum(rewards_after)
      * - total_return = sum(rewards_after) + sum(rewards_before)
+     * 
+     * Every 'rewards_before' is a prefix of 'rewards', and every 'rewards_after' is a prefix of 'rewards' reversed. So 
+     * the reversed rewards and the prefix sums of 'rewards' are computed once (into thread local buffers), and each 
+     * node is passed RewardsView's into them, making the cost of the backup phase linear in the depth of the trial, 
+     * rather than quadratic. Sums are accumulated in the same order as building the lists up one reward at a time.
+     * 
+     * If using virtual loss, then the virtual loss added to chance nodes in the selection phase is removed just before 
+     * the chance node is backed up.
      */
     void ThtsPool::run_backup_phase(
         vector<pair<shared_ptr<ThtsDNode>,shared_ptr<ThtsCNode>>>& nodes_to_backup, 
         vector<double>& rewards, 
         ThtsEnvContext& context)
     {
+        vector<double>& reversed_rewards = thread_trial_buffers.reversed_rewards;
+        vector<double>& reward_prefix_sums = thread_trial_buffers.reward_prefix_sums;
+        reversed_rewards.assign(rewards.rbegin(), rewards.rend());
+        reward_prefix_sums.resize(rewards.size());
+
         double total_return = 0.0;
-        for (double& reward : rewards) total_return += reward;
+        for (size_t i=0; i<rewards.size(); i++) {
+            reward_prefix_sums[i] = total_return;
+            total_return += rewards[i];
+        }
 
-        vector<double> rewards_after;
-        vector<double> rewards_before(rewards);
+        double total_return_after = reversed_rewards[0];
 
-        double heuristic_val_at_end = rewards_before.back();
-        rewards_before.pop_back();
-        rewards_after.push_back(heuristic_val_at_end);
+        size_t num_rewards_before = rewards.size() - 1;
+        while (nodes_to_backup.size() > 0) {
+            num_rewards_before--;
+            total_return_after += rewards[num_rewards_before];
 
-        double total_return_after = heuristic_val_at_end;
+            RewardsView rewards_before(rewards.data(), num_rewards_before, reward_prefix_sums[num_rewards_before]);
+            RewardsView rewards_after(
+                reversed_rewards.data(), rewards.size() - num_rewards_before, total_return_after);
 
-        while (nodes_to_backup.size() > 0) {
-            double reward = rewards_before.back();
-            rewards_before.pop_back();
-            rewards_after.push_back(reward);
-            total_return_after += reward;
-
-            pair<shared_ptr<ThtsDNode>,shared_ptr<ThtsCNode>> pr = nodes_to_backup.back();
-            shared_ptr<ThtsDNode> decision_node = pr.first;
-            shared_ptr<ThtsCNode> chance_node = pr.second;
-            nodes_to_backup.pop_back();
+            pair<shared_ptr<ThtsDNode>,shared_ptr<ThtsCNode>>& pr = nodes_to_backup.back();
+            ThtsDNode* decision_node = pr.first.get();
+            ThtsCNode* chance_node = pr.second.get();
 
             chance_node->lock();
+            if (thts_manager->virtual_loss > 0.0) {
+                chance_node->remove_virtual_loss();
+            }
             chance_node->backup_itfc(rewards_before, rewards_after, total_return_after, total_return, context);
             chance_node->unlock();
 
             decision_node->lock();
             decision_node->backup_itfc(rewards_before, rewards_after, total_return_after, total_return, context);
             decision_node->unlock();
+
+            nodes_to_backup.pop_back();
         }
     }
 
@@ -229,27 +339,96 @@ namespace thts {
      * Checks if each condition is violated in turn, and returns false if violated, otherwise returns true at end.
      */
     bool ThtsPool::work_left() {
-        if (trials_remaining <= 0) return false;
+        if (trials_remaining.load(memory_order_relaxed) <= 0) return false;
+        if (!time_left()) return false;
+        return true;
+    }
 
-        chrono::time_point<chrono::system_clock> cur_time = chrono::system_clock::now();
-        chrono::duration<double> elapsed_time = cur_time - start_time;
-        if (elapsed_time >= max_run_time) return false;
+    /**
+     * Sets the time limits for a 'run_trials' call.
+     * 
+     * The deadline saturates at the max steady_clock time point, so that the default 'max_time' (max double) doesn't 
+     * overflow.
+     */
+    void ThtsPool::set_run_time_limits(
+        chrono::time_point<chrono::steady_clock> new_start_time, chrono::duration<double> new_max_run_time) 
+    {
+        start_time = new_start_time;
+        max_run_time = new_max_run_time;
+
+        chrono::duration<double> time_until_max_deadline = chrono::steady_clock::time_point::max() - start_time;
+        if (max_run_time >= time_until_max_deadline) {
+            deadline = chrono::steady_clock::time_point::max();
+        } else {
+            deadline = start_time + chrono::duration_cast<chrono::steady_clock::duration>(max_run_time);
+        }
+    }
 
-        return true;
+    /**
+     * Checks the current (steady clock) time against the deadline.
+     */
+    bool ThtsPool::time_left() const {
+        return chrono::steady_clock::now() < deadline;
+    }
+
+    /**
+     * Claims a chunk of trials using a single atomic fetch_sub (guided scheduling).
+     * 
+     * The chunk size is a heuristic, computed from a relaxed load. If another thread claims trials in between the load 
+     * and the fetch_sub, then 'trials_remaining' may go negative, and we only run the trials that were actually 
+     * available at the time of our fetch_sub.
+     */
+    int ThtsPool::claim_trials(int& trials_remaining_at_claim) {
+        int remaining_estimate = trials_remaining.load(memory_order_relaxed);
+        if (remaining_estimate <= 0) {
+            trials_remaining_at_claim = remaining_estimate;
+            return 0;
+        }
+
+        int chunk_size = remaining_estimate / (2 * max(1, num_threads));
+        chunk_size = min(max(1, chunk_size), max_trial_chunk_size);
+
+        trials_remaining_at_claim = trials_remaining.fetch_sub(chunk_size, memory_order_relaxed);
+        if (trials_remaining_at_claim <= 0) return 0;
+        return min(chunk_size, trials_remaining_at_claim);
+    }
+
+    /**
+     * Repeatedly claims chunks of trials and runs them, checking the deadline (lock free) before each trial.
+     * 
+     * If the deadline passes part way through a chunk, then the unrun trials are returned to 'trials_remaining', so 
+     * that it reflects the number of trials that were not run.
+     */
+    void ThtsPool::run_claimed_trials() {
+        int trials_remaining_at_claim;
+        int num_claimed = claim_trials(trials_remaining_at_claim);
+        while (num_claimed > 0) {
+            for (int i=0; i<num_claimed; i++) {
+                if (!time_left()) {
+                    trials_remaining.fetch_add(num_claimed - i, memory_order_relaxed);
+                    return;
+                }
+                run_thts_trial(trials_remaining_at_claim - i - 1);
+            }
+            num_claimed = claim_trials(trials_remaining_at_claim);
+        }
     }
 
     /**
      * Used by a worker thread to run a single trial of thts
      * 
      * Selection phase uses visit and selection functions to fill 'nodes_to_backup' and 'rewards', passed by ref.
-     * Backup phase calls backup on 'nodes_to_backup' passing them rewards from 'rewards'.
+     * Backup phase calls backup on 'nodes_to_backup' passing them rewards from 'rewards'. Both are thread local 
+     * buffers that are reused between trials ('nodes_to_backup' is emptied by the backup phase).
      * 
      * Trys to perform logging at the end of this trial (if there is a logger and is time to log)
      */
     void ThtsPool::run_thts_trial(int trials_remaining) {
-        vector<pair<shared_ptr<ThtsDNode>,shared_ptr<ThtsCNode>>> nodes_to_backup;
-        vector<double> rewards; 
-        
+        vector<pair<shared_ptr<ThtsDNode>,shared_ptr<ThtsCNode>>>& nodes_to_backup = thread_trial_buffers.nodes_to_backup;
+        vector<double>& rewards = thread_trial_buffers.rewards;
+        nodes_to_backup.clear();
+        rewards.clear();
+
         shared_ptr<ThtsEnvContext> context = thts_manager->thts_env->sample_context_itfc(root_node->state);
         run_selection_phase(nodes_to_backup, rewards, *context);
         run_backup_phase(nodes_to_backup, rewards, *context);
@@ -290,7 +469,8 @@ namespace thts {
      *      - notify work_left_cv to try to signal any threads waiting on workers completing
      *      - wait on work_left_cv until notified
      * - if just woken up from waiting on work_left_cv: 
-     *      -check if thread_pool is still alive, and if not, exit
+     *      -check if thread_pool is still alive, and if not, exit (releasing the thread's evaluators and random 
+     *          number stream in the manager, see 'ThtsManager::release_thread_state')
      * - when can run a trial: 
      *      - decrement trials remaining to indicate we're going to run a trial
      *      - increment num_threads_working to indicate we're starting some work
@@ -298,8 +478,17 @@ namespace thts {
      * 
      * A lock_guard is used to make sure that the work_left_lock is locked throughout the routine, except while waiting 
      * on work_left_cv, and when unlocked around running a trial.
+     * 
+     * When 'use_lock_free_dispatch' is true, rather than decrementing trials remaining and running a single trial, the 
+     * worker unlocks work_left_lock and runs trials (claimed in chunks from the atomic 'trials_remaining') until there 
+     * is no work left. So work_left_lock and work_left_cv are only used when a worker goes idle.
+     * 
+     * If the manager has a leaf evaluator, then workers tell it when they start and stop running trials, so that it 
+     * can dispatch a batch as soon as all of the workers running trials are parked waiting on evaluations.
      */
     void ThtsPool::worker_fn() {
+        BatchedLeafEvaluator* leaf_evaluator = thts_manager->leaf_evaluator.get();
+
         lock_guard<mutex> lg(work_left_lock);
         while (thread_pool_alive) {
             num_threads_working--;
@@ -309,17 +498,32 @@ namespace thts {
             }
             while (!work_left()) {
                 work_left_cv.wait(work_left_lock);
-                if (!thread_pool_alive) return;
+                if (!thread_pool_alive) {
+                    thts_manager->release_thread_state();
+                    return;
+                }
             }
 
             num_threads_working++;
-            trials_remaining--;
-            int trials_remaining_copy = trials_remaining;
+
+            if (use_lock_free_dispatch) {
+                work_left_lock.unlock();
+                if (leaf_evaluator != nullptr) leaf_evaluator->add_active_worker();
+                run_claimed_trials();
+                if (leaf_evaluator != nullptr) leaf_evaluator->remove_active_worker();
+                work_left_lock.lock();
+                continue;
+            }
+
+            int trials_remaining_copy = --trials_remaining;
 
             work_left_lock.unlock();
+            if (leaf_evaluator != nullptr) leaf_evaluator->add_active_worker();
             run_thts_trial(trials_remaining_copy);
+            if (leaf_evaluator != nullptr) leaf_evaluator->remove_active_worker();
             work_left_lock.lock();
         }
+        thts_manager->release_thread_state();
     }
 
     /**
@@ -362,8 +566,7 @@ namespace thts {
         work_left_lock.lock();
         num_trials = max_trials;
         trials_remaining = max_trials;
-        start_time = std::chrono::system_clock::now();
-        max_run_time =  std::chrono::duration<double>(max_time);
+        set_run_time_limits(chrono::steady_clock::now(), chrono::duration<double>(max_time));
         work_left_lock.unlock();
 
         work_left_cv.notify_all();
@@ -4,11 +4,17 @@
 #include "thts_manager.h"
 #include "thts_types.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <functional>
+#include <limits>
 #include <mutex>
+#include <stdexcept>
+#include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 using namespace std;
 using namespace thts;
@@ -32,7 +38,8 @@ namespace thts {
             decision_depth(decision_depth),
             decision_timestep(decision_timestep),
             parent(parent),
-            num_visits(0)
+            num_visits(0),
+            num_virtual_losses(0)
     {
     }
 
@@ -57,11 +64,32 @@ namespace thts {
         return node_lock; 
     }
 
+    /**
+     * Increments the (atomic) virtual loss counter.
+     */
+    void ThtsCNode::add_virtual_loss() {
+        num_virtual_losses.fetch_add(1, memory_order_relaxed);
+    }
+
+    /**
+     * Decrements the (atomic) virtual loss counter.
+     */
+    void ThtsCNode::remove_virtual_loss() {
+        num_virtual_losses.fetch_sub(1, memory_order_relaxed);
+    }
+
+    /**
+     * Reads the (atomic) virtual loss counter.
+     */
+    int ThtsCNode::get_num_virtual_losses() const {
+        return num_virtual_losses.load(memory_order_relaxed);
+    }
+
     /**
      * Helper function to lock all children nodes.
      */
     void ThtsCNode::lock_all_children() const {
-        for (auto action_child_pair : children) {
+        for (const auto& action_child_pair : children) {
             action_child_pair.second->lock();
         }
     }
@@ -70,7 +98,7 @@ namespace thts {
      * Helper function to unlock all children nodes.
      */
     void ThtsCNode::unlock_all_children() const {
-        for (auto action_child_pair : children) {
+        for (const auto& action_child_pair : children) {
             action_child_pair.second->unlock();
         }
     }
@@ -91,41 +119,41 @@ namespace thts {
      * If using a transposition table, we first check the transposition table to try get it from there. If it's not in 
      * the table, we make the child and insert it in children and the transposition table.
      * 
-     * Additionally, we protect accessing 'dmap[dnode_id]' with the mutex 'thts_manager->dmap_mutexes[mutex_indx]' 
-     * where 'mutex_indx = hash(dnode_id) % thts_manager->dmap_mutexes.size()', by locking it using a lock_guard.
+     * The key (decision_timestep, observation) is hashed once for both the lookup and the insert. The child is made 
+     * without holding any lock in the transposition table, so if another thread inserted the same child in the 
+     * meantime, 'insert' returns that child instead, and the one we made is discarded.
+     * 
+     * Entries in the table may have expired if the node was freed (e.g. when the root was advanced using 
+     * 'ThtsPool::advance_root' and the node was only in a discarded subtree). The table treats these as missing.
+     * 
+     * If caching rewards, the reward for reaching the child is computed here (once per child) and stored in 
+     * 'child_rewards', at the position of the child's slot in 'children'.
      */
     shared_ptr<ThtsDNode> ThtsCNode::create_child_node_itfc(
-        shared_ptr<const Observation> observation, shared_ptr<const State> next_state) 
+        const shared_ptr<const Observation>& observation, const shared_ptr<const State>& next_state) 
     {
         if (has_child_node_itfc(observation)) return get_child_node_itfc(observation);
 
+        shared_ptr<ThtsDNode> child_node;
         if (!thts_manager->use_transposition_table) {
-            shared_ptr<ThtsDNode> child_node = create_child_node_helper_itfc(observation, next_state);
-            children[observation] = child_node;
-            return child_node;
+            child_node = create_child_node_helper_itfc(observation, next_state);
+        } else {
+            TranspositionTable& dmap = thts_manager->dmap;
+            size_t dnode_id_hash = TranspositionTable::compute_hash(decision_timestep, observation);
+            child_node = dmap.find(dnode_id_hash, decision_timestep, observation);
+            if (child_node == nullptr) {
+                child_node = create_child_node_helper_itfc(observation, next_state);
+                child_node = dmap.insert(dnode_id_hash, decision_timestep, observation, child_node);
+            }
         }
 
-        DNodeTable& dmap = thts_manager->dmap;
-        DNodeIdTuple dnode_id = make_tuple(decision_timestep, observation);
-
-        int mutex_indx = 0;
-        if (thts_manager->dmap_mutexes.size() > 1) {
-            size_t tpl_hash = hash<DNodeIdTuple>()(dnode_id);
-            mutex_indx = tpl_hash % thts_manager->dmap_mutexes.size();
-        }
-
-        lock_guard<mutex> lg(thts_manager->dmap_mutexes[mutex_indx]);
-
-        auto iter = dmap.find(dnode_id);
-        if (iter != dmap.end()) {
-            shared_ptr<ThtsDNode> child_node = shared_ptr<ThtsDNode>(dmap[dnode_id]);
-            children[observation] = child_node;
-            return child_node;
+        size_t position = children.insert_or_assign(observation, child_node).first.position();
+        if (thts_manager->cache_rewards) {
+            if (child_rewards.size() <= position) {
+                child_rewards.resize(position+1, numeric_limits<double>::quiet_NaN());
+            }
+            child_rewards[position] = thts_manager->thts_env->get_reward_itfc(state, action, observation);
         }
-
-        shared_ptr<ThtsDNode> child_node = create_child_node_helper_itfc(observation, next_state);
-        children[observation] = child_node;
-        dmap[dnode_id] = child_node;
         return child_node;
     }
 
@@ -157,7 +185,7 @@ namespace thts {
      * iterator if it is not in the map. So if the returned iterator == children.end() then a child doesn't exist for 
      * that action in the children map.
      */
-    bool ThtsCNode::has_child_node_itfc(shared_ptr<const Observation> observation) const {
+    bool ThtsCNode::has_child_node_itfc(const shared_ptr<const Observation>& observation) const {
         auto iterator = children.find(observation);
         return iterator != children.end();
     }
@@ -165,10 +193,32 @@ namespace thts {
     /**
      * Just looks up observation in 'children' map.
      */
-    shared_ptr<ThtsDNode> ThtsCNode::get_child_node_itfc(shared_ptr<const Observation> observation) const {
+    shared_ptr<ThtsDNode> ThtsCNode::get_child_node_itfc(const shared_ptr<const Observation>& observation) const {
         return children.at(observation);
     }
 
+    /**
+     * Finds the child in 'children', and uses its slot position to look up the reward in 'child_rewards', falling 
+     * back to the environment if it wasn't stored (if not caching rewards, or if the child wasn't created through 
+     * 'create_child_node_itfc'). Throws 'std::out_of_range' if there is no child for 'observation' (like 
+     * 'get_child_node_itfc').
+     */
+    shared_ptr<ThtsDNode> ThtsCNode::get_child_node_and_reward(
+        const shared_ptr<const Observation>& observation, double& reward) const 
+    {
+        auto iterator = children.find(observation);
+        if (iterator == children.end()) {
+            throw out_of_range("ThtsCNode::get_child_node_and_reward: no child node for observation");
+        }
+        size_t position = iterator.position();
+        if (position < child_rewards.size() && !isnan(child_rewards[position])) {
+            reward = child_rewards[position];
+        } else {
+            reward = thts_manager->thts_env->get_reward_itfc(state, action, observation);
+        }
+        return iterator->second;
+    }
+
     /**
      * Returns a pretty printing of the node as a string. This is just a wrapper around the helper function. 
      * 
@@ -194,13 +244,20 @@ namespace thts {
         // Print out this nodes info
         ss << "C(vl=" << get_pretty_print_val() << ",#v=" << num_visits << ")[";
 
-        // print out child trees recursively
+        // print out child trees recursively (sorted by observation strings, so independent of the order children 
+        // stored)
+        vector<pair<string,ThtsDNode*>> sorted_children;
         for (const pair<const shared_ptr<const Observation>,shared_ptr<ThtsDNode>>& key_val_pair : children) {
-            const Observation& observation = *(key_val_pair.first);
+            stringstream observation_ss;
+            observation_ss << *(key_val_pair.first);
+            sorted_children.push_back(make_pair(observation_ss.str(), key_val_pair.second.get()));
+        }
+        sort(sorted_children.begin(), sorted_children.end());
+        for (pair<string,ThtsDNode*>& key_val_pair : sorted_children) {
             ThtsDNode& child_node = *(key_val_pair.second);
             ss << "\n";
             for (int i=0; i<num_tabs+1; i++) ss << "|\t";
-            ss << "{" << observation << "}->";
+            ss << "{" << key_val_pair.first << "}->";
             child_node.get_pretty_print_string_helper(ss, depth-1, num_tabs+1);
         }
 
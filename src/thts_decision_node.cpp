@@ -3,9 +3,13 @@
 #include "helper_templates.h"
 #include "thts_manager.h"
 
+#include <algorithm>
 #include <stdexcept>
+#include <string>
 #include <tuple>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 using namespace std;
 using namespace thts;
@@ -16,6 +20,10 @@ namespace thts {
      * Constructor mostly uses initialisation list. 
      * 
      * Nuance use of heuristic value is to enforce nodes for sink states to have a value of zero
+     * 
+     * If the manager has a 'leaf_evaluator', then the heuristic value (and prior) are evaluated in a batch, and this 
+     * thread is parked until the batch has been evaluated. The prior is kept in 'evaluated_policy_prior' until a 
+     * subclass gets it with 'compute_policy_prior'.
      */
     ThtsDNode::ThtsDNode(
         shared_ptr<ThtsManager> thts_manager,
@@ -28,13 +36,33 @@ namespace thts {
             state(state),
             decision_depth(decision_depth),
             decision_timestep(decision_timestep),
+            is_sink_node(thts_manager->thts_env->is_sink_state_itfc(state)),
             parent(parent),
             num_visits(0),
-            heuristic_value(0.0)
+            heuristic_value(0.0),
+            evaluated_policy_prior()
     {
-        if (thts_manager->heuristic_fn != nullptr && !thts_manager->thts_env->is_sink_state_itfc(state)) {
-            heuristic_value = thts_manager->heuristic_fn(state, thts_manager->thts_env);
+        if (thts_manager->leaf_evaluator != nullptr) {
+            bool evaluate_heuristic = thts_manager->has_heuristic_fn() && !is_sink_node;
+            LeafEvaluation evaluation = thts_manager->leaf_evaluator->evaluate(state, evaluate_heuristic);
+            heuristic_value = evaluation.heuristic_value;
+            evaluated_policy_prior = move(evaluation.policy_prior);
+            return;
+        }
+
+        if (thts_manager->has_heuristic_fn() && !is_sink_node) {
+            heuristic_value = thts_manager->compute_heuristic_value(state);
+        }
+    }
+
+    /**
+     * Returns the prior evaluated by the leaf evaluator if using one (only the first call), otherwise computes it.
+     */
+    shared_ptr<ActionPrior> ThtsDNode::compute_policy_prior() {
+        if (thts_manager->leaf_evaluator != nullptr) {
+            return move(evaluated_policy_prior);
         }
+        return thts_manager->compute_policy_prior(state);
     }
 
     /**
@@ -65,7 +93,7 @@ namespace thts {
      * Helper function to lock all children nodes.
      */
     void ThtsDNode::lock_all_children() const {
-        for (auto action_child_pair : children) {
+        for (const auto& action_child_pair : children) {
             action_child_pair.second->lock();
         }
     }
@@ -74,7 +102,7 @@ namespace thts {
      * Helper function to unlock all children nodes.
      */
     void ThtsDNode::unlock_all_children() const {
-        for (auto action_child_pair : children) {
+        for (const auto& action_child_pair : children) {
             action_child_pair.second->unlock();
         }
     }
@@ -87,10 +115,28 @@ namespace thts {
     }
 
     /**
-     * This node is a sink node iff the state corresponds to a sink state
+     * Default implementation only has access to visit counts of the children.
+     */
+    void ThtsDNode::fill_child_recommendation_stats_itfc(ChildRecommendationStatsMap& child_stats) const {
+        for (const pair<const shared_ptr<const Action>,shared_ptr<ThtsCNode>>& pr : children) {
+            lock_guard<mutex> lg(pr.second->get_lock());
+            child_stats[pr.first] = ChildRecommendationStats{pr.second->num_visits, 0.0};
+        }
+    }
+
+    /**
+     * Default implementation recommends the most visited action (the only statistic that the default implementation 
+     * of 'fill_child_recommendation_stats_itfc' fills in).
+     */
+    bool ThtsDNode::recommends_most_visited_itfc() const {
+        return true;
+    }
+
+    /**
+     * This node is a sink node iff the state corresponds to a sink state (which is checked once in the constructor)
      */
     bool ThtsDNode::is_sink() const {
-        return thts_manager->thts_env->is_sink_state_itfc(state);
+        return is_sink_node;
     }
 
     /**
@@ -110,7 +156,7 @@ namespace thts {
      * As transposition table is implemented for decision nodes, we don't need to use one for chance nodes. If two 
      * chance nodes would be transpositions, then their parent (decision) nodes would be transpositions!
      */
-    shared_ptr<ThtsCNode> ThtsDNode::create_child_node_itfc(shared_ptr<const Action> action) {
+    shared_ptr<ThtsCNode> ThtsDNode::create_child_node_itfc(const shared_ptr<const Action>& action) {
         if (has_child_node_itfc(action)) return get_child_node_itfc(action);
         shared_ptr<ThtsCNode> child_node = create_child_node_helper_itfc(action);
         children[action] = child_node;
@@ -120,13 +166,42 @@ namespace thts {
     /**
      * A decision node is the root node iff the decision depth is 0.
      * 
-     * TODO: this current implementation will lead to bugs if trying to reuse trees. Consider changing implementation 
-     * to use parent. And make sure root node doesn't have a parent in thts routine.
+     * When reusing trees, 'make_root_node' must be called on the new root, to maintain this invariant.
      */
     bool ThtsDNode::is_root_node() const {
         return decision_depth == 0;
     }
 
+    /**
+     * Depth first traversal of the subtree, using an explicit stack so that deep trees cannot overflow the call stack. 
+     * When using a transposition table the subtree may be a DAG, so keep track of the decision nodes already updated 
+     * (their chance node children are only reachable through them, so don't need tracking).
+     */
+    void ThtsDNode::make_root_node() {
+        int depth_reduction = decision_depth;
+        parent.reset();
+        if (depth_reduction == 0) return;
+
+        unordered_set<ThtsDNode*> visited;
+        vector<ThtsDNode*> stack;
+        visited.insert(this);
+        stack.push_back(this);
+        while (!stack.empty()) {
+            ThtsDNode* dnode = stack.back();
+            stack.pop_back();
+            dnode->decision_depth -= depth_reduction;
+            for (pair<const shared_ptr<const Action>,shared_ptr<ThtsCNode>>& cpr : dnode->children) {
+                ThtsCNode& cnode = *cpr.second;
+                cnode.decision_depth -= depth_reduction;
+                for (pair<const shared_ptr<const Observation>,shared_ptr<ThtsDNode>>& dpr : cnode.children) {
+                    if (visited.insert(dpr.second.get()).second) {
+                        stack.push_back(dpr.second.get());
+                    }
+                }
+            }
+        }
+    }
+
     /**
      * Just passes information out of the thts manager 
      */
@@ -150,6 +225,10 @@ namespace thts {
         return num_visits;
     }
 
+    int ThtsDNode::get_decision_depth() const {
+        return decision_depth;
+    }
+
     /**
      * Number of children = length of children map.
      */
@@ -162,7 +241,7 @@ namespace thts {
      * iterator if it is not in the map. So if the returned iterator == children.end() then a child doesn't exist for 
      * that action in the children map.
      */
-    bool ThtsDNode::has_child_node_itfc(shared_ptr<const Action> action) const {
+    bool ThtsDNode::has_child_node_itfc(const shared_ptr<const Action>& action) const {
         auto iterator = children.find(action);
         return iterator != children.end();
     }
@@ -170,7 +249,7 @@ namespace thts {
     /**
      * Just looks up action in 'children' map.
      */
-    shared_ptr<ThtsCNode> ThtsDNode::get_child_node_itfc(shared_ptr<const Action> action) const {
+    shared_ptr<ThtsCNode> ThtsDNode::get_child_node_itfc(const shared_ptr<const Action>& action) const {
         return children.at(action);
     }
 
@@ -206,13 +285,19 @@ namespace thts {
             return;
         }
 
-        // print out child trees recursively
+        // print out child trees recursively (sorted by action strings, so independent of the order children stored)
+        vector<pair<string,ThtsCNode*>> sorted_children;
         for (const pair<const shared_ptr<const Action>,shared_ptr<ThtsCNode>>& key_val_pair : children) {
-            const Action& action = *(key_val_pair.first);
+            stringstream action_ss;
+            action_ss << *(key_val_pair.first);
+            sorted_children.push_back(make_pair(action_ss.str(), key_val_pair.second.get()));
+        }
+        sort(sorted_children.begin(), sorted_children.end());
+        for (pair<string,ThtsCNode*>& key_val_pair : sorted_children) {
             ThtsCNode& child_node = *(key_val_pair.second);
             ss << "\n";
             for (int i=0; i<num_tabs+1; i++) ss << "|\t";
-            ss << "\"" << action << "\"->";
+            ss << "\"" << key_val_pair.first << "\"->";
             child_node.get_pretty_print_string_helper(ss, depth-1, num_tabs+1);
         }
 
@@ -6,6 +6,13 @@
 
 using namespace std;
 
+/**
+ * Thread local cache of the last context returned by the default 'sample_context_itfc' on the calling thread.
+ */
+namespace {
+    thread_local shared_ptr<thts::ThtsEnvContext> thread_context_cache;
+}
+
 namespace thts {
     /**
      * Constructor
@@ -58,11 +65,19 @@ namespace thts {
     /**
      * Default implementation of 'sample_context'
      * 
-     * Returns an (default constructed) ThtsEnvContext, which is really just a wrapper around an empty map. It's useful 
-     * to return this type so we can subclass it, rather than forcing Thts algorithms to use a specific map for a 
-     * context.
+     * Returns an (empty) ThtsEnvContext, which is really just a wrapper around an empty map. It's useful to return 
+     * this type so we can subclass it, rather than forcing Thts algorithms to use a specific map for a context.
+     * 
+     * Contexts are recycled per thread rather than allocated for every trial. If the context returned last time on 
+     * this thread is only referenced by the cache (i.e. the trial that used it has finished), it is cleared and 
+     * returned again, otherwise (e.g. a context is sampled while another is in use) a new context is made.
      */
     shared_ptr<ThtsEnvContext> ThtsEnv::sample_context_itfc(shared_ptr<const State> state) const {
-        return make_shared<ThtsEnvContext>();
+        if (thread_context_cache != nullptr && thread_context_cache.use_count() == 1) {
+            thread_context_cache->clear();
+            return thread_context_cache;
+        }
+        thread_context_cache = make_shared<ThtsEnvContext>();
+        return thread_context_cache;
     }
 } 
\ No newline at end of file
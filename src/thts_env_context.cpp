@@ -1,7 +1,25 @@
 #include "thts_env_context.h"
 
+#include <mutex>
+#include <stdexcept>
+
 using namespace std;
 
+/**
+ * The registry of context slots, mapping slot names to their index and type.
+ */
+namespace {
+    struct ContextSlotRegistry {
+        mutex registry_lock;
+        unordered_map<string, pair<size_t,type_index>> slots;
+    };
+
+    ContextSlotRegistry& get_context_slot_registry() {
+        static ContextSlotRegistry registry;
+        return registry;
+    }
+}
+
 namespace thts {
     /**
      * Implementation of 'get_value_for_key'
@@ -47,4 +65,32 @@ namespace thts {
    void ThtsEnvContext::erase_const(const string& key) {
         context_const.erase(key);
    }
+
+    /**
+     * Looks up the name in the registry, and adds a new slot (with the next index) if it isn't there.
+     */
+    size_t ThtsEnvContext::register_slot_index(const string& name, type_index type) {
+        ContextSlotRegistry& registry = get_context_slot_registry();
+        lock_guard<mutex> lg(registry.registry_lock);
+        auto iter = registry.slots.find(name);
+        if (iter == registry.slots.end()) {
+            size_t index = registry.slots.size();
+            registry.slots.emplace(name, make_pair(index, type));
+            return index;
+        }
+        if (iter->second.second != type) {
+            throw runtime_error("ThtsEnvContext slot '" + name + "' was already registered with a different type");
+        }
+        return iter->second.first;
+    }
+
+    /**
+     * Clears the maps, and resets the slot values without shrinking 'slot_values' or freeing inline values.
+     */
+    void ThtsEnvContext::clear() {
+        context.clear();
+        context_const.clear();
+        for (shared_ptr<void>& val : slot_values) val = nullptr;
+        for (InlineSlotValue& inline_val : inline_slot_values) inline_val.is_set = false;
+    }
 }
\ No newline at end of file
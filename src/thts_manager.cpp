@@ -0,0 +1,266 @@
+#include "thts_manager.h"
+
+#include <atomic>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Small thread local caches of the RandStreams and ThreadEvaluators used by the calling thread, tagged with the id of 
+ * the RandManager (or ThtsManager) they belong to. Each thread can have entries for a few managers at once, so that 
+ * a thread alternating between managers doesn't miss the cache each time.
+ *
+ * RandManager ids are never reused, so a cached entry from a RandManager that has since been destroyed can never be
+ * matched against a new RandManager. Entries are removed when a thread releases its stream or evaluators.
+ */
+namespace {
+    template <typename T>
+    struct ThreadManagerCache {
+        static constexpr int num_entries = 4;
+        uint64_t rand_manager_ids[num_entries] = {};
+        T* values[num_entries] = {};
+        int next_entry = 0;
+
+        T* find(uint64_t rand_manager_id) const {
+            for (int i=0; i<num_entries; i++) {
+                if (rand_manager_ids[i] == rand_manager_id) return values[i];
+            }
+            return nullptr;
+        }
+
+        void insert(uint64_t rand_manager_id, T* value) {
+            rand_manager_ids[next_entry] = rand_manager_id;
+            values[next_entry] = value;
+            next_entry = (next_entry + 1) % num_entries;
+        }
+
+        void erase(uint64_t rand_manager_id) {
+            for (int i=0; i<num_entries; i++) {
+                if (rand_manager_ids[i] == rand_manager_id) {
+                    rand_manager_ids[i] = 0;
+                    values[i] = nullptr;
+                }
+            }
+        }
+    };
+
+    thread_local ThreadManagerCache<thts::RandStream> thread_rand_stream_cache;
+    thread_local ThreadManagerCache<thts::ThreadEvaluators> thread_evaluators_cache;
+    atomic<uint64_t> next_rand_manager_id(1);
+}
+
+/**
+ * RandStream implementation
+ */
+namespace thts {
+    /**
+     * The tree index is only added to the seed sequences if it's non-zero, so that the first tree uses the same 
+     * streams as a search over a single tree.
+     */
+    RandStream::RandStream(uint32_t base_seed, int stream_id, uint32_t tree_index) :
+        int_gen(),
+        real_gen(),
+        int_distr(0,RAND_MAX),
+        real_distr(0.0,1.0)
+    {
+        vector<uint32_t> int_seeds = {base_seed, (uint32_t) stream_id, 0u};
+        vector<uint32_t> real_seeds = {base_seed, (uint32_t) stream_id, 1u};
+        if (tree_index != 0u) {
+            int_seeds.push_back(tree_index);
+            real_seeds.push_back(tree_index);
+        }
+        seed_seq int_seed_seq(int_seeds.begin(), int_seeds.end());
+        seed_seq real_seed_seq(real_seeds.begin(), real_seeds.end());
+        int_gen.seed(int_seed_seq);
+        real_gen.seed(real_seed_seq);
+    }
+}
+
+/**
+ * RandManager implementation
+ */
+namespace thts {
+    uint64_t RandManager::get_new_rand_manager_id() {
+        return next_rand_manager_id.fetch_add(1, memory_order_relaxed);
+    }
+
+    /**
+     * Reseeds the shared (compatibility mode) generators from (base_seed, tree_index), and discards any existing 
+     * RandStreams so that they're remade for the tree. The manager is given a new id, so that thread local caches 
+     * of the discarded streams are never used.
+     */
+    void RandManager::set_rand_tree_index(int tree_index) {
+        lock_guard<mutex> lg(rng_lock);
+        if ((uint32_t) tree_index == rand_tree_index) return;
+        rand_tree_index = tree_index;
+        seed_seq int_seed_seq{base_seed, rand_tree_index, 0u};
+        seed_seq real_seed_seq{base_seed, rand_tree_index, 1u};
+        int_gen.seed(int_seed_seq);
+        real_gen.seed(real_seed_seq);
+        thread_rand_streams.clear();
+        next_stream_id = 0;
+        rand_manager_id = get_new_rand_manager_id();
+    }
+
+    /**
+     * Checks the thread local cache first (lock free). If the cache misses, grabs the rng_lock and looks up (or
+     * creates) the stream for this thread, and updates the cache.
+     */
+    RandStream& RandManager::get_thread_rand_stream() {
+        RandStream* cached_stream = thread_rand_stream_cache.find(rand_manager_id);
+        if (cached_stream != nullptr) {
+            return *cached_stream;
+        }
+
+        lock_guard<mutex> lg(rng_lock);
+        thread::id thread_id = this_thread::get_id();
+        auto iter = thread_rand_streams.find(thread_id);
+        if (iter == thread_rand_streams.end()) {
+            int stream_id = next_stream_id++;
+            iter = thread_rand_streams.emplace(
+                thread_id, make_unique<RandStream>(base_seed, stream_id, rand_tree_index)).first;
+        }
+
+        thread_rand_stream_cache.insert(rand_manager_id, iter->second.get());
+        return *iter->second;
+    }
+
+    /**
+     * Removes the thread's cache entry before freeing the stream, so that the cache never points to a freed stream.
+     */
+    void RandManager::release_thread_rand_stream() {
+        lock_guard<mutex> lg(rng_lock);
+        thread_rand_stream_cache.erase(rand_manager_id);
+        thread_rand_streams.erase(this_thread::get_id());
+    }
+}
+
+
+/**
+ * ThtsManager implementation
+ */
+namespace thts {
+    /**
+     * Slabs are the same size as the old arena's.
+     */
+    void ThtsManager::start_new_node_arena() {
+        if (node_arena == nullptr) return;
+        node_arena->retire();
+        node_arena = make_shared<NodeArena>(node_arena->get_slab_size());
+    }
+
+    /**
+     * Checks the thread local cache first (lock free). If the cache misses, grabs the thread_evaluators_lock and 
+     * looks up (or clones) the evaluators for this thread, and updates the cache. References to values in an 
+     * unordered_map are stable, so the cache can point into 'thread_evaluators'.
+     */
+    ThreadEvaluators& ThtsManager::get_thread_evaluators() {
+        ThreadEvaluators* cached_evaluators = thread_evaluators_cache.find(rand_manager_id);
+        if (cached_evaluators != nullptr) {
+            return *cached_evaluators;
+        }
+
+        lock_guard<mutex> lg(thread_evaluators_lock);
+        thread::id thread_id = this_thread::get_id();
+        auto iter = thread_evaluators.find(thread_id);
+        if (iter == thread_evaluators.end()) {
+            ThreadEvaluators evaluators;
+            if (heuristic_evaluator != nullptr) {
+                evaluators.heuristic_evaluator = heuristic_evaluator->clone_for_thread();
+                if (evaluators.heuristic_evaluator == nullptr) evaluators.heuristic_evaluator = heuristic_evaluator;
+            }
+            if (prior_evaluator != nullptr) {
+                evaluators.prior_evaluator = prior_evaluator->clone_for_thread();
+                if (evaluators.prior_evaluator == nullptr) evaluators.prior_evaluator = prior_evaluator;
+            }
+            iter = thread_evaluators.emplace(thread_id, move(evaluators)).first;
+        }
+
+        thread_evaluators_cache.insert(rand_manager_id, &iter->second);
+        return iter->second;
+    }
+
+    /**
+     * As in 'release_thread_rand_stream', the thread's cache entry is removed before the evaluators are freed.
+     */
+    void ThtsManager::release_thread_state() {
+        {
+            lock_guard<mutex> lg(thread_evaluators_lock);
+            thread_evaluators_cache.erase(rand_manager_id);
+            thread_evaluators.erase(this_thread::get_id());
+        }
+        release_thread_rand_stream();
+    }
+
+    HeuristicEvaluator& ThtsManager::get_heuristic_evaluator() {
+        return *get_thread_evaluators().heuristic_evaluator;
+    }
+
+    PriorEvaluator& ThtsManager::get_prior_evaluator() {
+        return *get_thread_evaluators().prior_evaluator;
+    }
+
+    /**
+     * The batch functions are used instead of the single state functions if they are set (as 'heuristic_fn' is 
+     * non-null by default), and are called with a batch of one state.
+     */
+    double ThtsManager::compute_heuristic_value(shared_ptr<const State> state) {
+        if (heuristic_evaluator != nullptr) {
+            return get_heuristic_evaluator().evaluate(state, thts_env);
+        }
+        if (batch_heuristic_fn == nullptr) {
+            return (heuristic_fn != nullptr) ? heuristic_fn(state, thts_env) : 0.0;
+        }
+        vector<shared_ptr<const State>> states = {state};
+        vector<double> heuristic_values(1, 0.0);
+        batch_heuristic_fn(states, thts_env, heuristic_values);
+        return heuristic_values[0];
+    }
+
+    void ThtsManager::compute_heuristic_values(
+        const vector<shared_ptr<const State>>& states, vector<double>& heuristic_values)
+    {
+        if (heuristic_evaluator != nullptr) {
+            get_heuristic_evaluator().evaluate_batch(states, thts_env, heuristic_values);
+            return;
+        }
+        if (batch_heuristic_fn != nullptr) {
+            batch_heuristic_fn(states, thts_env, heuristic_values);
+            return;
+        }
+        for (size_t i=0; i<states.size(); i++) {
+            heuristic_values[i] = (heuristic_fn != nullptr) ? heuristic_fn(states[i], thts_env) : 0.0;
+        }
+    }
+
+    shared_ptr<ActionPrior> ThtsManager::compute_policy_prior(shared_ptr<const State> state) {
+        if (prior_evaluator != nullptr) {
+            return get_prior_evaluator().evaluate(state, thts_env);
+        }
+        if (batch_prior_fn == nullptr) {
+            return (prior_fn != nullptr) ? prior_fn(state, thts_env) : nullptr;
+        }
+        vector<shared_ptr<const State>> states = {state};
+        vector<shared_ptr<ActionPrior>> policy_priors(1);
+        batch_prior_fn(states, thts_env, policy_priors);
+        return policy_priors[0];
+    }
+
+    void ThtsManager::compute_policy_priors(
+        const vector<shared_ptr<const State>>& states, vector<shared_ptr<ActionPrior>>& policy_priors)
+    {
+        if (prior_evaluator != nullptr) {
+            get_prior_evaluator().evaluate_batch(states, thts_env, policy_priors);
+            return;
+        }
+        if (batch_prior_fn != nullptr) {
+            batch_prior_fn(states, thts_env, policy_priors);
+            return;
+        }
+        for (size_t i=0; i<states.size(); i++) {
+            policy_priors[i] = (prior_fn != nullptr) ? prior_fn(states[i], thts_env) : nullptr;
+        }
+    }
+}
\ No newline at end of file
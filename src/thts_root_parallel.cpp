@@ -0,0 +1,120 @@
+#include "thts_root_parallel.h"
+
+#include "helper_templates.h"
+
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+namespace thts {
+    /**
+     * Constructor. Checks that each tree has a distinct manager, derives the random number streams of each manager 
+     * for its tree, and makes a ThtsPool for each tree.
+     */
+    ThtsRootParallelPool::ThtsRootParallelPool(
+        vector<shared_ptr<ThtsManager>> thts_managers,
+        vector<shared_ptr<ThtsDNode>> root_nodes,
+        int num_threads_per_tree,
+        bool use_lock_free_dispatch) :
+            thts_managers(thts_managers),
+            root_nodes(root_nodes),
+            thts_pools()
+    {
+        if (thts_managers.size() == 0u || thts_managers.size() != root_nodes.size()) {
+            throw runtime_error("ThtsRootParallelPool needs one (distinct) ThtsManager for each root node.");
+        }
+
+        unordered_set<ThtsManager*> seen_managers;
+        for (size_t i=0; i<thts_managers.size(); i++) {
+            if (thts_managers[i] == nullptr || root_nodes[i] == nullptr) {
+                throw runtime_error("ThtsRootParallelPool given a nullptr manager or root node.");
+            }
+            if (!seen_managers.insert(thts_managers[i].get()).second) {
+                throw runtime_error("ThtsRootParallelPool needs a distinct ThtsManager for each root node.");
+            }
+        }
+
+        for (size_t i=0; i<thts_managers.size(); i++) {
+            thts_managers[i]->set_rand_tree_index(i);
+            thts_pools.push_back(make_unique<ThtsPool>(
+                thts_managers[i], root_nodes[i], num_threads_per_tree, nullptr, use_lock_free_dispatch));
+        }
+    }
+
+    int ThtsRootParallelPool::num_trees() const {
+        return thts_pools.size();
+    }
+
+    void ThtsRootParallelPool::join() {
+        for (unique_ptr<ThtsPool>& pool : thts_pools) {
+            pool->join();
+        }
+    }
+
+    /**
+     * Gives each tree 'max_trials / num_trees' trials, and gives the remainder out one at a time to the first trees.
+     */
+    void ThtsRootParallelPool::run_trials(int max_trials, double max_time, bool blocking) {
+        int n = num_trees();
+        for (int i=0; i<n; i++) {
+            int tree_trials = max_trials / n;
+            if (i < max_trials % n) tree_trials++;
+            thts_pools[i]->run_trials(tree_trials, max_time, false);
+        }
+        if (blocking) join();
+    }
+
+    /**
+     * Sums visit counts, and accumulates the visit weighted sum of values before normalising. If a child has zero 
+     * visits over all trees, then the value is the unweighted average over the trees.
+     */
+    void ThtsRootParallelPool::fill_merged_child_recommendation_stats(
+        ChildRecommendationStatsMap& merged_child_stats) const 
+    {
+        unordered_map<shared_ptr<const Action>,double> unweighted_value_sums;
+        unordered_map<shared_ptr<const Action>,int> num_trees_with_child;
+        for (const shared_ptr<ThtsDNode>& root_node : root_nodes) {
+            ChildRecommendationStatsMap child_stats;
+            root_node->fill_child_recommendation_stats_itfc(child_stats);
+            for (pair<const shared_ptr<const Action>,ChildRecommendationStats>& pr : child_stats) {
+                ChildRecommendationStats& merged_stats = merged_child_stats[pr.first];
+                merged_stats.num_visits += pr.second.num_visits;
+                merged_stats.value += pr.second.num_visits * pr.second.value;
+                unweighted_value_sums[pr.first] += pr.second.value;
+                num_trees_with_child[pr.first] += 1;
+            }
+        }
+
+        for (pair<const shared_ptr<const Action>,ChildRecommendationStats>& pr : merged_child_stats) {
+            if (pr.second.num_visits > 0) {
+                pr.second.value /= pr.second.num_visits;
+            } else {
+                pr.second.value = unweighted_value_sums[pr.first] / num_trees_with_child[pr.first];
+            }
+        }
+    }
+
+    /**
+     * Picks the argmax of the merged visit counts or merged values. If no tree has expanded any root children, falls 
+     * back to the recommendation of the first tree.
+     */
+    shared_ptr<const Action> ThtsRootParallelPool::recommend_action() const {
+        ChildRecommendationStatsMap merged_child_stats;
+        fill_merged_child_recommendation_stats(merged_child_stats);
+
+        if (merged_child_stats.size() == 0u) {
+            shared_ptr<ThtsEnvContext> context = thts_managers[0]->thts_env->sample_context_itfc(
+                root_nodes[0]->state);
+            return root_nodes[0]->recommend_action_itfc(*context);
+        }
+
+        bool use_visits = root_nodes[0]->recommends_most_visited_itfc();
+        unordered_map<shared_ptr<const Action>,double> recommendation_scores;
+        for (pair<const shared_ptr<const Action>,ChildRecommendationStats>& pr : merged_child_stats) {
+            recommendation_scores[pr.first] = use_visits ? (double) pr.second.num_visits : pr.second.value;
+        }
+        return helper::get_max_key_break_ties_randomly(recommendation_scores, *thts_managers[0]);
+    }
+}
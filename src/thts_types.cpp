@@ -253,35 +253,35 @@ namespace thts {
  */
 namespace std {
     /**
-     * Implementation of std::hash<Observation>, calling the virtual hash function.
+     * Implementation of std::hash<Observation>, calling the virtual hash function (or using the cached hash).
      */
     size_t hash<Observation>::operator()(const Observation& observation) const {
-        return observation.hash();
+        return observation.get_hash();
     }
 
     size_t hash<shared_ptr<const Observation>>::operator()(const shared_ptr<const Observation>& observation) const {
-        return observation->hash();
+        return observation->get_hash();
     }
 
     /**
-     * Implementation of std::equal_to<Observation>, calling the equals function.
+     * Implementation of std::equal_to<Observation>, calling the equals function (if the cached hashes don't differ).
      */
     bool operator==(const Observation& lhs, const Observation& rhs) {
-        return lhs.equals_itfc(rhs);
+        return lhs.equals_using_cached_hash(rhs);
     }
 
     bool operator==(const shared_ptr<const Observation>& lhs, const shared_ptr<const Observation>& rhs) {
-        return lhs->equals_itfc(*rhs);
+        return lhs->equals_using_cached_hash(*rhs);
     }
 
     bool equal_to<Observation>::operator()(const Observation& lhs, const Observation& rhs) const {
-        return lhs.equals_itfc(rhs);
+        return lhs.equals_using_cached_hash(rhs);
     }
 
     bool equal_to<shared_ptr<const Observation>>::operator()(
         const shared_ptr<const Observation>& lhs, const shared_ptr<const Observation>& rhs) const 
     {
-        return lhs->equals_itfc(*rhs);
+        return lhs->equals_using_cached_hash(*rhs);
     }
 
     /**
@@ -298,34 +298,34 @@ namespace std {
     }
 
     /**
-     * Implementation of std::hash<State>, calling the virtual hash function.
+     * Implementation of std::hash<State>, calling the virtual hash function (or using the cached hash).
      */
     size_t hash<State>::operator()(const State& state) const {
-        return state.hash();
+        return state.get_hash();
     }
     
     size_t hash<shared_ptr<const State>>::operator()(const shared_ptr<const State>& state) const {
-        return state->hash();
+        return state->get_hash();
     }
     /**
-     * Implementation of std::equal_to<State>, calling the equals function.
+     * Implementation of std::equal_to<State>, calling the equals function (if the cached hashes don't differ).
      */
     bool operator==(const State& lhs, const State& rhs) {
-        return lhs.equals_itfc(rhs);
+        return lhs.equals_using_cached_hash(rhs);
     }
 
     bool operator==(const shared_ptr<const State>& lhs, const shared_ptr<const State>& rhs) {
-        return lhs->equals_itfc(*rhs);
+        return lhs->equals_using_cached_hash(*rhs);
     }
 
     bool equal_to<State>::operator()(const State& lhs, const State& rhs) const {
-        return lhs.equals_itfc(rhs);
+        return lhs.equals_using_cached_hash(rhs);
     }
 
     bool equal_to<shared_ptr<const State>>::operator()(
         const shared_ptr<const State>& lhs, const shared_ptr<const State>& rhs) const 
     {
-        return lhs->equals_itfc(*rhs);
+        return lhs->equals_using_cached_hash(*rhs);
     }
 
     /**
@@ -342,35 +342,35 @@ namespace std {
     }
 
     /**
-     * Implementation of std::hash<Action>, calling the virtual hash function.
+     * Implementation of std::hash<Action>, calling the virtual hash function (or using the cached hash).
      */
     size_t hash<Action>::operator()(const Action& action) const {
-        return action.hash();
+        return action.get_hash();
     }
 
     size_t hash<shared_ptr<const Action>>::operator()(const shared_ptr<const Action>& action) const {
-        return action->hash();
+        return action->get_hash();
     }
 
     /**
-     * Implementation of std::equal_to<Action>, calling the equals function.
+     * Implementation of std::equal_to<Action>, calling the equals function (if the cached hashes don't differ).
      */
     bool operator==(const Action& lhs, const Action& rhs) {
-        return lhs.equals_itfc(rhs);
+        return lhs.equals_using_cached_hash(rhs);
     }
 
     bool operator==(const shared_ptr<const Action>& lhs, const shared_ptr<const Action>& rhs) {
-        return lhs->equals_itfc(*rhs);
+        return lhs->equals_using_cached_hash(*rhs);
     }
 
     bool equal_to<Action>::operator()(const Action& lhs, const Action& rhs) const {
-        return lhs.equals_itfc(rhs);
+        return lhs.equals_using_cached_hash(rhs);
     }
 
     bool equal_to<shared_ptr<const Action>>::operator()(
         const shared_ptr<const Action>& lhs, const shared_ptr<const Action>& rhs) const 
     {
-        return lhs->equals_itfc(*rhs);
+        return lhs->equals_using_cached_hash(*rhs);
     }
 
     /**
@@ -510,7 +510,7 @@ namespace std {
      */
     ostream& operator<<(ostream& os, const DNodeTable& tbl) {
         unordered_map<DNodeIdTuple,shared_ptr<ThtsDNode>> shared_tbl_for_print;
-        for (auto pr : tbl) {
+        for (const auto& pr : tbl) {
             shared_tbl_for_print.insert_or_assign(pr.first, shared_ptr<ThtsDNode>(pr.second));
         }
         os << helper::unordered_map_pretty_print_string(shared_tbl_for_print);
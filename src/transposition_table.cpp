@@ -0,0 +1,272 @@
+#include "transposition_table.h"
+
+#include "helper_templates.h"
+#include "thts_decision_node.h"
+
+#include <limits>
+
+using namespace std;
+
+namespace thts {
+    /**
+     * Constructor. Each segment holds at most max_size/num_segments entries (rounded up) if the size is limited.
+     */
+    TranspositionTable::TranspositionTable(int num_segments, size_t max_size) :
+        segments((num_segments > 0) ? num_segments : 1),
+        max_entries_per_segment(0)
+    {
+        if (max_size > 0) {
+            max_entries_per_segment = (max_size + segments.size() - 1) / segments.size();
+        }
+        for (Segment& segment : segments) {
+            segment.entries.resize(initial_segment_capacity);
+        }
+    }
+
+    /**
+     * Same as std::hash<DNodeIdTuple>, but without having to construct a tuple (and copy the observation pointer).
+     */
+    size_t TranspositionTable::compute_hash(int decision_timestep, const shared_ptr<const Observation>& observation) {
+        size_t hash_val = 0;
+        hash_val = helper::hash_combine(hash_val, decision_timestep);
+        hash_val = helper::hash_combine(hash_val, observation);
+        return hash_val;
+    }
+
+    /**
+     * Hashes (e.g. of integer types) can have poorly distributed bits, so mix them before using them as indices.
+     */
+    size_t TranspositionTable::mix_hash(size_t hash) {
+        uint64_t mixed = (uint64_t) hash;
+        mixed ^= mixed >> 33;
+        mixed *= 0xff51afd7ed558ccdULL;
+        mixed ^= mixed >> 33;
+        return (size_t) mixed;
+    }
+
+    TranspositionTable::Segment& TranspositionTable::get_segment(size_t mixed_hash) {
+        return segments[mixed_hash % segments.size()];
+    }
+
+    /**
+     * Segment capacities are powers of two, so can mask instead of taking a modulo.
+     */
+    size_t TranspositionTable::get_home_slot(const Segment& segment, size_t mixed_hash) const {
+        return (mixed_hash / segments.size()) & (segment.entries.size() - 1);
+    }
+
+    /**
+     * Linear probing from the home slot until an empty slot is found. Compares cached hashes before comparing keys.
+     */
+    size_t TranspositionTable::find_slot(
+        Segment& segment,
+        size_t hash,
+        size_t mixed_hash,
+        int decision_timestep,
+        const shared_ptr<const Observation>& observation)
+    {
+        vector<Entry>& entries = segment.entries;
+        size_t capacity = entries.size();
+        size_t mask = capacity - 1;
+        size_t slot = get_home_slot(segment, mixed_hash);
+        equal_to<shared_ptr<const Observation>> observation_equal_to;
+        for (size_t i=0; i<capacity; i++) {
+            Entry& entry = entries[slot];
+            if (entry.state == SlotState::empty) break;
+            if (entry.state == SlotState::occupied) {
+                if (entry.node.expired()) {
+                    make_tombstone(segment, slot);
+                } else if (entry.hash == hash
+                    && entry.decision_timestep == decision_timestep
+                    && observation_equal_to(entry.observation, observation))
+                {
+                    return slot;
+                }
+            }
+            slot = (slot + 1) & mask;
+        }
+        return capacity;
+    }
+
+    void TranspositionTable::make_tombstone(Segment& segment, size_t slot) {
+        Entry& entry = segment.entries[slot];
+        entry.observation.reset();
+        entry.node.reset();
+        entry.state = SlotState::tombstone;
+        segment.num_occupied--;
+        segment.num_tombstones++;
+    }
+
+    /**
+     * Reinserts all live entries into a new vector of slots.
+     */
+    void TranspositionTable::rebuild_segment(Segment& segment, size_t new_capacity) {
+        vector<Entry> old_entries(new_capacity);
+        old_entries.swap(segment.entries);
+        segment.num_occupied = 0;
+        segment.num_tombstones = 0;
+
+        size_t mask = new_capacity - 1;
+        for (Entry& entry : old_entries) {
+            if (entry.state != SlotState::occupied || entry.node.expired()) continue;
+            size_t slot = get_home_slot(segment, mix_hash(entry.hash));
+            while (segment.entries[slot].state == SlotState::occupied) {
+                slot = (slot + 1) & mask;
+            }
+            segment.entries[slot] = std::move(entry);
+            segment.num_occupied++;
+        }
+    }
+
+    /**
+     * If the segment is full (at 'max_entries_per_segment'), replaces an entry. Considers the occupied slots in the
+     * 'max_replacement_probes' slots from the home slot (or keeps looking until an occupied slot is found), and picks
+     * the first expired entry, or otherwise the entry with the fewest visits.
+     *
+     * Then keeps the number of used slots (occupied or tombstones) at most half of the capacity. If live entries (whose
+     * nodes haven't been freed) fill more than a quarter of the segment then it doubles in size, otherwise it is
+     * rebuilt at the same size (which just removes the tombstones and expired entries).
+     */
+    void TranspositionTable::make_space_for_insert(Segment& segment, size_t mixed_hash) {
+        size_t capacity = segment.entries.size();
+        if (max_entries_per_segment > 0 && segment.num_occupied >= max_entries_per_segment) {
+            size_t mask = capacity - 1;
+            size_t slot = get_home_slot(segment, mixed_hash);
+            size_t victim_slot = capacity;
+            int victim_visits = numeric_limits<int>::max();
+            for (size_t i=0; i<capacity && (i<max_replacement_probes || victim_slot == capacity); i++) {
+                Entry& entry = segment.entries[slot];
+                if (entry.state == SlotState::occupied) {
+                    shared_ptr<ThtsDNode> node = entry.node.lock();
+                    if (node == nullptr) {
+                        victim_slot = slot;
+                        break;
+                    }
+                    int visits = node->get_num_visits();
+                    if (visits < victim_visits) {
+                        victim_slot = slot;
+                        victim_visits = visits;
+                    }
+                }
+                slot = (slot + 1) & mask;
+            }
+            make_tombstone(segment, victim_slot);
+        }
+
+        if ((segment.num_occupied + segment.num_tombstones + 1) * 2 > capacity) {
+            size_t num_live = 0;
+            for (const Entry& entry : segment.entries) {
+                if (entry.state == SlotState::occupied && !entry.node.expired()) num_live++;
+            }
+            size_t new_capacity = capacity;
+            if ((num_live + 1) * 4 > capacity) new_capacity *= 2;
+            rebuild_segment(segment, new_capacity);
+        }
+    }
+
+    /**
+     * Looks up the key holding the segment lock. If the entry's node was freed between checking 'expired' and
+     * 'lock', the entry is turned into a tombstone.
+     */
+    shared_ptr<ThtsDNode> TranspositionTable::find(
+        size_t hash, int decision_timestep, const shared_ptr<const Observation>& observation)
+    {
+        size_t mixed_hash = mix_hash(hash);
+        Segment& segment = get_segment(mixed_hash);
+        lock_guard<mutex> lg(segment.segment_lock);
+        size_t slot = find_slot(segment, hash, mixed_hash, decision_timestep, observation);
+        if (slot == segment.entries.size()) return nullptr;
+        shared_ptr<ThtsDNode> node = segment.entries[slot].node.lock();
+        if (node == nullptr) make_tombstone(segment, slot);
+        return node;
+    }
+
+    /**
+     * Inserts into the first non-occupied slot from the home slot, after making space for the entry.
+     */
+    shared_ptr<ThtsDNode> TranspositionTable::insert(
+        size_t hash,
+        int decision_timestep,
+        const shared_ptr<const Observation>& observation,
+        const shared_ptr<ThtsDNode>& node)
+    {
+        size_t mixed_hash = mix_hash(hash);
+        Segment& segment = get_segment(mixed_hash);
+        lock_guard<mutex> lg(segment.segment_lock);
+
+        size_t slot = find_slot(segment, hash, mixed_hash, decision_timestep, observation);
+        if (slot != segment.entries.size()) {
+            shared_ptr<ThtsDNode> existing_node = segment.entries[slot].node.lock();
+            if (existing_node != nullptr) return existing_node;
+            make_tombstone(segment, slot);
+        }
+
+        make_space_for_insert(segment, mixed_hash);
+
+        size_t mask = segment.entries.size() - 1;
+        slot = get_home_slot(segment, mixed_hash);
+        while (segment.entries[slot].state == SlotState::occupied) {
+            slot = (slot + 1) & mask;
+        }
+
+        Entry& entry = segment.entries[slot];
+        if (entry.state == SlotState::tombstone) segment.num_tombstones--;
+        entry.hash = hash;
+        entry.decision_timestep = decision_timestep;
+        entry.observation = observation;
+        entry.node = node;
+        entry.state = SlotState::occupied;
+        segment.num_occupied++;
+        return node;
+    }
+
+    void TranspositionTable::erase_up_to_timestep(int decision_timestep) {
+        for (Segment& segment : segments) {
+            lock_guard<mutex> lg(segment.segment_lock);
+            for (size_t slot=0; slot<segment.entries.size(); slot++) {
+                Entry& entry = segment.entries[slot];
+                if (entry.state == SlotState::occupied && entry.decision_timestep <= decision_timestep) {
+                    make_tombstone(segment, slot);
+                }
+            }
+            rebuild_segment(segment, segment.entries.size());
+        }
+    }
+
+    void TranspositionTable::clear() {
+        for (Segment& segment : segments) {
+            lock_guard<mutex> lg(segment.segment_lock);
+            segment.entries.clear();
+            segment.entries.resize(initial_segment_capacity);
+            segment.num_occupied = 0;
+            segment.num_tombstones = 0;
+        }
+    }
+
+    size_t TranspositionTable::size() {
+        size_t total = 0;
+        for (Segment& segment : segments) {
+            lock_guard<mutex> lg(segment.segment_lock);
+            total += segment.num_occupied;
+        }
+        return total;
+    }
+
+    size_t TranspositionTable::get_num_tombstones() {
+        size_t total = 0;
+        for (Segment& segment : segments) {
+            lock_guard<mutex> lg(segment.segment_lock);
+            total += segment.num_tombstones;
+        }
+        return total;
+    }
+
+    size_t TranspositionTable::get_capacity() {
+        size_t total = 0;
+        for (Segment& segment : segments) {
+            lock_guard<mutex> lg(segment.segment_lock);
+            total += segment.entries.size();
+        }
+        return total;
+    }
+}
@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "algorithms/common/boltzmann_kernel.h"
+
+// includes
+#include "thts_types.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+
+/**
+ * Helper to get all of the simd levels that can be tested on this processor
+ */
+vector<SimdLevel> get_testable_simd_levels() {
+    vector<SimdLevel> levels = {SimdLevel::scalar};
+    if (get_supported_simd_level() == SimdLevel::avx2 || get_supported_simd_level() == SimdLevel::avx512) {
+        levels.push_back(SimdLevel::avx2);
+    }
+    if (get_supported_simd_level() == SimdLevel::avx512) {
+        levels.push_back(SimdLevel::avx512);
+    }
+    return levels;
+}
+
+/**
+ * Check each implementation against a direct computation with std::exp, for sizes that cover the vectorised tails,
+ * and for values where exp underflows
+ */
+TEST(BoltzmannKernel_UnitTest, weights_match_std_exp) {
+    mt19937 rng(60415);
+    uniform_real_distribution<double> value_distr(-800.0, 50.0);
+
+    for (SimdLevel level : get_testable_simd_levels()) {
+        for (size_t n=1; n<=37; n++) {
+            vector<double> values(n);
+            for (double& value : values) value = value_distr(rng);
+
+            double expected_max = numeric_limits<double>::lowest();
+            for (double value : values) expected_max = max(expected_max, value);
+            double expected_sum = 0.0;
+            vector<double> expected_weights(n);
+            for (size_t i=0; i<n; i++) {
+                double arg = values[i] - expected_max;
+                expected_weights[i] = (arg < -708.0) ? 0.0 : exp(arg);
+                expected_sum += expected_weights[i];
+            }
+
+            double max_value;
+            double sum_weights = compute_boltzmann_weights(values.data(), n, max_value, level);
+            EXPECT_EQ(max_value, expected_max);
+            EXPECT_NEAR(sum_weights, expected_sum, 1e-14 * expected_sum);
+            for (size_t i=0; i<n; i++) {
+                EXPECT_NEAR(values[i], expected_weights[i], 1e-15 * expected_weights[i]);
+            }
+        }
+    }
+}
+
+/**
+ * Check the log-sum-exp doesn't overflow for large values, and edge cases with zero and one values
+ */
+TEST(BoltzmannKernel_UnitTest, edge_cases) {
+    for (SimdLevel level : get_testable_simd_levels()) {
+        vector<double> values = {1000.0, 1000.0, 999.0};
+        double max_value;
+        double sum_weights = compute_boltzmann_weights(values.data(), values.size(), max_value, level);
+        EXPECT_NEAR(max_value + log(sum_weights), 1000.0 + log(2.0 + exp(-1.0)), 1e-12);
+
+        vector<double> single_value = {-3.0};
+        EXPECT_DOUBLE_EQ(compute_boltzmann_weights(single_value.data(), 1, max_value, level), 1.0);
+        EXPECT_EQ(max_value, -3.0);
+        EXPECT_EQ(single_value[0], 1.0);
+
+        EXPECT_EQ(compute_boltzmann_weights(nullptr, 0, max_value, level), 0.0);
+    }
+}
+
+/**
+ * Check scaling and shifting values
+ */
+TEST(BoltzmannKernel_UnitTest, scale_and_shift_values) {
+    for (SimdLevel level : get_testable_simd_levels()) {
+        for (size_t n=0; n<=11; n++) {
+            vector<double> values(n);
+            for (size_t i=0; i<n; i++) values[i] = (double) i;
+            scale_and_shift_values(values.data(), n, 0.5, 2.0, level);
+            for (size_t i=0; i<n; i++) {
+                EXPECT_DOUBLE_EQ(values[i], 0.5 * i + 2.0);
+            }
+        }
+    }
+}
+
+/**
+ * Micro-benchmark comparing computing boltzmann weights into an ActionDistr (as MentsDNode used to), with computing
+ * them in a contiguous buffer with each implementation of the kernel. Prints the times taken rather than asserting
+ * on them, as timings depend on the machine and compiler flags.
+ */
+TEST(BoltzmannKernel_Benchmark, action_distr_vs_kernel) {
+    size_t num_actions = 64;
+    int num_repeats = 5000;
+    ActionVector actions;
+    vector<double> q_values(num_actions);
+    for (size_t i=0; i<num_actions; i++) {
+        actions.push_back(make_shared<const IntAction>(i));
+        q_values[i] = 0.1 * i;
+    }
+
+    chrono::time_point<chrono::steady_clock> start_time = chrono::steady_clock::now();
+    double map_sum = 0.0;
+    for (int r=0; r<num_repeats; r++) {
+        ActionDistr action_weights;
+        double normalisation_term = numeric_limits<double>::lowest();
+        for (size_t i=0; i<num_actions; i++) normalisation_term = max(normalisation_term, q_values[i]);
+        double sum_weights = 0.0;
+        for (size_t i=0; i<num_actions; i++) {
+            double weight = exp(q_values[i] - normalisation_term);
+            action_weights[actions[i]] = weight;
+            sum_weights += weight;
+        }
+        map_sum += sum_weights;
+    }
+    chrono::duration<double> map_dur = chrono::steady_clock::now() - start_time;
+    cout << "Boltzmann weights for " << num_actions << " actions, " << num_repeats << " times:" << endl;
+    cout << "    ActionDistr took " << map_dur.count() << endl;
+
+    vector<double> buffer(num_actions);
+    for (SimdLevel level : get_testable_simd_levels()) {
+        start_time = chrono::steady_clock::now();
+        double kernel_sum = 0.0;
+        for (int r=0; r<num_repeats; r++) {
+            for (size_t i=0; i<num_actions; i++) buffer[i] = q_values[i];
+            double normalisation_term;
+            kernel_sum += compute_boltzmann_weights(buffer.data(), num_actions, normalisation_term, level);
+        }
+        chrono::duration<double> kernel_dur = chrono::steady_clock::now() - start_time;
+        cout << "    Kernel (simd level " << (int) level << ") took " << kernel_dur.count() << endl;
+        EXPECT_NEAR(kernel_sum, map_sum, 1e-12 * map_sum);
+    }
+}
@@ -6,4 +6,37 @@
 // namespace thtt::test {
 //     using namespace std;
 //     using namespace thts;
-// }
\ No newline at end of file
+// }
+
+#include "algorithms/ments/dents/dents_chance_node.h"
+#include "algorithms/ments/dents/dents_decision_node.h"
+#include "algorithms/ments/dents/dents_manager.h"
+
+namespace thts::test {
+    using namespace std;
+    using namespace thts;
+
+    /**
+     * DentsDNode that exposes its children map, so that the common mixin functions can be called directly in tests
+     */
+    class DentsDNodeChildrenAccess : public DentsDNode {
+        public:
+            using DentsDNode::DentsDNode;
+
+            const CNodeChildMap& get_children() const {
+                return children;
+            }
+    };
+
+    /**
+     * DentsCNode that exposes its children map, so that the common mixin functions can be called directly in tests
+     */
+    class DentsCNodeChildrenAccess : public DentsCNode {
+        public:
+            using DentsCNode::DentsCNode;
+
+            const DNodeChildMap& get_children() const {
+                return children;
+            }
+    };
+}
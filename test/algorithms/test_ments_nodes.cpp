@@ -1,4 +1,4 @@
-#include "test/algorithms/test_puct_nodes.h"
+#include "test/algorithms/test_ments_nodes.h"
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 
@@ -45,7 +45,8 @@ void run_ments_integration_test(
     double stay_prob=0.0, 
     int print_tree_depth=0, 
     double temp=1.0, 
-    bool use_temp_decay=false) 
+    bool use_temp_decay=false,
+    double virtual_loss=0.0) 
 {
     chrono::time_point<chrono::system_clock> start_time = chrono::system_clock::now();
 
@@ -56,6 +57,7 @@ void run_ments_integration_test(
     manager_args.mcts_mode = false;
     manager_args.temp = temp;
     manager_args.temp_decay_fn = use_temp_decay ? decayed_temp_inv_sqrt : nullptr;
+    manager_args.virtual_loss = virtual_loss;
     shared_ptr<MentsManager> manager = make_shared<MentsManager>(manager_args);
     shared_ptr<MentsDNode> root_node = make_shared<MentsDNode>(manager, grid_env->get_initial_state_itfc(), 0, 0);
     ThtsPool uct_pool(manager, root_node, num_threads);
@@ -65,6 +67,13 @@ void run_ments_integration_test(
         // TODO add asserts
     }
 
+    // All virtual losses should have been removed by the end of the trials
+    shared_ptr<ActionVector> root_actions = grid_env->get_valid_actions_itfc(grid_env->get_initial_state_itfc());
+    for (shared_ptr<const Action> action : *root_actions) {
+        if (!root_node->has_child_node_itfc(action)) continue;
+        EXPECT_EQ(root_node->get_child_node_itfc(action)->get_num_virtual_losses(), 0);
+    }
+
     std::chrono::duration<double> dur = chrono::system_clock::now() - start_time;
 
     cout << "MENTS with " << num_threads << " threads (took " << dur.count() << ")";
@@ -92,6 +101,10 @@ TEST(Ments_IntegrationTest, easy_grid_world_stochastic_multithreaded) {
     run_ments_integration_test(2, 4, 10000, 0.1, 1, 0.5);
 }
 
+TEST(Ments_IntegrationTest, easy_grid_world_multithreaded_virtual_loss) {
+    run_ments_integration_test(2, 4, 10000, 0.0, 1, 0.5, false, 1.0);
+}
+
 
 
 TEST(Ments_WithTempDecay_IntegrationTest, easy_grid_world) {
@@ -154,4 +167,97 @@ TEST(Ments_WithTempDecay_IntegrationTest, two_player_game_env) {
 
 TEST(Ments_WithTempDecay_IntegrationTest, two_player_game_env_starting_as_opponent) {
     run_ments_game_integration_test(3, 10000, 4, 1, true);
-}
\ No newline at end of file
+}
+
+
+
+/**
+ * Runs ments with and without incremental soft backups (with the same seed, so the same trials are run), and checks 
+ * that the root node ends up with the same soft value
+ */
+void run_ments_incremental_soft_backup_test(
+    double stay_prob, 
+    bool use_temp_decay, 
+    int recompute_period, 
+    bool is_two_player_game=false, 
+    bool use_progressive_widening=false,
+    bool use_transposition_table=false) 
+{
+    int num_trials = 2000;
+    vector<double> soft_values;
+    for (bool incremental_soft_backup : {false, true}) {
+        shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(2, stay_prob);
+        if (is_two_player_game) env = make_shared<TestThtsGameEnv>(3);
+        MentsManagerArgs manager_args(env);
+        manager_args.seed = 60415;
+        manager_args.max_depth = 8;
+        manager_args.mcts_mode = false;
+        manager_args.is_two_player_game = is_two_player_game;
+        manager_args.temp = 0.5;
+        manager_args.temp_decay_fn = use_temp_decay ? decayed_temp_inv_sqrt : nullptr;
+        manager_args.incremental_soft_backup = incremental_soft_backup;
+        manager_args.incremental_soft_backup_recompute_period = recompute_period;
+        manager_args.use_progressive_widening = use_progressive_widening;
+        manager_args.progressive_widening_coeff = 0.5;
+        manager_args.use_transposition_table = use_transposition_table;
+        shared_ptr<MentsManager> manager = make_shared<MentsManager>(manager_args);
+        shared_ptr<TestMentsDNode> root_node = make_shared<TestMentsDNode>(
+            manager, env->get_initial_state_itfc(), 0, 0);
+        ThtsPool pool(manager, root_node, 1);
+        pool.run_trials(num_trials);
+        soft_values.push_back(root_node->get_soft_value());
+    }
+    EXPECT_NEAR(soft_values[0], soft_values[1], 1e-9);
+}
+
+TEST(Ments_IncrementalSoftBackup, matches_full_backup) {
+    run_ments_incremental_soft_backup_test(0.0, false, 100);
+}
+
+TEST(Ments_IncrementalSoftBackup, matches_full_backup_stochastic_frequent_recompute) {
+    run_ments_incremental_soft_backup_test(0.1, false, 3);
+}
+
+TEST(Ments_IncrementalSoftBackup, matches_full_backup_with_temp_decay) {
+    run_ments_incremental_soft_backup_test(0.1, true, 100);
+}
+
+TEST(Ments_IncrementalSoftBackup, matches_full_backup_two_player_game) {
+    run_ments_incremental_soft_backup_test(0.0, false, 100, true);
+}
+
+TEST(Ments_IncrementalSoftBackup, matches_full_backup_with_progressive_widening) {
+    run_ments_incremental_soft_backup_test(0.1, false, 100, false, true);
+}
+
+TEST(Ments_IncrementalSoftBackup, matches_full_backup_with_transposition_table) {
+    run_ments_incremental_soft_backup_test(0.1, false, 100, false, false, true);
+}
+
+
+
+/**
+ * Check that with progressive widening, the root node only admits ceil(k * N^alpha) actions
+ */
+TEST(Ments_ProgressiveWidening, admits_actions_with_visits) {
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(3);
+    shared_ptr<const State> root_state = make_shared<const IntPairState>(1,1);
+    MentsManagerArgs manager_args(env);
+    manager_args.seed = 60415;
+    manager_args.use_progressive_widening = true;
+    manager_args.progressive_widening_coeff = 1.0;
+    manager_args.progressive_widening_exponent = 0.5;
+    shared_ptr<MentsManager> manager = make_shared<MentsManager>(manager_args);
+    shared_ptr<TestMentsDNode> root_node = make_shared<TestMentsDNode>(manager, root_state, 0, 0);
+    EXPECT_EQ(root_node->get_num_admitted_actions(), 1u);
+
+    ThtsPool pool(manager, root_node, 1);
+    pool.run_trials(4);
+    EXPECT_EQ(root_node->get_num_admitted_actions(), 2u);
+    EXPECT_LE(root_node->get_num_children(), 2);
+    pool.run_trials(5);
+    EXPECT_EQ(root_node->get_num_admitted_actions(), 3u);
+    pool.run_trials(100);
+    EXPECT_EQ(root_node->get_num_admitted_actions(), 4u);
+}
+
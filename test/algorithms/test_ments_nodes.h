@@ -7,7 +7,32 @@
 #include "algorithms/uct/puct_manager.h"
 
 
+#include "algorithms/ments/ments_decision_node.h"
+#include "algorithms/ments/ments_manager.h"
+
+
 namespace thts::test {
     using namespace std;
     using namespace thts;
+
+    /**
+     * MentsDNode that exposes its soft value (and number of admitted actions) for testing
+     */
+    class TestMentsDNode : public MentsDNode {
+        public:
+            TestMentsDNode(
+                shared_ptr<MentsManager> thts_manager,
+                shared_ptr<const State> state,
+                int decision_depth,
+                int decision_timestep) :
+                    MentsDNode(thts_manager, state, decision_depth, decision_timestep) {}
+
+            double get_soft_value() const {
+                return soft_value;
+            }
+
+            size_t get_num_admitted_actions() const {
+                return actions->size();
+            }
+    };
 }
\ No newline at end of file
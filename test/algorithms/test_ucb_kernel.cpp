@@ -0,0 +1,171 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "algorithms/common/ucb_kernel.h"
+
+// includes
+#include "thts_manager.h"
+#include "thts_types.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+
+/**
+ * Helper to get all of the simd levels that can be tested on this processor
+ */
+vector<SimdLevel> get_testable_ucb_simd_levels() {
+    vector<SimdLevel> levels = {SimdLevel::scalar};
+    if (get_supported_simd_level() == SimdLevel::avx2 || get_supported_simd_level() == SimdLevel::avx512) {
+        levels.push_back(SimdLevel::avx2);
+    }
+    if (get_supported_simd_level() == SimdLevel::avx512) {
+        levels.push_back(SimdLevel::avx512);
+    }
+    return levels;
+}
+
+/**
+ * Check each implementation gives exactly the same values as a direct computation, with and without weights, for 
+ * both scalings, and for sizes that cover the vectorised tails
+ */
+TEST(UcbKernel_UnitTest, exploration_terms_match_direct_computation) {
+    mt19937 rng(60415);
+    uniform_real_distribution<double> value_distr(-10.0, 10.0);
+    uniform_int_distribution<int> visits_distr(0, 1000);
+
+    for (SimdLevel level : get_testable_ucb_simd_levels()) {
+        for (UcbVisitsScaling scaling : {UcbVisitsScaling::inv_sqrt, UcbVisitsScaling::inv}) {
+            for (bool use_weights : {false, true}) {
+                for (size_t n=0; n<=37; n++) {
+                    vector<double> values(n);
+                    vector<double> child_visits(n);
+                    vector<double> weights(n);
+                    for (size_t i=0; i<n; i++) {
+                        values[i] = value_distr(rng);
+                        child_visits[i] = visits_distr(rng);
+                        weights[i] = abs(value_distr(rng)) / 10.0;
+                    }
+
+                    double coeff = 1.7;
+                    vector<double> expected_values(n);
+                    for (size_t i=0; i<n; i++) {
+                        double visits = max(child_visits[i], 1.0);
+                        double term = use_weights ? coeff * weights[i] : coeff;
+                        term /= (scaling == UcbVisitsScaling::inv_sqrt) ? sqrt(visits) : visits;
+                        expected_values[i] = values[i] + term;
+                    }
+
+                    const double* weights_ptr = use_weights ? weights.data() : nullptr;
+                    add_ucb_exploration_terms(
+                        values.data(), child_visits.data(), weights_ptr, n, coeff, scaling, level);
+                    for (size_t i=0; i<n; i++) {
+                        EXPECT_EQ(values[i], expected_values[i]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Check the max value for each implementation
+ */
+TEST(UcbKernel_UnitTest, max_value) {
+    mt19937 rng(60415);
+    uniform_real_distribution<double> value_distr(-10.0, 10.0);
+    for (SimdLevel level : get_testable_ucb_simd_levels()) {
+        EXPECT_EQ(compute_max_value(nullptr, 0, level), numeric_limits<double>::lowest());
+        for (size_t n=1; n<=37; n++) {
+            vector<double> values(n);
+            for (double& value : values) value = value_distr(rng);
+            double expected_max = numeric_limits<double>::lowest();
+            for (double value : values) expected_max = max(expected_max, value);
+            EXPECT_EQ(compute_max_value(values.data(), n, level), expected_max);
+        }
+    }
+}
+
+/**
+ * Check that ties are broken uniformly at random, and that the rand manager isn't used without ties
+ */
+TEST(UcbKernel_UnitTest, max_index_breaks_ties_randomly) {
+    RandManager rand_manager(60415);
+    vector<double> no_ties = {1.0, 4.0, 3.0, 2.0, -1.0};
+    EXPECT_EQ(get_max_index_break_ties_randomly(no_ties, rand_manager), 1);
+
+    vector<double> ties = {1.0, 3.0, 3.0, 2.0, 3.0, 0.0};
+    vector<int> counts(ties.size(), 0);
+    int num_samples = 3000;
+    for (int i=0; i<num_samples; i++) {
+        counts[get_max_index_break_ties_randomly(ties, rand_manager)]++;
+    }
+    EXPECT_EQ(counts[0] + counts[3] + counts[5], 0);
+    for (int index : {1, 2, 4}) {
+        EXPECT_NEAR(counts[index], num_samples / 3.0, num_samples / 15.0);
+    }
+}
+
+/**
+ * Micro-benchmark comparing computing ucb values into an unordered_map and taking the max key (as UctDNode used to), 
+ * with computing them in contiguous buffers with each implementation of the kernel. Prints the times taken rather 
+ * than asserting on them, as timings depend on the machine and compiler flags.
+ */
+TEST(UcbKernel_Benchmark, map_vs_kernel) {
+    size_t num_actions = 256;
+    int num_repeats = 2000;
+    RandManager rand_manager(60415);
+    ActionVector actions;
+    vector<double> q_values(num_actions);
+    vector<double> child_visits(num_actions);
+    for (size_t i=0; i<num_actions; i++) {
+        actions.push_back(make_shared<const IntAction>(i));
+        q_values[i] = 0.01 * i;
+        child_visits[i] = (double) (num_actions - i);
+    }
+    double coeff = sqrt(log(100000.0));
+
+    chrono::time_point<chrono::steady_clock> start_time = chrono::steady_clock::now();
+    shared_ptr<const Action> map_best_action;
+    for (int r=0; r<num_repeats; r++) {
+        unordered_map<shared_ptr<const Action>,double> ucb_values;
+        for (size_t i=0; i<num_actions; i++) {
+            ucb_values[actions[i]] = q_values[i] + sqrt(log(100000.0) / child_visits[i]);
+        }
+        double best_value = numeric_limits<double>::lowest();
+        for (pair<const shared_ptr<const Action>,double>& pr : ucb_values) {
+            if (pr.second > best_value) {
+                best_value = pr.second;
+                map_best_action = pr.first;
+            }
+        }
+    }
+    chrono::duration<double> map_dur = chrono::steady_clock::now() - start_time;
+    cout << "Ucb values for " << num_actions << " actions, " << num_repeats << " times:" << endl;
+    cout << "    unordered_map took " << map_dur.count() << endl;
+
+    vector<double> buffer(num_actions);
+    for (SimdLevel level : get_testable_ucb_simd_levels()) {
+        start_time = chrono::steady_clock::now();
+        int best_index = -1;
+        for (int r=0; r<num_repeats; r++) {
+            for (size_t i=0; i<num_actions; i++) buffer[i] = q_values[i];
+            add_ucb_exploration_terms(
+                buffer.data(), child_visits.data(), nullptr, num_actions, coeff, UcbVisitsScaling::inv_sqrt, level);
+            best_index = get_max_index_break_ties_randomly(buffer, rand_manager);
+        }
+        chrono::duration<double> kernel_dur = chrono::steady_clock::now() - start_time;
+        cout << "    Kernel (simd level " << (int) level << ") took " << kernel_dur.count() << endl;
+        EXPECT_EQ(actions[best_index], map_best_action);
+    }
+}
@@ -13,6 +13,7 @@
 #include "thts_env_context.h"
 
 #include <iostream>
+#include <limits>
 #include <unordered_map>
 
 
@@ -75,6 +76,72 @@ TEST(Uct_Ucb, compute_ucb_values_no_prior) {
     EXPECT_EQ(ucb_values[a[2]], 1.0+2.0*3.0);
 }
 
+/**
+ * Test that 'fill_ucb_values' lowers the values of children with virtual losses by 'virtual_loss * k / (n+k)' when 
+ * using virtual loss.
+ */
+TEST(Uct_Ucb, compute_ucb_values_virtual_loss) {
+    shared_ptr<MockThtsEnv_ForUct> mock_env = make_shared<MockThtsEnv_ForUct>();
+    shared_ptr<MockUctManager> uct_manager = make_shared<MockUctManager>(mock_env);
+    uct_manager->bias = 2.0;
+    uct_manager->virtual_loss = 2.0;
+    shared_ptr<ThtsEnvContext> dummy_context = mock_env->sample_context_itfc(nullptr);
+    
+    // Actions
+    shared_ptr<ActionVector> actions = make_shared<ActionVector>(3);
+    ActionVector& a = *actions;
+    a[0] = make_shared<IntAction>(0);
+    a[1] = make_shared<IntAction>(1);
+    a[2] = make_shared<IntAction>(2);
+
+    // Make mock env give actions to Uct D Node when make it
+    EXPECT_CALL(*mock_env, get_valid_actions_itfc)
+        .Times(1)
+        .WillOnce(Return(actions));
+
+    // Children (child 0 has 3 backups + 1 virtual loss, child 1 no virtual loss, child 2 0 backups + 2 virtual losses)
+    shared_ptr<SettableUctCNode> child_0 = make_shared<SettableUctCNode>(uct_manager, 1.0);
+    shared_ptr<SettableUctCNode> child_1 = make_shared<SettableUctCNode>(uct_manager, 0.5);
+    shared_ptr<SettableUctCNode> child_2 = make_shared<SettableUctCNode>(uct_manager, 1.0);
+    child_0->set_num_backups(3);
+    child_0->add_virtual_loss();
+    child_1->set_num_backups(3);
+    child_2->add_virtual_loss();
+    child_2->add_virtual_loss();
+
+    CNodeChildMap children;
+    children[a[0]] = child_0;
+    children[a[1]] = child_1;
+    children[a[2]] = child_2;
+
+    // Uct D Node
+    shared_ptr<MockUctDNode_ComputeUcbMock> uct_d_node = make_shared<MockUctDNode_ComputeUcbMock>(uct_manager);
+    EXPECT_CALL(*uct_d_node, compute_ucb_term)
+        .Times(3)
+        .WillRepeatedly(Return(1.0));
+    EXPECT_CALL(*uct_d_node, is_opponent)
+        .Times(1)
+        .WillOnce(Return(false));
+    uct_d_node->set_children(children);
+
+    // Fill ucb values
+    unordered_map<shared_ptr<const Action>,double> ucb_values;
+    uct_d_node->fill_ucb_values(ucb_values, *dummy_context);
+
+    // Checks
+    EXPECT_EQ(ucb_values.size(), 3u);
+    EXPECT_DOUBLE_EQ(ucb_values[a[0]], 1.0+2.0*1.0 - 2.0*1.0/4.0);
+    EXPECT_DOUBLE_EQ(ucb_values[a[1]], 0.5+2.0*1.0);
+    EXPECT_DOUBLE_EQ(ucb_values[a[2]], 1.0+2.0*1.0 - 2.0*2.0/2.0);
+
+    // Removing virtual losses should remove the penalty
+    child_0->remove_virtual_loss();
+    child_2->remove_virtual_loss();
+    child_2->remove_virtual_loss();
+    EXPECT_EQ(child_0->get_num_virtual_losses(), 0);
+    EXPECT_EQ(child_2->get_num_virtual_losses(), 0);
+}
+
 /**
  * Test when we call 'fill_ucb_values' with a prior. Note that this can be called when 
  * children.size() != actions.size(), so we make sure to cover this case.
@@ -153,6 +220,65 @@ TEST(Uct_Ucb, compute_ucb_values_with_prior) {
     EXPECT_EQ(ucb_values[a[2]], 1.0+0.1*2.0*3.0);
 }
 
+/**
+ * Check that 'fill_dense_ucb_values' computes the same values as 'fill_ucb_values', with the adaptive bias, a virtual 
+ * loss, a prior, and children that don't exist yet
+ */
+void check_dense_ucb_values_match_ucb_values(bool use_prior) {
+    shared_ptr<MockThtsEnv_ForUct> mock_env = make_shared<MockThtsEnv_ForUct>();
+    shared_ptr<MockUctManager> uct_manager = make_shared<MockUctManager>(mock_env);
+    uct_manager->virtual_loss = 2.0;
+    if (use_prior) uct_manager->prior_fn = mock_prior_fn;
+    shared_ptr<ThtsEnvContext> dummy_context = mock_env->sample_context_itfc(nullptr);
+    
+    // Actions
+    shared_ptr<ActionVector> actions = make_shared<ActionVector>(3);
+    ActionVector& a = *actions;
+    a[0] = make_shared<IntAction>(0);
+    a[1] = make_shared<IntAction>(1);
+    a[2] = make_shared<IntAction>(2);
+
+    // Make mock env give actions to Uct D Node when make it
+    EXPECT_CALL(*mock_env, get_valid_actions_itfc)
+        .Times(1)
+        .WillOnce(Return(actions));
+
+    // Children (child 2 has a virtual loss, and there is no child for a[0])
+    shared_ptr<SettableUctCNode> child_1 = make_shared<SettableUctCNode>(uct_manager, -3.0, 4);
+    shared_ptr<SettableUctCNode> child_2 = make_shared<SettableUctCNode>(uct_manager, 1.5, 7);
+    child_2->set_num_backups(6);
+    child_2->add_virtual_loss();
+    CNodeChildMap children;
+    children[a[1]] = child_1;
+    children[a[2]] = child_2;
+
+    // Uct D Node, visited a few times
+    shared_ptr<SettableUctDNode> uct_d_node = make_shared<SettableUctDNode>(uct_manager);
+    uct_d_node->set_children(children);
+    for (int i=0; i<12; i++) uct_d_node->visit_itfc(*dummy_context);
+
+    // Fill ucb values both ways
+    unordered_map<shared_ptr<const Action>,double> ucb_values;
+    uct_d_node->fill_ucb_values(ucb_values, *dummy_context);
+    vector<double> dense_ucb_values;
+    vector<double> child_visits;
+    uct_d_node->fill_dense_ucb_values(dense_ucb_values, child_visits, *dummy_context);
+
+    // Checks
+    EXPECT_EQ(dense_ucb_values.size(), 3u);
+    for (size_t i=0; i<a.size(); i++) {
+        EXPECT_NEAR(dense_ucb_values[i], ucb_values[a[i]], 1e-12);
+    }
+}
+
+TEST(Uct_Ucb, dense_ucb_values_match_ucb_values) {
+    check_dense_ucb_values_match_ucb_values(false);
+}
+
+TEST(Uct_Ucb, dense_ucb_values_match_ucb_values_with_prior) {
+    check_dense_ucb_values_match_ucb_values(true);
+}
+
 /**
  * Test when we call 'fill_ucb_values' without a prior as an opponent. Note that this should never be called when 
  * children.size() != actions.size(), so we don't test for that case.
@@ -587,6 +713,34 @@ TEST(Uct_ChanceNode, not_much_to_test) {
     // elsewhere
 }
 
+/**
+ * Check that sampling from the chance node's (alias table) sampler matches the transition distribution
+ */
+TEST(Uct_ChanceNode, sample_observation_matches_transition_distribution) {
+    shared_ptr<ThtsEnv> grid_env = make_shared<TestThtsEnv>(3, 0.25);
+    UctManagerArgs manager_args(grid_env);
+    manager_args.seed = 60415;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    shared_ptr<ThtsEnvContext> ctx = grid_env->sample_context_itfc(grid_env->get_initial_state_itfc());
+
+    shared_ptr<const State> init_state = grid_env->get_initial_state_itfc();
+    shared_ptr<const Action> right = make_shared<const StringAction>("right");
+    shared_ptr<const State> right_state = make_shared<const IntPairState>(1,0);
+    shared_ptr<UctCNode> uct_c_node = make_shared<UctCNode>(manager, init_state, right, 0, 0);
+
+    int num_samples = 10000;
+    int num_right = 0;
+    for (int i=0; i<num_samples; i++) {
+        shared_ptr<const State> sampled_state = uct_c_node->sample_observation(*ctx);
+        if (sampled_state == right_state) {
+            num_right++;
+        } else {
+            EXPECT_TRUE(sampled_state == init_state);
+        }
+    }
+    EXPECT_NEAR((double) num_right / num_samples, 0.75, 0.02);
+}
+
 
 
 /**
@@ -594,7 +748,14 @@ TEST(Uct_ChanceNode, not_much_to_test) {
  * 
  * Prints some fun things out for if we want to read
  */
-void run_uct_integration_test(int env_size, int num_threads, int num_trials, double stay_prob=0.0, int print_tree_depth=0) {
+void run_uct_integration_test(
+    int env_size, 
+    int num_threads, 
+    int num_trials, 
+    double stay_prob=0.0, 
+    int print_tree_depth=0, 
+    double virtual_loss=0.0) 
+{
     chrono::time_point<chrono::system_clock> start_time = chrono::system_clock::now();
 
     shared_ptr<ThtsEnv> grid_env = make_shared<TestThtsEnv>(env_size, stay_prob);
@@ -602,6 +763,7 @@ void run_uct_integration_test(int env_size, int num_threads, int num_trials, dou
     manager_args.seed = 60415;
     manager_args.max_depth = env_size * 4;
     manager_args.mcts_mode = false;
+    manager_args.virtual_loss = virtual_loss;
     shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
     shared_ptr<UctDNode> root_node = make_shared<UctDNode>(manager, grid_env->get_initial_state_itfc(), 0, 0);
     ThtsPool uct_pool(manager, root_node, num_threads);
@@ -611,6 +773,13 @@ void run_uct_integration_test(int env_size, int num_threads, int num_trials, dou
         // TODO add asserts
     }
 
+    // All virtual losses should have been removed by the end of the trials
+    shared_ptr<ActionVector> root_actions = grid_env->get_valid_actions_itfc(grid_env->get_initial_state_itfc());
+    for (shared_ptr<const Action> action : *root_actions) {
+        if (!root_node->has_child_node_itfc(action)) continue;
+        EXPECT_EQ(root_node->get_child_node_itfc(action)->get_num_virtual_losses(), 0);
+    }
+
     std::chrono::duration<double> dur = chrono::system_clock::now() - start_time;
 
     cout << "UCT with " << num_threads << " threads (took " << dur.count() << ")";
@@ -638,6 +807,101 @@ TEST(Uct_IntegrationTest, easy_grid_world_stochastic_multithreaded) {
     run_uct_integration_test(2,4,10000,0.1,1);
 }
 
+TEST(Uct_IntegrationTest, easy_grid_world_multithreaded_virtual_loss) {
+    run_uct_integration_test(2,4,10000,0.0,1,1.0);
+}
+
+/**
+ * Run uct on a grid world, advance the root after taking a real action, and check that the subtree is reused (with 
+ * decision depths now relative to the new root) and that the search can continue from the new root
+ */
+void run_uct_advance_root_test(bool use_transposition_table, bool free_old_tree_in_background) {
+    int env_size = 3;
+    int num_trials = 2000;
+    shared_ptr<TestThtsEnv> grid_env = make_shared<TestThtsEnv>(env_size);
+    UctManagerArgs manager_args(grid_env);
+    manager_args.seed = 60415;
+    manager_args.max_depth = env_size * 4;
+    manager_args.mcts_mode = false;
+    manager_args.use_transposition_table = use_transposition_table;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    shared_ptr<UctDNode> root_node = make_shared<UctDNode>(manager, grid_env->get_initial_state_itfc(), 0, 0);
+    unique_ptr<ThtsPool> uct_pool = make_unique<ThtsPool>(manager, root_node, 1);
+    uct_pool->run_trials(num_trials);
+
+    shared_ptr<const Action> action = make_shared<const StringAction>("right");
+    shared_ptr<const State> observation = make_shared<const IntPairState>(1,0);
+    shared_ptr<ThtsDNode> expected_new_root = root_node->get_child_node_itfc(action)->get_child_node_itfc(observation);
+    int new_root_visits = expected_new_root->get_num_visits();
+    weak_ptr<UctDNode> old_root_weak = root_node;
+    root_node.reset();
+
+    shared_ptr<ThtsDNode> new_root = uct_pool->advance_root(action, observation, free_old_tree_in_background);
+    EXPECT_EQ(new_root, expected_new_root);
+    EXPECT_TRUE(new_root->is_root_node());
+    EXPECT_EQ(new_root->get_decision_depth(), 0);
+    EXPECT_EQ(new_root->get_num_visits(), new_root_visits);
+    expected_new_root.reset();
+
+    // Grandchildren should now be at depth 1
+    shared_ptr<ActionVector> new_root_actions = grid_env->get_valid_actions_itfc(observation);
+    for (shared_ptr<const Action> new_root_action : *new_root_actions) {
+        if (!new_root->has_child_node_itfc(new_root_action)) continue;
+        shared_ptr<ThtsCNode> chance_node = new_root->get_child_node_itfc(new_root_action);
+        shared_ptr<const State> next_state = grid_env->sample_transition_distribution_itfc(
+            observation, new_root_action, *manager);
+        if (!chance_node->has_child_node_itfc(next_state)) continue;
+        EXPECT_EQ(chance_node->get_child_node_itfc(next_state)->get_decision_depth(), 1);
+    }
+
+    // Trials continue from the new root
+    uct_pool->run_trials(num_trials);
+    EXPECT_EQ(new_root->get_num_visits(), new_root_visits + num_trials);
+
+    // Advancing on an action that isn't in the tree returns nullptr and leaves the pool unchanged
+    shared_ptr<const Action> missing_action = make_shared<const StringAction>("up");
+    EXPECT_EQ(uct_pool->advance_root(missing_action, observation), nullptr);
+
+    // Old tree is freed (destroying the pool waits for any background deleter to finish)
+    uct_pool.reset();
+    EXPECT_TRUE(old_root_weak.expired());
+}
+
+TEST(Uct_IntegrationTest, advance_root) {
+    run_uct_advance_root_test(false, false);
+}
+
+TEST(Uct_IntegrationTest, advance_root_free_in_background) {
+    run_uct_advance_root_test(false, true);
+}
+
+TEST(Uct_IntegrationTest, advance_root_with_transposition_table) {
+    run_uct_advance_root_test(true, true);
+}
+
+/**
+ * Check that advancing the root after a non-blocking call to 'run_trials' waits for the running trials to finish
+ */
+TEST(Uct_IntegrationTest, advance_root_after_non_blocking_run_trials) {
+    int num_trials = 2000;
+    shared_ptr<TestThtsEnv> grid_env = make_shared<TestThtsEnv>(3);
+    UctManagerArgs manager_args(grid_env);
+    manager_args.seed = 60415;
+    manager_args.mcts_mode = false;
+    manager_args.use_transposition_table = true;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    shared_ptr<UctDNode> root_node = make_shared<UctDNode>(manager, grid_env->get_initial_state_itfc(), 0, 0);
+    ThtsPool uct_pool(manager, root_node, 4);
+    uct_pool.run_trials(num_trials, numeric_limits<double>::max(), false);
+
+    shared_ptr<const Action> action = make_shared<const StringAction>("right");
+    shared_ptr<const State> observation = make_shared<const IntPairState>(1,0);
+    shared_ptr<ThtsDNode> new_root = uct_pool.advance_root(action, observation);
+    EXPECT_EQ(root_node->get_num_visits(), num_trials);
+    ASSERT_NE(new_root, nullptr);
+    EXPECT_TRUE(new_root->is_root_node());
+}
+
 
 // TODO: Add test that check for #trials == #nodes in mcts mode
 TEST(Uct_IntegrationTest, mcts_mode_todo) {
@@ -674,4 +938,130 @@ TEST(Uct_IntegrationTest, two_player_game_env) {
 
 TEST(Uct_IntegrationTest, two_player_game_env_starting_as_opponent) {
     run_uct_game_integration_test(3, 10000, 4, 1);
-}
\ No newline at end of file
+}
+
+/**
+ * Test that when using the env as a generative model, chance nodes never enumerate the transition distribution, and 
+ * add children as outcomes are sampled
+ */
+TEST(Uct_IntegrationTest, generative_model_env) {
+    shared_ptr<ThtsEnv> env = make_shared<GenerativeTestThtsEnv>(3, 0.5);
+    UctManagerArgs manager_args(env);
+    manager_args.seed = 60415;
+    manager_args.use_generative_model = true;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    shared_ptr<UctDNode> root_node = make_shared<UctDNode>(manager, env->get_initial_state_itfc(), 0, 0);
+    ThtsPool uct_pool(manager, root_node, 1);
+    uct_pool.run_trials(1000);
+
+    EXPECT_EQ(root_node->get_num_visits(), 1000);
+    shared_ptr<ActionVector> root_actions = env->get_valid_actions_itfc(env->get_initial_state_itfc());
+    for (shared_ptr<const Action> action : *root_actions) {
+        if (root_node->has_child_node(action)) {
+            EXPECT_EQ(root_node->get_child_node(action)->get_num_children(), 2);
+        }
+    }
+}
+
+/**
+ * Test that each decision node checks if it's a sink state once (when constructed), and that when caching rewards, 
+ * each reward is computed once (when the child node is created), rather than on every trial
+ */
+void run_uct_env_call_counting_test(bool cache_rewards) {
+    int num_trials = 1000;
+    shared_ptr<CountingTestThtsEnv> env = make_shared<CountingTestThtsEnv>(3);
+    UctManagerArgs manager_args(env);
+    manager_args.seed = 60415;
+    manager_args.cache_rewards = cache_rewards;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    shared_ptr<UctDNode> root_node = make_shared<UctDNode>(manager, env->get_initial_state_itfc(), 0, 0);
+    ThtsPool uct_pool(manager, root_node, 1);
+    uct_pool.run_trials(num_trials);
+
+    // mcts mode, so one decision node added per trial (unless the trial ends at a sink state)
+    int num_decision_nodes = env->num_is_sink_state_calls;
+    EXPECT_LE(num_decision_nodes, num_trials + 1);
+    if (cache_rewards) {
+        EXPECT_EQ(env->num_reward_calls, num_decision_nodes - 1);
+    } else {
+        EXPECT_GT(env->num_reward_calls, num_trials);
+    }
+}
+
+TEST(Uct_IntegrationTest, env_calls_cached_on_nodes) {
+    run_uct_env_call_counting_test(true);
+}
+
+TEST(Uct_IntegrationTest, env_calls_without_cached_rewards) {
+    run_uct_env_call_counting_test(false);
+}
+
+
+
+/**
+ * A prior for TestThtsEnv that prefers moving down, then right, and then left and up equally
+ */
+shared_ptr<ActionPrior> grid_prior_fn(shared_ptr<const State> state, shared_ptr<ThtsEnv> env=nullptr) {
+    shared_ptr<ActionPrior> policy_prior = make_shared<ActionPrior>();
+    ActionPrior& prior = *policy_prior;
+    prior[make_shared<const StringAction>("down")] = 0.7;
+    prior[make_shared<const StringAction>("right")] = 0.2;
+    prior[make_shared<const StringAction>("left")] = 0.05;
+    prior[make_shared<const StringAction>("up")] = 0.05;
+    return policy_prior;
+}
+
+/**
+ * Check that with progressive widening actions are admitted in order of the prior, and that only ceil(k * N^alpha) 
+ * actions are admitted after N visits
+ */
+TEST(Uct_ProgressiveWidening, admits_actions_in_prior_order) {
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(3);
+    UctManagerArgs manager_args(env);
+    manager_args.prior_fn = grid_prior_fn;
+    manager_args.use_progressive_widening = true;
+    manager_args.progressive_widening_coeff = 1.0;
+    manager_args.progressive_widening_exponent = 0.5;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    WideningUctDNode node(manager, make_shared<const IntPairState>(1,1));
+    shared_ptr<ThtsEnvContext> ctx = env->sample_context_itfc(nullptr);
+
+    vector<string> expected_order = {"down", "right", "left", "up"};
+    vector<int> num_visits_to_admit = {0, 2, 5, 10};
+    for (int visits=0; visits<=16; visits++) {
+        if (visits > 0) node.visit_itfc(*ctx);
+        size_t num_expected_actions = 0;
+        for (int threshold : num_visits_to_admit) {
+            if (visits >= threshold) num_expected_actions++;
+        }
+
+        ActionVector& actions = *node.get_actions();
+        ASSERT_EQ(actions.size(), num_expected_actions);
+        for (size_t i=0; i<actions.size(); i++) {
+            EXPECT_EQ(static_pointer_cast<const StringAction>(actions[i])->action, expected_order[i]);
+        }
+    }
+}
+
+/**
+ * Check that with progressive widening on chance nodes, a chance node with a widening limit of one child only ever 
+ * has one child, even though the environment is stochastic
+ */
+TEST(Uct_ProgressiveWidening, chance_nodes_limit_outcomes) {
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(3, 0.5);
+    UctManagerArgs manager_args(env);
+    manager_args.seed = 60415;
+    manager_args.use_chance_progressive_widening = true;
+    manager_args.chance_progressive_widening_coeff = 1.0;
+    manager_args.chance_progressive_widening_exponent = 0.0;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    shared_ptr<UctDNode> root_node = make_shared<UctDNode>(manager, env->get_initial_state_itfc(), 0, 0);
+    ThtsPool pool(manager, root_node, 1);
+    pool.run_trials(200);
+
+    shared_ptr<ActionVector> root_actions = env->get_valid_actions_itfc(env->get_initial_state_itfc());
+    for (shared_ptr<const Action> action : *root_actions) {
+        EXPECT_EQ(root_node->get_child_node(action)->get_num_children(), 1);
+    }
+}
+
@@ -58,6 +58,9 @@ namespace thts::test {
 
     /**
      * Mock UctThtsManager. Used to spoof random number generation.
+     * 
+     * The unit tests mock 'compute_ucb_term' and 'fill_ucb_values', so nodes are set to use those rather than the 
+     * dense ucb kernel.
      */
     class MockUctManager : public UctManager {
         public:
@@ -65,6 +68,7 @@ namespace thts::test {
                 UctManager(thts_env) 
             {
                 this->bias = bias;
+                this->use_dense_ucb_values = false;
             };
 
             MOCK_METHOD(int, get_rand_int, (int min_included, int max_excluded), (override));
@@ -94,6 +98,22 @@ namespace thts::test {
             {
                 UctDNode::fill_ucb_values(ucb_values, ctx);
             }
+
+            void fill_dense_ucb_values(vector<double>& ucb_values, vector<double>& child_visits, ThtsEnvContext& ctx)
+            {
+                UctDNode::fill_dense_ucb_values(ucb_values, child_visits, ctx);
+            }
+    };
+
+    /**
+     * UctDNode that exposes its (admitted) actions, for testing progressive widening
+     */
+    class WideningUctDNode : public UctDNode {
+        public:
+            WideningUctDNode(shared_ptr<UctManager> thts_manager, shared_ptr<const State> state) : 
+                UctDNode(thts_manager, state, 0, 0) {};
+
+            shared_ptr<ActionVector> get_actions() { return actions; }
     };
 
     /**
@@ -117,6 +137,7 @@ namespace thts::test {
             void set_next_state_distr(shared_ptr<StateDistr> distr) { next_state_distr = distr; }
             double get_avg_return() { return avg_return; }
             void set_avg_return(double ret) { avg_return = ret; }
+            void set_num_backups(int backups) { num_backups = backups; }
     };
 
     /**
@@ -0,0 +1,91 @@
+#include "test/algorithms/test_common.h"
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// includes
+#include "test/test_thts_env.h"
+#include "thts.h"
+#include "thts_types.h"
+
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+
+using namespace std;
+using namespace thts;
+using namespace thts::test;
+
+/**
+ * Count the heap allocations made by each thread, by replacing the global operator new. 
+ * 
+ * The replacement applies to the whole program, which is why these tests are built into their own binary 
+ * ('thts-alloc-test' in the Makefile) rather than into 'thts-test'.
+ */
+namespace {
+    thread_local long long num_thread_allocations = 0;
+}
+
+void* operator new(size_t size) {
+    num_thread_allocations++;
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) throw bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+    free(ptr);
+}
+
+/**
+ * Check that the dp and entropy backups (at decision nodes and chance nodes) make no heap allocations, as they 
+ * iterate over children through a MixinChildMapView, rather than building a new map of children.
+ */
+TEST(Common_MixinChildMapView, backups_make_no_allocations) {
+    // sanity check the allocation counter
+    long long num_allocations_before = num_thread_allocations;
+    shared_ptr<int> counted_allocation = make_shared<int>(0);
+    ASSERT_EQ(num_thread_allocations - num_allocations_before, 1);
+
+    shared_ptr<ThtsEnv> grid_env = make_shared<TestThtsEnv>(3);
+    DentsManagerArgs manager_args(grid_env);
+    manager_args.seed = 60415;
+    manager_args.max_depth = 12;
+    shared_ptr<DentsManager> manager = make_shared<DentsManager>(manager_args);
+
+    // decision node backups, with children from running some trials
+    shared_ptr<DentsDNodeChildrenAccess> root_node = make_shared<DentsDNodeChildrenAccess>(
+        manager, grid_env->get_initial_state_itfc(), 0, 0);
+    ThtsPool thts_pool(manager, root_node, 1);
+    thts_pool.run_trials(100);
+
+    const CNodeChildMap& d_children = root_node->get_children();
+    ASSERT_GT(d_children.size(), 0u);
+    ActionDistr policy;
+    for (const pair<const shared_ptr<const Action>,shared_ptr<ThtsCNode>>& pr : d_children) {
+        policy[pr.first] = 1.0 / d_children.size();
+    }
+
+    num_allocations_before = num_thread_allocations;
+    root_node->backup_dp<DentsCNode>(d_children);
+    root_node->backup_ent<DentsCNode>(d_children, policy);
+    EXPECT_EQ(num_thread_allocations - num_allocations_before, 0);
+
+    // chance node backups, with children for the two grid cells adjacent to the initial state
+    shared_ptr<DentsCNodeChildrenAccess> chance_node = make_shared<DentsCNodeChildrenAccess>(
+        manager, grid_env->get_initial_state_itfc(), make_shared<const StringAction>("right"), 0, 0);
+    chance_node->create_child_node_itfc(make_shared<const IntPairState>(1,0));
+    chance_node->create_child_node_itfc(make_shared<const IntPairState>(0,1));
+
+    const DNodeChildMap& c_children = chance_node->get_children();
+    ASSERT_EQ(c_children.size(), 2u);
+
+    num_allocations_before = num_thread_allocations;
+    chance_node->backup_dp<DentsDNode>(c_children, 0.0);
+    chance_node->backup_ent<DentsDNode>(c_children);
+    EXPECT_EQ(num_thread_allocations - num_allocations_before, 0);
+}
@@ -0,0 +1,206 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "batched_leaf_evaluator.h"
+
+// includes
+#include "algorithms/uct/uct_decision_node.h"
+#include "algorithms/uct/uct_manager.h"
+#include "test/test_thts_env.h"
+#include "thts.h"
+#include "thts_types.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+using namespace thts::test;
+
+/**
+ * Counts the number of calls to the batch functions, and the number of states passed to them
+ */
+atomic<int> num_batch_fn_calls(0);
+atomic<int> num_batch_fn_states(0);
+
+/**
+ * A heuristic for TestThtsEnv, minus the manhattan distance to the origin
+ */
+double grid_origin_heuristic_fn(shared_ptr<const State> state, shared_ptr<ThtsEnv> env=nullptr) {
+    shared_ptr<const IntPairState> grid_state = static_pointer_cast<const IntPairState>(state);
+    return -(double) (grid_state->state.first + grid_state->state.second);
+}
+
+void grid_origin_batch_heuristic_fn(
+    const vector<shared_ptr<const State>>& states, shared_ptr<ThtsEnv> env, vector<double>& heuristic_values)
+{
+    num_batch_fn_calls++;
+    num_batch_fn_states += states.size();
+    for (size_t i=0; i<states.size(); i++) {
+        heuristic_values[i] = grid_origin_heuristic_fn(states[i], env);
+    }
+}
+
+void throwing_batch_heuristic_fn(
+    const vector<shared_ptr<const State>>& states, shared_ptr<ThtsEnv> env, vector<double>& heuristic_values)
+{
+    throw runtime_error("Heuristic failed");
+}
+
+/**
+ * A prior for TestThtsEnv that puts more weight on moving right than any other action
+ */
+shared_ptr<ActionPrior> grid_right_prior_fn(shared_ptr<const State> state, shared_ptr<ThtsEnv> env) {
+    shared_ptr<ActionPrior> policy_prior = make_shared<ActionPrior>();
+    shared_ptr<ActionVector> actions = env->get_valid_actions_itfc(state);
+    for (shared_ptr<const Action> action : *actions) {
+        shared_ptr<const StringAction> string_action = static_pointer_cast<const StringAction>(action);
+        (*policy_prior)[action] = (string_action->action == "right") ? 0.7 : 0.1;
+    }
+    return policy_prior;
+}
+
+/**
+ * Helper to make a UctManager that uses batched evaluation
+ */
+shared_ptr<UctManager> make_batched_evaluation_manager(size_t batch_size, double max_latency) {
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(4);
+    UctManagerArgs manager_args(env);
+    manager_args.seed = 60415;
+    manager_args.batch_heuristic_fn = grid_origin_batch_heuristic_fn;
+    manager_args.use_batched_evaluation = true;
+    manager_args.evaluation_batch_size = batch_size;
+    manager_args.evaluation_max_latency = max_latency;
+    return make_shared<UctManager>(manager_args);
+}
+
+/**
+ * Check that states queued by parked threads are evaluated in a single batch, when there are as many threads as the
+ * batch size (with a max latency long enough that the test would time out if the batch isn't dispatched when full)
+ */
+TEST(BatchedLeafEvaluator_UnitTest, batches_states_from_parked_threads) {
+    num_batch_fn_calls = 0;
+    num_batch_fn_states = 0;
+    int num_threads = 4;
+    shared_ptr<UctManager> manager = make_batched_evaluation_manager(num_threads, 600.0);
+    BatchedLeafEvaluator& evaluator = *manager->leaf_evaluator;
+    for (int i=0; i<num_threads; i++) evaluator.add_active_worker();
+
+    vector<double> heuristic_values(num_threads, 0.0);
+    vector<thread> threads;
+    for (int i=0; i<num_threads; i++) {
+        threads.emplace_back([&evaluator, &heuristic_values, i]() {
+            shared_ptr<const State> state = make_shared<const IntPairState>(i, 1);
+            heuristic_values[i] = evaluator.evaluate(state).heuristic_value;
+        });
+    }
+    for (thread& t : threads) t.join();
+    for (int i=0; i<num_threads; i++) evaluator.remove_active_worker();
+
+    for (int i=0; i<num_threads; i++) {
+        EXPECT_EQ(heuristic_values[i], -(double) (i+1));
+    }
+    EXPECT_EQ(evaluator.get_num_batches(), 1u);
+    EXPECT_EQ(evaluator.get_num_evaluations(), (size_t) num_threads);
+    EXPECT_EQ(num_batch_fn_calls, 1);
+    EXPECT_EQ(num_batch_fn_states, num_threads);
+}
+
+/**
+ * Check that a batch that doesn't fill up is dispatched after the max latency, and that states are evaluated
+ * immediately when there are no active workers (e.g. when constructing a root node)
+ */
+TEST(BatchedLeafEvaluator_UnitTest, dispatches_partial_batches) {
+    double max_latency = 0.05;
+    shared_ptr<UctManager> manager = make_batched_evaluation_manager(4, max_latency);
+    BatchedLeafEvaluator& evaluator = *manager->leaf_evaluator;
+    shared_ptr<const State> state = make_shared<const IntPairState>(2, 3);
+
+    chrono::time_point<chrono::steady_clock> start_time = chrono::steady_clock::now();
+    EXPECT_EQ(evaluator.evaluate(state).heuristic_value, -5.0);
+    EXPECT_LT(chrono::duration<double>(chrono::steady_clock::now() - start_time).count(), max_latency);
+
+    evaluator.add_active_worker();
+    evaluator.add_active_worker();
+    start_time = chrono::steady_clock::now();
+    EXPECT_EQ(evaluator.evaluate(state).heuristic_value, -5.0);
+    EXPECT_GE(chrono::duration<double>(chrono::steady_clock::now() - start_time).count(), max_latency);
+    evaluator.remove_active_worker();
+    evaluator.remove_active_worker();
+
+    EXPECT_EQ(evaluator.get_num_batches(), 2u);
+}
+
+/**
+ * Check that priors are evaluated (with the single state prior function) along with the heuristic, that the
+ * heuristic is skipped if not requested, and that decision nodes are evaluated by the evaluator
+ */
+TEST(BatchedLeafEvaluator_UnitTest, evaluates_priors) {
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(4);
+    UctManagerArgs manager_args(env);
+    manager_args.heuristic_fn = grid_origin_heuristic_fn;
+    manager_args.prior_fn = grid_right_prior_fn;
+    manager_args.use_batched_evaluation = true;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+
+    shared_ptr<const State> state = make_shared<const IntPairState>(1, 1);
+    LeafEvaluation evaluation = manager->leaf_evaluator->evaluate(state, false);
+    EXPECT_EQ(evaluation.heuristic_value, 0.0);
+    ASSERT_NE(evaluation.policy_prior, nullptr);
+    EXPECT_EQ(evaluation.policy_prior->at(make_shared<const StringAction>("right")), 0.7);
+    EXPECT_EQ(evaluation.policy_prior->size(), 4u);
+
+    UctDNode node(manager, state, 0, 0);
+    EXPECT_EQ(manager->leaf_evaluator->get_num_evaluations(), 2u);
+}
+
+/**
+ * Check that exceptions from the heuristic function are rethrown in the thread that requested the evaluation
+ */
+TEST(BatchedLeafEvaluator_UnitTest, rethrows_errors) {
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(4);
+    UctManagerArgs manager_args(env);
+    manager_args.batch_heuristic_fn = throwing_batch_heuristic_fn;
+    manager_args.use_batched_evaluation = true;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    EXPECT_THROW(manager->leaf_evaluator->evaluate(env->get_initial_state_itfc()), runtime_error);
+}
+
+/**
+ * Helper to run uct on the grid env, and return the pretty print string of the tree
+ */
+string run_uct_on_grid(bool use_batched_evaluation, int num_threads, int num_trials) {
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(4);
+    UctManagerArgs manager_args(env);
+    manager_args.seed = 60415;
+    manager_args.heuristic_fn = grid_origin_heuristic_fn;
+    manager_args.prior_fn = grid_right_prior_fn;
+    manager_args.use_batched_evaluation = use_batched_evaluation;
+    manager_args.evaluation_batch_size = num_threads;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    shared_ptr<UctDNode> root_node = make_shared<UctDNode>(manager, env->get_initial_state_itfc(), 0, 0);
+    ThtsPool pool(manager, root_node, num_threads);
+    pool.run_trials(num_trials);
+
+    EXPECT_EQ(root_node->get_num_visits(), num_trials);
+    if (use_batched_evaluation) {
+        EXPECT_GT(manager->leaf_evaluator->get_num_evaluations(), 0u);
+        EXPECT_LE(manager->leaf_evaluator->get_num_batches(), manager->leaf_evaluator->get_num_evaluations());
+    }
+    return root_node->get_pretty_print_string(2);
+}
+
+/**
+ * Check that running uct with batched evaluation on a single thread builds the same tree as without, and that
+ * running with multiple threads (that park on evaluations) runs all of the trials
+ */
+TEST(BatchedLeafEvaluator_IntegrationTest, uct_with_batched_evaluation) {
+    EXPECT_EQ(run_uct_on_grid(true, 1, 200), run_uct_on_grid(false, 1, 200));
+    run_uct_on_grid(true, 4, 500);
+}
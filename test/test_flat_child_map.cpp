@@ -0,0 +1,142 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "flat_child_map.h"
+
+// includes
+#include "thts_types.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+
+typedef FlatChildMap<shared_ptr<const Action>,shared_ptr<int>> TestFlatChildMap;
+
+/**
+ * Helper to make a vector of string actions
+ */
+vector<shared_ptr<const Action>> make_string_actions(int num_actions) {
+    vector<shared_ptr<const Action>> actions;
+    for (int i=0; i<num_actions; i++) {
+        actions.push_back(make_shared<const StringAction>("action_" + to_string(i)));
+    }
+    return actions;
+}
+
+/**
+ * Check that keys can be found by pointer and by value, in small and large maps
+ */
+void check_find_by_pointer_and_value(int num_actions) {
+    vector<shared_ptr<const Action>> actions = make_string_actions(num_actions);
+    TestFlatChildMap child_map;
+    for (int i=0; i<num_actions; i++) {
+        child_map[actions[i]] = make_shared<int>(i);
+    }
+    EXPECT_EQ(child_map.size(), (size_t) num_actions);
+
+    for (int i=0; i<num_actions; i++) {
+        EXPECT_EQ(*child_map.at(actions[i]), i);
+        shared_ptr<const Action> equal_action = make_shared<const StringAction>("action_" + to_string(i));
+        ASSERT_NE(child_map.find(equal_action), child_map.end());
+        EXPECT_EQ(*child_map.find(equal_action)->second, i);
+    }
+
+    shared_ptr<const Action> missing_action = make_shared<const StringAction>("missing");
+    EXPECT_EQ(child_map.find(missing_action), child_map.end());
+    EXPECT_EQ(child_map.count(missing_action), 0u);
+    EXPECT_THROW(child_map.at(missing_action), out_of_range);
+}
+
+TEST(FlatChildMap_UnitTest, find_small_map) {
+    check_find_by_pointer_and_value(TestFlatChildMap::small_size);
+}
+
+TEST(FlatChildMap_UnitTest, find_large_map) {
+    check_find_by_pointer_and_value(5 * TestFlatChildMap::small_size);
+}
+
+/**
+ * Check that reserved slots are not in the map until assigned, that iteration follows the reserved order, and that 
+ * position hints work (including for stale or wrong hints)
+ */
+TEST(FlatChildMap_UnitTest, reserved_keys_and_position_hints) {
+    vector<shared_ptr<const Action>> actions = make_string_actions(4);
+    TestFlatChildMap child_map;
+    child_map.reserve_keys(actions);
+    EXPECT_EQ(child_map.size(), 0u);
+    EXPECT_TRUE(child_map.empty());
+    EXPECT_EQ(child_map.begin(), child_map.end());
+    EXPECT_EQ(child_map.find(actions[2], 2), child_map.end());
+
+    child_map.insert_or_assign(actions[3], make_shared<int>(3));
+    child_map[actions[1]] = make_shared<int>(1);
+    EXPECT_EQ(child_map.size(), 2u);
+
+    vector<int> iteration_order;
+    for (pair<const shared_ptr<const Action>,shared_ptr<int>>& pr : child_map) {
+        iteration_order.push_back(*pr.second);
+    }
+    EXPECT_EQ(iteration_order, vector<int>({1,3}));
+
+    EXPECT_EQ(*child_map.find(actions[3], 3)->second, 3);
+    EXPECT_EQ(*child_map.find(actions[3], 0)->second, 3);
+    EXPECT_EQ(*child_map.find(actions[1], 100)->second, 1);
+    EXPECT_EQ(child_map.find(actions[0], 0), child_map.end());
+    EXPECT_EQ(child_map.find(actions[1]).position(), 1u);
+    EXPECT_EQ(child_map.insert_or_assign(actions[2], make_shared<int>(2)).first.position(), 2u);
+}
+
+/**
+ * Check that copies are independent
+ */
+TEST(FlatChildMap_UnitTest, copy_assignment) {
+    vector<shared_ptr<const Action>> actions = make_string_actions(20);
+    TestFlatChildMap child_map;
+    for (int i=0; i<20; i++) {
+        child_map[actions[i]] = make_shared<int>(i);
+    }
+
+    TestFlatChildMap other_map;
+    other_map[actions[0]] = make_shared<int>(-1);
+    other_map = child_map;
+    EXPECT_EQ(other_map.size(), 20u);
+    EXPECT_EQ(*other_map.at(actions[0]), 0);
+
+    other_map[actions[0]] = make_shared<int>(-1);
+    EXPECT_EQ(*child_map.at(actions[0]), 0);
+}
+
+/**
+ * Check that in a large map, the (lazily built) key index is kept up to date as slots are added after it's built, 
+ * and that copies (which rebuild their own index) and moved maps can still find keys by value
+ */
+TEST(FlatChildMap_UnitTest, lazy_key_index) {
+    int num_actions = 4 * TestFlatChildMap::small_size;
+    vector<shared_ptr<const Action>> actions = make_string_actions(num_actions + 1);
+    vector<shared_ptr<const Action>> reserved_actions(actions.begin(), actions.begin() + num_actions);
+    TestFlatChildMap child_map;
+    child_map.reserve_keys(reserved_actions);
+    for (int i=0; i<num_actions; i++) {
+        child_map.insert_or_assign(actions[i], make_shared<int>(i));
+        EXPECT_EQ(*child_map.find(actions[i], i)->second, i);
+    }
+
+    shared_ptr<const Action> equal_action = make_shared<const StringAction>("action_3");
+    EXPECT_EQ(*child_map.at(equal_action), 3);
+
+    child_map[actions[num_actions]] = make_shared<int>(num_actions);
+    shared_ptr<const Action> equal_new_action = make_shared<const StringAction>("action_" + to_string(num_actions));
+    EXPECT_EQ(*child_map.at(equal_new_action), num_actions);
+
+    TestFlatChildMap copied_map(child_map);
+    EXPECT_EQ(*copied_map.at(equal_action), 3);
+    TestFlatChildMap moved_map(std::move(child_map));
+    EXPECT_EQ(*moved_map.at(equal_new_action), num_actions);
+    EXPECT_EQ(moved_map.size(), (size_t) (num_actions + 1));
+}
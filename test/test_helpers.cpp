@@ -3,6 +3,7 @@
 #include "gmock/gmock.h"
 
 // testing
+#include "helper.h"
 #include "helper_templates.h"
 
 // includes
@@ -10,6 +11,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 
 using namespace std;
@@ -259,6 +261,31 @@ TEST(Helpers_SampleFromDistribution, error_check_too_little_mass)
 }
 
 
+/**
+ * Testing helper::sample_index_from_weights
+ * From helper.h
+ */
+TEST(Helpers_SampleIndexFromWeights, typical_sampling_with_zero_weights)
+{
+    MockThtsManager mock_manager;
+    EXPECT_CALL(mock_manager, get_rand_uniform)
+        .Times(5)
+        .WillOnce(Return(0.05))
+        .WillOnce(Return(0.45))
+        .WillOnce(Return(0.55))
+        .WillOnce(Return(0.85))
+        .WillOnce(Return(0.9999999999));
+
+    vector<double> weights = {4.0, 0.0, 1.0, 3.0, 2.0, 0.0};
+    EXPECT_EQ(helper::sample_index_from_weights(weights, mock_manager), 0);
+    EXPECT_EQ(helper::sample_index_from_weights(weights, mock_manager), 2);
+    EXPECT_EQ(helper::sample_index_from_weights(weights, mock_manager), 3);
+    EXPECT_EQ(helper::sample_index_from_weights(weights, mock_manager), 4);
+    EXPECT_EQ(helper::sample_index_from_weights(weights, mock_manager), 4);
+
+    vector<double> zero_weights = {0.0, 0.0};
+    EXPECT_ANY_THROW(helper::sample_index_from_weights(zero_weights, mock_manager));
+}
 
 /**
  * Testing herlper::vector_pretty_print_string
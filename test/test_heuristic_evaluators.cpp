@@ -0,0 +1,210 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "heuristic_evaluators.h"
+
+// includes
+#include "algorithms/uct/uct_decision_node.h"
+#include "algorithms/uct/uct_manager.h"
+#include "test/test_thts_env.h"
+#include "thts.h"
+#include "thts_types.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+using namespace thts::test;
+
+/**
+ * A heuristic evaluator for TestThtsEnv that caches the values it computes (minus the manhattan distance to the
+ * origin) in an unsynchronised map, so it's only safe to use if each thread has its own clone. Counts the clones 
+ * made, and the clones that haven't been freed yet.
+ */
+class CachingGridHeuristicEvaluator : public HeuristicEvaluator {
+    public:
+        static atomic<int> num_clones;
+        static atomic<int> num_live_clones;
+
+        bool clone_per_thread;
+        bool is_clone;
+        unordered_map<shared_ptr<const State>,double> cache;
+
+        CachingGridHeuristicEvaluator(bool clone_per_thread, bool is_clone=false) : 
+            clone_per_thread(clone_per_thread), is_clone(is_clone), cache() 
+        {
+            if (is_clone) num_live_clones++;
+        }
+
+        virtual ~CachingGridHeuristicEvaluator() {
+            if (is_clone) num_live_clones--;
+        }
+
+        virtual double evaluate(shared_ptr<const State> state, shared_ptr<ThtsEnv> env) {
+            auto iter = cache.find(state);
+            if (iter != cache.end()) return iter->second;
+            shared_ptr<const IntPairState> grid_state = static_pointer_cast<const IntPairState>(state);
+            double value = -(double) (grid_state->state.first + grid_state->state.second);
+            cache[state] = value;
+            return value;
+        }
+
+        virtual shared_ptr<HeuristicEvaluator> clone_for_thread() const {
+            if (!clone_per_thread) return nullptr;
+            num_clones++;
+            return make_shared<CachingGridHeuristicEvaluator>(true, true);
+        }
+};
+
+atomic<int> CachingGridHeuristicEvaluator::num_clones(0);
+atomic<int> CachingGridHeuristicEvaluator::num_live_clones(0);
+
+/**
+ * A prior evaluator for TestThtsEnv that holds the prior probability of each action name, and counts the number of
+ * states it has been called with (atomically, as it is shared between threads)
+ */
+class TableGridPriorEvaluator : public PriorEvaluator {
+    public:
+        unordered_map<string,double> action_probs;
+        atomic<int> num_evaluations;
+
+        TableGridPriorEvaluator() :
+            action_probs({{"left", 0.1}, {"right", 0.4}, {"up", 0.1}, {"down", 0.4}}), num_evaluations(0) {}
+
+        virtual shared_ptr<ActionPrior> evaluate(shared_ptr<const State> state, shared_ptr<ThtsEnv> env) {
+            num_evaluations++;
+            shared_ptr<ActionPrior> policy_prior = make_shared<ActionPrior>();
+            shared_ptr<ActionVector> actions = env->get_valid_actions_itfc(state);
+            for (shared_ptr<const Action> action : *actions) {
+                shared_ptr<const StringAction> string_action = static_pointer_cast<const StringAction>(action);
+                (*policy_prior)[action] = action_probs.at(string_action->action);
+            }
+            return policy_prior;
+        }
+};
+
+/**
+ * Check that the manager uses evaluator objects in preference to function pointers, and that a heuristic evaluator
+ * that can be cloned is cloned once per thread, while one that can't is shared
+ */
+TEST(HeuristicEvaluators_UnitTest, thread_clones) {
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(4);
+    shared_ptr<const State> state = make_shared<const IntPairState>(1, 2);
+
+    for (bool clone_per_thread : {true, false}) {
+        CachingGridHeuristicEvaluator::num_clones = 0;
+        UctManagerArgs manager_args(env);
+        manager_args.heuristic_evaluator = make_shared<CachingGridHeuristicEvaluator>(clone_per_thread);
+        shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+
+        EXPECT_TRUE(manager->has_heuristic_fn());
+        EXPECT_FALSE(manager->has_prior_fn());
+        EXPECT_EQ(manager->compute_heuristic_value(state), -3.0);
+        HeuristicEvaluator* main_thread_evaluator = &manager->get_heuristic_evaluator();
+        EXPECT_EQ(main_thread_evaluator, &manager->get_heuristic_evaluator());
+
+        HeuristicEvaluator* other_thread_evaluator = nullptr;
+        thread other_thread([&]() {
+            EXPECT_EQ(manager->compute_heuristic_value(state), -3.0);
+            other_thread_evaluator = &manager->get_heuristic_evaluator();
+        });
+        other_thread.join();
+
+        if (clone_per_thread) {
+            EXPECT_NE(main_thread_evaluator, other_thread_evaluator);
+            EXPECT_NE(main_thread_evaluator, manager->heuristic_evaluator.get());
+            EXPECT_EQ(CachingGridHeuristicEvaluator::num_clones, 2);
+        } else {
+            EXPECT_EQ(main_thread_evaluator, other_thread_evaluator);
+            EXPECT_EQ(main_thread_evaluator, manager->heuristic_evaluator.get());
+            EXPECT_EQ(CachingGridHeuristicEvaluator::num_clones, 0);
+        }
+    }
+}
+
+/**
+ * Check that the clones used by pool workers are released when the workers exit, so that clones don't accumulate 
+ * when the manager is used by several pools in turn
+ */
+TEST(HeuristicEvaluators_UnitTest, pool_workers_release_thread_clones) {
+    int num_threads = 4;
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(4);
+    UctManagerArgs manager_args(env);
+    manager_args.seed = 60415;
+    manager_args.heuristic_evaluator = make_shared<CachingGridHeuristicEvaluator>(true);
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    shared_ptr<UctDNode> root_node = make_shared<UctDNode>(manager, env->get_initial_state_itfc(), 0, 0);
+    int num_live_clones_before = CachingGridHeuristicEvaluator::num_live_clones;
+
+    for (int i=0; i<3; i++) {
+        {
+            ThtsPool pool(manager, root_node, num_threads);
+            pool.run_trials(200);
+            EXPECT_GT(CachingGridHeuristicEvaluator::num_live_clones, num_live_clones_before);
+        }
+        EXPECT_EQ(CachingGridHeuristicEvaluator::num_live_clones, num_live_clones_before);
+    }
+}
+
+/**
+ * Check that the default batch implementations call the single state evaluate functions
+ */
+TEST(HeuristicEvaluators_UnitTest, default_evaluate_batch) {
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(4);
+    UctManagerArgs manager_args(env);
+    manager_args.heuristic_evaluator = make_shared<CachingGridHeuristicEvaluator>(true);
+    manager_args.prior_evaluator = make_shared<TableGridPriorEvaluator>();
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+
+    vector<shared_ptr<const State>> states = {
+        make_shared<const IntPairState>(0, 0), make_shared<const IntPairState>(2, 1)};
+    vector<double> heuristic_values(states.size());
+    vector<shared_ptr<ActionPrior>> policy_priors(states.size());
+    manager->compute_heuristic_values(states, heuristic_values);
+    manager->compute_policy_priors(states, policy_priors);
+
+    EXPECT_EQ(heuristic_values[0], 0.0);
+    EXPECT_EQ(heuristic_values[1], -3.0);
+    EXPECT_EQ(policy_priors[0]->size(), 2u);
+    EXPECT_EQ(policy_priors[1]->size(), 4u);
+    EXPECT_EQ(policy_priors[1]->at(make_shared<const StringAction>("right")), 0.4);
+}
+
+/**
+ * Check running uct with multiple threads, using a heuristic evaluator (that is only safe to use with a clone per
+ * thread) and a shared prior evaluator, with and without batched evaluation
+ */
+TEST(HeuristicEvaluators_IntegrationTest, uct_with_evaluators) {
+    for (bool use_batched_evaluation : {false, true}) {
+        int num_threads = 4;
+        int num_trials = 500;
+        CachingGridHeuristicEvaluator::num_clones = 0;
+        shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(4);
+        UctManagerArgs manager_args(env);
+        manager_args.seed = 60415;
+        shared_ptr<TableGridPriorEvaluator> prior_evaluator = make_shared<TableGridPriorEvaluator>();
+        manager_args.heuristic_evaluator = make_shared<CachingGridHeuristicEvaluator>(true);
+        manager_args.prior_evaluator = prior_evaluator;
+        manager_args.use_batched_evaluation = use_batched_evaluation;
+        manager_args.evaluation_batch_size = num_threads;
+        shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+        shared_ptr<UctDNode> root_node = make_shared<UctDNode>(manager, env->get_initial_state_itfc(), 0, 0);
+        ThtsPool pool(manager, root_node, num_threads);
+        pool.run_trials(num_trials);
+
+        EXPECT_EQ(root_node->get_num_visits(), num_trials);
+        EXPECT_GT(prior_evaluator->num_evaluations, 0);
+        if (use_batched_evaluation) {
+            EXPECT_EQ(CachingGridHeuristicEvaluator::num_clones, 1);
+        } else {
+            EXPECT_GE(CachingGridHeuristicEvaluator::num_clones, 1);
+            EXPECT_LE(CachingGridHeuristicEvaluator::num_clones, num_threads + 1);
+        }
+    }
+}
@@ -0,0 +1,147 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "mc_eval.h"
+
+// includes
+#include "algorithms/uct/uct_decision_node.h"
+#include "algorithms/uct/uct_manager.h"
+#include "test/test_thts_env.h"
+#include "thts.h"
+#include "thts_types.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+using namespace thts::test;
+
+/**
+ * Helpers to compute the mean and (sample) variance of a list of values with two passes
+ */
+double two_pass_mean(const vector<double>& values) {
+    double sum = 0.0;
+    for (double val : values) sum += val;
+    return sum / values.size();
+}
+
+double two_pass_variance(const vector<double>& values) {
+    double mean = two_pass_mean(values);
+    double sum_squares = 0.0;
+    for (double val : values) sum_squares += (val - mean) * (val - mean);
+    return sum_squares / (values.size() - 1.0);
+}
+
+/**
+ * Check that the streaming statistics match the two pass computation, including after merging accumulators
+ */
+TEST(MCEval_ReturnAccumulator, add_and_merge) {
+    vector<double> values = {1.0, -2.5, 3.0, 7.25, 0.0, -4.0, 2.0};
+    ReturnAccumulator all_stats;
+    ReturnAccumulator first_stats;
+    ReturnAccumulator second_stats;
+    for (size_t i=0; i<values.size(); i++) {
+        all_stats.add(values[i]);
+        if (i < 3) {
+            first_stats.add(values[i]);
+        } else {
+            second_stats.add(values[i]);
+        }
+    }
+    first_stats.merge(second_stats);
+    first_stats.merge(ReturnAccumulator());
+
+    EXPECT_EQ(all_stats.num_samples, 7);
+    EXPECT_NEAR(all_stats.mean, two_pass_mean(values), 1e-12);
+    EXPECT_NEAR(all_stats.get_variance(), two_pass_variance(values), 1e-12);
+    EXPECT_EQ(first_stats.num_samples, 7);
+    EXPECT_NEAR(first_stats.mean, two_pass_mean(values), 1e-12);
+    EXPECT_NEAR(first_stats.get_variance(), two_pass_variance(values), 1e-12);
+    EXPECT_EQ(ReturnAccumulator().get_variance(), 0.0);
+}
+
+/**
+ * Runs some uct trials on a TestThtsEnv to get a tree to evaluate. Only a few trials are run, so the evaluated policy 
+ * quickly leaves the tree and acts randomly (so that the returns have a non-zero variance).
+ */
+shared_ptr<UctDNode> make_eval_tree(shared_ptr<ThtsEnv> env, shared_ptr<UctManager>& manager) {
+    UctManagerArgs manager_args(env);
+    manager_args.seed = 60415;
+    manager = make_shared<UctManager>(manager_args);
+    shared_ptr<UctDNode> root_node = make_shared<UctDNode>(manager, env->get_initial_state_itfc(), 0, 0);
+    ThtsPool pool(manager, root_node, 1);
+    pool.run_trials(10);
+    return root_node;
+}
+
+/**
+ * Check that the mean and stddev are computed correctly (the stddev was previously the variance), and that trials
+ * are cut off at the max trial length
+ */
+TEST(MCEval_Evaluator, run_rollouts) {
+    int max_trial_length = 10;
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(5);
+    shared_ptr<UctManager> manager;
+    shared_ptr<UctDNode> root_node = make_eval_tree(env, manager);
+
+    EvalPolicy policy(root_node, env, *manager);
+    MCEvaluator evaluator(env, policy, max_trial_length, *manager);
+    evaluator.run_rollouts(500, 4);
+    evaluator.run_rollouts(500, 4);
+
+    const vector<double>& returns = evaluator.get_sampled_returns();
+    EXPECT_EQ(evaluator.get_num_rollouts(), 1000);
+    EXPECT_EQ(returns.size(), 1000u);
+    for (double sample_return : returns) {
+        EXPECT_GE(sample_return, -max_trial_length);
+    }
+    EXPECT_NEAR(evaluator.get_mean_return(), two_pass_mean(returns), 1e-9);
+    EXPECT_NEAR(evaluator.get_stddev_return(), sqrt(two_pass_variance(returns)), 1e-9);
+    EXPECT_NEAR(
+        evaluator.get_confidence_interval_width(),
+        2.0 * 1.96 * sqrt(two_pass_variance(returns) / 1000.0),
+        1e-9);
+}
+
+/**
+ * Check that returns aren't stored if 'store_sampled_returns' is false
+ */
+TEST(MCEval_Evaluator, without_storing_returns) {
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(3);
+    shared_ptr<UctManager> manager;
+    shared_ptr<UctDNode> root_node = make_eval_tree(env, manager);
+
+    EvalPolicy policy(root_node, env, *manager);
+    MCEvaluator evaluator(env, policy, 20, *manager, false);
+    evaluator.run_rollouts(200, 2);
+
+    EXPECT_EQ(evaluator.get_num_rollouts(), 200);
+    EXPECT_TRUE(evaluator.get_sampled_returns().empty());
+    EXPECT_LT(evaluator.get_mean_return(), 0.0);
+    EXPECT_GT(evaluator.get_stddev_return(), 0.0);
+}
+
+/**
+ * Check that rollouts stop early once the confidence interval is narrow enough
+ */
+TEST(MCEval_Evaluator, run_rollouts_until_confident) {
+    int max_num_rollouts = 1000000;
+    int min_num_rollouts = MCEvaluator::min_num_rollouts_default;
+    double target_width = 0.5;
+    shared_ptr<ThtsEnv> env = make_shared<TestThtsEnv>(3);
+    shared_ptr<UctManager> manager;
+    shared_ptr<UctDNode> root_node = make_eval_tree(env, manager);
+
+    EvalPolicy policy(root_node, env, *manager);
+    MCEvaluator evaluator(env, policy, 20, *manager, false);
+    evaluator.run_rollouts_until_confident(max_num_rollouts, 4, target_width);
+
+    EXPECT_GT(evaluator.get_stddev_return(), 0.0);
+    EXPECT_GE(evaluator.get_num_rollouts(), min_num_rollouts);
+    EXPECT_LT(evaluator.get_num_rollouts(), max_num_rollouts);
+    EXPECT_LE(evaluator.get_confidence_interval_width(), target_width);
+}
@@ -0,0 +1,141 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "memoizing_thts_env.h"
+#include "sharded_cache.h"
+
+// includes
+#include "algorithms/uct/uct_decision_node.h"
+#include "algorithms/uct/uct_manager.h"
+#include "test/test_thts_env.h"
+#include "thts.h"
+#include "thts_types.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+using namespace thts::test;
+
+/**
+ * Check that values are found after being inserted, the first value inserted for a key is kept, and the size of the
+ * cache is bounded
+ */
+TEST(ShardedCache_UnitTest, insert_find_and_evict) {
+    ShardedCache<int,int> cache(4, 8);
+    int value;
+    EXPECT_FALSE(cache.find(1, value));
+    EXPECT_EQ(cache.insert(1, 10), 10);
+    EXPECT_EQ(cache.insert(1, 20), 10);
+    EXPECT_TRUE(cache.find(1, value));
+    EXPECT_EQ(value, 10);
+
+    for (int i=0; i<100; i++) cache.insert(i, i);
+    EXPECT_LE(cache.size(), 8u);
+    EXPECT_TRUE(cache.find(99, value));
+    EXPECT_EQ(value, 99);
+
+    CacheStats stats = cache.get_stats();
+    EXPECT_EQ(stats.num_hits, 2u);
+    EXPECT_EQ(stats.num_misses, 1u);
+    EXPECT_DOUBLE_EQ(stats.get_hit_rate(), 2.0 / 3.0);
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+/**
+ * Check that repeated calls (with equal, but not identical, states) are served from the cache, and return the same
+ * shared objects
+ */
+TEST(MemoizingThtsEnv_UnitTest, memoizes_by_value) {
+    shared_ptr<CountingTestThtsEnv> counting_env = make_shared<CountingTestThtsEnv>(3);
+    MemoizingThtsEnv env(counting_env);
+
+    shared_ptr<const State> state = make_shared<const IntPairState>(1, 1);
+    shared_ptr<const State> equal_state = make_shared<const IntPairState>(1, 1);
+    shared_ptr<const Action> action = make_shared<const StringAction>("right");
+
+    shared_ptr<ActionVector> actions = env.get_valid_actions_itfc(state);
+    EXPECT_EQ(env.get_valid_actions_itfc(equal_state), actions);
+    EXPECT_EQ(actions->size(), 4u);
+    EXPECT_EQ(counting_env->num_valid_actions_calls, 1);
+
+    shared_ptr<StateDistr> distr = env.get_transition_distribution_itfc(state, action);
+    EXPECT_EQ(env.get_transition_distribution_itfc(equal_state, make_shared<const StringAction>("right")), distr);
+    EXPECT_NE(env.get_transition_distribution_itfc(state, make_shared<const StringAction>("left")), distr);
+    EXPECT_EQ(counting_env->num_transition_distribution_calls, 2);
+
+    EXPECT_FALSE(env.is_sink_state_itfc(state));
+    EXPECT_FALSE(env.is_sink_state_itfc(equal_state));
+    EXPECT_TRUE(env.is_sink_state_itfc(make_shared<const IntPairState>(3, 3)));
+    EXPECT_EQ(counting_env->num_is_sink_state_calls, 2);
+
+    shared_ptr<const Observation> observation = make_shared<const IntPairState>(2, 1);
+    EXPECT_EQ(env.get_reward_itfc(state, action, observation), -1.0);
+    EXPECT_EQ(env.get_reward_itfc(equal_state, action, make_shared<const IntPairState>(2, 1)), -1.0);
+    EXPECT_EQ(env.get_reward_itfc(state, action), -1.0);
+    EXPECT_EQ(env.get_reward_itfc(state, action), -1.0);
+    EXPECT_EQ(counting_env->num_reward_calls, 2);
+
+    CacheStats stats = env.get_valid_actions_cache_stats();
+    EXPECT_EQ(stats.num_hits, 1u);
+    EXPECT_EQ(stats.num_misses, 1u);
+    EXPECT_EQ(stats.size, 1u);
+    EXPECT_EQ(env.get_reward_cache_stats().num_hits, 2u);
+
+    env.clear_caches();
+    env.get_valid_actions_itfc(state);
+    EXPECT_EQ(counting_env->num_valid_actions_calls, 2);
+}
+
+/**
+ * Check that rewards are always forwarded when not caching rewards, and that the caches are bounded
+ */
+TEST(MemoizingThtsEnv_UnitTest, options) {
+    shared_ptr<CountingTestThtsEnv> counting_env = make_shared<CountingTestThtsEnv>(10);
+    MemoizingThtsEnv env(counting_env, false, 16, 4);
+
+    shared_ptr<const State> state = make_shared<const IntPairState>(1, 1);
+    shared_ptr<const Action> action = make_shared<const StringAction>("right");
+    env.get_reward_itfc(state, action);
+    env.get_reward_itfc(state, action);
+    EXPECT_EQ(counting_env->num_reward_calls, 2);
+    EXPECT_EQ(env.get_reward_cache_stats().size, 0u);
+
+    for (int x=0; x<=10; x++) {
+        for (int y=0; y<=10; y++) {
+            env.get_valid_actions_itfc(make_shared<const IntPairState>(x, y));
+        }
+    }
+    EXPECT_LE(env.get_valid_actions_cache_stats().size, 16u);
+}
+
+/**
+ * Check running uct with multiple threads on the memoizing env, which should call the wrapped env far less often
+ * than the tree calls the memoizing env. (There are 25 states, and at most each of the 4 threads can miss the cache
+ * for each state.)
+ */
+TEST(MemoizingThtsEnv_IntegrationTest, uct_with_memoizing_env) {
+    int num_trials = 1000;
+    shared_ptr<CountingTestThtsEnv> counting_env = make_shared<CountingTestThtsEnv>(4);
+    shared_ptr<MemoizingThtsEnv> env = make_shared<MemoizingThtsEnv>(counting_env);
+    UctManagerArgs manager_args(env);
+    manager_args.seed = 60415;
+    manager_args.mcts_mode = false;
+    manager_args.max_depth = 8;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    shared_ptr<UctDNode> root_node = make_shared<UctDNode>(manager, env->get_initial_state_itfc(), 0, 0);
+    ThtsPool pool(manager, root_node, 4);
+    pool.run_trials(num_trials);
+
+    EXPECT_EQ(root_node->get_num_visits(), num_trials);
+    CacheStats reward_stats = env->get_reward_cache_stats();
+    EXPECT_EQ((size_t) counting_env->num_reward_calls, reward_stats.num_misses);
+    EXPECT_GT(reward_stats.get_hit_rate(), 0.9);
+    EXPECT_LE(counting_env->num_valid_actions_calls, 4 * 25);
+}
@@ -0,0 +1,255 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "node_arena.h"
+
+// includes
+#include "algorithms/uct/uct_decision_node.h"
+#include "algorithms/uct/uct_manager.h"
+#include "test/test_thts_env.h"
+#include "thts.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+using namespace thts::test;
+
+/**
+ * Check that allocations are aligned and don't overlap, and that freed blocks are reused
+ */
+TEST(NodeArena_UnitTest, allocate_and_reuse) {
+    NodeArena node_arena(1024);
+    void* block_a = node_arena.allocate(40);
+    void* block_b = node_arena.allocate(40);
+    EXPECT_EQ((uintptr_t) block_a % NodeArena::alignment, 0u);
+    EXPECT_EQ((uintptr_t) block_b % NodeArena::alignment, 0u);
+    EXPECT_GE((char*) block_b - (char*) block_a, 40);
+    EXPECT_EQ(node_arena.get_num_slabs(), 1);
+
+    node_arena.deallocate(block_a, 40);
+    EXPECT_EQ(node_arena.allocate(40), block_a);
+    EXPECT_EQ(node_arena.get_num_slabs(), 1);
+
+    node_arena.deallocate(block_a, 40);
+    node_arena.deallocate(block_b, 40);
+    EXPECT_EQ(node_arena.get_num_bytes_in_use(), 0u);
+}
+
+/**
+ * Check that new slabs are allocated when full, and that large allocations get their own slab
+ */
+TEST(NodeArena_UnitTest, new_slabs) {
+    NodeArena node_arena(1024);
+    for (int i=0; i<64; i++) {
+        node_arena.allocate(16);
+    }
+    EXPECT_EQ(node_arena.get_num_slabs(), 1);
+    node_arena.allocate(16);
+    EXPECT_EQ(node_arena.get_num_slabs(), 2);
+    node_arena.allocate(4096);
+    EXPECT_EQ(node_arena.get_num_slabs(), 3);
+}
+
+/**
+ * Check that threads allocating concurrently are given distinct blocks
+ */
+TEST(NodeArena_UnitTest, concurrent_allocation) {
+    int num_threads = 8;
+    int num_allocations = 10000;
+    NodeArena node_arena(1024);
+
+    vector<vector<void*>> thread_blocks(num_threads);
+    vector<thread> threads;
+    for (int i=0; i<num_threads; i++) {
+        threads.push_back(thread([&,i]() {
+            for (int j=0; j<num_allocations; j++) {
+                thread_blocks[i].push_back(node_arena.allocate(48));
+            }
+        }));
+    }
+    for (thread& t : threads) t.join();
+
+    unordered_set<void*> all_blocks;
+    for (vector<void*>& blocks : thread_blocks) {
+        all_blocks.insert(blocks.begin(), blocks.end());
+    }
+    EXPECT_EQ(all_blocks.size(), (size_t) (num_threads * num_allocations));
+}
+
+/**
+ * Check that a search tree can be allocated in the manager's arena, that nodes keep the arena alive after the manager 
+ * is freed, and that all memory is returned to the arena when the tree is freed
+ */
+TEST(NodeArena_IntegrationTest, uct_tree_in_arena) {
+    shared_ptr<ThtsEnv> grid_env = make_shared<TestThtsEnv>(2);
+    UctManagerArgs manager_args(grid_env);
+    manager_args.seed = 60415;
+    manager_args.max_depth = 8;
+    manager_args.mcts_mode = false;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    shared_ptr<NodeArena> node_arena = manager->node_arena;
+    ASSERT_NE(node_arena, nullptr);
+
+    shared_ptr<UctDNode> root_node = manager->make_node<UctDNode>(manager, grid_env->get_initial_state_itfc(), 0, 0);
+    {
+        ThtsPool uct_pool(manager, root_node, 4);
+        uct_pool.run_trials(2000);
+    }
+    EXPECT_EQ(root_node->get_num_visits(), 2000);
+    EXPECT_GT(node_arena->get_num_bytes_in_use(), 0u);
+
+    manager.reset();
+    EXPECT_FALSE(root_node->get_pretty_print_string(2).empty());
+
+    root_node.reset();
+    EXPECT_EQ(node_arena->get_num_bytes_in_use(), 0u);
+}
+
+/**
+ * Check that blocks freed by another thread are moved to the shared free lists in batches, and reused by a thread 
+ * whose slab is full before it allocates a new slab
+ */
+TEST(NodeArena_UnitTest, reuse_blocks_freed_by_other_threads) {
+    NodeArena node_arena(16 * NodeArena::free_batch_size);
+    vector<void*> blocks;
+    for (size_t i=0; i<NodeArena::free_batch_size; i++) {
+        blocks.push_back(node_arena.allocate(16));
+    }
+    EXPECT_EQ(node_arena.get_num_slabs(), 1);
+
+    thread freeing_thread([&]() {
+        for (void* block : blocks) node_arena.deallocate(block, 16);
+    });
+    freeing_thread.join();
+
+    unordered_set<void*> freed_blocks(blocks.begin(), blocks.end());
+    for (size_t i=0; i<NodeArena::free_batch_size; i++) {
+        EXPECT_EQ(freed_blocks.count(node_arena.allocate(16)), 1u);
+    }
+    EXPECT_EQ(node_arena.get_num_slabs(), 1);
+}
+
+/**
+ * Check that blocks freed in a retired arena are not reused
+ */
+TEST(NodeArena_UnitTest, retired_arena) {
+    NodeArena node_arena(1024);
+    void* block = node_arena.allocate(40);
+    node_arena.retire();
+    EXPECT_TRUE(node_arena.is_retired());
+    node_arena.deallocate(block, 40);
+    EXPECT_EQ(node_arena.get_num_bytes_in_use(), 0u);
+    EXPECT_NE(node_arena.allocate(40), block);
+}
+
+/**
+ * Check that a retired arena releases the slabs without live blocks when it's retired, and releases each other slab as 
+ * soon as its last block is freed
+ */
+TEST(NodeArena_UnitTest, retired_arena_releases_slabs) {
+    NodeArena node_arena(1024);
+    vector<void*> blocks;
+    for (int i=0; i<3*64; i++) {
+        blocks.push_back(node_arena.allocate(16));
+    }
+    EXPECT_EQ(node_arena.get_num_slabs(), 3);
+
+    // free all of the first slab, and all but one block of the second slab
+    for (int i=0; i<2*64-1; i++) {
+        node_arena.deallocate(blocks[i], 16);
+    }
+    node_arena.retire();
+    EXPECT_EQ(node_arena.get_num_slabs(), 2);
+
+    node_arena.deallocate(blocks[2*64-1], 16);
+    EXPECT_EQ(node_arena.get_num_slabs(), 1);
+    for (int i=2*64; i<3*64-1; i++) {
+        node_arena.deallocate(blocks[i], 16);
+    }
+    EXPECT_EQ(node_arena.get_num_slabs(), 1);
+    node_arena.deallocate(blocks[3*64-1], 16);
+    EXPECT_EQ(node_arena.get_num_slabs(), 0);
+    EXPECT_EQ(node_arena.get_num_bytes_in_use(), 0u);
+}
+
+/**
+ * Check that large blocks are released as soon as they're freed
+ */
+TEST(NodeArena_UnitTest, large_blocks_released) {
+    NodeArena node_arena(1024);
+    void* block = node_arena.allocate(4096);
+    EXPECT_EQ(node_arena.get_num_slabs(), 1);
+    EXPECT_EQ(node_arena.get_num_bytes_in_use(), 4096u);
+    node_arena.deallocate(block, 4096);
+    EXPECT_EQ(node_arena.get_num_slabs(), 0);
+    EXPECT_EQ(node_arena.get_num_bytes_in_use(), 0u);
+}
+
+/**
+ * Check that advancing the root starts a new arena, and that the old arena is freed once all of the nodes allocated 
+ * in it have been freed
+ */
+TEST(NodeArena_IntegrationTest, advance_root_starts_new_arena) {
+    shared_ptr<TestThtsEnv> grid_env = make_shared<TestThtsEnv>(3);
+    UctManagerArgs manager_args(grid_env);
+    manager_args.seed = 60415;
+    manager_args.max_depth = 12;
+    manager_args.mcts_mode = false;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    weak_ptr<NodeArena> old_node_arena = manager->node_arena;
+
+    shared_ptr<ThtsDNode> root_node = manager->make_node<UctDNode>(manager, grid_env->get_initial_state_itfc(), 0, 0);
+    unique_ptr<ThtsPool> uct_pool = make_unique<ThtsPool>(manager, root_node, 2);
+    root_node.reset();
+    uct_pool->run_trials(1000);
+
+    shared_ptr<const Action> action = make_shared<const StringAction>("right");
+    shared_ptr<const State> observation = make_shared<const IntPairState>(1,0);
+    shared_ptr<ThtsDNode> new_root_node = uct_pool->advance_root(action, observation);
+    ASSERT_NE(new_root_node, nullptr);
+    EXPECT_NE(manager->node_arena, old_node_arena.lock());
+    EXPECT_TRUE(old_node_arena.lock()->is_retired());
+    EXPECT_FALSE(manager->node_arena->is_retired());
+
+    uct_pool->run_trials(1000);
+    EXPECT_GT(manager->node_arena->get_num_bytes_in_use(), 0u);
+
+    uct_pool.reset();
+    EXPECT_FALSE(old_node_arena.expired());
+    new_root_node.reset();
+    EXPECT_TRUE(old_node_arena.expired());
+}
+
+/**
+ * Check that setting a new root with the same manager starts a new arena, and that the old tree's slabs are released 
+ * when it's freed
+ */
+TEST(NodeArena_IntegrationTest, set_new_env_starts_new_arena) {
+    shared_ptr<TestThtsEnv> grid_env = make_shared<TestThtsEnv>(3);
+    UctManagerArgs manager_args(grid_env);
+    manager_args.seed = 60415;
+    manager_args.max_depth = 12;
+    manager_args.mcts_mode = false;
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    shared_ptr<NodeArena> old_node_arena = manager->node_arena;
+
+    shared_ptr<ThtsDNode> root_node = manager->make_node<UctDNode>(manager, grid_env->get_initial_state_itfc(), 0, 0);
+    ThtsPool uct_pool(manager, root_node, 2);
+    root_node.reset();
+    uct_pool.run_trials(1000);
+    EXPECT_GT(old_node_arena->get_num_slabs(), 0);
+
+    shared_ptr<ThtsDNode> new_root_node = make_shared<UctDNode>(manager, grid_env->get_initial_state_itfc(), 0, 0);
+    uct_pool.set_new_env(manager, new_root_node);
+    EXPECT_TRUE(old_node_arena->is_retired());
+    EXPECT_NE(manager->node_arena, old_node_arena);
+    EXPECT_EQ(old_node_arena->get_num_slabs(), 0);
+    EXPECT_EQ(old_node_arena->get_num_bytes_in_use(), 0u);
+}
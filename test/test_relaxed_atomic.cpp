@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "relaxed_atomic.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+
+/**
+ * Check that RelaxedAtomic can be used like the plain value it wraps
+ */
+TEST(RelaxedAtomic_Operators, behaves_like_value) {
+    RelaxedAtomic<int> count;
+    EXPECT_EQ(count, 0);
+    EXPECT_EQ(count++, 0);
+    EXPECT_EQ(++count, 2);
+    count += 3;
+    EXPECT_EQ(count, 5);
+    count -= 1;
+    EXPECT_EQ(count--, 4);
+    EXPECT_EQ(--count, 2);
+
+    RelaxedAtomic<double> avg(1.0);
+    avg += (4.0 - avg) / 3.0;
+    EXPECT_DOUBLE_EQ(avg, 2.0);
+    avg *= 2.0;
+    avg /= 8.0;
+    EXPECT_DOUBLE_EQ(avg.load(), 0.5);
+
+    RelaxedAtomic<double> other(avg);
+    EXPECT_DOUBLE_EQ(other, 0.5);
+    other = 3.0;
+    avg = other;
+    EXPECT_DOUBLE_EQ(avg, 3.0);
+}
+
+/**
+ * Check that a reader thread can read values while a single writer updates them, and only ever observes values that
+ * were written (i.e. it never reads a torn value)
+ */
+TEST(RelaxedAtomic_Concurrency, single_writer_many_readers) {
+    int num_writes = 100000;
+    int num_readers = 4;
+    RelaxedAtomic<double> value(0.0);
+    atomic<bool> writer_done(false);
+
+    vector<thread> readers;
+    vector<int> all_valid(num_readers, 0);
+    for (int i=0; i<num_readers; i++) {
+        readers.push_back(thread([&,i]() {
+            bool valid = true;
+            double last_read = 0.0;
+            while (!writer_done.load()) {
+                double read = value;
+                double integral_part = (double) (long long) read;
+                valid = valid && read == integral_part && read >= last_read && read <= num_writes;
+                last_read = read;
+            }
+            all_valid[i] = valid ? 1 : 0;
+        }));
+    }
+
+    for (int i=0; i<num_writes; i++) {
+        value += 1.0;
+    }
+    writer_done.store(true);
+    for (thread& t : readers) t.join();
+
+    EXPECT_DOUBLE_EQ(value, (double) num_writes);
+    for (int i=0; i<num_readers; i++) {
+        EXPECT_EQ(all_valid[i], 1);
+    }
+}
@@ -21,6 +21,7 @@ using ::testing::Return;
 using ::testing::_;
 using ::testing::IsEmpty;
 using ::testing::ElementsAre;
+using ::testing::Property;
 
 
 /**
@@ -123,6 +124,83 @@ TEST(ThtsPool_TestThreadPool, test_run_trials) {
     EXPECT_FALSE(mock_pool.work_left());
 }
 
+/**
+ * Test that the correct number of trials is run when trials are claimed in chunks by many threads, and that repeated 
+ * calls to 'run_trials' each run the correct number of trials.
+ */
+TEST(ThtsPool_TestThreadPool, test_run_trials_lock_free_chunked_dispatch) {
+    int num_trials = 1000;
+    int num_runs = 3;
+
+    shared_ptr<ThtsEnv> dummy_env = make_shared<TestThtsEnv>(2);
+    ThtsManagerArgs manager_args(dummy_env);
+    shared_ptr<ThtsManager> dummy_manager = make_shared<ThtsManager>(manager_args);
+    shared_ptr<const IntPairState> dummy_init_state = ((TestThtsEnv&) *dummy_env).get_initial_state();
+    shared_ptr<ThtsDNode> dummy_root_node = make_shared<TestThtsDNode>(dummy_manager,dummy_init_state,0,0);
+    int num_threads = 8;
+    bool use_lock_free_dispatch = true;
+    int max_trial_chunk_size = 16;
+
+    MockThtsPool_PoolTesting mock_pool(
+        dummy_manager, dummy_root_node, num_threads, use_lock_free_dispatch, max_trial_chunk_size);
+    EXPECT_CALL(mock_pool, run_thts_trial)
+        .Times(num_trials * num_runs);
+
+    for (int i=0; i<num_runs; i++) {
+        mock_pool.run_trials(num_trials);
+        EXPECT_FALSE(mock_pool.work_left());
+    }
+}
+
+/**
+ * Test that the correct number of trials is run when using the (locking) dispatch mode.
+ */
+TEST(ThtsPool_TestThreadPool, test_run_trials_locked_dispatch) {
+    int num_trials = 100;
+
+    shared_ptr<ThtsEnv> dummy_env = make_shared<TestThtsEnv>(2);
+    ThtsManagerArgs manager_args(dummy_env);
+    shared_ptr<ThtsManager> dummy_manager = make_shared<ThtsManager>(manager_args);
+    shared_ptr<const IntPairState> dummy_init_state = ((TestThtsEnv&) *dummy_env).get_initial_state();
+    shared_ptr<ThtsDNode> dummy_root_node = make_shared<TestThtsDNode>(dummy_manager,dummy_init_state,0,0);
+    int num_threads = 4;
+    bool use_lock_free_dispatch = false;
+
+    MockThtsPool_PoolTesting mock_pool(dummy_manager, dummy_root_node, num_threads, use_lock_free_dispatch);
+    EXPECT_CALL(mock_pool, run_thts_trial)
+        .Times(num_trials);
+
+    mock_pool.run_trials(num_trials);
+
+    EXPECT_FALSE(mock_pool.work_left());
+}
+
+/**
+ * Test that a time limited call to 'run_trials' stops at (approximately) the deadline when trials are dispatched 
+ * lock free.
+ */
+TEST(ThtsPool_TestThreadPool, test_run_trials_time_limit) {
+    int run_trial_duration_ms = 10;
+
+    shared_ptr<ThtsEnv> dummy_env = make_shared<TestThtsEnv>(2);
+    ThtsManagerArgs manager_args(dummy_env);
+    shared_ptr<ThtsManager> dummy_manager = make_shared<ThtsManager>(manager_args);
+    shared_ptr<const IntPairState> dummy_init_state = ((TestThtsEnv&) *dummy_env).get_initial_state();
+    shared_ptr<ThtsDNode> dummy_root_node = make_shared<TestThtsDNode>(dummy_manager,dummy_init_state,0,0);
+    int num_threads = 2;
+
+    MockThtsPool_DurationTrialPoolTesting mock_pool(run_trial_duration_ms, dummy_manager, dummy_root_node, num_threads);
+
+    double max_time = 0.1;
+    chrono::time_point<chrono::steady_clock> start_time = chrono::steady_clock::now();
+    mock_pool.run_trials(numeric_limits<int>::max(), max_time);
+    chrono::duration<double> trials_duration = chrono::steady_clock::now() - start_time;
+
+    EXPECT_GE(trials_duration, 100ms);
+    EXPECT_LE(trials_duration, 500ms);
+    EXPECT_FALSE(mock_pool.work_left());
+}
+
 /**
  * Test that a non-blocking call to run trials is non-blocking. 
  */
@@ -634,4 +712,47 @@ TEST(ThtsPool_TestRunTrial, test_backup_phase) {
     shared_ptr<ThtsEnvContext> context = env_ptr->sample_context_itfc(nullptr);
 
     thts_pool.run_backup_phase(nodes_to_backup, rewards, *context);
-}
\ No newline at end of file
+}
+
+/**
+ * Test that the RewardsView's passed to backups in the backup phase have the sums of the rewards they view, and that 
+ * 'nodes_to_backup' is emptied, so that it can be reused by the next trial
+ */
+TEST(ThtsPool_TestRunTrial, test_backup_phase_rewards_view_sums) {
+    shared_ptr<MockTestThtsEnv> mock_env_ptr = make_shared<MockTestThtsEnv>(2);
+    shared_ptr<ThtsEnv> env_ptr = static_pointer_cast<ThtsEnv>(mock_env_ptr);
+    ThtsManagerArgs manager_args(env_ptr);
+    shared_ptr<ThtsManager> manager_ptr = make_shared<ThtsManager>(manager_args);
+    shared_ptr<const IntPairState> mock_init_state = mock_env_ptr->get_initial_state();
+    shared_ptr<MockThtsDNode> dnode0 = make_shared<MockThtsDNode>(manager_ptr,mock_init_state,0,0);
+    shared_ptr<MockThtsCNode> cnode0 = make_shared<MockThtsCNode>(manager_ptr,mock_init_state,nullptr,0,0);
+    shared_ptr<MockThtsDNode> dnode1 = make_shared<MockThtsDNode>(manager_ptr,mock_init_state,0,0);
+    shared_ptr<MockThtsCNode> cnode1 = make_shared<MockThtsCNode>(manager_ptr,mock_init_state,nullptr,0,0);
+
+    int num_threads = 0;
+    MockPublicThtsPool thts_pool(manager_ptr, static_pointer_cast<ThtsDNode>(dnode0), num_threads);
+
+    EXPECT_CALL(*dnode0, backup_itfc(
+            Property(&RewardsView::sum, 0.0),Property(&RewardsView::sum, 7.0),7.0,7.0,_))
+        .Times(1);
+    EXPECT_CALL(*cnode0, backup_itfc(
+            Property(&RewardsView::sum, 0.0),Property(&RewardsView::sum, 7.0),7.0,7.0,_))
+        .Times(1);
+    EXPECT_CALL(*dnode1, backup_itfc(
+            Property(&RewardsView::sum, 1.0),Property(&RewardsView::sum, 6.0),6.0,7.0,_))
+        .Times(1);
+    EXPECT_CALL(*cnode1, backup_itfc(
+            Property(&RewardsView::sum, 1.0),Property(&RewardsView::sum, 6.0),6.0,7.0,_))
+        .Times(1);
+
+    vector<pair<shared_ptr<ThtsDNode>,shared_ptr<ThtsCNode>>> nodes_to_backup;
+    nodes_to_backup.push_back(make_pair(dnode0, cnode0));
+    nodes_to_backup.push_back(make_pair(dnode1, cnode1));
+
+    vector<double> rewards = {1.0, 2.0, 4.0};
+    shared_ptr<ThtsEnvContext> context = env_ptr->sample_context_itfc(nullptr);
+
+    thts_pool.run_backup_phase(nodes_to_backup, rewards, *context);
+    EXPECT_TRUE(nodes_to_backup.empty());
+    EXPECT_THAT(rewards, ElementsAre(1.0, 2.0, 4.0));
+}
@@ -24,20 +24,30 @@ namespace thts::test {
             MockThtsPool_PoolTesting(
                 shared_ptr<ThtsManager> thts_manager, 
                 shared_ptr<ThtsDNode> root_node, 
-                int num_threads=1) :
-                    ThtsPool(thts_manager, root_node, num_threads)  {};
+                int num_threads=1,
+                bool use_lock_free_dispatch=true,
+                int max_trial_chunk_size=16) :
+                    ThtsPool(
+                        thts_manager, 
+                        root_node, 
+                        num_threads, 
+                        nullptr, 
+                        use_lock_free_dispatch, 
+                        max_trial_chunk_size)  {};
 
             MOCK_METHOD(void, run_thts_trial, (int), (override));
 
-            // Setup for being able to test 'work_left'
+            // Setup for being able to test 'work_left' (start_time converted from the system clock to steady clock)
             void mock_work_left_scenario(
                 int trials_remaining,
                 chrono::time_point<chrono::system_clock> start_time,
                 chrono::duration<double> max_run_time) 
             {
+                chrono::duration<double> time_since_start = chrono::system_clock::now() - start_time;
+                chrono::time_point<chrono::steady_clock> steady_start_time = 
+                    chrono::steady_clock::now() - chrono::duration_cast<chrono::steady_clock::duration>(time_since_start);
                 this->trials_remaining = trials_remaining;
-                this->start_time = start_time;
-                this->max_run_time = max_run_time;
+                set_run_time_limits(steady_start_time, max_run_time);
             }
     };
 
@@ -138,12 +148,12 @@ namespace thts::test {
             MOCK_METHOD(
                 void, 
                 backup_itfc, 
-                (const vector<double>&,const vector<double>&,const double,const double,ThtsEnvContext&), 
+                (const RewardsView&,const RewardsView&,const double,const double,ThtsEnvContext&), 
                 (override));
             MOCK_METHOD(
                 shared_ptr<ThtsCNode>, 
                 get_child_node_itfc, 
-                (shared_ptr<const Action>),
+                (const shared_ptr<const Action>&),
                 (const, override));
             MOCK_METHOD(int, get_num_children, (), (const, override));
 
@@ -169,14 +179,25 @@ namespace thts::test {
             MOCK_METHOD(
                 void, 
                 backup_itfc, 
-                (const vector<double>&,const vector<double>&,const double,const double,ThtsEnvContext&), 
+                (const RewardsView&,const RewardsView&,const double,const double,ThtsEnvContext&), 
                 (override));
             MOCK_METHOD(
                 shared_ptr<ThtsDNode>, 
                 get_child_node_itfc, 
-                (shared_ptr<const Observation>),
+                (const shared_ptr<const Observation>&),
                 (const, override));
             MOCK_METHOD(int, get_num_children, (), (const, override));
+
+            /**
+             * Mock nodes don't store their children, so look up the child through the mocked 'get_child_node_itfc', 
+             * and get the reward from the env
+             */
+            shared_ptr<ThtsDNode> get_child_node_and_reward(
+                const shared_ptr<const Observation>& observation, double& reward) const override 
+            {
+                reward = thts_manager->thts_env->get_reward_itfc(state, action, observation);
+                return get_child_node_itfc(observation);
+            }
     };
 
     /**
@@ -206,7 +227,7 @@ namespace thts::test {
                 int num_threads=1) :
                     PublicThtsPool(thts_manager, root_node, num_threads) {};
 
-            MOCK_METHOD(bool, should_continue_selection_phase, (shared_ptr<ThtsDNode>,bool), (override));
+            MOCK_METHOD(bool, should_continue_selection_phase, (const shared_ptr<ThtsDNode>&,bool), (override));
     };
 }
 
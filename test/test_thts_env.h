@@ -6,8 +6,10 @@
 
 #include "test_thts_manager.h"
 
+#include <atomic>
 #include <cstdlib>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -209,6 +211,68 @@ namespace thts::test{
             }
     };
 
+    /**
+     * A TestThtsEnv that can only be used as a generative model, throwing if its transition distributions are 
+     * enumerated. Used to test 'use_generative_model'.
+     */
+    class GenerativeTestThtsEnv : public TestThtsEnv {
+        public:
+            GenerativeTestThtsEnv(int grid_size, double stay_prob=0.0) : TestThtsEnv(grid_size, stay_prob) {}
+
+            virtual ~GenerativeTestThtsEnv() = default;
+
+            virtual shared_ptr<StateDistr> get_transition_distribution_itfc(
+                shared_ptr<const State> state, shared_ptr<const Action> action) const 
+            {
+                throw runtime_error("GenerativeTestThtsEnv cannot enumerate transition distributions");
+            }
+    };
+
+    /**
+     * A TestThtsEnv that counts the number of calls to the (deterministic) functions that can be cached. Used to test
+     * MemoizingThtsEnv and the caching done by nodes
+     */
+    class CountingTestThtsEnv : public TestThtsEnv {
+        public:
+            mutable atomic<int> num_is_sink_state_calls;
+            mutable atomic<int> num_valid_actions_calls;
+            mutable atomic<int> num_transition_distribution_calls;
+            mutable atomic<int> num_reward_calls;
+
+            CountingTestThtsEnv(int grid_size) :
+                TestThtsEnv(grid_size),
+                num_is_sink_state_calls(0),
+                num_valid_actions_calls(0),
+                num_transition_distribution_calls(0),
+                num_reward_calls(0) {}
+
+            virtual bool is_sink_state_itfc(shared_ptr<const State> state) const {
+                num_is_sink_state_calls++;
+                return TestThtsEnv::is_sink_state_itfc(state);
+            }
+
+            virtual shared_ptr<ActionVector> get_valid_actions_itfc(shared_ptr<const State> state) const {
+                num_valid_actions_calls++;
+                return TestThtsEnv::get_valid_actions_itfc(state);
+            }
+
+            virtual shared_ptr<StateDistr> get_transition_distribution_itfc(
+                shared_ptr<const State> state, shared_ptr<const Action> action) const
+            {
+                num_transition_distribution_calls++;
+                return TestThtsEnv::get_transition_distribution_itfc(state, action);
+            }
+
+            virtual double get_reward_itfc(
+                shared_ptr<const State> state,
+                shared_ptr<const Action> action,
+                shared_ptr<const Observation> observation=nullptr) const
+            {
+                num_reward_calls++;
+                return TestThtsEnv::get_reward_itfc(state, action, observation);
+            }
+    };
+
 
 
     /** 
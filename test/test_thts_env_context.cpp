@@ -6,11 +6,15 @@
 #include "thts_env_context.h"
 
 // includes
+#include "test_thts_env.h"
+
 #include <string>
+#include <vector>
 
 
 using namespace std;
 using namespace thts;
+using namespace thts::test;
 
 /**
  * Testing herlper::get_max_key_break_ties_randomly
@@ -32,3 +36,98 @@ TEST(EnvContext_CheckIsMapWithoutDefaults, test_missing_key)
     context.put_value("World!", make_shared<double>(2.5));
     EXPECT_ANY_THROW(context.get_value_raw("NotInContext"));
 }
+
+/**
+ * Test putting and getting values from slots, and that registering the same name gives the same slot
+ */
+TEST(EnvContext_Slots, test_normal_use)
+{
+    ThtsEnvContextSlot<double> slot = ThtsEnvContext::register_slot<double>("test_slot_double");
+    ThtsEnvContextSlot<double> same_slot = ThtsEnvContext::register_slot<double>("test_slot_double");
+    ThtsEnvContextSlot<const int> other_slot = ThtsEnvContext::register_slot<const int>("test_slot_const_int");
+    EXPECT_TRUE(slot.is_valid());
+    EXPECT_FALSE(ThtsEnvContextSlot<double>().is_valid());
+
+    ThtsEnvContext context;
+    EXPECT_EQ(context.get_value_ptr(slot), nullptr);
+    context.put_value(slot, make_shared<double>(2.5));
+    context.put_value(other_slot, make_shared<const int>(3));
+    EXPECT_EQ(*context.get_value_ptr(same_slot), 2.5);
+    EXPECT_EQ(*context.get_value_ptr(other_slot), 3);
+
+    context.erase(slot);
+    EXPECT_EQ(context.get_value_ptr(slot), nullptr);
+    EXPECT_EQ(*context.get_value_ptr(other_slot), 3);
+}
+
+/**
+ * Test registering a slot name with a different type throws
+ */
+TEST(EnvContext_Slots, test_type_mismatch_throws)
+{
+    ThtsEnvContext::register_slot<double>("test_slot_type_mismatch");
+    EXPECT_ANY_THROW(ThtsEnvContext::register_slot<int>("test_slot_type_mismatch"));
+}
+
+/**
+ * Test that clear removes values from both the maps and slots
+ */
+TEST(EnvContext_Slots, test_clear)
+{
+    ThtsEnvContextSlot<double> slot = ThtsEnvContext::register_slot<double>("test_slot_clear");
+    ThtsEnvContext context;
+    context.put_value("Hello,", make_shared<double>(1.0));
+    context.put_value(slot, make_shared<double>(2.0));
+    context.clear();
+    EXPECT_ANY_THROW(context.get_value_raw("Hello,"));
+    EXPECT_EQ(context.get_value_ptr(slot), nullptr);
+}
+
+/**
+ * Test that inline slot values can be written in place, are unset by clear, and that their storage (and the memory 
+ * the value owns) is reused after clearing
+ */
+TEST(EnvContext_Slots, test_inline_values)
+{
+    ThtsEnvContextSlot<vector<double>> slot = ThtsEnvContext::register_slot<vector<double>>("test_slot_inline");
+    ThtsEnvContext context;
+    EXPECT_EQ(context.get_inline_value_ptr(slot), nullptr);
+
+    vector<double>& value = context.emplace_inline_value(slot);
+    value.assign(16, 1.5);
+    const double* value_data = value.data();
+    ASSERT_NE(context.get_inline_value_ptr(slot), nullptr);
+    EXPECT_EQ(context.get_inline_value_ptr(slot)->at(15), 1.5);
+
+    context.clear();
+    EXPECT_EQ(context.get_inline_value_ptr(slot), nullptr);
+    vector<double>& reused_value = context.emplace_inline_value(slot);
+    EXPECT_EQ(&reused_value, &value);
+    reused_value.assign(8, 2.0);
+    EXPECT_EQ(reused_value.data(), value_data);
+
+    context.erase(slot);
+    EXPECT_EQ(context.get_inline_value_ptr(slot), nullptr);
+}
+
+/**
+ * Test that the default 'sample_context_itfc' recycles contexts that are no longer in use (clearing them), but 
+ * doesn't return a context that is still in use
+ */
+TEST(EnvContext_Pooling, test_contexts_recycled)
+{
+    TestThtsEnv env(2);
+    ThtsEnvContext* first_context_raw_ptr;
+    {
+        shared_ptr<ThtsEnvContext> context = env.sample_context_itfc(nullptr);
+        context->put_value("Hello,", make_shared<double>(1.0));
+        first_context_raw_ptr = context.get();
+    }
+
+    shared_ptr<ThtsEnvContext> recycled_context = env.sample_context_itfc(nullptr);
+    EXPECT_EQ(recycled_context.get(), first_context_raw_ptr);
+    EXPECT_ANY_THROW(recycled_context->get_value_raw("Hello,"));
+
+    shared_ptr<ThtsEnvContext> nested_context = env.sample_context_itfc(nullptr);
+    EXPECT_NE(nested_context.get(), recycled_context.get());
+}
@@ -0,0 +1,137 @@
+#include "test_thts_manager.h"
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "thts_manager.h"
+
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+using namespace thts::test;
+
+/**
+ * Helper to sample a sequence of random integers from a RandManager
+ */
+vector<int> sample_rand_ints(RandManager& rand_manager, int num_samples) {
+    vector<int> samples;
+    for (int i=0; i<num_samples; i++) {
+        samples.push_back(rand_manager.get_rand_int(0,RAND_MAX));
+    }
+    return samples;
+}
+
+/**
+ * Helper to sample a sequence of random integers from a RandStream
+ */
+vector<int> sample_rand_ints(RandStream& rand_stream, int num_samples) {
+    vector<int> samples;
+    for (int i=0; i<num_samples; i++) {
+        samples.push_back(rand_stream.int_distr(rand_stream.int_gen) % RAND_MAX);
+    }
+    return samples;
+}
+
+/**
+ * Check that (single threaded) random number generation is reproducible for a fixed seed, and differs across seeds
+ */
+TEST(RandManager_ThreadLocalRng, reproducible_from_seed) {
+    int num_samples = 100;
+    RandManager rand_manager_a(42);
+    RandManager rand_manager_b(42);
+    RandManager rand_manager_c(43);
+
+    vector<int> samples_a = sample_rand_ints(rand_manager_a, num_samples);
+    vector<int> samples_b = sample_rand_ints(rand_manager_b, num_samples);
+    vector<int> samples_c = sample_rand_ints(rand_manager_c, num_samples);
+
+    EXPECT_EQ(samples_a, samples_b);
+    EXPECT_NE(samples_a, samples_c);
+
+    for (int i=0; i<num_samples; i++) {
+        double uniform_a = rand_manager_a.get_rand_uniform();
+        double uniform_b = rand_manager_b.get_rand_uniform();
+        EXPECT_EQ(uniform_a, uniform_b);
+        EXPECT_GE(uniform_a, 0.0);
+        EXPECT_LT(uniform_a, 1.0);
+    }
+}
+
+/**
+ * Check that threads are given their own stream, with the stream ids given in the order that threads first use the
+ * RandManager
+ */
+TEST(RandManager_ThreadLocalRng, threads_get_split_streams) {
+    int num_samples = 100;
+    int seed = 42;
+    RandManager rand_manager(seed);
+
+    vector<int> main_thread_samples = sample_rand_ints(rand_manager, num_samples);
+    vector<int> other_thread_samples;
+    thread other_thread([&]() { other_thread_samples = sample_rand_ints(rand_manager, num_samples); });
+    other_thread.join();
+
+    RandStream stream_zero(seed, 0);
+    RandStream stream_one(seed, 1);
+    EXPECT_EQ(main_thread_samples, sample_rand_ints(stream_zero, num_samples));
+    EXPECT_EQ(other_thread_samples, sample_rand_ints(stream_one, num_samples));
+    EXPECT_NE(main_thread_samples, other_thread_samples);
+
+    // main thread continues its stream
+    EXPECT_EQ(sample_rand_ints(rand_manager, num_samples), sample_rand_ints(stream_zero, num_samples));
+}
+
+/**
+ * Check that many threads can use the same RandManager concurrently
+ */
+TEST(RandManager_ThreadLocalRng, concurrent_use) {
+    int num_threads = 8;
+    int num_samples = 10000;
+    RandManager rand_manager(42);
+
+    vector<thread> threads;
+    vector<int> all_in_range(num_threads, 0);
+    for (int i=0; i<num_threads; i++) {
+        threads.push_back(thread([&,i]() {
+            bool in_range = true;
+            for (int j=0; j<num_samples; j++) {
+                int rand_int = rand_manager.get_rand_int(-5,5);
+                double rand_uniform = rand_manager.get_rand_uniform();
+                in_range = in_range && -5 <= rand_int && rand_int < 5 && 0.0 <= rand_uniform && rand_uniform < 1.0;
+            }
+            all_in_range[i] = in_range ? 1 : 0;
+        }));
+    }
+    for (thread& t : threads) t.join();
+
+    for (int i=0; i<num_threads; i++) {
+        EXPECT_EQ(all_in_range[i], 1);
+    }
+}
+
+/**
+ * Check that the mutex protected compatibility mode produces the same numbers as a single generator seeded with seed
+ */
+TEST(RandManager_MutexRng, compatibility_mode) {
+    int num_samples = 100;
+    int seed = 42;
+    bool use_thread_local_rng = false;
+    RandManager rand_manager(seed, use_thread_local_rng);
+
+    mt19937 int_gen(seed);
+    uniform_int_distribution<int> int_distr(0,RAND_MAX);
+    for (int i=0; i<num_samples; i++) {
+        EXPECT_EQ(rand_manager.get_rand_int(0,RAND_MAX), int_distr(int_gen) % RAND_MAX);
+    }
+
+    mt19937 real_gen(seed);
+    uniform_real_distribution<double> real_distr(0.0,1.0);
+    for (int i=0; i<num_samples; i++) {
+        EXPECT_EQ(rand_manager.get_rand_uniform(), real_distr(real_gen));
+    }
+}
@@ -33,8 +33,8 @@ namespace thts::test{
             shared_ptr<const Action> recommend_action_itfc(ThtsEnvContext& ctx) const { return nullptr; }
 
             void backup_itfc(
-                    const vector<double>& trial_rewards_before_node, 
-                    const vector<double>& trial_rewards_after_node, 
+                    const RewardsView& trial_rewards_before_node, 
+                    const RewardsView& trial_rewards_after_node, 
                     const double trial_cumulative_return_after_node, 
                     const double trial_cumulative_return,
                     ThtsEnvContext& ctx) {}
@@ -47,7 +47,7 @@ namespace thts::test{
             int get_decision_timestep() const { return decision_timestep; }
         
         protected:
-            shared_ptr<ThtsCNode> create_child_node_helper_itfc(shared_ptr<const Action> action) const { 
+            shared_ptr<ThtsCNode> create_child_node_helper_itfc(const shared_ptr<const Action>& action) const { 
                 shared_ptr<TestThtsCNode> new_child_ptr = make_shared<TestThtsCNode>(
                     thts_manager,state,action,decision_depth,decision_timestep);
                 return static_pointer_cast<ThtsCNode>(new_child_ptr); 
@@ -74,8 +74,8 @@ namespace thts::test{
             shared_ptr<const Observation> sample_observation_itfc(ThtsEnvContext& ctx) { return nullptr; }
 
             void backup_itfc(
-                    const vector<double>& trial_rewards_before_node, 
-                    const vector<double>& trial_rewards_after_node, 
+                    const RewardsView& trial_rewards_before_node, 
+                    const RewardsView& trial_rewards_after_node, 
                     const double trial_cumulative_return_after_node, 
                     const double trial_cumulative_return,
                     ThtsEnvContext& ctx) {}
@@ -93,7 +93,8 @@ namespace thts::test{
 
         protected:
             shared_ptr<ThtsDNode> create_child_node_helper_itfc(
-                shared_ptr<const Observation> observation, shared_ptr<const State> next_state=nullptr) const 
+                const shared_ptr<const Observation>& observation, 
+                const shared_ptr<const State>& next_state=nullptr) const 
             { 
                 shared_ptr<const State> mdp_next_state = compute_next_state_from_observation_itfc(observation);
                 shared_ptr<TestThtsDNode> new_child_ptr = make_shared<TestThtsDNode>(
@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "thts_root_parallel.h"
+
+// includes
+#include "algorithms/uct/uct_decision_node.h"
+#include "algorithms/uct/uct_manager.h"
+#include "test/test_thts_env.h"
+#include "thts.h"
+#include "thts_types.h"
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+using namespace thts::test;
+
+/**
+ * Check that the pool derives a distinct random number stream for each tree, even when the managers have the same 
+ * seed, and that the first tree uses the same stream as a manager that isn't part of a root parallel search
+ */
+TEST(ThtsRootParallel_UnitTest, per_tree_rand_streams) {
+    int num_trees = 3;
+    int num_samples = 16;
+    shared_ptr<ThtsEnv> grid_env = make_shared<TestThtsEnv>(2);
+    UctManagerArgs manager_args(grid_env);
+    manager_args.seed = 60415;
+    vector<shared_ptr<ThtsManager>> managers;
+    vector<shared_ptr<ThtsDNode>> root_nodes;
+    for (int i=0; i<num_trees; i++) {
+        shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+        managers.push_back(manager);
+        root_nodes.push_back(make_shared<UctDNode>(manager, grid_env->get_initial_state_itfc(), 0, 0));
+    }
+    ThtsRootParallelPool root_parallel_pool(managers, root_nodes);
+    UctManager single_tree_manager(manager_args);
+
+    vector<vector<int>> samples(num_trees);
+    vector<int> single_tree_samples;
+    for (int j=0; j<num_samples; j++) {
+        for (int i=0; i<num_trees; i++) {
+            samples[i].push_back(managers[i]->get_rand_int(0, 1 << 30));
+        }
+        single_tree_samples.push_back(single_tree_manager.get_rand_int(0, 1 << 30));
+    }
+    EXPECT_EQ(samples[0], single_tree_samples);
+    EXPECT_NE(samples[0], samples[1]);
+    EXPECT_NE(samples[0], samples[2]);
+    EXPECT_NE(samples[1], samples[2]);
+}
+
+/**
+ * Run root parallel uct over a number of independent trees, and check that the merged root 
+ * statistics account for all of the trials and that a valid action is recommended
+ */
+void run_uct_root_parallel_integration_test(int env_size, int num_trees, int num_trials) {
+    shared_ptr<ThtsEnv> grid_env = make_shared<TestThtsEnv>(env_size);
+    vector<shared_ptr<ThtsManager>> managers;
+    vector<shared_ptr<ThtsDNode>> root_nodes;
+    vector<shared_ptr<UctDNode>> uct_root_nodes;
+    for (int i=0; i<num_trees; i++) {
+        UctManagerArgs manager_args(grid_env);
+        manager_args.seed = 60415;
+        manager_args.max_depth = env_size * 4;
+        manager_args.mcts_mode = false;
+        shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+        shared_ptr<UctDNode> root_node = make_shared<UctDNode>(manager, grid_env->get_initial_state_itfc(), 0, 0);
+        managers.push_back(manager);
+        root_nodes.push_back(root_node);
+        uct_root_nodes.push_back(root_node);
+    }
+
+    ThtsRootParallelPool root_parallel_pool(managers, root_nodes);
+    root_parallel_pool.run_trials(num_trials);
+
+    int total_root_visits = 0;
+    for (shared_ptr<UctDNode> root_node : uct_root_nodes) {
+        total_root_visits += root_node->get_num_visits();
+    }
+    EXPECT_EQ(total_root_visits, num_trials);
+
+    ChildRecommendationStatsMap merged_child_stats;
+    root_parallel_pool.fill_merged_child_recommendation_stats(merged_child_stats);
+    int total_child_visits = 0;
+    for (pair<const shared_ptr<const Action>,ChildRecommendationStats>& pr : merged_child_stats) {
+        total_child_visits += pr.second.num_visits;
+    }
+    EXPECT_EQ(total_child_visits, num_trials);
+
+    shared_ptr<const Action> recommended_action = root_parallel_pool.recommend_action();
+    shared_ptr<ActionVector> root_actions = grid_env->get_valid_actions_itfc(grid_env->get_initial_state_itfc());
+    bool recommended_action_valid = false;
+    for (shared_ptr<const Action> action : *root_actions) {
+        if (*action == *recommended_action) recommended_action_valid = true;
+    }
+    EXPECT_TRUE(recommended_action_valid);
+}
+
+TEST(ThtsRootParallel_IntegrationTest, easy_grid_world_uct) {
+    run_uct_root_parallel_integration_test(2,4,10001);
+}
+
+TEST(ThtsRootParallel_UnitTest, requires_distinct_managers) {
+    shared_ptr<ThtsEnv> grid_env = make_shared<TestThtsEnv>(2);
+    UctManagerArgs manager_args(grid_env);
+    shared_ptr<UctManager> manager = make_shared<UctManager>(manager_args);
+    vector<shared_ptr<ThtsManager>> managers = {manager, manager};
+    vector<shared_ptr<ThtsDNode>> root_nodes = {
+        make_shared<UctDNode>(manager, grid_env->get_initial_state_itfc(), 0, 0),
+        make_shared<UctDNode>(manager, grid_env->get_initial_state_itfc(), 0, 0)};
+    EXPECT_THROW(ThtsRootParallelPool(managers, root_nodes), runtime_error);
+}
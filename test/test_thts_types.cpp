@@ -0,0 +1,147 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "thts_types.h"
+
+#include "helper_templates.h"
+
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+
+namespace thts::test {
+    /**
+     * State that counts calls to hash and equals_itfc, and optionally caches its hash
+     */
+    class CountingState : public State {
+        public:
+            int state;
+            mutable int num_hash_calls;
+            mutable int num_equals_calls;
+
+            CountingState(int state, bool cache_hash) : state(state), num_hash_calls(0), num_equals_calls(0) {
+                if (cache_hash) enable_hash_caching();
+            }
+
+            virtual size_t hash() const {
+                num_hash_calls++;
+                return std::hash<int>()(state);
+            }
+
+            virtual bool equals_itfc(const Observation& other) const {
+                num_equals_calls++;
+                const CountingState* oth = dynamic_cast<const CountingState*>(&other);
+                return oth != nullptr && state == oth->state;
+            }
+    };
+}
+
+using namespace thts::test;
+
+/**
+ * Check that a state with hash caching enabled only computes its hash once, and one without computes it every time
+ */
+TEST(ThtsTypes_CachedHash, hash_computed_once) {
+    shared_ptr<const State> cached_state = make_shared<const CountingState>(1, true);
+    shared_ptr<const State> uncached_state = make_shared<const CountingState>(1, false);
+    const CountingState& cached = (const CountingState&) *cached_state;
+    const CountingState& uncached = (const CountingState&) *uncached_state;
+
+    for (int i=0; i<5; i++) {
+        EXPECT_EQ(hash<shared_ptr<const State>>()(cached_state), std::hash<int>()(1));
+        EXPECT_EQ(hash<shared_ptr<const State>>()(uncached_state), std::hash<int>()(1));
+    }
+    EXPECT_EQ(cached.num_hash_calls, 1);
+    EXPECT_EQ(uncached.num_hash_calls, 5);
+}
+
+/**
+ * Check that equality returns false without calling equals_itfc when cached hashes differ, and still calls
+ * equals_itfc when they match (as different objects can have the same hash)
+ */
+TEST(ThtsTypes_CachedHash, equality_short_circuits_on_hash_mismatch) {
+    shared_ptr<const State> state_one = make_shared<const CountingState>(1, true);
+    shared_ptr<const State> state_two = make_shared<const CountingState>(2, true);
+    shared_ptr<const State> other_state_one = make_shared<const CountingState>(1, true);
+    const CountingState& one = (const CountingState&) *state_one;
+
+    // hashes not computed yet, so have to call equals_itfc
+    EXPECT_FALSE(state_one == state_two);
+    EXPECT_EQ(one.num_equals_calls, 1);
+
+    hash<shared_ptr<const State>>()(state_one);
+    hash<shared_ptr<const State>>()(state_two);
+    hash<shared_ptr<const State>>()(other_state_one);
+    EXPECT_FALSE(state_one == state_two);
+    EXPECT_FALSE(equal_to<shared_ptr<const State>>()(state_one, state_two));
+    EXPECT_EQ(one.num_equals_calls, 1);
+
+    EXPECT_TRUE(state_one == other_state_one);
+    EXPECT_EQ(one.num_equals_calls, 2);
+    EXPECT_TRUE(state_one == state_one);
+    EXPECT_EQ(one.num_equals_calls, 2);
+}
+
+/**
+ * Check that the provided types can be modified after construction and before hashing, that copies don't copy the
+ * cached hash, and that they work as keys in maps
+ */
+TEST(ThtsTypes_CachedHash, provided_types_cache_hash) {
+    shared_ptr<IntPairState> state = make_shared<IntPairState>(0,0);
+    state->state.first += 3;
+    shared_ptr<const Observation> obsv = state;
+    size_t expected_hash = helper::hash_combine(helper::hash_combine(0, 3), 0);
+    EXPECT_EQ(hash<shared_ptr<const Observation>>()(obsv), expected_hash);
+    EXPECT_EQ(obsv->get_hash(), expected_hash);
+
+    IntPairState copy(*state);
+    copy.state.second = 5;
+    EXPECT_EQ(copy.get_hash(), copy.hash());
+    EXPECT_NE(copy.get_hash(), expected_hash);
+
+    unordered_map<shared_ptr<const Action>,int> action_map;
+    action_map[make_shared<const StringAction>("a")] = 1;
+    action_map[make_shared<const IntAction>(1)] = 2;
+    EXPECT_EQ(action_map[make_shared<const StringAction>("a")], 1);
+    EXPECT_EQ(action_map[make_shared<const IntAction>(1)], 2);
+    EXPECT_EQ(action_map.size(), 2u);
+
+    shared_ptr<const State> tuple_state = make_shared<const Int3TupleState>(1,2,3);
+    EXPECT_EQ(tuple_state->get_hash(), tuple_state->hash());
+    shared_ptr<const State> equal_tuple_state = make_shared<const Int3TupleState>(1,2,3);
+    EXPECT_TRUE(tuple_state == equal_tuple_state);
+}
+
+/**
+ * Check that many threads hashing the same object concurrently all get the right hash
+ */
+TEST(ThtsTypes_CachedHash, concurrent_hashing) {
+    int num_threads = 8;
+    vector<shared_ptr<const State>> states;
+    for (int i=0; i<1000; i++) {
+        states.push_back(make_shared<const IntPairState>(i,-i));
+    }
+
+    vector<int> all_correct(num_threads, 0);
+    vector<thread> threads;
+    for (int t=0; t<num_threads; t++) {
+        threads.push_back(thread([&,t]() {
+            bool correct = true;
+            for (shared_ptr<const State>& state : states) {
+                correct = correct && hash<shared_ptr<const State>>()(state) == state->hash();
+            }
+            all_correct[t] = correct ? 1 : 0;
+        }));
+    }
+    for (thread& th : threads) th.join();
+
+    for (int t=0; t<num_threads; t++) {
+        EXPECT_EQ(all_correct[t], 1);
+    }
+}
@@ -0,0 +1,158 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+// testing
+#include "transposition_table.h"
+
+// includes
+#include "algorithms/uct/uct_decision_node.h"
+#include "algorithms/uct/uct_manager.h"
+#include "test/test_thts_env.h"
+#include "thts_types.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+using namespace thts;
+using namespace thts::test;
+
+/**
+ * Helper to make a (uct) decision node to put in a transposition table
+ */
+shared_ptr<ThtsDNode> make_tt_test_node(shared_ptr<UctManager> manager) {
+    return make_shared<UctDNode>(manager, manager->thts_env->get_initial_state_itfc(), 0, 0);
+}
+
+/**
+ * Helper to make a UctManager for transposition table tests
+ */
+shared_ptr<UctManager> make_tt_test_manager() {
+    shared_ptr<ThtsEnv> grid_env = make_shared<TestThtsEnv>(3);
+    UctManagerArgs manager_args(grid_env);
+    manager_args.seed = 60415;
+    return make_shared<UctManager>(manager_args);
+}
+
+/**
+ * Helper to insert a node for a key
+ */
+shared_ptr<ThtsDNode> tt_insert(
+    TranspositionTable& table, int timestep, shared_ptr<const Observation> obsv, shared_ptr<ThtsDNode> node)
+{
+    return table.insert(TranspositionTable::compute_hash(timestep, obsv), timestep, obsv, node);
+}
+
+/**
+ * Helper to find the node for a key
+ */
+shared_ptr<ThtsDNode> tt_find(TranspositionTable& table, int timestep, shared_ptr<const Observation> obsv) {
+    return table.find(TranspositionTable::compute_hash(timestep, obsv), timestep, obsv);
+}
+
+/**
+ * Check the hash matches std::hash<DNodeIdTuple>, and basic insert and find (keys are compared by value)
+ */
+TEST(TranspositionTable_UnitTest, insert_and_find) {
+    shared_ptr<UctManager> manager = make_tt_test_manager();
+    TranspositionTable table(4);
+    shared_ptr<const Observation> obsv = make_shared<const IntPairState>(1,2);
+    shared_ptr<const Observation> equal_obsv = make_shared<const IntPairState>(1,2);
+    EXPECT_EQ(TranspositionTable::compute_hash(3, obsv), hash<DNodeIdTuple>()(make_tuple(3, obsv)));
+
+    EXPECT_EQ(tt_find(table, 0, obsv), nullptr);
+    shared_ptr<ThtsDNode> node = make_tt_test_node(manager);
+    EXPECT_EQ(tt_insert(table, 0, obsv, node), node);
+    EXPECT_EQ(tt_find(table, 0, equal_obsv), node);
+    EXPECT_EQ(tt_find(table, 1, obsv), nullptr);
+
+    // inserting a key that is already in the table returns the existing node
+    shared_ptr<ThtsDNode> other_node = make_tt_test_node(manager);
+    EXPECT_EQ(tt_insert(table, 0, equal_obsv, other_node), node);
+    EXPECT_EQ(tt_insert(table, 1, obsv, other_node), other_node);
+    EXPECT_EQ(table.size(), 2u);
+
+    table.erase_up_to_timestep(0);
+    EXPECT_EQ(tt_find(table, 0, obsv), nullptr);
+    EXPECT_EQ(tt_find(table, 1, obsv), other_node);
+    EXPECT_EQ(table.size(), 1u);
+
+    table.clear();
+    EXPECT_EQ(table.size(), 0u);
+}
+
+/**
+ * Check that entries for freed nodes are treated as missing, are cleaned up, and that the table doesn't grow when
+ * nodes are repeatedly freed and reinserted
+ */
+TEST(TranspositionTable_UnitTest, expired_entries_cleaned_up) {
+    shared_ptr<UctManager> manager = make_tt_test_manager();
+    TranspositionTable table(1);
+    shared_ptr<const Observation> obsv = make_shared<const IntPairState>(0,0);
+
+    shared_ptr<ThtsDNode> node = make_tt_test_node(manager);
+    tt_insert(table, 0, obsv, node);
+    node.reset();
+    EXPECT_EQ(tt_find(table, 0, obsv), nullptr);
+    EXPECT_EQ(table.size(), 0u);
+
+    shared_ptr<ThtsDNode> new_node = make_tt_test_node(manager);
+    EXPECT_EQ(tt_insert(table, 0, obsv, new_node), new_node);
+
+    for (int i=0; i<1000; i++) {
+        shared_ptr<ThtsDNode> temp_node = make_tt_test_node(manager);
+        tt_insert(table, i+1, obsv, temp_node);
+    }
+    EXPECT_LE(table.get_capacity(), 4 * TranspositionTable::initial_segment_capacity);
+    EXPECT_EQ(tt_find(table, 0, obsv), new_node);
+}
+
+/**
+ * Check that the table respects its max size, replacing entries with the fewest visits
+ */
+TEST(TranspositionTable_UnitTest, max_size_replacement) {
+    shared_ptr<UctManager> manager = make_tt_test_manager();
+    size_t max_size = 8;
+    TranspositionTable table(1, max_size);
+
+    vector<shared_ptr<ThtsDNode>> nodes;
+    for (int i=0; i<100; i++) {
+        nodes.push_back(make_tt_test_node(manager));
+        shared_ptr<const Observation> obsv = make_shared<const IntPairState>(i,0);
+        EXPECT_EQ(tt_insert(table, 0, obsv, nodes.back()), nodes.back());
+        EXPECT_LE(table.size(), max_size);
+        EXPECT_EQ(tt_find(table, 0, obsv), nodes.back());
+    }
+    EXPECT_EQ(table.size(), max_size);
+}
+
+/**
+ * Check that when many threads insert the same keys concurrently, they all get the same node for each key
+ */
+TEST(TranspositionTable_Concurrency, concurrent_inserts_agree) {
+    shared_ptr<UctManager> manager = make_tt_test_manager();
+    TranspositionTable table(4);
+    int num_threads = 8;
+    int num_keys = 200;
+
+    vector<vector<shared_ptr<ThtsDNode>>> thread_nodes(num_threads);
+    vector<thread> threads;
+    for (int t=0; t<num_threads; t++) {
+        threads.push_back(thread([&,t]() {
+            for (int i=0; i<num_keys; i++) {
+                shared_ptr<const Observation> obsv = make_shared<const IntPairState>(i,i);
+                shared_ptr<ThtsDNode> node = tt_find(table, 0, obsv);
+                if (node == nullptr) node = tt_insert(table, 0, obsv, make_tt_test_node(manager));
+                thread_nodes[t].push_back(node);
+            }
+        }));
+    }
+    for (thread& th : threads) th.join();
+
+    EXPECT_EQ(table.size(), (size_t) num_keys);
+    for (int t=1; t<num_threads; t++) {
+        EXPECT_EQ(thread_nodes[t], thread_nodes[0]);
+    }
+}